@@ -0,0 +1,145 @@
+﻿#pragma execution_character_set("utf-8")
+
+#include "pch.h"
+#include "CacheRecordIndex.h"
+#include <algorithm>
+
+static_assert(sizeof(CacheRecord) == 24, "CacheRecord must stay 24 bytes");
+static_assert(CacheRecordIndex::SEGMENT_SIZE % sizeof(CacheRecord) == 0, "index records must not straddle segments");
+
+CacheRecordIndex::CacheRecordIndex()
+	: m_store(SEGMENT_SIZE), m_startTime(0)
+{
+}
+
+bool CacheRecordIndex::Open(const std::wstring& basePath)
+{
+	if (!m_store.Open(basePath))
+	{
+		return false;
+	}
+
+	m_startClock = std::chrono::steady_clock::now();
+	m_startTime = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count());
+	return true;
+}
+
+void CacheRecordIndex::Close()
+{
+	m_store.Close();
+	m_startTime = 0;
+}
+
+bool CacheRecordIndex::Append(uint64_t offset, uint32_t length, CacheDirection direction, uint16_t sourcePort)
+{
+	CacheRecord record = {};
+	record.offset = offset;
+	record.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - m_startClock).count());
+	record.length = length;
+	record.direction = static_cast<uint8_t>(direction);
+	record.sourcePort = sourcePort;
+
+	// 段大小是记录大小的整数倍，一条记录总是整体写入同一段
+	return m_store.Append(reinterpret_cast<const uint8_t*>(&record), sizeof(record));
+}
+
+bool CacheRecordIndex::GetRecord(uint64_t index, CacheRecord& record) const
+{
+	CacheView view;
+	const CacheRecord* found = PeekRecord(index, view);
+	if (!found)
+	{
+		return false;
+	}
+	record = *found;
+	return true;
+}
+
+uint64_t CacheRecordIndex::FindByTime(uint64_t timestamp) const
+{
+	return FindFirst([timestamp](const CacheRecord& record) { return record.timestamp < timestamp; });
+}
+
+uint64_t CacheRecordIndex::FindByOffset(uint64_t offset) const
+{
+	// 找最后一条起始偏移不大于offset的记录，再确认offset落在其数据范围内
+	const uint64_t count = GetCount();
+	uint64_t after = FindFirst([offset](const CacheRecord& record) { return record.offset <= offset; });
+	if (after == 0 || after > count)
+	{
+		return count;
+	}
+
+	CacheView view;
+	const CacheRecord* record = PeekRecord(after - 1, view);
+	if (record && offset < record->offset + record->length)
+	{
+		return after - 1;
+	}
+	return count;
+}
+
+uint64_t CacheRecordIndex::ToTimestamp(uint64_t unixMicroseconds) const
+{
+	return unixMicroseconds > m_startTime ? unixMicroseconds - m_startTime : 0;
+}
+
+template <typename Before>
+uint64_t CacheRecordIndex::FindFirst(Before before) const
+{
+	const uint64_t count = GetCount();
+	const uint64_t perSegment = SEGMENT_SIZE / sizeof(CacheRecord);
+
+	// 先按各段首条记录二分确定所在段，段内再对同一视图直接二分，避免每次比较都取视图
+	uint64_t low = 0;
+	uint64_t high = (count + perSegment - 1) / perSegment;
+	while (low < high)
+	{
+		uint64_t middle = low + (high - low) / 2;
+		CacheView view;
+		const CacheRecord* record = PeekRecord(middle * perSegment, view);
+		if (!record)
+		{
+			return count;
+		}
+
+		if (before(*record))
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	if (low == 0)
+	{
+		return 0;
+	}
+
+	// 结果位于第low-1段（该段全部早于目标时为下一段首条，即段末）
+	const uint64_t first = (low - 1) * perSegment;
+	const uint64_t last = (std::min)(low * perSegment, count);
+	CacheView view = m_store.ReadView(first * sizeof(CacheRecord), static_cast<size_t>((last - first) * sizeof(CacheRecord)));
+	if (view.GetSize() != (last - first) * sizeof(CacheRecord))
+	{
+		return count;
+	}
+
+	const CacheRecord* records = reinterpret_cast<const CacheRecord*>(view.Data());
+	const CacheRecord* found = std::partition_point(records, records + (last - first), before);
+	return first + static_cast<uint64_t>(found - records);
+}
+
+const CacheRecord* CacheRecordIndex::PeekRecord(uint64_t index, CacheView& view) const
+{
+	view = m_store.ReadView(index * sizeof(CacheRecord), sizeof(CacheRecord));
+	if (view.GetSize() != sizeof(CacheRecord))
+	{
+		return nullptr;
+	}
+	return reinterpret_cast<const CacheRecord*>(view.Data());
+}
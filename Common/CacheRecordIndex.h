@@ -0,0 +1,75 @@
+﻿#pragma once
+#pragma execution_character_set("utf-8")
+
+#include <cstdint>
+#include <string>
+#include <chrono>
+#include "SegmentedCacheStore.h"
+
+// 缓存记录方向
+enum class CacheDirection : uint8_t
+{
+	Receive = 0,  // 接收
+	Send = 1      // 发送
+};
+
+// 缓存记录：每次追加对应一条，定长24字节
+struct CacheRecord
+{
+	uint64_t offset;      // 数据在缓存中的起始偏移
+	uint64_t timestamp;   // 单调时间戳（微秒，自索引打开起计）
+	uint32_t length;      // 数据长度（字节）
+	uint8_t direction;    // CacheDirection
+	uint8_t reserved;
+	uint16_t sourcePort;  // 来源端口标识（串口号或网络端口，0表示未知）
+};
+
+// 缓存记录索引（旁路索引）：按追加顺序把CacheRecord写入独立的映射段文件
+// - 第n条记录位于n*sizeof(CacheRecord)，按序号读取O(1)
+// - 偏移与时间戳均单调不减，按时间、按数据偏移查找为二分查找，O(log n)
+// - 索引本身由SegmentedCacheStore保存，进程内存占用不随记录数增长（1亿条约2.4GB，驻留由系统页缓存管理）
+// Append为单写者接口，多个追加者需由调用方串行化；查询可在任意线程并发调用。
+class CacheRecordIndex
+{
+public:
+	static const size_t SEGMENT_SIZE = 24 * 1024 * 1024; // 索引段大小：分配粒度与记录大小的公倍数，记录不跨段（每段1M条）
+
+public:
+	CacheRecordIndex();
+
+	CacheRecordIndex(const CacheRecordIndex&) = delete;
+	CacheRecordIndex& operator=(const CacheRecordIndex&) = delete;
+
+	// 以basePath为前缀创建索引段文件，并以当前时间作为时间戳起点
+	bool Open(const std::wstring& basePath);
+	void Close();
+	bool IsOpen() const { return m_store.IsOpen(); }
+
+	// 追加一条记录，时间戳取当前单调时间
+	bool Append(uint64_t offset, uint32_t length, CacheDirection direction, uint16_t sourcePort);
+
+	// 查询
+	uint64_t GetCount() const { return m_store.GetSize() / sizeof(CacheRecord); }
+	bool GetRecord(uint64_t index, CacheRecord& record) const;
+	// 第一条时间戳不早于timestamp的记录序号，全部更早时返回GetCount()
+	uint64_t FindByTime(uint64_t timestamp) const;
+	// 包含数据偏移offset的记录序号，不存在时返回GetCount()
+	uint64_t FindByOffset(uint64_t offset) const;
+
+	// 时间换算：索引时间戳（微秒）与系统时间（Unix微秒），以打开时的系统时间为基准（之后调整系统时间不影响时间戳）
+	uint64_t GetStartTime() const { return m_startTime; }
+	uint64_t ToTimestamp(uint64_t unixMicroseconds) const;
+	uint64_t ToUnixTime(uint64_t timestamp) const { return m_startTime + timestamp; }
+
+private:
+	// 第index条记录在映射视图中的地址（记录不跨段），view持有映射，失败返回nullptr
+	const CacheRecord* PeekRecord(uint64_t index, CacheView& view) const;
+	// 第一条不满足before（记录早于目标）的记录序号，全部满足时返回GetCount()
+	template <typename Before>
+	uint64_t FindFirst(Before before) const;
+
+private:
+	SegmentedCacheStore m_store;
+	std::chrono::steady_clock::time_point m_startClock;
+	uint64_t m_startTime;             // 打开时的系统时间（Unix微秒）
+};
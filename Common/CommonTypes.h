@@ -47,7 +47,7 @@
 #define DEFAULT_FLOW_CONTROL 0
 
 // 可靠传输协议常量
-#define RELIABLE_PROTOCOL_VERSION 1   // 协议版本
+#define RELIABLE_PROTOCOL_VERSION 2   // 协议版本（握手协商，对端为v1时自动回落）
 #define RELIABLE_MAX_PAYLOAD_SIZE 1024 // 最大负载大小
 #define RELIABLE_WINDOW_SIZE 4       // 滑动窗口大小
 #define RELIABLE_MAX_RETRIES 3       // 最大重试次数
@@ -161,14 +161,16 @@ enum class NetworkProtocol
 	PROTOCOL_UNKNOWN  // 未知协议
 };
 
-// 日志级别
+// 日志级别（由低到高，Logger按此比较模块最低级别）
 enum class LogLevel
 {
-	LOG_LEVEL_DEBUG = 0,    // 调试
-	LOG_LEVEL_INFO = 1,     // 信息
-	LOG_LEVEL_WARNING = 2,  // 警告
-	LOG_LEVEL_ERROR = 3,    // 错误
-	LOG_LEVEL_FATAL = 4     // 致命
+	LOG_LEVEL_TRACE = 0,    // 逐包细节，默认不输出
+	LOG_LEVEL_DEBUG = 1,    // 调试
+	LOG_LEVEL_INFO = 2,     // 信息
+	LOG_LEVEL_WARNING = 3,  // 警告
+	LOG_LEVEL_ERROR = 4,    // 错误
+	LOG_LEVEL_FATAL = 5,    // 致命
+	LOG_LEVEL_OFF = 6       // 仅用于Logger::SetModuleLevel：关闭该模块
 };
 
 // 操作结果
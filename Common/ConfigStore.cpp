@@ -803,6 +803,10 @@ std::string ConfigStore::SerializeToJson() const
 	ss << "    \"heartbeatInterval\": " << DwordToString(m_config.protocol.heartbeatInterval) << ",\n";
 	ss << "    \"maxPayloadSize\": " << DwordToString(m_config.protocol.maxPayloadSize) << ",\n";
 	ss << "    \"enableCompression\": " << BoolToString(m_config.protocol.enableCompression) << ",\n";
+	ss << "    \"enableStreamCompression\": " << BoolToString(m_config.protocol.enableStreamCompression) << ",\n";
+	ss << "    \"enableFec\": " << BoolToString(m_config.protocol.enableFec) << ",\n";
+	ss << "    \"fecGroupSize\": " << IntToString(m_config.protocol.fecGroupSize) << ",\n";
+	ss << "    \"enableMultiplexing\": " << BoolToString(m_config.protocol.enableMultiplexing) << ",\n";
 	ss << "    \"enableEncryption\": " << BoolToString(m_config.protocol.enableEncryption) << ",\n";
 	ss << "    \"encryptionKey\": \"" << EscapeJsonString(m_config.protocol.encryptionKey) << "\"\n";
 	ss << "  },\n";
@@ -956,6 +960,10 @@ bool ConfigStore::DeserializeFromJson(const std::string& jsonStr)
 			m_config.protocol.heartbeatInterval = StringToDword(GetJsonValue(protocolSection, "heartbeatInterval"));
 			m_config.protocol.maxPayloadSize = StringToDword(GetJsonValue(protocolSection, "maxPayloadSize"));
 			m_config.protocol.enableCompression = StringToBool(GetJsonValue(protocolSection, "enableCompression"));
+			m_config.protocol.enableStreamCompression = StringToBool(GetJsonValue(protocolSection, "enableStreamCompression"));
+			m_config.protocol.enableFec = StringToBool(GetJsonValue(protocolSection, "enableFec"));
+			m_config.protocol.fecGroupSize = static_cast<BYTE>(StringToInt(GetJsonValue(protocolSection, "fecGroupSize")));
+			m_config.protocol.enableMultiplexing = StringToBool(GetJsonValue(protocolSection, "enableMultiplexing"));
 			m_config.protocol.enableEncryption = StringToBool(GetJsonValue(protocolSection, "enableEncryption"));
 			m_config.protocol.encryptionKey = GetJsonValue(protocolSection, "encryptionKey");
 		}
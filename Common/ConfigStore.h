@@ -74,6 +74,10 @@ struct ReliableProtocolConfig
 	DWORD heartbeatInterval = 1000;            // 心跳间隔(ms)
 	DWORD maxPayloadSize = 1024;               // 最大负载大小
 	bool enableCompression = false;            // 启用压缩
+	bool enableStreamCompression = false;      // 启用跨帧字典压缩（需同时启用压缩）
+	bool enableFec = false;                    // 启用前向纠错（异或校验帧）
+	BYTE fecGroupSize = 0;                     // 校验组大小（0为按丢包率自适应）
+	bool enableMultiplexing = false;           // 启用多文件流复用（SendFiles并发传输）
 	bool enableEncryption = false;             // 启用加密
 	std::string encryptionKey;                 // 加密密钥
 
@@ -2,16 +2,91 @@
 
 #include "pch.h"
 #include "Logger.h"
-#include <Windows.h>
 #include <ctime>
+#include <cstdio>
+#include <cstring>
 #include <iomanip>
+#include <sstream>
 
 // 静态成员初始化
 std::string Logger::s_logFilePath = "";
 std::mutex Logger::s_mutex;
 bool Logger::s_initialized = false;
+LoggerConfig Logger::s_config;
+std::unique_ptr<MpscQueue<Logger::LogRecord>> Logger::s_queue;
+std::atomic<bool> Logger::s_running(false);
+std::atomic<bool> Logger::s_wakePending(false);
+std::atomic<uint64_t> Logger::s_droppedTotal(0);
+std::thread Logger::s_writerThread;
+std::mutex Logger::s_writerMutex;
+std::condition_variable Logger::s_writerCondition;
+std::condition_variable Logger::s_flushCondition;
+uint64_t Logger::s_writtenCount = 0;
+uint64_t Logger::s_flushTarget = 0;
+HANDLE Logger::s_file = INVALID_HANDLE_VALUE;
+std::atomic<uint8_t> Logger::s_moduleLevels[static_cast<size_t>(LogModule::Count)] = {
+	{ static_cast<uint8_t>(LogLevel::LOG_LEVEL_DEBUG) },
+	{ static_cast<uint8_t>(LogLevel::LOG_LEVEL_DEBUG) },
+	{ static_cast<uint8_t>(LogLevel::LOG_LEVEL_DEBUG) },
+	{ static_cast<uint8_t>(LogLevel::LOG_LEVEL_DEBUG) }
+};
 
-void Logger::Initialize(const std::string& logFilePath)
+namespace
+{
+	// 单次WriteFile的批量上限，超过时分批写出
+	const size_t WRITE_BATCH_SIZE = 256 * 1024;
+
+	const char* GetLevelName(LogLevel level)
+	{
+		switch (level)
+		{
+		case LogLevel::LOG_LEVEL_TRACE: return "TRACE";
+		case LogLevel::LOG_LEVEL_DEBUG: return "DEBUG";
+		case LogLevel::LOG_LEVEL_INFO: return "INFO";
+		case LogLevel::LOG_LEVEL_WARNING: return "WARNING";
+		case LogLevel::LOG_LEVEL_ERROR: return "ERROR";
+		case LogLevel::LOG_LEVEL_FATAL: return "FATAL";
+		default: return "OFF";
+		}
+	}
+
+	// General模块不加标签，与原有日志格式一致
+	const char* GetModuleTag(LogModule module)
+	{
+		switch (module)
+		{
+		case LogModule::Channel: return "[Channel] ";
+		case LogModule::Transport: return "[Transport] ";
+		case LogModule::Cache: return "[Cache] ";
+		default: return "";
+		}
+	}
+
+	// 整数格式化（写入线程逐参数调用，避免snprintf）
+	void AppendDecimal(std::string& output, uint64_t value)
+	{
+		char digits[20];
+		size_t count = 0;
+		do {
+			digits[count++] = static_cast<char>('0' + value % 10);
+			value /= 10;
+		} while (value != 0);
+		while (count > 0) {
+			output += digits[--count];
+		}
+	}
+
+	// 未调用Shutdown就退出进程时，在静态对象析构阶段停止写入线程（定义在上述静态成员之后，先于它们析构）
+	struct LoggerShutdownGuard
+	{
+		~LoggerShutdownGuard()
+		{
+			Logger::Shutdown();
+		}
+	} s_shutdownGuard;
+}
+
+void Logger::Initialize(const std::string& logFilePath, const LoggerConfig& config)
 {
 	std::lock_guard<std::mutex> lock(s_mutex);
 
@@ -20,16 +95,28 @@ void Logger::Initialize(const std::string& logFilePath)
 	}
 
 	s_logFilePath = logFilePath;
+	s_config = config;
 	s_initialized = true;
 
 	// 清空或创建日志文件
-	std::ofstream logFile(s_logFilePath, std::ios::trunc);
-	if (logFile.is_open()) {
-		logFile << "=== PortMaster Debug Log ===" << std::endl;
-		logFile << "启动时间: " << GetTimeStamp() << std::endl;
-		logFile << "============================" << std::endl;
-		logFile.close();
+	HANDLE file = CreateFileA(s_logFilePath.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file != INVALID_HANDLE_VALUE) {
+		std::string header = "=== PortMaster Debug Log ===\r\n";
+		header += "启动时间: " + GetTimeStamp() + "\r\n";
+		header += "============================\r\n";
+		DWORD written = 0;
+		WriteFile(file, header.data(), static_cast<DWORD>(header.size()), &written, nullptr);
+		CloseHandle(file);
+	}
+	OpenFile();
+
+	if (!s_queue) {
+		s_queue.reset(new MpscQueue<LogRecord>(s_config.queueCapacity));
 	}
+	s_wakePending = false;
+	s_running.store(true, std::memory_order_release);
+	s_writerThread = std::thread(&Logger::WriterThread);
 }
 
 void Logger::Shutdown()
@@ -37,10 +124,20 @@ void Logger::Shutdown()
 	std::lock_guard<std::mutex> lock(s_mutex);
 
 	if (s_initialized) {
-		std::ofstream logFile(s_logFilePath, std::ios::app);
-		if (logFile.is_open()) {
-			logFile << "=== 日志系统关闭 ===" << std::endl;
-			logFile.close();
+		{
+			// 持有写入线程的锁置位，写入线程不会错过停止通知
+			std::lock_guard<std::mutex> writerLock(s_writerMutex);
+			s_running = false;
+			s_writerCondition.notify_one();
+		}
+		if (s_writerThread.joinable()) {
+			s_writerThread.join();
+		}
+
+		WriteBatch("=== 日志系统关闭 ===\r\n");
+		if (s_file != INVALID_HANDLE_VALUE) {
+			CloseHandle(s_file);
+			s_file = INVALID_HANDLE_VALUE;
 		}
 		s_initialized = false;
 	}
@@ -48,49 +145,353 @@ void Logger::Shutdown()
 
 void Logger::Log(const std::string& message)
 {
-	WriteInternal("INFO", message);
+	WriteInternal(LogLevel::LOG_LEVEL_INFO, message);
 }
 
 void Logger::LogError(const std::string& message)
 {
-	WriteInternal("ERROR", message);
+	WriteInternal(LogLevel::LOG_LEVEL_ERROR, message);
 }
 
 void Logger::LogWarning(const std::string& message)
 {
-	WriteInternal("WARNING", message);
+	WriteInternal(LogLevel::LOG_LEVEL_WARNING, message);
 }
 
 void Logger::LogDebug(const std::string& message)
 {
-	WriteInternal("DEBUG", message);
+	WriteInternal(LogLevel::LOG_LEVEL_DEBUG, message);
 }
 
-void Logger::WriteInternal(const std::string& level, const std::string& message)
+void Logger::Flush()
 {
-	std::lock_guard<std::mutex> lock(s_mutex);
+	if (!s_running.load(std::memory_order_acquire)) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(s_writerMutex);
+	const uint64_t target = s_queue->GetPushCount();
+	s_flushTarget = (std::max)(s_flushTarget, target);
+	s_writerCondition.notify_one();
+	s_flushCondition.wait(lock, [target] { return s_writtenCount >= target || !s_running.load(); });
+}
+
+uint64_t Logger::GetDroppedCount()
+{
+	return s_droppedTotal.load();
+}
+
+void Logger::SetModuleLevel(LogModule module, LogLevel level)
+{
+	s_moduleLevels[static_cast<size_t>(module)].store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::GetModuleLevel(LogModule module)
+{
+	return static_cast<LogLevel>(s_moduleLevels[static_cast<size_t>(module)].load(std::memory_order_relaxed));
+}
+
+void Logger::CaptureArgument(LogRecord& record, bool value)
+{
+	LogArgument& argument = record.arguments[record.argumentCount++];
+	argument.type = LogArgument::Bool;
+	argument.boolValue = value;
+}
+
+void Logger::CaptureArgument(LogRecord& record, const char* value)
+{
+	if (value) {
+		CaptureText(record, value, strlen(value));
+	}
+	else {
+		CaptureText(record, "(null)", 6);
+	}
+}
+
+void Logger::CaptureArgument(LogRecord& record, const std::string& value)
+{
+	CaptureText(record, value.data(), value.size());
+}
+
+void Logger::CaptureText(LogRecord& record, const char* data, size_t length)
+{
+	// 定长区用尽时截断，记录大小固定，入队不做堆分配
+	const size_t count = (std::min)(length, LOG_TEXT_CAPACITY - record.textUsed);
+	memcpy(record.text + record.textUsed, data, count);
+
+	LogArgument& argument = record.arguments[record.argumentCount++];
+	argument.type = LogArgument::Text;
+	argument.text.offset = record.textUsed;
+	argument.text.length = static_cast<uint16_t>(count);
+	record.textUsed = static_cast<uint16_t>(record.textUsed + count);
+}
+
+void Logger::WriteInternal(LogLevel level, const std::string& message)
+{
+	if (!IsEnabled(LogModule::General, level)) {
+		return;
+	}
+
+	if (!s_running.load(std::memory_order_acquire)) {
+		// 未初始化（或已关闭）时只输出到调试器
+		OutputDebugStringA((GetTimeStamp() + " [" + GetLevelName(level) + "] " + message + "\n").c_str());
+		return;
+	}
+
+	LogRecord record;
+	record.level = level;
+	record.message = message;
+	Enqueue(std::move(record));
+}
+
+void Logger::Enqueue(LogRecord&& record)
+{
+	if (!s_running.load(std::memory_order_acquire)) {
+		if (record.format) {
+			// 未初始化（或已关闭）时就地格式化，只输出到调试器
+			std::string line;
+			record.time = std::chrono::system_clock::now();
+			FormatRecord(record, line);
+			OutputDebugStringA(line.c_str());
+		}
+		return;
+	}
+
+	record.time = std::chrono::system_clock::now();
 
-	// 构造日志行
-	std::string logLine = GetTimeStamp() + " [" + level + "] " + message;
+	MpscQueue<LogRecord>& queue = *s_queue;
+	const bool isError = record.level >= LogLevel::LOG_LEVEL_ERROR;
+	if (queue.TryPush(std::move(record))) {
+		// 积压到四分之一容量或出现错误时立即唤醒写入线程，否则等其定时写出
+		if (isError || queue.GetSize() >= queue.GetCapacity() / 4) {
+			WakeWriter();
+		}
+		return;
+	}
+
+	if (s_config.overflowPolicy == LogOverflowPolicy::Drop && !isError) {
+		s_droppedTotal.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	// 等待写入线程腾出空间（写入线程停止后放弃）
+	while (!queue.TryPush(std::move(record))) {
+		if (!s_running.load()) {
+			return;
+		}
+		WakeWriter();
+		std::this_thread::yield();
+	}
+}
+
+void Logger::WakeWriter()
+{
+	if (!s_wakePending.exchange(true)) {
+		std::lock_guard<std::mutex> lock(s_writerMutex);
+		s_writerCondition.notify_one();
+	}
+}
+
+void Logger::WriterThread()
+{
+	MpscQueue<LogRecord>& queue = *s_queue;
+	const std::chrono::milliseconds interval((std::max)(s_config.flushIntervalMs, 1));
+	std::string batch;
+	batch.reserve(WRITE_BATCH_SIZE + 4096);
+	LogRecord record;
+	uint64_t reportedDropped = s_droppedTotal.load();
+
+	while (true) {
+		bool stopping = false;
+		{
+			std::unique_lock<std::mutex> lock(s_writerMutex);
+			s_writerCondition.wait_for(lock, interval, [] {
+				return !s_running.load() || s_wakePending.load() || s_writtenCount < s_flushTarget;
+			});
+			stopping = !s_running.load();
+		}
+		s_wakePending = false;
+
+		while (queue.TryPop(record)) {
+			const size_t lineStart = batch.size();
+			FormatRecord(record, batch);
+			// 行尾即批尾，可直接作为以NUL结尾的单行输出
+			OutputDebugStringA(batch.c_str() + lineStart);
+
+			if (batch.size() >= WRITE_BATCH_SIZE) {
+				WriteBatch(batch);
+				batch.clear();
+			}
+		}
+
+		const uint64_t dropped = s_droppedTotal.load();
+		if (dropped != reportedDropped) {
+			batch += GetTimeStamp() + " [WARNING] 日志队列已满，丢弃 " + std::to_string(dropped - reportedDropped) + " 条日志\r\n";
+			reportedDropped = dropped;
+		}
+
+		if (!batch.empty()) {
+			WriteBatch(batch);
+			batch.clear();
+		}
 
-	// 写入文件
-	if (!s_logFilePath.empty()) {
-		std::ofstream logFile(s_logFilePath, std::ios::app);
-		if (logFile.is_open()) {
-			logFile << logLine << std::endl;
-			logFile.close();
+		{
+			std::lock_guard<std::mutex> lock(s_writerMutex);
+			s_writtenCount = queue.GetPopCount();
+			s_flushCondition.notify_all();
+		}
+
+		// 停止后取尽队列再退出（已领取位置但尚未发布的记录等其发布）
+		if (stopping && queue.GetSize() == 0) {
+			break;
 		}
 	}
 
-	// 同时输出到调试器（可选）
-	OutputDebugStringA((logLine + "\n").c_str());
+	std::lock_guard<std::mutex> lock(s_writerMutex);
+	s_flushCondition.notify_all();
+}
+
+void Logger::FormatRecord(const LogRecord& record, std::string& batch)
+{
+	// 同一秒内的记录复用"HH:MM:SS"，避免逐条调用localtime_s（仅写入线程与未初始化时的调用线程使用）
+	static thread_local time_t cachedSecond = static_cast<time_t>(-1);
+	static thread_local char secondText[16] = "";
+
+	const time_t second = std::chrono::system_clock::to_time_t(record.time);
+	if (second != cachedSecond) {
+		std::tm bt;
+		localtime_s(&bt, &second);
+		snprintf(secondText, sizeof(secondText), "%02d:%02d:%02d", bt.tm_hour, bt.tm_min, bt.tm_sec);
+		cachedSecond = second;
+	}
+	const int milliseconds = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+		record.time.time_since_epoch()).count() % 1000);
+	// 逐段追加"[HH:MM:SS.mmm] [LEVEL] [Module] "，写入线程每行都要经过这里，不用snprintf
+	const char milliText[] = {
+		'.',
+		static_cast<char>('0' + milliseconds / 100),
+		static_cast<char>('0' + milliseconds / 10 % 10),
+		static_cast<char>('0' + milliseconds % 10),
+		']', ' ', '['
+	};
+	batch += '[';
+	batch += secondText;
+	batch.append(milliText, sizeof(milliText));
+	batch += GetLevelName(record.level);
+	batch += "] ";
+	batch += GetModuleTag(record.module);
+
+	if (!record.format) {
+		batch += record.message;
+		batch += "\r\n";
+		return;
+	}
+
+	// 依次以参数替换"{}"，占位符之间的字面量整段追加；多余的占位符原样保留
+	const char* text = record.format;
+	for (size_t next = 0; next < record.argumentCount; ++next) {
+		const char* placeholder = strstr(text, "{}");
+		if (!placeholder) {
+			break;
+		}
+		batch.append(text, placeholder - text);
+		text = placeholder + 2;
+
+		const LogArgument& argument = record.arguments[next];
+		switch (argument.type) {
+		case LogArgument::Signed:
+			if (argument.signedValue < 0) {
+				batch += '-';
+				AppendDecimal(batch, 0 - static_cast<uint64_t>(argument.signedValue));
+			}
+			else {
+				AppendDecimal(batch, static_cast<uint64_t>(argument.signedValue));
+			}
+			break;
+		case LogArgument::Unsigned:
+			AppendDecimal(batch, argument.unsignedValue);
+			break;
+		case LogArgument::Float:
+		{
+			char number[32];
+			snprintf(number, sizeof(number), "%g", argument.floatValue);
+			batch += number;
+			break;
+		}
+		case LogArgument::Bool:
+			batch += argument.boolValue ? "true" : "false";
+			break;
+		case LogArgument::Text:
+			batch.append(record.text + argument.text.offset, argument.text.length);
+			break;
+		}
+	}
+	batch += text;
+	batch += "\r\n";
+}
+
+void Logger::WriteBatch(const std::string& batch)
+{
+	if (s_file == INVALID_HANDLE_VALUE && !OpenFile()) {
+		return; // 文件无法打开，仅保留调试器输出
+	}
+
+	if (s_config.maxFileSize > 0) {
+		LARGE_INTEGER size;
+		if (GetFileSizeEx(s_file, &size) && size.QuadPart > 0 &&
+			static_cast<uint64_t>(size.QuadPart) + batch.size() > s_config.maxFileSize) {
+			RotateFile();
+			if (s_file == INVALID_HANDLE_VALUE) {
+				return;
+			}
+		}
+	}
+
+	const char* data = batch.data();
+	size_t remaining = batch.size();
+	while (remaining > 0) {
+		DWORD written = 0;
+		DWORD chunk = static_cast<DWORD>((std::min)(remaining, static_cast<size_t>(64 * 1024 * 1024)));
+		if (!WriteFile(s_file, data, chunk, &written, nullptr) || written == 0) {
+			break; // 写入失败（如磁盘已满），丢弃本批
+		}
+		data += written;
+		remaining -= written;
+	}
+}
+
+void Logger::RotateFile()
+{
+	CloseHandle(s_file);
+	s_file = INVALID_HANDLE_VALUE;
+
+	if (s_config.maxBackupFiles <= 0) {
+		DeleteFileA(s_logFilePath.c_str());
+	}
+	else {
+		for (int i = s_config.maxBackupFiles - 1; i >= 1; --i) {
+			MoveFileExA((s_logFilePath + "." + std::to_string(i)).c_str(),
+				(s_logFilePath + "." + std::to_string(i + 1)).c_str(), MOVEFILE_REPLACE_EXISTING);
+		}
+		MoveFileExA(s_logFilePath.c_str(), (s_logFilePath + ".1").c_str(), MOVEFILE_REPLACE_EXISTING);
+	}
+
+	// 改名失败（文件被其他进程占用）时继续追加到原文件，下一批再尝试
+	OpenFile();
+}
+
+bool Logger::OpenFile()
+{
+	// FILE_APPEND_DATA：每次写入都追加到当前文件末尾，其他追加者或外部清空文件不会造成覆盖
+	s_file = CreateFileA(s_logFilePath.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	return s_file != INVALID_HANDLE_VALUE;
 }
 
-std::string Logger::GetTimeStamp()
+std::string Logger::GetTimeStamp(std::chrono::system_clock::time_point time)
 {
-	auto now = std::chrono::system_clock::now();
-	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
-	auto timer = std::chrono::system_clock::to_time_t(now);
+	auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()) % 1000;
+	auto timer = std::chrono::system_clock::to_time_t(time);
 
 	std::tm bt;
 	localtime_s(&bt, &timer);
@@ -2,11 +2,62 @@
 #pragma execution_character_set("utf-8")
 
 #include <string>
-#include <fstream>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <memory>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <Windows.h>
+#include "CommonTypes.h"
+#include "RingBuffer.h"
+
+// 日志模块：各模块有独立的运行时最低级别（Logger::SetModuleLevel，默认Debug）
+enum class LogModule : uint8_t
+{
+	General = 0,  // Log/LogError/LogWarning/LogDebug
+	Channel,      // ReliableChannel
+	Transport,    // 传输层
+	Cache,        // ReceiveCacheService
+	Count
+};
+
+// 编译期最低日志级别：低于该级别的PM_LOG连同参数求值在编译期被移除（如定义为2去掉TRACE/DEBUG）
+#ifndef PM_LOG_MIN_LEVEL
+#define PM_LOG_MIN_LEVEL 0
+#endif
+
+// 延迟格式化日志：format为含"{}"占位符的字符串字面量，参数以二进制形式入队，由写入线程格式化
+// 级别低于编译期或模块运行时最低级别时不求值参数、不入队
+// 用法：PM_LOG(LogModule::Channel, LogLevel::LOG_LEVEL_DEBUG, "处理帧 seq={} len={}", sequence, length);
+#define PM_LOG(module, level, ...) \
+	do \
+	{ \
+		if (static_cast<int>(level) >= PM_LOG_MIN_LEVEL && Logger::IsEnabled(module, level)) \
+		{ \
+			Logger::Write(module, level, __VA_ARGS__); \
+		} \
+	} while (0)
+
+// 日志队列满时的处理策略
+enum class LogOverflowPolicy
+{
+	Drop,   // 丢弃并计数，写入线程随后补记丢弃条数（ERROR级别始终等待，不丢弃）
+	Block   // 等待写入线程腾出空间
+};
+
+// 异步日志配置
+struct LoggerConfig
+{
+	size_t queueCapacity = 8192;                 // 队列容量（条，向上取整为2的幂）
+	uint64_t maxFileSize = 16 * 1024 * 1024;     // 日志文件达到该大小时轮转（字节），0表示不轮转
+	int maxBackupFiles = 3;                      // 轮转保留的历史文件数（<路径>.1为最近一份）
+	LogOverflowPolicy overflowPolicy = LogOverflowPolicy::Drop;
+	int flushIntervalMs = 50;                    // 写入线程最长等待间隔（毫秒）
+};
 
 /**
  * @brief 全局日志工具类
@@ -19,6 +70,19 @@
  * - 同时输出到文件和OutputDebugString
  * - 支持日志级别
  *
+ * 异步写入：
+ * - Log*只把时间与消息放入无锁多生产者队列（MpscQueue），不加锁、不做文件I/O
+ * - 写入线程保持日志文件打开，按批格式化后一次WriteFile写入（追加方式打开，可与其他追加者共存）
+ * - 队列达到四分之一容量、ERROR日志或Flush时立即唤醒写入线程，否则每flushIntervalMs写一次
+ * - 文件超过maxFileSize时轮转为<路径>.1 ~ <路径>.N
+ * - 队列满时按LoggerConfig::overflowPolicy丢弃或等待
+ * - 未初始化或Shutdown之后的日志只同步输出到调试器
+ *
+ * 延迟格式化（PM_LOG / Write）：
+ * - 只记录格式串指针与参数（整数、浮点、布尔按值，字符串拷入记录内的定长区，超长截断）
+ * - 调用方不做to_string/拼接/堆分配，格式化在写入线程完成
+ * - 支持的参数：整数、浮点、bool、const char*、std::string；每条最多MAX_LOG_ARGUMENTS个
+ *
  * 使用示例：
  * @code
  * Logger::Log("[USB] 端口枚举开始");
@@ -31,11 +95,15 @@ public:
 	/**
 	 * @brief 初始化日志系统
 	 * @param logFilePath 日志文件路径，默认为"PortMaster_debug.log"
+	 * @param config 队列、轮转与溢出策略（队列在首次初始化时创建，容量以首次为准）
+	 *
+	 * 说明：
+	 * - 清空或创建日志文件并启动写入线程；已初始化时直接返回
 	 */
-	static void Initialize(const std::string& logFilePath = "PortMaster_debug.log");
+	static void Initialize(const std::string& logFilePath = "PortMaster_debug.log", const LoggerConfig& config = LoggerConfig());
 
 	/**
-	 * @brief 关闭日志系统
+	 * @brief 关闭日志系统（写出队列中的全部日志后停止写入线程并关闭文件）
 	 */
 	static void Shutdown();
 
@@ -63,21 +131,200 @@ public:
 	 */
 	static void LogDebug(const std::string& message);
 
+	/**
+	 * @brief 延迟格式化写入（通常经PM_LOG调用，由其先判断级别）
+	 * @param format 含"{}"占位符的格式串，必须是字符串字面量（记录只保存指针）
+	 */
+	template<typename... Args>
+	static void Write(LogModule module, LogLevel level, const char* format, const Args&... args)
+	{
+		static_assert(sizeof...(Args) <= MAX_LOG_ARGUMENTS, "too many log arguments");
+
+		LogRecord record;
+		record.level = level;
+		record.module = module;
+		record.format = format;
+		int expand[] = { 0, (CaptureArgument(record, args), 0)... };
+		(void)expand;
+		Enqueue(std::move(record));
+	}
+
+	/**
+	 * @brief 模块运行时最低级别
+	 */
+	static void SetModuleLevel(LogModule module, LogLevel level);
+	static LogLevel GetModuleLevel(LogModule module);
+	static bool IsEnabled(LogModule module, LogLevel level)
+	{
+		return static_cast<uint8_t>(level) >= s_moduleLevels[static_cast<size_t>(module)].load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * @brief 等待调用前写入的日志全部写入文件
+	 */
+	static void Flush();
+
+	/**
+	 * @brief 获取因队列满而丢弃的日志条数（累计）
+	 */
+	static uint64_t GetDroppedCount();
+
+	static const size_t MAX_LOG_ARGUMENTS = 8;
+	static const size_t LOG_TEXT_CAPACITY = 160;   // 每条记录的字符串参数总长上限（字节）
+
 private:
+	// 延迟格式化参数
+	struct LogArgument
+	{
+		enum Type : uint8_t { Signed, Unsigned, Float, Bool, Text };
+
+		Type type;
+		union
+		{
+			int64_t signedValue;
+			uint64_t unsignedValue;
+			double floatValue;
+			bool boolValue;
+			struct
+			{
+				uint16_t offset;
+				uint16_t length;
+			} text;                 // 在LogRecord::text中的位置
+		};
+	};
+
+	// 队列中的日志记录：格式化推迟到写入线程
+	// message非空的记录由Log/LogError等写入；format非空的记录由Write写入，参数保存在arguments/text中
+	struct LogRecord
+	{
+		LogLevel level = LogLevel::LOG_LEVEL_INFO;
+		LogModule module = LogModule::General;
+		std::chrono::system_clock::time_point time;
+		std::string message;
+		const char* format = nullptr;
+		uint8_t argumentCount = 0;
+		uint16_t textUsed = 0;
+		LogArgument arguments[MAX_LOG_ARGUMENTS];
+		char text[LOG_TEXT_CAPACITY];
+
+		LogRecord() = default;
+		LogRecord(LogRecord&& other) { *this = std::move(other); }
+
+		// 入队与出队各移动一次，只复制已用的参数与文本，不触及记录的剩余部分
+		LogRecord& operator=(LogRecord&& other)
+		{
+			level = other.level;
+			module = other.module;
+			time = other.time;
+			message = std::move(other.message);
+			format = other.format;
+			argumentCount = other.argumentCount;
+			textUsed = other.textUsed;
+			memcpy(arguments, other.arguments, argumentCount * sizeof(LogArgument));
+			memcpy(text, other.text, textUsed);
+			return *this;
+		}
+	};
+
+	// 参数捕获（调用线程）：按值保存，字符串拷入定长区
+	static void CaptureArgument(LogRecord& record, bool value);
+	static void CaptureArgument(LogRecord& record, const char* value);
+	static void CaptureArgument(LogRecord& record, const std::string& value);
+
+	template<typename T>
+	static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type
+		CaptureArgument(LogRecord& record, T value)
+	{
+		LogArgument& argument = record.arguments[record.argumentCount++];
+		argument.type = LogArgument::Signed;
+		argument.signedValue = static_cast<int64_t>(value);
+	}
+
+	template<typename T>
+	static typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type
+		CaptureArgument(LogRecord& record, T value)
+	{
+		LogArgument& argument = record.arguments[record.argumentCount++];
+		argument.type = LogArgument::Unsigned;
+		argument.unsignedValue = static_cast<uint64_t>(value);
+	}
+
+	template<typename T>
+	static typename std::enable_if<std::is_floating_point<T>::value>::type
+		CaptureArgument(LogRecord& record, T value)
+	{
+		LogArgument& argument = record.arguments[record.argumentCount++];
+		argument.type = LogArgument::Float;
+		argument.floatValue = static_cast<double>(value);
+	}
+
+	static void CaptureText(LogRecord& record, const char* data, size_t length);
+
+	static std::atomic<uint8_t> s_moduleLevels[static_cast<size_t>(LogModule::Count)];
+
 	static std::string s_logFilePath;      // 日志文件路径
-	static std::mutex s_mutex;             // 线程安全互斥锁
+	static std::mutex s_mutex;             // 生命周期互斥锁（Initialize/Shutdown）
 	static bool s_initialized;             // 是否已初始化
 
+	// 异步写入
+	static LoggerConfig s_config;
+	static std::unique_ptr<MpscQueue<LogRecord>> s_queue;  // 生产者（任意线程）→ 写入线程
+	static std::atomic<bool> s_running;                     // 写入线程是否接收日志
+	static std::atomic<bool> s_wakePending;                 // 已请求唤醒写入线程（避免重复通知）
+	static std::atomic<uint64_t> s_droppedTotal;            // 累计丢弃条数
+	static std::thread s_writerThread;
+	static std::mutex s_writerMutex;
+	static std::condition_variable s_writerCondition;       // 唤醒写入线程
+	static std::condition_variable s_flushCondition;        // 一批写入完成
+	static uint64_t s_writtenCount;                         // 已写入的记录数（s_writerMutex保护）
+	static uint64_t s_flushTarget;                          // Flush等待的记录数（s_writerMutex保护）
+	static HANDLE s_file;                                   // 日志文件句柄（写入线程独占，Initialize/Shutdown在线程外访问）
+
 	/**
 	 * @brief 内部写入方法
 	 * @param level 日志级别
 	 * @param message 消息内容
 	 */
-	static void WriteInternal(const std::string& level, const std::string& message);
+	static void WriteInternal(LogLevel level, const std::string& message);
+
+	/**
+	 * @brief 记录入队（补上时间戳），队列满时按溢出策略处理
+	 */
+	static void Enqueue(LogRecord&& record);
+
+	/**
+	 * @brief 写入线程：把一条记录格式化追加到batch
+	 */
+	static void FormatRecord(const LogRecord& record, std::string& batch);
+
+	/**
+	 * @brief 唤醒写入线程（已有未处理的唤醒请求时不重复通知）
+	 */
+	static void WakeWriter();
+
+	/**
+	 * @brief 写入线程主函数（队列的唯一消费者）
+	 */
+	static void WriterThread();
+
+	/**
+	 * @brief 把已格式化的一批日志写入文件，必要时先轮转
+	 */
+	static void WriteBatch(const std::string& batch);
+
+	/**
+	 * @brief 轮转日志文件：<路径>.N-1 → <路径>.N，…，<路径> → <路径>.1，然后重新创建<路径>
+	 */
+	static void RotateFile();
+
+	/**
+	 * @brief 以追加方式打开（不存在时创建）日志文件
+	 */
+	static bool OpenFile();
 
 	/**
-	 * @brief 获取当前时间戳字符串
+	 * @brief 获取时间戳字符串
 	 * @return 格式化的时间戳字符串 [HH:MM:SS.mmm]
 	 */
-	static std::string GetTimeStamp();
+	static std::string GetTimeStamp(std::chrono::system_clock::time_point time = std::chrono::system_clock::now());
 };
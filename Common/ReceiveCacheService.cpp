@@ -3,9 +3,20 @@
 #include "pch.h"
 #include "ReceiveCacheService.h"
 #include "StringUtils.h"
+#include "Logger.h"
 #include <Shlwapi.h>
 #pragma comment(lib, "Shlwapi.lib")
 
+// 详细日志：仅在开关开启时按值捕获参数入队，由Logger写入线程格式化后写入调试日志文件
+#define LOG_DETAIL(...) \
+	do \
+	{ \
+		if (m_verboseLogging) \
+		{ \
+			PM_LOG(LogModule::Cache, LogLevel::LOG_LEVEL_DEBUG, __VA_ARGS__); \
+		} \
+	} while (0)
+
 // ==================== 构造与析构 ====================
 
 ReceiveCacheService::ReceiveCacheService()
@@ -15,12 +26,21 @@ ReceiveCacheService::ReceiveCacheService()
 	, m_totalReceivedBytes(0)
 	, m_totalSentBytes(0)
 	, m_verboseLogging(false)
+	, m_writeBehindEnabled(false)
+	, m_stagedTotal(0)
+	, m_flushedTotal(0)
+	, m_syncTarget(0)
+	, m_discardTarget(0)
+	, m_flusherRunning(false)
+	, m_flusherStop(false)
+	, m_recordIndexEnabled(false)
 {
 }
 
 ReceiveCacheService::~ReceiveCacheService()
 {
 	Shutdown();
+	StopFlusher();
 }
 
 // ==================== 生命周期管理 ====================
@@ -47,17 +67,24 @@ bool ReceiveCacheService::Initialize()
 
 		m_tempCacheFilePath = tempFileName;
 
-		// 打开临时文件用于写入（二进制模式）
-		m_tempCacheFile.open(m_tempCacheFilePath, std::ios::out | std::ios::binary | std::ios::trunc);
-		if (!m_tempCacheFile.is_open())
+		// GetTempFileNameW创建的空文件保留为名称占位，数据写入以其路径为前缀的缓存段文件
+		if (!m_cacheStore.Open(m_tempCacheFilePath))
 		{
-			Log("打开临时文件失败");
+			Log("创建缓存段文件失败");
+			DeleteFileW(m_tempCacheFilePath.c_str());
+			m_tempCacheFilePath.clear();
 			return false;
 		}
 
 		m_useTempCacheFile = true;
 		m_totalReceivedBytes = 0;
 		m_totalSentBytes = 0;
+
+		if (m_recordIndexEnabled.load())
+		{
+			std::lock_guard<std::mutex> indexLock(m_indexMutex);
+			OpenRecordIndexLocked();
+		}
 	// 【第七轮修复】删除内存缓存初始化 - 仅使用文件缓存
 	// m_memoryCache.clear();
 	// m_memoryCacheValid = false;
@@ -76,9 +103,17 @@ bool ReceiveCacheService::Initialize()
 
 void ReceiveCacheService::Shutdown()
 {
-	if (m_tempCacheFile.is_open())
+	// 临时文件即将删除，暂存数据无需写出
+	DiscardStagedData();
+
 	{
-		m_tempCacheFile.close();
+		// 与追加互斥，避免关闭正在写入的缓存段；读取者持有的视图在释放前保持有效
+		std::lock_guard<std::mutex> lock(m_fileMutex);
+		m_cacheStore.Close();
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_indexMutex);
+		m_recordIndex.Close();
 	}
 
 	// 删除临时文件
@@ -106,26 +141,32 @@ void ReceiveCacheService::Shutdown()
 
 bool ReceiveCacheService::IsInitialized() const
 {
-	return m_useTempCacheFile && m_tempCacheFile.is_open();
+	return m_useTempCacheFile && m_cacheStore.IsOpen();
 }
 
 // ==================== 数据操作接口 ====================
 
-bool ReceiveCacheService::AppendData(const std::vector<uint8_t>& data)
+bool ReceiveCacheService::AppendData(const std::vector<uint8_t>& data, CacheDirection direction, uint16_t sourcePort)
 {
 	if (data.empty())
 	{
 		return false;
 	}
 
+	// 写后模式：只拷入暂存环，文件写入与日志由刷新线程按批完成
+	if (m_writeBehindEnabled.load() && StageData(data.data(), data.size(), direction, sourcePort))
+	{
+		return true;
+	}
+
 	// 使用接收文件专用互斥锁
 	std::lock_guard<std::mutex> lock(m_fileMutex);
 
-	LogDetail("=== AppendData 开始（接收线程直接落盘）===");
-	LogDetail("接收数据大小: " + std::to_string(data.size()) + " 字节");
+	LOG_DETAIL("=== AppendData 开始（接收线程直接落盘）===");
+	LOG_DETAIL("接收数据大小: {} 字节", data.size());
 	// 【第七轮修复】删除内存缓存日志 - 不再维护内存镜像
-	// LogDetail("当前接收缓存大小: " + std::to_string(m_memoryCache.size()) + " 字节");
-	LogDetail("总接收字节数: " + std::to_string(m_totalReceivedBytes.load()) + " 字节");
+	// LOG_DETAIL("当前接收缓存大小: {} 字节", m_memoryCache.size());
+	LOG_DETAIL("总接收字节数: {} 字节", m_totalReceivedBytes.load());
 
 	// 【第七轮修复】删除内存缓存复制逻辑
 	// 原来的代码在每次 AppendData 都复制整个接收数据到内存，导致大数据内存溢出
@@ -134,10 +175,10 @@ bool ReceiveCacheService::AppendData(const std::vector<uint8_t>& data)
 	// else { m_memoryCache.insert(m_memoryCache.end(), data.begin(), data.end()); }
 	// m_memoryCacheValid = true;
 
-	// 简化状态检查，仅在文件流关闭时恢复
-	if (m_useTempCacheFile && !m_tempCacheFile.is_open())
+	// 简化状态检查，仅在缓存段关闭时恢复
+	if (m_useTempCacheFile && !m_cacheStore.IsOpen())
 	{
-		Log("⚠️ 检测到临时文件流关闭，启动自动恢复...");
+		Log("⚠️ 检测到缓存段已关闭，启动自动恢复...");
 		if (CheckAndRecover())
 		{
 			Log("✅ 临时文件自动恢复成功，继续数据写入");
@@ -149,32 +190,31 @@ bool ReceiveCacheService::AppendData(const std::vector<uint8_t>& data)
 		}
 	}
 
-	// 3. 立即同步写入临时文件（强制串行化，确保数据完全落盘）
-	if (m_useTempCacheFile && m_tempCacheFile.is_open())
+	// 3. 立即写入缓存段（m_fileMutex串行化，返回后对读取者可见）
+	if (m_useTempCacheFile && m_cacheStore.IsOpen())
 	{
-		LogDetail("执行强制同步写入临时缓存文件...");
-		try
+		LOG_DETAIL("执行写入缓存段...");
+		if (m_cacheStore.Append(data.data(), data.size()))
 		{
-			// 写入数据到文件
-			m_tempCacheFile.write(reinterpret_cast<const char*>(data.data()), data.size());
-
-			// 强制刷新缓冲区到磁盘
-			m_tempCacheFile.flush();
+			if (m_recordIndexEnabled.load())
+			{
+				AppendRecord(m_totalReceivedBytes.load(), data.size(), direction, sourcePort);
+			}
 
 			// 更新总字节数统计
 			m_totalReceivedBytes += data.size();
 
-			LogDetail("强制同步写入成功: " + std::to_string(data.size()) + " 字节");
-			LogDetail("更新后总接收字节数: " + std::to_string(m_totalReceivedBytes.load()) + " 字节");
+			LOG_DETAIL("写入缓存段成功: {} 字节", data.size());
+			LOG_DETAIL("更新后总接收字节数: {} 字节", m_totalReceivedBytes.load());
 
 			if (m_verboseLogging)
 			{
 				LogFileStatus("数据写入后状态验证");
 			}
 		}
-		catch (const std::exception& e)
+		else
 		{
-			Log("临时缓存文件写入异常: " + std::string(e.what()));
+			Log("缓存段写入失败（段文件创建或映射失败）");
 			// 【第七轮修复】修改日志信息 - 不再有内存缓存备份
 			Log("❌ 文件写入失败，接收的数据将丢失");
 		}
@@ -182,13 +222,13 @@ bool ReceiveCacheService::AppendData(const std::vector<uint8_t>& data)
 	else
 	{
 		// 【第七轮修复】修改日志 - 无内存缓存备份
-		LogDetail("⚠️ 临时缓存文件未启用或未打开，接收数据将丢失");
+		LOG_DETAIL("⚠️ 临时缓存文件未启用或未打开，接收数据将丢失");
 		// 仍然需要更新总字节数统计
 		m_totalReceivedBytes += data.size();
-		LogDetail("更新总接收字节数: " + std::to_string(m_totalReceivedBytes.load()) + " 字节");
+		LOG_DETAIL("更新总接收字节数: {} 字节", m_totalReceivedBytes.load());
 	}
 
-	LogDetail("=== AppendData 结束（数据已强制落盘）===");
+	LOG_DETAIL("=== AppendData 结束（数据已写入缓存段）===");
 	return true;
 }
 
@@ -196,13 +236,55 @@ std::vector<uint8_t> ReceiveCacheService::ReadData(uint64_t offset, size_t lengt
 {
 	std::vector<uint8_t> result;
 
-	if (m_tempCacheFilePath.empty() || !PathFileExistsW(m_tempCacheFilePath.c_str()))
+	if (!m_cacheStore.IsOpen())
 	{
 		return result;
 	}
 
-	std::lock_guard<std::mutex> lock(m_fileMutex);
-	return ReadDataUnlocked(offset, length);
+	// 写后模式下先写出暂存数据，保证读到调用前追加的全部数据
+	Sync();
+
+	try
+	{
+		// 不持有m_fileMutex：按已发布的长度从映射段拷贝，读取期间追加照常进行
+		uint64_t cachedSize = m_cacheStore.GetSize();
+		if (offset >= cachedSize)
+		{
+			LOG_DETAIL("ReadData: 偏移 {} 超出缓存大小 {} 字节", offset, cachedSize);
+			return result;
+		}
+
+		// 计算读取长度（0表示读取全部）
+		uint64_t availableLength = cachedSize - offset;
+		size_t targetReadLength = (length == 0 || length > availableLength) ? static_cast<size_t>(availableLength) : length;
+
+		result.resize(targetReadLength);
+		size_t totalBytesRead = m_cacheStore.Read(offset, result.data(), targetReadLength);
+		if (totalBytesRead == targetReadLength)
+		{
+			LOG_DETAIL("ReadData: ✅ 数据读取完整，成功读取 {} 字节", totalBytesRead);
+		}
+		else
+		{
+			Log("ReadData: ⚠️ 数据读取不完整（缓存段映射失败） - 预期: " +
+				std::to_string(targetReadLength) + " 字节，实际: " +
+				std::to_string(totalBytesRead) + " 字节");
+			result.resize(totalBytesRead);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		Log("ReadData: 读取异常 - " + std::string(e.what()));
+		result.clear();
+	}
+	return result;
+}
+
+CacheView ReceiveCacheService::ReadView(uint64_t offset, size_t length)
+{
+	// 写后模式下先写出暂存数据
+	Sync();
+	return m_cacheStore.ReadView(offset, length);
 }
 
 std::vector<uint8_t> ReceiveCacheService::ReadAllData()
@@ -214,159 +296,105 @@ bool ReceiveCacheService::CopyToFile(const std::wstring& targetPath, uint64_t& b
 {
 	bytesWritten = 0;
 
-	// 检查临时文件是否初始化
-	if (m_tempCacheFilePath.empty())
+	// 检查临时缓存是否初始化
+	if (!m_cacheStore.IsOpen())
 	{
-		Log("CopyToFile: 临时文件未初始化，路径为空");
+		Log("CopyToFile: 临时缓存未初始化");
 		return false;
 	}
 
-	if (!PathFileExistsW(m_tempCacheFilePath.c_str()))
+	// 保存前写出暂存数据（持久化点）
+	if (!Sync())
 	{
-		Log("CopyToFile: 临时文件不存在");
+		Log("CopyToFile: 暂存数据写出失败");
 		return false;
 	}
 
-	// 使用互斥锁保护，避免与AppendData冲突
-	std::lock_guard<std::mutex> lock(m_fileMutex);
-
 	try
 	{
-		// 记录开始时间和文件大小
+		// 复制调用时已写入缓存段的数据；不持有m_fileMutex，复制期间追加照常进行
 		uint64_t beforeCopyBytes = m_totalReceivedBytes.load();
-		Log("=== 开始流式复制 ===");
+		uint64_t targetSize = m_cacheStore.GetSize();
+		Log("=== 开始复制 ===");
 
 		// 转换目标路径为UTF-8字符串用于日志（使用安全转换）
 		std::string targetPathStr = StringUtils::Utf8EncodeWide(targetPath);
 		Log("目标文件: " + targetPathStr);
-		Log("源文件大小: " + std::to_string(beforeCopyBytes) + " 字节");
+		Log("源数据大小: " + std::to_string(targetSize) + " 字节");
 
-		// 刷新写入流，确保所有数据已落盘
-		if (m_tempCacheFile.is_open())
+		if (targetSize == 0)
 		{
-			m_tempCacheFile.flush();
-			LogDetail("CopyToFile: 已刷新写入流");
+			Log("CopyToFile: 缓存为空，无需复制");
+			return true; // 空文件也算成功
 		}
 
-		// 打开源文件（临时缓存文件）
-		std::ifstream sourceFile(m_tempCacheFilePath, std::ios::in | std::ios::binary);
-		if (!sourceFile.is_open())
+		HANDLE targetFile = CreateFileW(targetPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (targetFile == INVALID_HANDLE_VALUE)
 		{
-			Log("CopyToFile: 无法打开源文件进行读取");
+			Log("CopyToFile: 无法打开目标文件进行写入");
 			return false;
 		}
 
-		// 获取源文件大小
-		sourceFile.seekg(0, std::ios::end);
-		std::streamsize fileSize = sourceFile.tellg();
-		sourceFile.seekg(0, std::ios::beg);
-		LogDetail("CopyToFile: 源文件大小 " + std::to_string(fileSize) + " 字节");
-
-		if (fileSize <= 0)
+		// 预先扩展到最终大小，文件系统一次分配空间
+		LARGE_INTEGER distance = {};
+		distance.QuadPart = static_cast<LONGLONG>(targetSize);
+		if (SetFilePointerEx(targetFile, distance, nullptr, FILE_BEGIN) && SetEndOfFile(targetFile))
 		{
-			Log("CopyToFile: 源文件为空，无需复制");
-			sourceFile.close();
-			return true; // 空文件也算成功
+			distance.QuadPart = 0;
+			SetFilePointerEx(targetFile, distance, nullptr, FILE_BEGIN);
 		}
 
-		// 打开目标文件
-		std::ofstream targetFile(targetPath, std::ios::out | std::ios::binary | std::ios::trunc);
-		if (!targetFile.is_open())
-		{
-			Log("CopyToFile: 无法打开目标文件进行写入");
-			sourceFile.close();
-			return false;
-		}
-
-		// 使用64KB块大小进行流式复制
-		const size_t CHUNK_SIZE = 65536; // 64KB
-		std::vector<char> buffer(CHUNK_SIZE);
+		// 以映射段视图为源直接WriteFile：数据由系统从缓存段页面拷入目标文件，不经过中间缓冲区
+		const size_t COPY_WRITE_SIZE = 8 * 1024 * 1024; // 8MB
 		uint64_t totalCopied = 0;
-		uint64_t targetSize = static_cast<uint64_t>(fileSize);
-
-		LogDetail("CopyToFile: 开始分块复制，块大小 64KB");
+		bool success = true;
 
-		while (totalCopied < targetSize && !sourceFile.eof())
+		while (totalCopied < targetSize)
 		{
-			// 计算本次读取大小（保留size_t用于缓冲区操作）
-			uint64_t remainingBytes = targetSize - totalCopied;
-			size_t currentChunkSize = (remainingBytes < CHUNK_SIZE) ? static_cast<size_t>(remainingBytes) : CHUNK_SIZE;
-
-			// 从源文件读取
-			sourceFile.read(buffer.data(), static_cast<std::streamsize>(currentChunkSize));
-			std::streamsize actualRead = sourceFile.gcount();
-
-			if (actualRead > 0)
+			size_t request = static_cast<size_t>((std::min)(targetSize - totalCopied, static_cast<uint64_t>(COPY_WRITE_SIZE)));
+			CacheView view = m_cacheStore.ReadView(totalCopied, request);
+			if (view.IsEmpty())
 			{
-				// 写入目标文件
-				targetFile.write(buffer.data(), actualRead);
-				if (targetFile.fail())
-				{
-					Log("CopyToFile: 写入目标文件失败");
-					sourceFile.close();
-					targetFile.close();
-					return false;
-				}
-
-				totalCopied += static_cast<uint64_t>(actualRead);
-
-				// 记录进度（每1MB输出一次）
-				if (totalCopied % (1024 * 1024) == 0 || totalCopied == targetSize)
-				{
-					double progress = (static_cast<double>(totalCopied) / targetSize) * 100.0;
-					LogDetail("CopyToFile: 复制进度 " +
-						std::to_string(totalCopied) + "/" +
-						std::to_string(targetSize) + " 字节 (" +
-						std::to_string(static_cast<int>(progress)) + "%)");
-				}
+				Log("CopyToFile: 读取缓存段失败");
+				success = false;
+				break;
 			}
-			else
+
+			DWORD written = 0;
+			if (!WriteFile(targetFile, view.Data(), static_cast<DWORD>(view.GetSize()), &written, nullptr) || written != view.GetSize())
 			{
-				// 无法读取更多数据
-				if (sourceFile.eof())
-				{
-					LogDetail("CopyToFile: 到达源文件末尾");
-					break;
-				}
-				else if (sourceFile.fail())
-				{
-					Log("CopyToFile: 读取源文件时发生错误");
-					sourceFile.close();
-					targetFile.close();
-					return false;
-				}
+				Log("CopyToFile: 写入目标文件失败");
+				success = false;
+				break;
 			}
-		}
 
-		// 确保数据写入磁盘
-		targetFile.flush();
+			totalCopied += written;
+			LOG_DETAIL("CopyToFile: 复制进度 {}/{} 字节 ({}%)", totalCopied, targetSize, static_cast<int>((totalCopied * 100) / targetSize));
+		}
 
-		// 关闭文件
-		sourceFile.close();
-		targetFile.close();
+		CloseHandle(targetFile);
 
 		// 验证复制结果
-		bytesWritten = static_cast<uint64_t>(totalCopied);
-		if (totalCopied == targetSize)
-		{
-			Log("=== 流式复制成功 ===");
-			Log("成功复制 " + std::to_string(totalCopied) + " 字节");
-		}
-		else
+		bytesWritten = totalCopied;
+		if (!success)
 		{
-			Log("⚠️ 流式复制不完整");
+			Log("⚠️ 复制不完整");
 			Log("预期: " + std::to_string(targetSize) + " 字节");
 			Log("实际: " + std::to_string(totalCopied) + " 字节");
 			return false;
 		}
 
+		Log("=== 复制成功 ===");
+		Log("成功复制 " + std::to_string(totalCopied) + " 字节");
+
 		// 检测复制过程中是否有新数据写入
 		uint64_t afterCopyBytes = m_totalReceivedBytes.load();
 		if (afterCopyBytes > beforeCopyBytes)
 		{
 			size_t newDataSize = static_cast<size_t>(afterCopyBytes - beforeCopyBytes);
 			Log("⚠️ 检测到复制过程中有新数据写入: " + std::to_string(newDataSize) + " 字节");
-			Log("已保存的数据可能不完整，建议用户等待传输完成后重新保存");
+			Log("新数据未包含在本次保存中，建议用户等待传输完成后重新保存");
 		}
 
 		return true;
@@ -385,41 +413,25 @@ bool ReceiveCacheService::CopyToFile(const std::wstring& targetPath, uint64_t& b
 
 bool ReceiveCacheService::VerifyFileIntegrity()
 {
-	if (m_tempCacheFilePath.empty())
-	{
-		Log("验证失败：临时文件路径为空");
-		return false;
-	}
-
-	if (!PathFileExistsW(m_tempCacheFilePath.c_str()))
-	{
-		Log("验证失败：临时文件不存在");
-		return false;
-	}
-
-	// 获取文件实际大小
-	WIN32_FILE_ATTRIBUTE_DATA fileAttr;
-	if (!GetFileAttributesExW(m_tempCacheFilePath.c_str(), GetFileExInfoStandard, &fileAttr))
+	if (!m_cacheStore.IsOpen())
 	{
-		Log("验证失败：无法获取文件属性");
+		Log("验证失败：缓存段未打开");
 		return false;
 	}
 
-	LARGE_INTEGER fileSize;
-	fileSize.LowPart = fileAttr.nFileSizeLow;
-	fileSize.HighPart = fileAttr.nFileSizeHigh;
-
-	// 验证文件大小与统计数据一致性
-	uint64_t receivedBytes = m_totalReceivedBytes.load();
-	if (static_cast<uint64_t>(fileSize.QuadPart) != receivedBytes)
+	// 验证缓存大小与统计数据一致性（写后模式下暂存环中的数据尚未写入缓存段）
+	uint64_t cachedSize = m_cacheStore.GetSize();
+	uint64_t receivedBytes = m_totalReceivedBytes.load() - GetStagedBytes();
+	if (cachedSize != receivedBytes)
 	{
-		Log("完整性验证：文件大小不匹配");
-		Log("文件实际大小: " + std::to_string(fileSize.QuadPart) + " 字节");
+		Log("完整性验证：缓存大小不匹配");
+		Log("缓存段已写入: " + std::to_string(cachedSize) + " 字节");
 		Log("统计接收字节: " + std::to_string(receivedBytes) + " 字节");
 		return false;
 	}
 
-	Log("完整性验证通过：文件大小 " + std::to_string(fileSize.QuadPart) + " 字节");
+	Log("完整性验证通过：缓存大小 " + std::to_string(cachedSize) + " 字节，" +
+		std::to_string(m_cacheStore.GetSegmentCount()) + " 段");
 	return true;
 }
 
@@ -434,66 +446,19 @@ bool ReceiveCacheService::CheckAndRecover()
 		return false;
 	}
 
-	// 检查文件流状态
-	if (m_tempCacheFile.is_open())
+	if (m_cacheStore.IsOpen())
 	{
-		// 验证文件流的健康状态
-		if (m_tempCacheFile.good())
-		{
-			Log("临时文件流状态正常，无需恢复");
-			return true;
-		}
-		else
-		{
-			Log("检测到文件流状态异常，开始修复...");
-			// 关闭异常的文件流
-			m_tempCacheFile.close();
-		}
-	}
-
-	// 文件流已关闭，尝试重新打开
-	Log("尝试重新打开临时文件");
-
-	if (m_tempCacheFilePath.empty())
-	{
-		Log("❌ 恢复失败：临时文件路径为空，尝试重新初始化");
-		return Initialize();
+		Log("缓存段状态正常，无需恢复");
+		return true;
 	}
 
-	try
+	// 缓存段关闭时段文件已随之删除，无法续写，只能重新创建
+	Log("❌ 缓存段已关闭，重新初始化临时缓存（此前缓存的数据已丢失）");
+	if (!m_tempCacheFilePath.empty())
 	{
-		// 使用追加模式重新打开，避免覆盖已有数据
-		m_tempCacheFile.open(m_tempCacheFilePath, std::ios::out | std::ios::binary | std::ios::app);
-
-		if (m_tempCacheFile.is_open())
-		{
-			Log("✅ 临时文件恢复成功");
-
-			// 验证文件完整性
-			if (VerifyFileIntegrity())
-			{
-				Log("✅ 文件完整性验证通过");
-				return true;
-			}
-			else
-			{
-				Log("⚠️ 文件完整性验证失败，但文件流已恢复");
-				// 即使完整性验证失败，文件流已经恢复，可以继续写入
-				return true;
-			}
-		}
-		else
-		{
-			Log("❌ 文件流打开失败，尝试重新创建临时文件");
-			return Initialize();
-		}
-	}
-	catch (const std::exception& e)
-	{
-		Log("❌ 文件恢复异常: " + std::string(e.what()));
-		Log("尝试重新初始化临时文件...");
-		return Initialize();
+		DeleteFileW(m_tempCacheFilePath.c_str());
 	}
+	return Initialize();
 }
 
 // ==================== 统计信息接口 ====================
@@ -505,27 +470,58 @@ uint64_t ReceiveCacheService::GetTotalReceivedBytes() const
 
 uint64_t ReceiveCacheService::GetFileSize() const
 {
-	if (m_tempCacheFilePath.empty() || !PathFileExistsW(m_tempCacheFilePath.c_str()))
-	{
-		return 0;
-	}
+	return m_cacheStore.GetSize();
+}
+
+std::wstring ReceiveCacheService::GetFilePath() const
+{
+	return m_tempCacheFilePath;
+}
+
+// ==================== 持久化点 ====================
 
-	WIN32_FILE_ATTRIBUTE_DATA fileAttr;
-	if (!GetFileAttributesExW(m_tempCacheFilePath.c_str(), GetFileExInfoStandard, &fileAttr))
+bool ReceiveCacheService::Sync(DWORD timeoutMs)
+{
+	const uint64_t target = m_stagedTotal.load();
+	if (m_flushedTotal.load() >= target)
 	{
-		return 0;
+		return true;
 	}
 
-	LARGE_INTEGER fileSize;
-	fileSize.LowPart = fileAttr.nFileSizeLow;
-	fileSize.HighPart = fileAttr.nFileSizeHigh;
+	std::unique_lock<std::mutex> lock(m_flushMutex);
+	m_syncTarget = (std::max)(m_syncTarget, target);
+	m_flushCondition.notify_one();
 
-	return static_cast<uint64_t>(fileSize.QuadPart);
+	auto flushed = [this, target] { return m_flushedTotal.load() >= target || !m_flusherRunning.load(); };
+	if (timeoutMs == INFINITE)
+	{
+		m_syncCondition.wait(lock, flushed);
+	}
+	else if (!m_syncCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), flushed))
+	{
+		return false;
+	}
+	return m_flushedTotal.load() >= target;
 }
 
-std::wstring ReceiveCacheService::GetFilePath() const
+bool ReceiveCacheService::Checkpoint()
 {
-	return m_tempCacheFilePath;
+	if (!Sync())
+	{
+		return false;
+	}
+
+	if (!m_cacheStore.IsOpen())
+	{
+		return false;
+	}
+
+	bool success = m_cacheStore.Flush();
+	if (!success)
+	{
+		Log("Checkpoint: 缓存段刷新失败");
+	}
+	return success;
 }
 
 // 【第七轮修复】删除 IsMemoryCacheValid() 方法 - 内存缓存已完全删除
@@ -543,226 +539,334 @@ void ReceiveCacheService::SetLogCallback(LogCallback callback)
 	m_logCallback = callback;
 }
 
-// ==================== 内部方法 ====================
-
-bool ReceiveCacheService::WriteDataUnlocked(const std::vector<uint8_t>& data)
+void ReceiveCacheService::SetWriteBehind(bool enable, const WriteBehindConfig& config)
 {
-	if (data.empty())
+	// 重新配置时先写出暂存数据并停止现有刷新线程
+	StopFlusher();
+
+	if (!enable)
 	{
-		return false;
+		m_writeBehindEnabled = false;
+		return;
 	}
 
-	// 如果文件流被关闭（如正在读取），将数据加入待写入队列
-	if (!m_tempCacheFile.is_open())
+	m_writeBehindConfig = config;
+	m_writeBehindConfig.stagingCapacity = (std::max)(config.stagingCapacity, static_cast<size_t>(4096));
+	m_stagingBuffer.reset(new SpscRingBuffer<uint8_t>(m_writeBehindConfig.stagingCapacity));
+	// 阈值不超过容量一半：暂存量低于阈值时总有足够空间容纳一段数据，追加者只在刷新线程已被唤醒后才会等待
+	m_writeBehindConfig.stagingCapacity = m_stagingBuffer->GetCapacity();
+	m_writeBehindConfig.flushThresholdBytes = (std::min)((std::max)(config.flushThresholdBytes, static_cast<size_t>(1)),
+		m_writeBehindConfig.stagingCapacity / 2);
+
+	m_flusherStop = false;
+	m_flusherRunning = true;
+	m_flusherThread = std::thread(&ReceiveCacheService::FlusherThread, this);
+	m_writeBehindEnabled = true;
+
+	Log("接收缓存写后模式已启用，暂存环 " + std::to_string(m_writeBehindConfig.stagingCapacity) +
+		" 字节，刷新阈值 " + std::to_string(m_writeBehindConfig.flushThresholdBytes) +
+		" 字节/" + std::to_string(m_writeBehindConfig.flushIntervalMs) + "ms");
+}
+
+size_t ReceiveCacheService::GetStagedBytes() const
+{
+	return static_cast<size_t>(m_stagedTotal.load() - m_flushedTotal.load());
+}
+
+void ReceiveCacheService::SetRecordIndexEnabled(bool enable)
+{
+	std::lock_guard<std::mutex> lock(m_indexMutex);
+	m_recordIndexEnabled = enable;
+
+	if (!enable)
 	{
-		m_pendingWrites.push(data);
-		Log("临时缓存文件流已关闭，数据加入待写入队列，大小: " + std::to_string(data.size()) + " 字节");
-		return true; // 返回成功，数据将在文件重新打开时写入
+		m_recordIndex.Close();
 	}
-
-	try
+	else if (!m_recordIndex.IsOpen() && IsInitialized())
 	{
-		// 先处理队列中的待写入数据
-		while (!m_pendingWrites.empty())
-		{
-			const auto& pendingData = m_pendingWrites.front();
-			m_tempCacheFile.write(reinterpret_cast<const char*>(pendingData.data()), pendingData.size());
-			if (m_tempCacheFile.fail())
-			{
-				Log("写入待处理数据失败，队列大小: " + std::to_string(m_pendingWrites.size()));
-				return false;
-			}
-			m_totalReceivedBytes += pendingData.size();
-			m_pendingWrites.pop();
-		}
+		OpenRecordIndexLocked();
+	}
+}
 
-		// 写入当前数据
-		m_tempCacheFile.write(reinterpret_cast<const char*>(data.data()), data.size());
-		if (m_tempCacheFile.fail())
-		{
-			Log("写入当前数据到临时缓存文件失败，大小: " + std::to_string(data.size()) + " 字节");
-			return false;
-		}
+uint64_t ReceiveCacheService::GetRecordCount() const
+{
+	std::lock_guard<std::mutex> lock(m_indexMutex);
+	return m_recordIndex.IsOpen() ? m_recordIndex.GetCount() : 0;
+}
 
-		m_tempCacheFile.flush(); // 确保数据立即写入磁盘
-		m_totalReceivedBytes += data.size();
+bool ReceiveCacheService::GetRecord(uint64_t index, CacheRecord& record) const
+{
+	std::lock_guard<std::mutex> lock(m_indexMutex);
+	return m_recordIndex.IsOpen() && m_recordIndex.GetRecord(index, record);
+}
 
-		Log("成功写入临时缓存文件，大小: " + std::to_string(data.size()) + " 字节，总计: " + std::to_string(m_totalReceivedBytes.load()) + " 字节");
-		return true;
+bool ReceiveCacheService::FindRecordByTime(uint64_t unixMicroseconds, uint64_t& index) const
+{
+	std::lock_guard<std::mutex> lock(m_indexMutex);
+	if (!m_recordIndex.IsOpen())
+	{
+		return false;
 	}
-	catch (const std::exception& e)
+
+	index = m_recordIndex.FindByTime(m_recordIndex.ToTimestamp(unixMicroseconds));
+	return index < m_recordIndex.GetCount();
+}
+
+bool ReceiveCacheService::FindRecordByOffset(uint64_t offset, uint64_t& index) const
+{
+	std::lock_guard<std::mutex> lock(m_indexMutex);
+	if (!m_recordIndex.IsOpen())
 	{
-		Log("写入临时缓存文件异常: " + std::string(e.what()));
 		return false;
 	}
+
+	index = m_recordIndex.FindByOffset(offset);
+	return index < m_recordIndex.GetCount();
 }
 
-std::vector<uint8_t> ReceiveCacheService::ReadDataUnlocked(uint64_t offset, size_t length)
+uint64_t ReceiveCacheService::GetRecordUnixTime(const CacheRecord& record) const
 {
-	std::vector<uint8_t> result;
+	std::lock_guard<std::mutex> lock(m_indexMutex);
+	return m_recordIndex.ToUnixTime(record.timestamp);
+}
 
-	try
+// ==================== 内部方法 ====================
+
+bool ReceiveCacheService::StageData(const uint8_t* data, size_t size, CacheDirection direction, uint16_t sourcePort)
+{
+	std::lock_guard<std::mutex> lock(m_stagingMutex);
+	if (!m_flusherRunning.load() || m_flusherStop.load())
 	{
-		// 记录读取前的总接收字节数（用于检测并发写入）
-		uint64_t beforeReadBytes = m_totalReceivedBytes.load();
-		LogDetail("ReadDataUnlocked: 读取前总接收字节数 " + std::to_string(beforeReadBytes) + " 字节");
+		return false;
+	}
 
-		// 刷新写入流但保持打开（避免读写冲突）
-		if (m_tempCacheFile.is_open())
-		{
-			m_tempCacheFile.flush();
-			LogDetail("ReadDataUnlocked: 刷新写入流，保持文件流打开状态");
-		}
+	// 分段暂存的一次追加仍只对应一条索引记录，在全部暂存后追加
+	const uint64_t recordOffset = m_totalReceivedBytes.load();
+	const size_t recordSize = size;
+
+	SpscRingBuffer<uint8_t>& staging = *m_stagingBuffer;
+	const size_t threshold = m_writeBehindConfig.flushThresholdBytes;
+	const size_t maxSegment = staging.GetCapacity() - threshold;
+
+	while (size > 0)
+	{
+		// 空间不足时WriteWait阻塞到刷新线程取出数据（此时暂存量已超过阈值，刷新线程已被唤醒）
+		size_t count = (std::min)(size, maxSegment);
+		staging.WriteWait(data, count);
 
-		// 使用独立的ifstream进行读取
-		std::ifstream file(m_tempCacheFilePath, std::ios::in | std::ios::binary);
-		if (!file.is_open())
+		m_totalReceivedBytes += count;
+		m_stagedTotal += count;
+		data += count;
+		size -= count;
+
+		if (staging.GetSize() >= threshold)
 		{
-			Log("ReadDataUnlocked: 无法打开临时缓存文件进行读取");
-			return result;
+			std::lock_guard<std::mutex> flushLock(m_flushMutex);
+			m_flushCondition.notify_one();
 		}
+	}
 
-		// 获取文件大小
-		file.seekg(0, std::ios::end);
-		std::streamsize fileSize = file.tellg();
-		file.seekg(0, std::ios::beg);
-		LogDetail("ReadDataUnlocked: 临时缓存文件大小 " + std::to_string(fileSize) + " 字节");
+	if (m_recordIndexEnabled.load())
+	{
+		AppendRecord(recordOffset, recordSize, direction, sourcePort);
+	}
+	return true;
+}
 
-		if (fileSize <= 0)
+void ReceiveCacheService::AppendRecord(uint64_t offset, size_t size, CacheDirection direction, uint16_t sourcePort)
+{
+	std::lock_guard<std::mutex> lock(m_indexMutex);
+	if (!m_recordIndex.IsOpen())
+	{
+		return;
+	}
+
+	uint64_t remaining = size;
+	while (remaining > 0)
+	{
+		uint32_t length = static_cast<uint32_t>((std::min)(remaining, static_cast<uint64_t>(UINT32_MAX)));
+		if (!m_recordIndex.Append(offset, length, direction, sourcePort))
 		{
-			Log("ReadDataUnlocked: 文件为空");
-			file.close();
-			return result;
+			m_recordIndex.Close();
+			Log("记录索引写入失败（索引段创建或映射失败），索引已关闭");
+			return;
 		}
+		offset += length;
+		remaining -= length;
+	}
+}
 
-		// 计算读取长度（0表示读取全部）
-		size_t availableLength = static_cast<size_t>(fileSize - offset);
-		size_t targetReadLength = (length == 0) ? static_cast<size_t>(fileSize) : (length < availableLength ? length : availableLength);
+void ReceiveCacheService::OpenRecordIndexLocked()
+{
+	if (m_recordIndex.Open(m_tempCacheFilePath + L".idx"))
+	{
+		LOG_DETAIL("记录索引已创建");
+	}
+	else
+	{
+		Log("创建记录索引失败，追加数据不再建立索引");
+	}
+}
 
-		if (targetReadLength > 0 && offset < static_cast<uint64_t>(fileSize))
+void ReceiveCacheService::FlusherThread()
+{
+	SpscRingBuffer<uint8_t>& staging = *m_stagingBuffer;
+	const size_t threshold = m_writeBehindConfig.flushThresholdBytes;
+
+	while (true)
+	{
+		bool discard = false;
 		{
-			LogDetail("ReadDataUnlocked: 开始分块循环读取，目标长度 " + std::to_string(targetReadLength) + " 字节");
+			std::unique_lock<std::mutex> lock(m_flushMutex);
+			m_flushCondition.wait_for(lock, std::chrono::milliseconds(m_writeBehindConfig.flushIntervalMs), [this, &staging, threshold] {
+				uint64_t flushed = m_flushedTotal.load();
+				return m_flusherStop.load() || staging.GetSize() >= threshold || flushed < m_syncTarget || flushed < m_discardTarget;
+			});
+			discard = m_flushedTotal.load() < m_discardTarget;
+		}
 
-			// 实施分块循环读取机制
-			try
-			{
-				// 预分配内存，提高性能
-				result.reserve(targetReadLength);
-
-				// 设置64KB块大小进行循环读取
-				const size_t CHUNK_SIZE = 65536; // 64KB
-				std::vector<char> chunk(CHUNK_SIZE);
-
-				file.seekg(offset);
-				size_t totalBytesRead = 0;
-				size_t remainingBytes = targetReadLength;
-
-				LogDetail("ReadDataUnlocked: 使用64KB分块循环读取策略");
-
-				while (remainingBytes > 0 && !file.eof())
-				{
-					// 计算本次读取大小
-					size_t currentChunkSize = (CHUNK_SIZE < remainingBytes) ? CHUNK_SIZE : remainingBytes;
-
-					// 读取数据块
-					file.read(chunk.data(), static_cast<std::streamsize>(currentChunkSize));
-					std::streamsize actualRead = file.gcount();
-
-					if (actualRead > 0)
-					{
-						// 将读取的数据追加到结果向量
-						size_t actualReadSize = static_cast<size_t>(actualRead);
-						result.insert(result.end(), chunk.begin(), chunk.begin() + actualReadSize);
-						totalBytesRead += actualReadSize;
-						remainingBytes -= actualReadSize;
-
-						// 记录读取进度（每10MB输出一次）
-						if (totalBytesRead % (10 * 1024 * 1024) == 0 || remainingBytes == 0)
-						{
-							LogDetail("ReadDataUnlocked: 读取进度 " +
-								std::to_string(totalBytesRead) + "/" +
-								std::to_string(targetReadLength) + " 字节 (" +
-								std::to_string((totalBytesRead * 100) / targetReadLength) + "%)");
-						}
-					}
-					else
-					{
-						// 无法再读取数据
-						if (file.eof())
-						{
-							LogDetail("ReadDataUnlocked: 到达文件末尾，读取完成");
-							break;
-						}
-						else if (file.fail())
-						{
-							Log("ReadDataUnlocked: 读取过程中发生错误");
-							break;
-						}
-					}
-				}
-
-				// 数据完整性验证
-				if (totalBytesRead == targetReadLength)
-				{
-					Log("ReadDataUnlocked: ✅ 数据读取完整，成功读取 " +
-						std::to_string(totalBytesRead) + " 字节");
-				}
-				else
-				{
-					Log("ReadDataUnlocked: ⚠️ 数据读取不完整 - 预期: " +
-						std::to_string(targetReadLength) + " 字节，实际: " +
-						std::to_string(totalBytesRead) + " 字节");
-
-					if (totalBytesRead == 0)
-					{
-						Log("ReadDataUnlocked: ❌ 未读取到任何数据，清空结果");
-						result.clear();
-					}
-				}
-			}
-			catch (const std::exception& e)
+		// 只取本批开始时已暂存的数据，持续追加时也能按批返回检查同步与停止请求
+		size_t count = staging.GetSize();
+		if (count == 0)
+		{
+			// 停止请求发出后不再有追加，暂存环为空即可退出
+			if (m_flusherStop.load())
 			{
-				Log("ReadDataUnlocked: ❌ 分块读取过程中发生异常: " + std::string(e.what()));
-				result.clear();
+				break;
 			}
+			continue;
 		}
 
-		file.close();
+		// 写入失败的数据同样取出（与直写模式一致：记录日志后丢弃），避免追加者无限等待
+		WriteStagedBatch(count, discard);
+
+		m_flushedTotal += count;
+		std::lock_guard<std::mutex> lock(m_flushMutex);
+		m_syncCondition.notify_all();
+	}
 
-		// 检测读取过程中是否有新数据写入
-		uint64_t afterReadBytes = m_totalReceivedBytes.load();
-		if (afterReadBytes > beforeReadBytes)
+	m_flusherRunning = false;
+	std::lock_guard<std::mutex> lock(m_flushMutex);
+	m_syncCondition.notify_all();
+}
+
+bool ReceiveCacheService::WriteStagedBatch(size_t count, bool discard)
+{
+	SpscRingBuffer<uint8_t>& staging = *m_stagingBuffer;
+	std::lock_guard<std::mutex> lock(m_fileMutex);
+
+	bool writable = !discard;
+	if (writable && m_useTempCacheFile && !m_cacheStore.IsOpen())
+	{
+		Log("⚠️ 检测到缓存段已关闭，启动自动恢复...");
+		if (!CheckAndRecover())
 		{
-			size_t newDataSize = static_cast<size_t>(afterReadBytes - beforeReadBytes);
-			Log("⚠️ 检测到读取过程中有新数据写入: " + std::to_string(newDataSize) + " 字节");
-			Log("读取前: " + std::to_string(beforeReadBytes) + " 字节, 读取后: " + std::to_string(afterReadBytes) + " 字节");
-			Log("当前返回的数据可能不完整，建议用户等待传输完成后重新保存");
+			Log("❌ 临时文件自动恢复失败，暂存数据将丢失: " + std::to_string(count) + " 字节");
+			writable = false;
 		}
-		else
+	}
+	writable = writable && m_cacheStore.IsOpen();
+
+	// 直接从暂存环的连续区写入缓存段，按刷新阈值分段释放空间，追加者无需等整批写完即可继续暂存
+	bool success = writable;
+	const size_t pieceLimit = m_writeBehindConfig.flushThresholdBytes;
+	size_t remaining = count;
+	while (remaining > 0)
+	{
+		const uint8_t* span = nullptr;
+		size_t spanSize = (std::min)((std::min)(staging.GetReadSpan(span), remaining), pieceLimit);
+		if (writable && !m_cacheStore.Append(span, spanSize))
 		{
-			LogDetail("✅ 数据完整性验证通过，读取期间无新数据写入");
+			Log("写后刷新失败（缓存段创建或映射失败），暂存数据将丢失: " + std::to_string(remaining) + " 字节");
+			writable = false;
+			success = false;
 		}
+		staging.CommitRead(spanSize);
+		remaining -= spanSize;
+	}
 
-		return result;
+	if (success)
+	{
+		LOG_DETAIL("写后刷新: {} 字节，总接收字节数: {} 字节", count, m_totalReceivedBytes.load());
 	}
-	catch (const std::exception& e)
+	return success;
+}
+
+void ReceiveCacheService::DiscardStagedData()
+{
+	const uint64_t target = m_stagedTotal.load();
+	if (m_flushedTotal.load() >= target)
 	{
-		Log("ReadDataUnlocked: 读取异常 - " + std::string(e.what()));
-		return result;
+		return;
 	}
+
+	std::unique_lock<std::mutex> lock(m_flushMutex);
+	m_discardTarget = (std::max)(m_discardTarget, target);
+	m_flushCondition.notify_one();
+	m_syncCondition.wait(lock, [this, target] { return m_flushedTotal.load() >= target || !m_flusherRunning.load(); });
 }
 
-void ReceiveCacheService::Log(const std::string& message)
+void ReceiveCacheService::StopFlusher()
 {
-	if (m_logCallback)
 	{
-		m_logCallback(message);
+		// 持有生产者锁置位：之后的追加改走直写，不会再进入暂存环
+		std::lock_guard<std::mutex> stagingLock(m_stagingMutex);
+		m_flusherStop = true;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_flushMutex);
+		m_flushCondition.notify_one();
+	}
+
+	if (m_flusherThread.joinable())
+	{
+		m_flusherThread.join();
 	}
 }
 
-void ReceiveCacheService::LogDetail(const std::string& message)
+bool ReceiveCacheService::WriteDataUnlocked(const std::vector<uint8_t>& data)
 {
-	if (m_verboseLogging && m_logCallback)
+	if (data.empty())
+	{
+		return false;
+	}
+
+	// 如果缓存段已关闭，将数据加入待写入队列
+	if (!m_cacheStore.IsOpen())
+	{
+		m_pendingWrites.push(data);
+		Log("临时缓存段已关闭，数据加入待写入队列，大小: " + std::to_string(data.size()) + " 字节");
+		return true; // 返回成功，数据将在缓存段重新打开时写入
+	}
+
+	// 先处理队列中的待写入数据
+	while (!m_pendingWrites.empty())
+	{
+		const auto& pendingData = m_pendingWrites.front();
+		if (!m_cacheStore.Append(pendingData.data(), pendingData.size()))
+		{
+			Log("写入待处理数据失败，队列大小: " + std::to_string(m_pendingWrites.size()));
+			return false;
+		}
+		m_totalReceivedBytes += pendingData.size();
+		m_pendingWrites.pop();
+	}
+
+	// 写入当前数据
+	if (!m_cacheStore.Append(data.data(), data.size()))
+	{
+		Log("写入当前数据到临时缓存段失败，大小: " + std::to_string(data.size()) + " 字节");
+		return false;
+	}
+	m_totalReceivedBytes += data.size();
+
+	Log("成功写入临时缓存段，大小: " + std::to_string(data.size()) + " 字节，总计: " + std::to_string(m_totalReceivedBytes.load()) + " 字节");
+	return true;
+}
+
+void ReceiveCacheService::Log(const std::string& message)
+{
+	if (m_logCallback)
 	{
 		m_logCallback(message);
 	}
@@ -770,15 +874,20 @@ void ReceiveCacheService::LogDetail(const std::string& message)
 
 void ReceiveCacheService::LogFileStatus(const std::string& context)
 {
-	LogDetail("--- " + context + " ---");
+	if (!m_verboseLogging)
+	{
+		return;
+	}
+
+	LOG_DETAIL("--- {} ---", context);
 	// 将wstring转换为string用于日志输出（使用安全转换）
 	std::string tempFilePathStr = StringUtils::Utf8EncodeWide(m_tempCacheFilePath);
-	LogDetail("临时文件路径: " + tempFilePathStr);
-	LogDetail("文件流打开状态: " + std::string(m_tempCacheFile.is_open() ? "是" : "否"));
-	LogDetail("文件流状态: " + std::string(m_tempCacheFile.good() ? "正常" : "异常"));
-	LogDetail("总接收字节数: " + std::to_string(m_totalReceivedBytes.load()) + " 字节");
+	LOG_DETAIL("临时文件路径: {}", tempFilePathStr);
+	LOG_DETAIL("缓存段打开状态: {}", m_cacheStore.IsOpen() ? "是" : "否");
+	LOG_DETAIL("缓存段数: {}，已映射: {}", m_cacheStore.GetSegmentCount(), m_cacheStore.GetMappedSegmentCount());
+	LOG_DETAIL("总接收字节数: {} 字节", m_totalReceivedBytes.load());
 	// 【第七轮修复】删除内存缓存日志 - 不再维护内存镜像
-	// LogDetail("内存缓存大小: " + std::to_string(m_memoryCache.size()) + " 字节");
-	// LogDetail("内存缓存有效性: " + std::string(m_memoryCacheValid ? "有效" : "无效"));
-	LogDetail("实际文件大小: " + std::to_string(GetFileSize()) + " 字节");
+	// LOG_DETAIL("内存缓存大小: {} 字节", m_memoryCache.size());
+	// LOG_DETAIL("内存缓存有效性: {}", m_memoryCacheValid ? "有效" : "无效");
+	LOG_DETAIL("缓存大小: {} 字节", GetFileSize());
 }
\ No newline at end of file
@@ -3,12 +3,26 @@
 
 #include <string>
 #include <vector>
-#include <fstream>
 #include <queue>
 #include <mutex>
 #include <functional>
 #include <cstdint>
 #include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <memory>
+#include <Windows.h>
+#include "RingBuffer.h"
+#include "SegmentedCacheStore.h"
+#include "CacheRecordIndex.h"
+
+// 接收缓存写后模式配置
+struct WriteBehindConfig
+{
+	size_t stagingCapacity = 4 * 1024 * 1024;   // 暂存环容量（字节，向上取整为2的幂）
+	size_t flushThresholdBytes = 256 * 1024;    // 暂存量达到该值立即刷新（不超过容量的一半）
+	DWORD flushIntervalMs = 20;                 // 暂存数据最长停留时间（毫秒）
+};
 
 /**
  * @brief 接收缓存服务
@@ -22,12 +36,23 @@
  * - 内存缓存+磁盘文件双重保障（确保数据不丢失）
  * - 文件完整性校验与自动恢复机制
  * - 统计信息跟踪（总接收字节数、文件大小等）
- * - 支持分块循环读取大文件（避免内存溢出）
+ * - 缓存由SegmentedCacheStore按64MB分段并内存映射，随机读取O(1)定位段，ReadView返回零拷贝视图
  *
  * 线程安全性：
- * - 所有数据追加和读取操作使用互斥锁保护
- * - 写入流与读取流分离，避免读写冲突
- * - 待写入队列机制处理读取期间的新数据
+ * - 追加操作由m_fileMutex串行化（缓存为单写者）
+ * - 读取按已发布的长度直接访问映射段，不持有m_fileMutex，读取与保存不阻塞追加
+ * - 待写入队列机制处理缓存段关闭期间的新数据
+ *
+ * 写后模式（SetWriteBehind）：
+ * - AppendData只把数据拷入内存暂存环（SpscRingBuffer），不做文件I/O、不输出日志
+ * - 刷新线程在暂存量达到阈值或间隔到期时直接从暂存环批量写入缓存段
+ * - 暂存环满时AppendData等待刷新线程腾出空间，数据不丢弃
+ * - ReadData/ReadView/CopyToFile先调用Sync，保证读到调用前追加的全部数据
+ *
+ * 记录索引（SetRecordIndexEnabled，默认关闭）：
+ * - 每次AppendData追加一条CacheRecord（数据偏移、长度、单调时间戳、方向、来源端口）到旁路索引段文件
+ * - 索引与缓存同样分段映射，内存占用不随记录数增长；按序号O(1)读取，按时间、按偏移二分查找
+ * - 偏移为接收流中的逻辑偏移（与GetTotalReceivedBytes同一坐标），可直接用于ReadData/ReadView
  *
  * 使用示例：
  * @code
@@ -76,8 +101,7 @@ public:
 	 * @return 初始化是否成功
 	 *
 	 * 说明：
-	 * - 在系统临时目录创建临时文件（前缀"PM_"）
-	 * - 打开文件流用于二进制写入（trunc模式）
+	 * - 在系统临时目录创建临时文件（前缀"PM_"），以其路径为前缀创建缓存段文件
 	 * - 重置统计计数器（总接收字节数、总发送字节数）
 	 * - 清空内存缓存
 	 */
@@ -87,7 +111,7 @@ public:
 	 * @brief 关闭并删除临时缓存文件
 	 *
 	 * 说明：
-	 * - 关闭文件流
+	 * - 关闭缓存段（段文件由系统随句柄关闭删除）
 	 * - 删除临时文件（如果存在）
 	 * - 重置所有状态和统计数据
 	 */
@@ -109,11 +133,12 @@ public:
 	 * 说明：
 	 * - 使用接收文件专用互斥锁，确保与保存操作完全互斥
 	 * - 立即更新内存缓存（作为备份，保证数据完整性）
-	 * - 如果临时文件流关闭，自动尝试恢复
-	 * - 强制同步写入临时文件（flush确保数据真正落盘）
+	 * - 如果缓存段已关闭，自动尝试恢复
+	 * - 直接拷入当前缓存段的映射视图，返回后对读取者立即可见
 	 * - 更新总接收字节数统计
+	 * - 记录索引启用时追加一条记录（direction/sourcePort仅写入索引）
 	 */
-	bool AppendData(const std::vector<uint8_t>& data);
+	bool AppendData(const std::vector<uint8_t>& data, CacheDirection direction = CacheDirection::Receive, uint16_t sourcePort = 0);
 
 	/**
 	 * @brief 从临时缓存读取指定范围的数据
@@ -122,14 +147,22 @@ public:
 	 * @return 读取的数据，失败返回空向量
 	 *
 	 * 说明：
-	 * - 使用接收文件专用互斥锁，与写入操作完全互斥
-	 * - 刷新写入流但保持打开（避免读写冲突）
-	 * - 使用独立的ifstream进行读取（不影响写入流）
-	 * - 采用分块循环读取机制（64KB块大小）
-	 * - 数据完整性验证（检测读取期间是否有新数据写入）
+	 * - 从映射段拷贝，可跨段；不持有m_fileMutex，读取期间追加照常进行
+	 * - 读取范围以调用时已写入缓存段的长度为准
 	 */
 	std::vector<uint8_t> ReadData(uint64_t offset, size_t length);
 
+	/**
+	 * @brief 零拷贝读取：返回指向映射段内数据的只读视图
+	 * @param offset 起始偏移量（字节）
+	 * @param length 最大长度（字节）
+	 * @return 视图，在段边界处截断（调用方按返回长度循环）；越界或失败返回空视图
+	 *
+	 * 说明：
+	 * - 持有视图期间所在段保持映射，Shutdown后视图仍可安全访问
+	 */
+	CacheView ReadView(uint64_t offset, size_t length);
+
 	/**
 	 * @brief 读取所有缓存数据
 	 * @return 所有缓存数据，失败返回空向量
@@ -143,14 +176,37 @@ public:
 	 * @return 复制是否成功
 	 *
 	 * 说明：
-	 * - 使用流式I/O，按64KB块大小循环读取和写入，避免大文件内存溢出
-	 * - 复用m_fileMutex，确保与AppendData操作互斥，保证数据一致性
+	 * - 以映射段视图为源直接WriteFile到目标文件（每次8MB），不经过中间缓冲区
+	 * - 复制调用时已写入缓存段的数据，不持有m_fileMutex，复制期间追加照常进行
 	 * - 提供详细的进度日志（开始/进度/完成/异常）
 	 * - 若临时文件不存在或未初始化，返回false并记录日志
 	 * - 成功后通过bytesWritten参数返回实际写入的字节数
 	 */
 	bool CopyToFile(const std::wstring& targetPath, uint64_t& bytesWritten);
 
+	// ========== 持久化点 ==========
+
+	/**
+	 * @brief 等待暂存数据写入临时文件
+	 * @param timeoutMs 超时（毫秒）
+	 * @return 调用前追加的数据是否已全部写入文件
+	 *
+	 * 说明：
+	 * - 写入缓存段后对ReadData/ReadView/CopyToFile可见（未必落盘）
+	 * - 直写模式下追加即已写入缓存段，直接返回true
+	 * - 不可在持有m_fileMutex时调用
+	 */
+	bool Sync(DWORD timeoutMs = INFINITE);
+
+	/**
+	 * @brief 检查点：Sync后将缓存段刷到磁盘（FlushViewOfFile + FlushFileBuffers）
+	 * @return 是否成功
+	 *
+	 * 说明：
+	 * - 适用于保存等需要确认数据已落盘的操作，开销为一次磁盘同步
+	 */
+	bool Checkpoint();
+
 	/**
 	 * @brief 获取内存缓存数据（已删除）
 	 * 【第七轮修复】内存缓存已完全删除，仅保留文件缓存
@@ -164,9 +220,9 @@ public:
 	 * @return 验证是否通过
 	 *
 	 * 说明：
-	 * - 检查临时文件是否存在
-	 * - 获取文件实际大小
-	 * - 与统计的总接收字节数比对
+	 * - 检查缓存段是否打开
+	 * - 获取缓存段已写入的字节数
+	 * - 与统计的总接收字节数（扣除暂存环中的数据）比对
 	 * - 不匹配则返回false并记录详细日志
 	 */
 	bool VerifyFileIntegrity();
@@ -176,10 +232,8 @@ public:
 	 * @return 恢复是否成功
 	 *
 	 * 说明：
-	 * - 检查文件流状态（is_open、good）
-	 * - 如果文件流关闭或异常，尝试重新打开（append模式）
-	 * - 如果文件路径为空，重新初始化临时文件
-	 * - 恢复成功后执行完整性验证
+	 * - 检查缓存段是否打开
+	 * - 缓存段关闭时段文件已随之删除，重新初始化临时缓存（此前数据丢失）
 	 */
 	bool CheckAndRecover();
 
@@ -192,12 +246,12 @@ public:
 	uint64_t GetTotalReceivedBytes() const;
 
 	/**
-	 * @brief 获取临时缓存文件大小
-	 * @return 文件大小（字节），文件不存在返回0
+	 * @brief 获取临时缓存大小
+	 * @return 已写入缓存段的字节数，未初始化返回0
 	 *
 	 * 说明：
-	 * - 使用GetFileAttributesEx获取实际文件大小
-	 * - 不依赖内部统计计数器（可用于验证数据一致性）
+	 * - 取自缓存段已发布的长度，不依赖总接收字节数统计（可用于验证数据一致性）
+	 * - 写后模式下不含暂存环中尚未写入的数据
 	 */
 	uint64_t GetFileSize() const;
 
@@ -222,9 +276,73 @@ public:
 	 * 说明：
 	 * - 详细日志包括数据追加细节、文件状态、读写进度等
 	 * - 适用于调试和问题诊断
+	 * - 详细日志经Logger延迟格式化后写入调试日志文件（Cache模块），不再经过日志回调
 	 */
 	void SetVerboseLogging(bool enabled);
 
+	/**
+	 * @brief 启用/停用写后模式
+	 * @param enable 是否启用
+	 * @param config 暂存环容量与刷新阈值
+	 *
+	 * 说明：
+	 * - 启用时创建暂存环并启动刷新线程
+	 * - 停用时刷新线程先把暂存数据全部写入文件再退出，之后AppendData恢复逐次直写
+	 * - 应在接收开始前调用，与AppendData并发切换时切换瞬间的数据顺序不作保证
+	 */
+	void SetWriteBehind(bool enable, const WriteBehindConfig& config = WriteBehindConfig());
+	bool IsWriteBehindEnabled() const { return m_writeBehindEnabled.load(); }
+
+	/**
+	 * @brief 获取暂存环中尚未写入文件的字节数
+	 */
+	size_t GetStagedBytes() const;
+
+	/**
+	 * @brief 启用/停用记录索引
+	 * @param enable 是否启用
+	 *
+	 * 说明：
+	 * - 已初始化时立即创建索引（临时文件路径加".idx"前缀的段文件），否则在Initialize时创建
+	 * - 只索引启用之后追加的数据；停用时关闭并删除索引
+	 * - 索引创建或写入失败只记录日志，不影响数据缓存
+	 */
+	void SetRecordIndexEnabled(bool enable);
+	bool IsRecordIndexEnabled() const { return m_recordIndexEnabled.load(); }
+
+	// ========== 记录索引查询（索引未启用时返回0/false） ==========
+
+	/**
+	 * @brief 获取已索引的记录数
+	 */
+	uint64_t GetRecordCount() const;
+
+	/**
+	 * @brief 按序号读取记录
+	 * @param index 记录序号（0起）
+	 * @param record 输出参数：记录内容，timestamp为自索引创建起的微秒数
+	 */
+	bool GetRecord(uint64_t index, CacheRecord& record) const;
+
+	/**
+	 * @brief 按时间查找：第一条不早于unixMicroseconds（系统时间，Unix微秒）的记录
+	 * @param index 输出参数：记录序号
+	 * @return 是否找到
+	 */
+	bool FindRecordByTime(uint64_t unixMicroseconds, uint64_t& index) const;
+
+	/**
+	 * @brief 按数据偏移查找：包含offset处字节的记录
+	 * @param index 输出参数：记录序号
+	 * @return 是否找到
+	 */
+	bool FindRecordByOffset(uint64_t offset, uint64_t& index) const;
+
+	/**
+	 * @brief 记录时间戳换算为系统时间（Unix微秒）
+	 */
+	uint64_t GetRecordUnixTime(const CacheRecord& record) const;
+
 	/**
 	 * @brief 设置日志回调函数
 	 * @param callback 日志回调函数
@@ -248,36 +366,62 @@ private:
 	 * 说明：
 	 * - 调用前必须已持有m_fileMutex锁
 	 * - 处理待写入队列中的数据（读取期间积累的数据）
-	 * - 写入当前数据并flush确保落盘
+	 * - 写入当前数据到缓存段
 	 * - 更新总接收字节数统计
 	 */
 	bool WriteDataUnlocked(const std::vector<uint8_t>& data);
 
 	/**
-	 * @brief 从临时缓存读取数据（内部实现，无锁版本）
-	 * @param offset 起始偏移量
-	 * @param length 读取长度
-	 * @return 读取的数据
+	 * @brief 写后模式：把数据拷入暂存环
+	 * @return 是否已暂存；刷新线程已停止时返回false，由调用方改为直写
 	 *
 	 * 说明：
-	 * - 调用前必须已持有m_fileMutex锁
-	 * - 实施分块循环读取机制（64KB块大小）
-	 * - 记录读取前后的总接收字节数，检测并发写入
-	 * - 详细的进度日志（每10MB输出一次进度）
+	 * - 多个接收线程由m_stagingMutex串行化为暂存环的单一生产者
+	 * - 暂存环空间不足时等待刷新线程腾出空间，大块数据分段暂存
 	 */
-	std::vector<uint8_t> ReadDataUnlocked(uint64_t offset, size_t length);
+	bool StageData(const uint8_t* data, size_t size, CacheDirection direction, uint16_t sourcePort);
 
 	/**
-	 * @brief 记录日志消息
-	 * @param message 日志消息
+	 * @brief 为一次追加写入索引记录（超过4GB的追加拆为多条）
+	 *
+	 * 说明：
+	 * - 调用方持有m_fileMutex（直写）或m_stagingMutex（写后），保证记录按偏移顺序追加
+	 * - 索引写入失败时关闭索引并记录日志，避免留下缺失记录的索引
 	 */
-	void Log(const std::string& message);
+	void AppendRecord(uint64_t offset, size_t size, CacheDirection direction, uint16_t sourcePort);
 
 	/**
-	 * @brief 记录详细日志消息（仅当详细日志开启时）
+	 * @brief 以当前临时文件路径创建记录索引（调用前必须已持有m_indexMutex）
+	 */
+	void OpenRecordIndexLocked();
+
+	/**
+	 * @brief 刷新线程主函数（暂存环的单一消费者）
+	 */
+	void FlusherThread();
+
+	/**
+	 * @brief 从暂存环取出count字节写入缓存段（持有m_fileMutex）
+	 * @param discard 为true时只取出不写入
+	 * @return 写入是否成功
+	 */
+	bool WriteStagedBatch(size_t count, bool discard);
+
+	/**
+	 * @brief 丢弃暂存数据（Shutdown时调用，由刷新线程取出后不写入）
+	 */
+	void DiscardStagedData();
+
+	/**
+	 * @brief 停止刷新线程（先写出全部暂存数据）
+	 */
+	void StopFlusher();
+
+	/**
+	 * @brief 记录日志消息
 	 * @param message 日志消息
 	 */
-	void LogDetail(const std::string& message);
+	void Log(const std::string& message);
 
 	/**
 	 * @brief 记录临时缓存文件状态（调试用）
@@ -288,9 +432,9 @@ private:
 private:
 	// ========== 成员变量 ==========
 
-	// 文件流和路径
-	std::ofstream m_tempCacheFile;              // 临时缓存文件输出流（写入）
-	std::wstring m_tempCacheFilePath;           // 临时缓存文件路径（宽字符）
+	// 缓存段和路径
+	SegmentedCacheStore m_cacheStore;           // 分段映射缓存（追加与读取）
+	std::wstring m_tempCacheFilePath;           // 临时缓存文件路径（宽字符，缓存段文件以其为前缀）
 	bool m_useTempCacheFile;                    // 是否启用临时文件机制
 
 	// 【第七轮修复】删除内存缓存 - 仅使用文件缓存，避免大数据内存溢出
@@ -302,10 +446,31 @@ private:
 	std::atomic<uint64_t> m_totalSentBytes;     // 总发送字节数（原子变量）
 
 	// 线程同步
-	mutable std::mutex m_fileMutex;             // 文件操作互斥锁
-	std::queue<std::vector<uint8_t>> m_pendingWrites; // 待写入队列（读取期间的新数据）
+	mutable std::mutex m_fileMutex;             // 追加互斥锁（缓存段单写者）
+	std::queue<std::vector<uint8_t>> m_pendingWrites; // 待写入队列（缓存段关闭期间的新数据）
 
 	// 日志配置
 	LogCallback m_logCallback;                  // 日志回调函数
 	bool m_verboseLogging;                      // 详细日志开关
+
+	// 写后模式：AppendData（生产者，m_stagingMutex串行化）→ 暂存环 → 刷新线程（消费者）
+	std::atomic<bool> m_writeBehindEnabled;     // AppendData是否走暂存环
+	WriteBehindConfig m_writeBehindConfig;
+	std::unique_ptr<SpscRingBuffer<uint8_t>> m_stagingBuffer; // 暂存环
+	std::mutex m_stagingMutex;                  // 串行化生产者
+	std::atomic<uint64_t> m_stagedTotal;        // 累计暂存字节数
+	std::atomic<uint64_t> m_flushedTotal;       // 累计已写入缓存段（或丢弃）的暂存字节数
+	uint64_t m_syncTarget;                      // Sync等待的m_flushedTotal目标（m_flushMutex保护）
+	uint64_t m_discardTarget;                   // 待丢弃到的m_flushedTotal目标（m_flushMutex保护）
+	std::atomic<bool> m_flusherRunning;
+	std::atomic<bool> m_flusherStop;
+	std::mutex m_flushMutex;
+	std::condition_variable m_flushCondition;   // 唤醒刷新线程
+	std::condition_variable m_syncCondition;    // 批量写入完成
+	std::thread m_flusherThread;
+
+	// 记录索引：锁顺序 m_fileMutex / m_stagingMutex → m_indexMutex
+	std::atomic<bool> m_recordIndexEnabled;     // AppendData是否追加索引记录
+	CacheRecordIndex m_recordIndex;
+	mutable std::mutex m_indexMutex;            // 串行化索引追加、打开/关闭与查询
 };
@@ -7,8 +7,10 @@
 #include <condition_variable>
 #include <chrono>
 #include <cstring>
+#include <cstdint>
 #include <algorithm>
 #include <stdexcept>
+#include <type_traits>
 
 // 环形缓冲区模板类
 template<typename T>
@@ -191,12 +193,13 @@ public:
 			return 0;
 		}
 
-		// 复制数据但不移除
+		// 复制数据但不移除（最多分两段整块复制）
 		size_t head = m_head.load();
-		for (size_t i = 0; i < toPeek; ++i)
+		size_t firstPart = std::min(toPeek, m_capacity - head);
+		std::memcpy(data, &m_buffer[head], firstPart * sizeof(T));
+		if (firstPart < toPeek)
 		{
-			data[i] = m_buffer[head];
-			head = (head + 1) % m_capacity;
+			std::memcpy(data + firstPart, &m_buffer[0], (toPeek - firstPart) * sizeof(T));
 		}
 
 		return toPeek;
@@ -350,6 +353,464 @@ using ByteRingBuffer = RingBuffer<uint8_t>;
 // 特化版本：字符缓冲区
 using CharRingBuffer = RingBuffer<char>;
 
+// 单生产者/单消费者无锁环形缓冲区
+// 只允许一个线程写入（Write/WriteWait/GetWriteSpan/CommitWrite），一个线程读取（Read/ReadWait/Peek/GetReadSpan/CommitRead/Clear）。
+// 读写索引单调递增、各由一方修改，以acquire/release发布，读写路径不加锁；容量向上取整为2的幂，按位与取下标。
+// 读索引与写索引分处不同缓存行，各方另缓存对方索引，只在看似空/满时才读取对方缓存行。
+// 阻塞等待仅在空/满时进入：等待方登记后在条件变量上休眠，另一方只在有登记的等待者时才加锁唤醒。
+// 用法（零拷贝）：
+//   T* span = nullptr;
+//   size_t n = buffer.GetWriteSpan(span);   // 生产者：连续空闲区，直接读入
+//   buffer.CommitWrite(filled);
+//   const T* data = nullptr;
+//   size_t m = buffer.GetReadSpan(data);    // 消费者：连续数据区，直接处理
+//   buffer.CommitRead(consumed);
+template<typename T>
+class SpscRingBuffer
+{
+	static_assert(std::is_trivially_copyable<T>::value, "SpscRingBuffer requires trivially copyable elements");
+
+public:
+	static const size_t CACHE_LINE_SIZE = 64;
+	static const int SPIN_COUNT = 64; // 进入休眠前的自旋检查次数
+
+public:
+	explicit SpscRingBuffer(size_t capacity = 1024)
+		: m_capacity(RoundUpPowerOfTwo(capacity))
+		, m_mask(m_capacity - 1)
+		, m_buffer(m_capacity)
+		, m_head(0)
+		, m_cachedTail(0)
+		, m_tail(0)
+		, m_cachedHead(0)
+		, m_waiters(0)
+	{
+		if (capacity == 0)
+		{
+			throw std::invalid_argument("Buffer capacity cannot be zero");
+		}
+	}
+
+	~SpscRingBuffer() = default;
+
+	SpscRingBuffer(const SpscRingBuffer&) = delete;
+	SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+	// 写入数据（生产者），空间不足时不写入并返回false
+	bool Write(const T* data, size_t count)
+	{
+		if (data == nullptr || count == 0)
+		{
+			return true;
+		}
+
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (GetFreeSpaceForWriter(tail, count) < count)
+		{
+			return false;
+		}
+
+		CopyIn(tail, data, count);
+		m_tail.store(tail + count, std::memory_order_release);
+		NotifyWaiters();
+		return true;
+	}
+
+	// 读取数据（消费者），返回实际读取个数
+	size_t Read(T* data, size_t maxCount)
+	{
+		if (data == nullptr || maxCount == 0)
+		{
+			return 0;
+		}
+
+		size_t head = m_head.load(std::memory_order_relaxed);
+		size_t toRead = std::min(maxCount, GetSizeForReader(head, maxCount));
+		if (toRead == 0)
+		{
+			return 0;
+		}
+
+		CopyOut(head, data, toRead);
+		m_head.store(head + toRead, std::memory_order_release);
+		NotifyWaiters();
+		return toRead;
+	}
+
+	// 等待写入数据（阻塞模式）
+	bool WriteWait(const T* data, size_t count, std::chrono::milliseconds timeout = (std::chrono::milliseconds::max)())
+	{
+		if (data == nullptr || count == 0)
+		{
+			return true;
+		}
+		if (count > m_capacity)
+		{
+			return false;
+		}
+
+		if (!WaitFor([this, count] { return GetFreeSpaceForWriter(m_tail.load(std::memory_order_relaxed), count) >= count; }, timeout))
+		{
+			return false; // 超时
+		}
+		return Write(data, count);
+	}
+
+	// 等待读取数据（阻塞模式）
+	size_t ReadWait(T* data, size_t maxCount, std::chrono::milliseconds timeout = (std::chrono::milliseconds::max)())
+	{
+		if (data == nullptr || maxCount == 0)
+		{
+			return 0;
+		}
+
+		if (!WaitFor([this] { return GetSizeForReader(m_head.load(std::memory_order_relaxed), 1) > 0; }, timeout))
+		{
+			return 0; // 超时
+		}
+		return Read(data, maxCount);
+	}
+
+	// 查看数据但不移除（消费者）
+	size_t Peek(T* data, size_t maxCount) const
+	{
+		if (data == nullptr || maxCount == 0)
+		{
+			return 0;
+		}
+
+		size_t head = m_head.load(std::memory_order_relaxed);
+		size_t toPeek = std::min(maxCount, m_tail.load(std::memory_order_acquire) - head);
+		CopyOut(head, data, toPeek);
+		return toPeek;
+	}
+
+	// 生产者：取得可直接写入的连续空闲区，返回其长度（绕回处截断，可能小于总空闲空间）
+	size_t GetWriteSpan(T*& span)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		size_t offset = tail & m_mask;
+		size_t contiguous = std::min(GetFreeSpaceForWriter(tail, m_capacity), m_capacity - offset);
+		span = m_buffer.data() + offset;
+		return contiguous;
+	}
+
+	// 生产者：提交已写入span的前count个元素
+	void CommitWrite(size_t count)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		m_tail.store(m_tail.load(std::memory_order_relaxed) + count, std::memory_order_release);
+		NotifyWaiters();
+	}
+
+	// 消费者：取得可直接读取的连续数据区，返回其长度（绕回处截断）
+	size_t GetReadSpan(const T*& span)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		size_t offset = head & m_mask;
+		size_t contiguous = std::min(GetSizeForReader(head, m_capacity), m_capacity - offset);
+		span = m_buffer.data() + offset;
+		return contiguous;
+	}
+
+	// 消费者：释放已处理的前count个元素
+	void CommitRead(size_t count)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		m_head.store(m_head.load(std::memory_order_relaxed) + count, std::memory_order_release);
+		NotifyWaiters();
+	}
+
+	// 清空缓冲区（消费者）
+	void Clear()
+	{
+		m_head.store(m_tail.load(std::memory_order_acquire), std::memory_order_release);
+		NotifyWaiters();
+	}
+
+	// 获取当前大小（另一方并发读写时为近似值）
+	size_t GetSize() const
+	{
+		size_t head = m_head.load(std::memory_order_acquire);
+		size_t tail = m_tail.load(std::memory_order_acquire);
+		return tail - head;
+	}
+
+	size_t GetCapacity() const
+	{
+		return m_capacity;
+	}
+
+	size_t GetAvailableSpace() const
+	{
+		return m_capacity - GetSize();
+	}
+
+	bool IsEmpty() const
+	{
+		return GetSize() == 0;
+	}
+
+	bool IsFull() const
+	{
+		return GetAvailableSpace() == 0;
+	}
+
+private:
+	static size_t RoundUpPowerOfTwo(size_t value)
+	{
+		size_t result = 1;
+		while (result < value)
+		{
+			result <<= 1;
+		}
+		return result;
+	}
+
+	// 生产者视角的空闲空间：缓存的读索引不够wanted个时再读取消费者的缓存行
+	// （按需刷新：大于容量一半的写入也不会因过期的缓存值而永远等待）
+	size_t GetFreeSpaceForWriter(size_t tail, size_t wanted)
+	{
+		size_t freeSpace = m_capacity - (tail - m_cachedHead);
+		if (freeSpace < wanted)
+		{
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+			freeSpace = m_capacity - (tail - m_cachedHead);
+		}
+		return freeSpace;
+	}
+
+	// 消费者视角的数据量：缓存的写索引不够wanted个时再读取生产者的缓存行
+	size_t GetSizeForReader(size_t head, size_t wanted)
+	{
+		size_t available = m_cachedTail - head;
+		if (available < wanted)
+		{
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+			available = m_cachedTail - head;
+		}
+		return available;
+	}
+
+	void CopyIn(size_t tail, const T* data, size_t count)
+	{
+		size_t offset = tail & m_mask;
+		size_t firstPart = std::min(count, m_capacity - offset);
+		std::memcpy(m_buffer.data() + offset, data, firstPart * sizeof(T));
+		if (firstPart < count)
+		{
+			std::memcpy(m_buffer.data(), data + firstPart, (count - firstPart) * sizeof(T));
+		}
+	}
+
+	void CopyOut(size_t head, T* data, size_t count) const
+	{
+		size_t offset = head & m_mask;
+		size_t firstPart = std::min(count, m_capacity - offset);
+		std::memcpy(data, m_buffer.data() + offset, firstPart * sizeof(T));
+		if (firstPart < count)
+		{
+			std::memcpy(data + firstPart, m_buffer.data(), (count - firstPart) * sizeof(T));
+		}
+	}
+
+	// 索引发布后检查等待者：全序栅栏保证"发布索引→读取等待者计数"与等待方"登记→检查条件"不会同时错过对方
+	void NotifyWaiters()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_waiters.load(std::memory_order_relaxed) != 0)
+		{
+			std::lock_guard<std::mutex> lock(m_waitMutex);
+			m_waitCondition.notify_all();
+		}
+	}
+
+	template<typename Predicate>
+	bool WaitFor(Predicate ready, std::chrono::milliseconds timeout)
+	{
+		for (int i = 0; i < SPIN_COUNT; ++i)
+		{
+			if (ready())
+			{
+				return true;
+			}
+		}
+
+		std::unique_lock<std::mutex> lock(m_waitMutex);
+		m_waiters.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		bool result = true;
+		if (timeout == (std::chrono::milliseconds::max)())
+		{
+			m_waitCondition.wait(lock, ready);
+		}
+		else
+		{
+			result = m_waitCondition.wait_for(lock, timeout, ready);
+		}
+		m_waiters.fetch_sub(1);
+		return result;
+	}
+
+private:
+	// 构造后只读
+	const size_t m_capacity;     // 容量（2的幂）
+	const size_t m_mask;
+	std::vector<T> m_buffer;
+	char m_configPadding[CACHE_LINE_SIZE];
+
+	// 消费者缓存行
+	std::atomic<size_t> m_head;  // 读索引（仅消费者修改）
+	size_t m_cachedTail;         // 消费者缓存的写索引
+	char m_headPadding[CACHE_LINE_SIZE];
+
+	// 生产者缓存行
+	std::atomic<size_t> m_tail;  // 写索引（仅生产者修改）
+	size_t m_cachedHead;         // 生产者缓存的读索引
+	char m_tailPadding[CACHE_LINE_SIZE];
+
+	// 阻塞等待（仅空/满时使用）
+	std::atomic<uint32_t> m_waiters;
+	std::mutex m_waitMutex;
+	std::condition_variable m_waitCondition;
+};
+
+// 特化版本：单生产者/单消费者字节缓冲区
+using SpscByteRingBuffer = SpscRingBuffer<uint8_t>;
+
+// 多生产者/单消费者有界无锁队列（每个槽位带序号的有界队列）
+// 生产者以CAS领取写位置，写入元素后发布槽位序号；唯一的消费者按序取出并把槽位序号推进一圈归还生产者。
+// 队列满时TryPush立即返回false且不移动传入的元素，由调用方决定丢弃、重试或等待。
+// 某个生产者领取位置后尚未发布时，消费者在该位置看到"空"，后续元素要等它发布后才能取出。
+template<typename T>
+class MpscQueue
+{
+public:
+	static const size_t CACHE_LINE_SIZE = 64;
+
+public:
+	explicit MpscQueue(size_t capacity = 1024)
+		: m_capacity(RoundUpPowerOfTwo(capacity))
+		, m_mask(m_capacity - 1)
+		, m_cells(m_capacity)
+		, m_tail(0)
+		, m_head(0)
+	{
+		if (capacity == 0)
+		{
+			throw std::invalid_argument("Queue capacity cannot be zero");
+		}
+		for (size_t i = 0; i < m_capacity; ++i)
+		{
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	~MpscQueue() = default;
+
+	MpscQueue(const MpscQueue&) = delete;
+	MpscQueue& operator=(const MpscQueue&) = delete;
+
+	// 入队（任意线程），队列满时返回false
+	template<typename U>
+	bool TryPush(U&& value)
+	{
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+		while (true)
+		{
+			Cell& cell = m_cells[tail & m_mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(tail);
+			if (difference == 0)
+			{
+				// 槽位空闲：领取写位置，失败时tail已被更新为最新值
+				if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+				{
+					cell.value = std::forward<U>(value);
+					cell.sequence.store(tail + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0)
+			{
+				return false; // 槽位仍被上一圈的元素占用：队列已满
+			}
+			else
+			{
+				tail = m_tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// 出队（仅消费者线程），队列空时返回false
+	bool TryPop(T& value)
+	{
+		size_t head = m_head.load(std::memory_order_relaxed);
+		Cell& cell = m_cells[head & m_mask];
+		if (cell.sequence.load(std::memory_order_acquire) != head + 1)
+		{
+			return false;
+		}
+
+		value = std::move(cell.value);
+		cell.sequence.store(head + m_capacity, std::memory_order_release);
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	// 近似元素数（含已领取位置但尚未发布的元素）
+	size_t GetSize() const
+	{
+		size_t head = m_head.load(std::memory_order_acquire);
+		size_t tail = m_tail.load(std::memory_order_acquire);
+		return tail > head ? tail - head : 0;
+	}
+
+	// 累计领取的写位置数（入队成功次数）
+	size_t GetPushCount() const { return m_tail.load(std::memory_order_acquire); }
+	// 累计出队次数
+	size_t GetPopCount() const { return m_head.load(std::memory_order_acquire); }
+	size_t GetCapacity() const { return m_capacity; }
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence; // 等于写位置：空闲；等于写位置+1：已发布
+		T value;
+	};
+
+	static size_t RoundUpPowerOfTwo(size_t value)
+	{
+		size_t result = 1;
+		while (result < value)
+		{
+			result <<= 1;
+		}
+		return result;
+	}
+
+private:
+	// 构造后只读
+	const size_t m_capacity;     // 容量（2的幂）
+	const size_t m_mask;
+	std::vector<Cell> m_cells;
+	char m_configPadding[CACHE_LINE_SIZE];
+
+	// 生产者共享的写位置
+	std::atomic<size_t> m_tail;
+	char m_tailPadding[CACHE_LINE_SIZE];
+
+	// 消费者的读位置
+	std::atomic<size_t> m_head;
+	char m_headPadding[CACHE_LINE_SIZE];
+};
+
 // 线程安全的环形缓冲区工厂类
 class RingBufferFactory
 {
@@ -366,6 +827,12 @@ public:
 		return std::make_unique<CharRingBuffer>(capacity);
 	}
 
+	// 创建单生产者/单消费者字节缓冲区（容量向上取整为2的幂）
+	static std::unique_ptr<SpscByteRingBuffer> CreateSpscByteBuffer(size_t capacity = 4096)
+	{
+		return std::make_unique<SpscByteRingBuffer>(capacity);
+	}
+
 	// 创建指定类型的缓冲区
 	template<typename T>
 	static std::unique_ptr<RingBuffer<T>> CreateBuffer(size_t capacity = 1024)
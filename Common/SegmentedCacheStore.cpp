@@ -0,0 +1,290 @@
+﻿#pragma execution_character_set("utf-8")
+
+#include "pch.h"
+#include "SegmentedCacheStore.h"
+#include <algorithm>
+#include <cstring>
+
+SegmentedCacheStore::SegmentFile::~SegmentFile()
+{
+	if (mapping)
+	{
+		CloseHandle(mapping);
+	}
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file);
+	}
+}
+
+SegmentedCacheStore::SegmentedCacheStore(size_t segmentSize)
+	: m_segmentSize(segmentSize), m_open(false), m_size(0), m_activeUsed(0), m_useCounter(0)
+{
+}
+
+SegmentedCacheStore::~SegmentedCacheStore()
+{
+	Close();
+}
+
+bool SegmentedCacheStore::Open(const std::wstring& basePath)
+{
+	Close();
+
+	m_basePath = basePath;
+	m_open = true;
+
+	// 立即创建首段，创建失败（目录不可写、磁盘已满）时在打开阶段即可发现
+	if (!OpenNextSegment())
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void SegmentedCacheStore::Close()
+{
+	m_open = false;
+	m_size.store(0, std::memory_order_release);
+	m_activeView.reset();
+	m_activeUsed = 0;
+
+	std::lock_guard<std::mutex> lock(m_segmentMutex);
+	m_segments.clear();
+	m_useCounter = 0;
+}
+
+bool SegmentedCacheStore::Append(const uint8_t* data, size_t size)
+{
+	if (!m_open.load())
+	{
+		return false;
+	}
+
+	while (size > 0)
+	{
+		if (!m_activeView || m_activeUsed == m_segmentSize)
+		{
+			if (!OpenNextSegment())
+			{
+				return false;
+			}
+		}
+
+		size_t count = (std::min)(size, m_segmentSize - m_activeUsed);
+		memcpy(static_cast<uint8_t*>(m_activeView.get()) + m_activeUsed, data, count);
+		m_activeUsed += count;
+		data += count;
+		size -= count;
+
+		// 拷贝完成后再发布长度，读取者只会看到已写好的数据
+		m_size.fetch_add(count, std::memory_order_release);
+	}
+	return true;
+}
+
+CacheView SegmentedCacheStore::ReadView(uint64_t offset, size_t length) const
+{
+	uint64_t size = GetSize();
+	if (length == 0 || offset >= size)
+	{
+		return CacheView();
+	}
+
+	size_t index = static_cast<size_t>(offset / m_segmentSize);
+	size_t segmentOffset = static_cast<size_t>(offset % m_segmentSize);
+	size_t count = (std::min)(length, m_segmentSize - segmentOffset);
+	count = static_cast<size_t>((std::min)(static_cast<uint64_t>(count), size - offset));
+
+	std::shared_ptr<const void> view = GetSegmentView(index);
+	if (!view)
+	{
+		return CacheView();
+	}
+	return CacheView(view, static_cast<const uint8_t*>(view.get()) + segmentOffset, count);
+}
+
+size_t SegmentedCacheStore::Read(uint64_t offset, uint8_t* buffer, size_t length) const
+{
+	size_t total = 0;
+	while (total < length)
+	{
+		CacheView view = ReadView(offset + total, length - total);
+		if (view.IsEmpty())
+		{
+			break;
+		}
+		memcpy(buffer + total, view.Data(), view.GetSize());
+		total += view.GetSize();
+	}
+	return total;
+}
+
+bool SegmentedCacheStore::Flush()
+{
+	std::vector<std::shared_ptr<SegmentFile>> files;
+	std::vector<std::shared_ptr<const void>> views;
+	{
+		std::lock_guard<std::mutex> lock(m_segmentMutex);
+		for (const SegmentEntry& entry : m_segments)
+		{
+			files.push_back(entry.file);
+			if (entry.view)
+			{
+				views.push_back(entry.view);
+			}
+		}
+	}
+
+	// 先把映射视图中的脏页写回文件，再刷新文件缓存与元数据
+	bool success = true;
+	for (const auto& view : views)
+	{
+		success = (FlushViewOfFile(view.get(), 0) != FALSE) && success;
+	}
+	for (const auto& file : files)
+	{
+		success = (FlushFileBuffers(file->file) != FALSE) && success;
+	}
+	return success;
+}
+
+size_t SegmentedCacheStore::GetSegmentCount() const
+{
+	std::lock_guard<std::mutex> lock(m_segmentMutex);
+	return m_segments.size();
+}
+
+size_t SegmentedCacheStore::GetMappedSegmentCount() const
+{
+	std::lock_guard<std::mutex> lock(m_segmentMutex);
+	return static_cast<size_t>(std::count_if(m_segments.begin(), m_segments.end(),
+		[](const SegmentEntry& entry) { return static_cast<bool>(entry.view); }));
+}
+
+bool SegmentedCacheStore::OpenNextSegment()
+{
+	size_t index = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_segmentMutex);
+		index = m_segments.size();
+	}
+
+	// 文件创建与映射在锁外完成，切换段期间读取者照常访问已有段
+	std::wstring path = m_basePath + L"." + std::to_wstring(index);
+	std::shared_ptr<SegmentFile> file = std::make_shared<SegmentFile>();
+	file->file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, CREATE_ALWAYS,
+		FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+	if (file->file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	// 映射对象按整段大小创建（文件随之扩展到段大小），段内追加不再需要重建映射
+	file->mapping = CreateFileMappingW(file->file, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(m_segmentSize), nullptr);
+	if (!file->mapping)
+	{
+		return false;
+	}
+
+	std::shared_ptr<void> view = MapSegment(file->mapping, true);
+	if (!view)
+	{
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_segmentMutex);
+		SegmentEntry entry;
+		entry.file = file;
+		entry.view = view;
+		entry.lastUse = ++m_useCounter;
+		m_segments.push_back(entry);
+		EvictViewsLocked();
+	}
+
+	m_activeView = view;
+	m_activeUsed = 0;
+	return true;
+}
+
+std::shared_ptr<const void> SegmentedCacheStore::GetSegmentView(size_t index) const
+{
+	std::shared_ptr<SegmentFile> file;
+	{
+		std::lock_guard<std::mutex> lock(m_segmentMutex);
+		if (index >= m_segments.size())
+		{
+			return nullptr;
+		}
+
+		SegmentEntry& entry = m_segments[index];
+		entry.lastUse = ++m_useCounter;
+		if (entry.view)
+		{
+			return entry.view;
+		}
+		file = entry.file;
+	}
+
+	// 已换出的段在锁外重新映射（持有SegmentFile保证映射句柄有效），并发映射同一段时保留先装入者
+	std::shared_ptr<const void> view = MapSegment(file->mapping, false);
+	if (!view)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(m_segmentMutex);
+	if (index < m_segments.size() && m_segments[index].file == file)
+	{
+		SegmentEntry& entry = m_segments[index];
+		if (entry.view)
+		{
+			return entry.view;
+		}
+		entry.view = view;
+		EvictViewsLocked();
+	}
+	return view;
+}
+
+void SegmentedCacheStore::EvictViewsLocked() const
+{
+	if (m_segments.empty())
+	{
+		return;
+	}
+
+	// 当前段（最后一段）始终保持映射，不计入上限
+	const size_t sealedCount = m_segments.size() - 1;
+	size_t mapped = static_cast<size_t>(std::count_if(m_segments.begin(), m_segments.begin() + sealedCount,
+		[](const SegmentEntry& entry) { return static_cast<bool>(entry.view); }));
+
+	while (mapped > MAX_MAPPED_SEGMENTS)
+	{
+		SegmentEntry* oldest = nullptr;
+		for (size_t i = 0; i < sealedCount; ++i)
+		{
+			SegmentEntry& entry = m_segments[i];
+			if (entry.view && (!oldest || entry.lastUse < oldest->lastUse))
+			{
+				oldest = &entry;
+			}
+		}
+		// 仅释放段表的引用，仍被CacheView持有的映射在视图释放时解除
+		oldest->view.reset();
+		--mapped;
+	}
+}
+
+std::shared_ptr<void> SegmentedCacheStore::MapSegment(HANDLE mapping, bool writable) const
+{
+	void* view = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, m_segmentSize);
+	if (!view)
+	{
+		return nullptr;
+	}
+	return std::shared_ptr<void>(view, [](void* address) { UnmapViewOfFile(address); });
+}
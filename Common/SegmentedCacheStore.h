@@ -0,0 +1,120 @@
+﻿#pragma once
+#pragma execution_character_set("utf-8")
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <Windows.h>
+
+// 缓存只读视图：直接指向映射段内的数据，不拷贝
+// 持有期间所在段保持映射，缓存关闭或段被换出后视图仍然有效，释放最后一个视图时才解除映射。
+class CacheView
+{
+public:
+	CacheView() : m_data(nullptr), m_size(0) {}
+
+	const uint8_t* Data() const { return m_data; }
+	size_t GetSize() const { return m_size; }
+	bool IsEmpty() const { return m_size == 0; }
+
+private:
+	friend class SegmentedCacheStore;
+	CacheView(std::shared_ptr<const void> mapping, const uint8_t* data, size_t size)
+		: m_mapping(std::move(mapping)), m_data(data), m_size(size) {}
+
+private:
+	std::shared_ptr<const void> m_mapping; // 保持映射视图存活
+	const uint8_t* m_data;
+	size_t m_size;
+};
+
+// 分段映射缓存：数据只追加，按固定大小切分为段文件（<基础路径>.0、.1……）
+// - 每段创建时即映射为段大小，追加直接拷入当前段的映射视图，写满后封存并切换到下一段
+// - 已追加长度原子发布，读取按偏移/段大小定位段，O(1)，返回映射内的视图，不经过文件读取
+// - 段表由独立的互斥锁保护，只在切换段和查找/映射段时短暂持有，读取不阻塞追加（拷贝与页错误均在锁外）
+// - 已封存段的只读映射按最近使用保留至多MAX_MAPPED_SEGMENTS个，地址空间占用与缓存大小无关（32位进程也可缓存超过4GB）
+// - 段文件以FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE创建，关闭（或进程异常退出）后由系统删除
+// Append为单写者接口，多个追加者需由调用方串行化；Read/ReadView/GetSize可在任意线程并发调用。
+class SegmentedCacheStore
+{
+public:
+	static const size_t DEFAULT_SEGMENT_SIZE = 64 * 1024 * 1024; // 默认段大小
+#ifdef _WIN64
+	static const size_t MAX_MAPPED_SEGMENTS = 1024;       // 保持映射的已封存段数（64位地址空间充足，默认段大小下64GB以内不换出）
+#else
+	static const size_t MAX_MAPPED_SEGMENTS = 4;          // 32位进程默认段大小下限制为256MB地址空间，随机读取跨段时重新映射
+#endif
+
+public:
+	// segmentSize需为分配粒度（64KB）的整数倍
+	explicit SegmentedCacheStore(size_t segmentSize = DEFAULT_SEGMENT_SIZE);
+	~SegmentedCacheStore();
+
+	SegmentedCacheStore(const SegmentedCacheStore&) = delete;
+	SegmentedCacheStore& operator=(const SegmentedCacheStore&) = delete;
+
+	// 以basePath为前缀创建段文件，已打开时先关闭
+	bool Open(const std::wstring& basePath);
+	// 关闭全部段（段文件随之删除），仍被CacheView引用的映射在视图释放时解除
+	void Close();
+	bool IsOpen() const { return m_open.load(); }
+
+	// 追加数据（单写者），段文件创建或映射失败时返回false，已追加的部分保持有效
+	bool Append(const uint8_t* data, size_t size);
+
+	// 返回[offset, offset+length)的视图，在段边界处截断（调用方按返回长度循环）；越界返回空视图
+	CacheView ReadView(uint64_t offset, size_t length) const;
+	// 拷贝[offset, offset+length)到buffer，可跨段，返回实际拷贝字节数
+	size_t Read(uint64_t offset, uint8_t* buffer, size_t length) const;
+
+	// 刷新当前段视图与全部段文件到磁盘（FlushViewOfFile + FlushFileBuffers）
+	bool Flush();
+
+	// 状态查询
+	uint64_t GetSize() const { return m_size.load(std::memory_order_acquire); }
+	size_t GetSegmentCount() const;
+	size_t GetMappedSegmentCount() const;
+	size_t GetSegmentSize() const { return m_segmentSize; }
+	const std::wstring& GetBasePath() const { return m_basePath; }
+
+private:
+	// 段文件：关闭句柄时系统删除文件；由段表与正在映射它的读取者共享
+	struct SegmentFile
+	{
+		SegmentFile() : file(INVALID_HANDLE_VALUE), mapping(nullptr) {}
+		~SegmentFile();
+
+		HANDLE file;
+		HANDLE mapping;
+	};
+
+	struct SegmentEntry
+	{
+		std::shared_ptr<SegmentFile> file;
+		std::shared_ptr<const void> view;   // 映射视图，为空表示未映射（已换出）
+		uint64_t lastUse;                   // 最近使用序号（换出依据）
+	};
+
+	bool OpenNextSegment();
+	std::shared_ptr<const void> GetSegmentView(size_t index) const;
+	void EvictViewsLocked() const;
+	std::shared_ptr<void> MapSegment(HANDLE mapping, bool writable) const;
+
+private:
+	const size_t m_segmentSize;
+	std::wstring m_basePath;
+	std::atomic<bool> m_open;
+	std::atomic<uint64_t> m_size;               // 已追加（对读取者可见）的字节数
+
+	// 写者独占：当前段的可写视图与段内写入位置
+	std::shared_ptr<void> m_activeView;
+	size_t m_activeUsed;
+
+	mutable std::mutex m_segmentMutex;          // 保护段表与最近使用序号
+	mutable std::vector<SegmentEntry> m_segments;
+	mutable uint64_t m_useCounter;
+};
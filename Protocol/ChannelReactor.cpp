@@ -0,0 +1,212 @@
+﻿#pragma execution_character_set("utf-8")
+
+#include "pch.h"
+#include "ChannelReactor.h"
+#include "ReliableChannel.h"
+#include <algorithm>
+
+ChannelReactor::ChannelReactor(uint32_t maxIdleWaitMs)
+	: m_maxIdleWaitMs((std::max)(maxIdleWaitMs, 1u)), m_running(false), m_stopRequested(false), m_wakePending(false), m_sleeping(false), m_loops(0), m_wakeups(0)
+{
+}
+
+ChannelReactor::~ChannelReactor()
+{
+	Stop();
+}
+
+bool ChannelReactor::Start()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_running)
+	{
+		// 反应器线程内先Stop()后Start()：线程尚未离开本轮，撤销停止请求即可继续运行
+		if (!m_stopRequested || std::this_thread::get_id() == m_threadId)
+		{
+			m_stopRequested = false;
+			return true;
+		}
+
+		// 之前在反应器线程内请求了停止，先回收已退出（或即将退出）的线程
+		lock.unlock();
+		Stop();
+		lock.lock();
+		if (m_running)
+		{
+			return true;
+		}
+	}
+
+	m_stopRequested = false;
+	m_wakePending = false;
+	m_running = true;
+	m_thread = std::thread(&ChannelReactor::Run, this);
+	m_threadId = m_thread.get_id();
+	return true;
+}
+
+void ChannelReactor::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_running)
+		{
+			return;
+		}
+		m_stopRequested = true;
+
+		// 在反应器线程内（通道回调中）无法等待自身：当前轮次结束后线程自行退出，
+		// 线程对象保持可join，由之后的Start()/Stop()/析构回收
+		if (std::this_thread::get_id() == m_threadId)
+		{
+			return;
+		}
+	}
+	m_condition.notify_all();
+
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_running = false;
+	m_threadId = std::thread::id();
+}
+
+bool ChannelReactor::IsRunning() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_running;
+}
+
+bool ChannelReactor::Attach(ReliableChannel* channel)
+{
+	if (!channel)
+	{
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (std::find(m_channels.begin(), m_channels.end(), channel) == m_channels.end())
+		{
+			m_channels.push_back(channel);
+		}
+	}
+
+	Wake();
+	return true;
+}
+
+void ChannelReactor::Detach(ReliableChannel* channel)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_channels.erase(std::remove(m_channels.begin(), m_channels.end(), channel), m_channels.end());
+
+		// 在反应器线程内调用时本轮已持有轮询锁，改为从本轮快照中移除，剩余轮次不再访问该通道
+		if (std::this_thread::get_id() == m_threadId)
+		{
+			std::replace(m_roundChannels.begin(), m_roundChannels.end(), channel, static_cast<ReliableChannel*>(nullptr));
+			return;
+		}
+	}
+
+	// 等待可能正在进行的轮询结束
+	std::lock_guard<std::mutex> pollLock(m_pollMutex);
+}
+
+void ChannelReactor::Wake()
+{
+	// 已有未处理的唤醒或反应器正在轮询时无需通知，避免每次Send()都争用反应器锁
+	if (m_wakePending.exchange(true) || !m_sleeping.load())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+	}
+	m_condition.notify_one();
+}
+
+size_t ChannelReactor::GetChannelCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_channels.size();
+}
+
+void ChannelReactor::Run()
+{
+	uint32_t idleWaitMs = 0;
+
+	while (true)
+	{
+		bool active = false;
+		bool hasDeadline = false;
+		TimerQueue::Clock::time_point deadline;
+
+		{
+			// 先持有轮询锁再取通道快照，保证Detach()返回后不会再访问已移除的通道
+			std::lock_guard<std::mutex> pollLock(m_pollMutex);
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (m_stopRequested)
+				{
+					break;
+				}
+				m_roundChannels = m_channels;
+				m_wakePending = false;
+			}
+
+			// 按下标遍历：回调中Detach()会把快照中的通道置空
+			for (size_t i = 0; i < m_roundChannels.size(); ++i)
+			{
+				if (m_roundChannels[i] && m_roundChannels[i]->PollReactor())
+				{
+					active = true;
+				}
+
+				TimerQueue::Clock::time_point channelDeadline;
+				if (m_roundChannels[i] && m_roundChannels[i]->GetNextTimerDeadline(channelDeadline) &&
+					(!hasDeadline || channelDeadline < deadline))
+				{
+					deadline = channelDeadline;
+					hasDeadline = true;
+				}
+			}
+		}
+		m_loops++;
+
+		// 有进展时立即进入下一轮，尽快处理后续数据
+		if (active)
+		{
+			idleWaitMs = 0;
+			continue;
+		}
+
+		// 空闲时逐步拉长轮询间隔，但不晚于最早的定时器截止时间
+		idleWaitMs = (idleWaitMs == 0) ? 1 : (std::min)(idleWaitMs * 2, m_maxIdleWaitMs);
+		auto wakeAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(idleWaitMs);
+		if (hasDeadline && deadline < wakeAt)
+		{
+			wakeAt = deadline;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_sleeping = true;
+		if (m_roundChannels.empty())
+		{
+			// 无通道时无需轮询，等待Attach()或Stop()
+			m_condition.wait(lock, [this] { return m_stopRequested || m_wakePending; });
+			idleWaitMs = 0;
+		}
+		else if (m_condition.wait_until(lock, wakeAt, [this] { return m_stopRequested || m_wakePending; }))
+		{
+			idleWaitMs = 0;
+		}
+		m_sleeping = false;
+		m_wakeups++;
+	}
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+#pragma execution_character_set("utf-8")
+
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class ReliableChannel;
+
+// 单线程反应器：在一个线程内驱动一个或多个ReliableChannel
+// 每轮依次处理各通道的传输层读取、发送队列、按序交付与到期定时器，替代每通道四个工作线程。
+// 用法：
+//   auto reactor = std::make_shared<ChannelReactor>();
+//   channelA.SetReactor(reactor);   // Connect()前设置，多个通道可共享
+//   channelB.SetReactor(reactor);
+//   channelA.Connect();             // 反应器未运行时自动启动
+// 仅设置 ReliableConfig::enableReactor 而未指定反应器时，通道在Connect()时创建私有反应器。
+// 传输层没有统一的就绪通知，空闲时按退避间隔轮询（1ms起倍增至maxIdleWaitMs），
+// 有活动时连续处理；定时器截止时间更早时按截止时间唤醒，Send()入队立即唤醒。
+// 回调在反应器线程中执行，不得在回调中阻塞等待同一反应器驱动的通道。
+// 回调中可调用Stop()/Detach()：Stop()仅请求停止，线程在本轮结束后退出，由之后的Start()/Stop()/析构回收；
+// 反应器不得在自身线程中析构。
+class ChannelReactor
+{
+public:
+	static const uint32_t DEFAULT_MAX_IDLE_WAIT_MS = 10;
+
+public:
+	explicit ChannelReactor(uint32_t maxIdleWaitMs = DEFAULT_MAX_IDLE_WAIT_MS);
+	~ChannelReactor();
+
+	ChannelReactor(const ChannelReactor&) = delete;
+	ChannelReactor& operator=(const ChannelReactor&) = delete;
+
+	// 启停；在反应器线程内调用Stop()只请求停止，不等待
+	bool Start();
+	void Stop();
+	bool IsRunning() const;
+
+	// 通道注册；Detach()返回后反应器不再访问该通道（在反应器线程内调用时同样成立）
+	bool Attach(ReliableChannel* channel);
+	void Detach(ReliableChannel* channel);
+
+	// 有新工作（如发送队列入队）时唤醒反应器
+	void Wake();
+
+	// 状态查询
+	size_t GetChannelCount() const;
+	uint64_t GetLoopCount() const { return m_loops.load(); }
+	uint64_t GetWakeupCount() const { return m_wakeups.load(); }
+
+private:
+	void Run();
+
+private:
+	std::thread m_thread;
+	std::thread::id m_threadId;
+	uint32_t m_maxIdleWaitMs;
+
+	mutable std::mutex m_mutex;          // 保护通道列表与启停状态
+	std::condition_variable m_condition;
+	std::vector<ReliableChannel*> m_channels;
+	std::vector<ReliableChannel*> m_roundChannels; // 本轮轮询的通道快照，仅反应器线程访问
+	bool m_running;
+	bool m_stopRequested;
+	std::atomic<bool> m_wakePending;     // 本轮开始后有新工作
+	std::atomic<bool> m_sleeping;        // 反应器处于空闲等待，仅此时Wake()需要加锁通知
+
+	std::mutex m_pollMutex;              // 轮询通道期间持有，Detach()借此等待当前轮次结束
+
+	std::atomic<uint64_t> m_loops;       // 轮询轮数
+	std::atomic<uint64_t> m_wakeups;     // 空闲等待后的唤醒次数
+};
@@ -0,0 +1,405 @@
+﻿#pragma execution_character_set("utf-8")
+
+#include "pch.h"
+#include "Crc32.h"
+#include <atomic>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define CRC32_HAS_X86 1
+#include <emmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define CRC32_HAS_X86 0
+#endif
+
+// GCC/Clang需要为使用PCLMUL指令的函数单独开启目标特性，MSVC无需声明
+#if CRC32_HAS_X86 && defined(__GNUC__)
+#define CRC32_TARGET_CLMUL __attribute__((target("pclmul,sse4.1")))
+#else
+#define CRC32_TARGET_CLMUL
+#endif
+
+namespace
+{
+	typedef uint32_t (*Crc32UpdateFunc)(uint32_t state, const uint8_t* data, size_t length);
+
+	// 切片查表：table[0]为标准字节表，table[k][i]为字节i后接k个零字节的CRC
+	struct Crc32Tables
+	{
+		uint32_t table[16][256];
+
+		Crc32Tables()
+		{
+			const uint32_t polynomial = 0xEDB88320;
+
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t crc = i;
+				for (int j = 0; j < 8; j++)
+				{
+					crc = (crc & 1) ? (crc >> 1) ^ polynomial : (crc >> 1);
+				}
+				table[0][i] = crc;
+			}
+
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				for (int k = 1; k < 16; k++)
+				{
+					uint32_t prev = table[k - 1][i];
+					table[k][i] = (prev >> 8) ^ table[0][prev & 0xFF];
+				}
+			}
+		}
+	};
+
+	// 函数内静态对象保证多线程下只初始化一次
+	const Crc32Tables& GetTables()
+	{
+		static const Crc32Tables tables;
+		return tables;
+	}
+
+	inline uint32_t LoadLE32(const uint8_t* p)
+	{
+		// 目标平台均为小端，memcpy避免非对齐访问
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t UpdateTable(uint32_t crc, const uint8_t* data, size_t length)
+	{
+		const uint32_t(&t)[16][256] = GetTables().table;
+
+		for (size_t i = 0; i < length; i++)
+		{
+			crc = (crc >> 8) ^ t[0][(crc ^ data[i]) & 0xFF];
+		}
+
+		return crc;
+	}
+
+	uint32_t UpdateSlicingBy8(uint32_t crc, const uint8_t* data, size_t length)
+	{
+		const uint32_t(&t)[16][256] = GetTables().table;
+
+		while (length >= 8)
+		{
+			uint32_t one = LoadLE32(data) ^ crc;
+			uint32_t two = LoadLE32(data + 4);
+
+			crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^
+				t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+				t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^
+				t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+
+			data += 8;
+			length -= 8;
+		}
+
+		return UpdateTable(crc, data, length);
+	}
+
+	uint32_t UpdateSlicingBy16(uint32_t crc, const uint8_t* data, size_t length)
+	{
+		const uint32_t(&t)[16][256] = GetTables().table;
+
+		while (length >= 16)
+		{
+			uint32_t one = LoadLE32(data) ^ crc;
+			uint32_t two = LoadLE32(data + 4);
+			uint32_t three = LoadLE32(data + 8);
+			uint32_t four = LoadLE32(data + 12);
+
+			crc = t[15][one & 0xFF] ^ t[14][(one >> 8) & 0xFF] ^
+				t[13][(one >> 16) & 0xFF] ^ t[12][one >> 24] ^
+				t[11][two & 0xFF] ^ t[10][(two >> 8) & 0xFF] ^
+				t[9][(two >> 16) & 0xFF] ^ t[8][two >> 24] ^
+				t[7][three & 0xFF] ^ t[6][(three >> 8) & 0xFF] ^
+				t[5][(three >> 16) & 0xFF] ^ t[4][three >> 24] ^
+				t[3][four & 0xFF] ^ t[2][(four >> 8) & 0xFF] ^
+				t[1][(four >> 16) & 0xFF] ^ t[0][four >> 24];
+
+			data += 16;
+			length -= 16;
+		}
+
+		return UpdateSlicingBy8(crc, data, length);
+	}
+
+#if CRC32_HAS_X86
+	bool DetectPclmul()
+	{
+		// CPUID.01H:ECX bit1 = PCLMULQDQ, bit19 = SSE4.1
+		unsigned int ecx = 0;
+#if defined(_MSC_VER)
+		int info[4] = { 0 };
+		__cpuid(info, 1);
+		ecx = static_cast<unsigned int>(info[2]);
+#else
+		unsigned int eax = 0, ebx = 0, edx = 0;
+		if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		{
+			return false;
+		}
+#endif
+		return (ecx & (1u << 1)) != 0 && (ecx & (1u << 19)) != 0;
+	}
+
+	// PCLMULQDQ折叠内核（Intel白皮书《Fast CRC Computation Using PCLMULQDQ》，反射域常量）
+	// 要求 length >= 64 且为16的倍数
+	CRC32_TARGET_CLMUL uint32_t FoldPclmul(uint32_t crc, const uint8_t* data, size_t length)
+	{
+		alignas(16) static const uint64_t k1k2[] = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+		alignas(16) static const uint64_t k3k4[] = { 0x01751997d0ULL, 0x00ccaa009eULL };
+		alignas(16) static const uint64_t k5k0[] = { 0x0163cd6124ULL, 0x0000000000ULL };
+		alignas(16) static const uint64_t poly[] = { 0x01db710641ULL, 0x01f7011641ULL };
+
+		__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+		// 载入首个64字节块并混入初始状态
+		x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00));
+		x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10));
+		x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20));
+		x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30));
+
+		x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+		x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+
+		data += 64;
+		length -= 64;
+
+		// 4路并行折叠64字节块
+		while (length >= 64)
+		{
+			x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+			x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+			x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+			x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+			x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+			x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+			x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+			x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+			y5 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00));
+			y6 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10));
+			y7 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20));
+			y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30));
+
+			x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+			x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+			x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+			x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+			data += 64;
+			length -= 64;
+		}
+
+		// 合并为128位
+		x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+		// 单路折叠剩余16字节块
+		while (length >= 16)
+		{
+			x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+
+			x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+			x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+			x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+			data += 16;
+			length -= 16;
+		}
+
+		// 128位折叠到64位
+		x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+		x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+		x1 = _mm_srli_si128(x1, 8);
+		x1 = _mm_xor_si128(x1, x2);
+
+		x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+
+		x2 = _mm_srli_si128(x1, 4);
+		x1 = _mm_and_si128(x1, x3);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_xor_si128(x1, x2);
+
+		// Barrett约简到32位
+		x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+
+		x2 = _mm_and_si128(x1, x3);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+		x2 = _mm_and_si128(x2, x3);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x1 = _mm_xor_si128(x1, x2);
+
+		return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+	}
+
+	uint32_t UpdatePclmul(uint32_t crc, const uint8_t* data, size_t length)
+	{
+		// 短数据折叠收益不足，直接走切片查表
+		if (length >= 64)
+		{
+			size_t foldLength = length & ~static_cast<size_t>(15);
+			crc = FoldPclmul(crc, data, foldLength);
+			data += foldLength;
+			length -= foldLength;
+		}
+
+		return UpdateSlicingBy8(crc, data, length);
+	}
+#endif
+
+	bool IsPclmulAvailable()
+	{
+#if CRC32_HAS_X86
+		static const bool available = DetectPclmul();
+		return available;
+#else
+		return false;
+#endif
+	}
+
+	Crc32UpdateFunc ResolveUpdateFunc(Crc32Implementation impl)
+	{
+		switch (impl)
+		{
+		case Crc32Implementation::Table:
+			return UpdateTable;
+		case Crc32Implementation::SlicingBy8:
+			return UpdateSlicingBy8;
+		case Crc32Implementation::SlicingBy16:
+			return UpdateSlicingBy16;
+		case Crc32Implementation::Pclmul:
+#if CRC32_HAS_X86
+			return IsPclmulAvailable() ? UpdatePclmul : nullptr;
+#else
+			return nullptr;
+#endif
+		case Crc32Implementation::Auto:
+		default:
+			return IsPclmulAvailable() ? ResolveUpdateFunc(Crc32Implementation::Pclmul) : UpdateSlicingBy8;
+		}
+	}
+
+	Crc32Implementation ResolveAutoImplementation()
+	{
+		return IsPclmulAvailable() ? Crc32Implementation::Pclmul : Crc32Implementation::SlicingBy8;
+	}
+
+	// 当前生效的实现（首次使用时按CPU能力选择）
+	struct Crc32Dispatch
+	{
+		std::atomic<Crc32UpdateFunc> func;
+		std::atomic<Crc32Implementation> impl;
+
+		Crc32Dispatch()
+		{
+			impl.store(ResolveAutoImplementation());
+			func.store(ResolveUpdateFunc(impl.load()));
+		}
+	};
+
+	Crc32Dispatch& GetDispatch()
+	{
+		static Crc32Dispatch dispatch;
+		return dispatch;
+	}
+}
+
+uint32_t Crc32::Update(uint32_t state, const uint8_t* data, size_t length)
+{
+	if (data == nullptr || length == 0)
+	{
+		return state;
+	}
+
+	return GetDispatch().func.load(std::memory_order_relaxed)(state, data, length);
+}
+
+uint32_t Crc32::Calculate(const uint8_t* data, size_t length)
+{
+	return Final(Update(Init(), data, length));
+}
+
+uint32_t Crc32::Update(Crc32Implementation impl, uint32_t state, const uint8_t* data, size_t length)
+{
+	Crc32UpdateFunc func = ResolveUpdateFunc(impl);
+	if (func == nullptr)
+	{
+		// 不支持的实现回退到当前实现
+		return Update(state, data, length);
+	}
+
+	if (data == nullptr || length == 0)
+	{
+		return state;
+	}
+
+	return func(state, data, length);
+}
+
+bool Crc32::SetImplementation(Crc32Implementation impl)
+{
+	Crc32UpdateFunc func = ResolveUpdateFunc(impl);
+	if (func == nullptr)
+	{
+		return false;
+	}
+
+	Crc32Dispatch& dispatch = GetDispatch();
+	dispatch.impl.store(impl == Crc32Implementation::Auto ? ResolveAutoImplementation() : impl);
+	dispatch.func.store(func);
+	return true;
+}
+
+Crc32Implementation Crc32::GetImplementation()
+{
+	return GetDispatch().impl.load();
+}
+
+bool Crc32::IsSupported(Crc32Implementation impl)
+{
+	return ResolveUpdateFunc(impl) != nullptr;
+}
+
+const char* Crc32::GetImplementationName(Crc32Implementation impl)
+{
+	switch (impl)
+	{
+	case Crc32Implementation::Auto:
+		return "Auto";
+	case Crc32Implementation::Table:
+		return "Table";
+	case Crc32Implementation::SlicingBy8:
+		return "SlicingBy8";
+	case Crc32Implementation::SlicingBy16:
+		return "SlicingBy16";
+	case Crc32Implementation::Pclmul:
+		return "PCLMUL";
+	default:
+		return "Unknown";
+	}
+}
@@ -0,0 +1,52 @@
+﻿#pragma once
+#pragma execution_character_set("utf-8")
+
+#include <cstdint>
+#include <cstddef>
+
+// CRC32实现类型（多项式 0xEDB88320，反射，与原查表实现逐位兼容）
+enum class Crc32Implementation : uint8_t
+{
+	Auto = 0,        // 按CPU能力自动选择
+	Table,           // 单字节查表（原始实现）
+	SlicingBy8,      // 8字节切片查表
+	SlicingBy16,     // 16字节切片查表
+	Pclmul           // PCLMULQDQ折叠（需要 PCLMUL + SSE4.1）
+};
+
+// CRC32计算引擎
+// 用法：
+//   Crc32 crc;                  // 或 uint32_t state = Crc32::Init();
+//   crc.Update(header, 5);
+//   crc.Update(payload, len);
+//   uint32_t value = crc.Final();
+class Crc32
+{
+public:
+	Crc32() : m_state(Init()) {}
+
+	// 流式接口
+	void Reset() { m_state = Init(); }
+	void Update(const uint8_t* data, size_t length) { m_state = Update(m_state, data, length); }
+	uint32_t Final() const { return Final(m_state); }
+
+	// 无状态接口（state为未取反的中间值）
+	static uint32_t Init() { return 0xFFFFFFFF; }
+	static uint32_t Update(uint32_t state, const uint8_t* data, size_t length);
+	static uint32_t Final(uint32_t state) { return state ^ 0xFFFFFFFF; }
+
+	// 一次性计算
+	static uint32_t Calculate(const uint8_t* data, size_t length);
+
+	// 指定实现计算（用于校验与性能对比）
+	static uint32_t Update(Crc32Implementation impl, uint32_t state, const uint8_t* data, size_t length);
+
+	// 实现选择：不支持的实现返回false且保持当前实现不变
+	static bool SetImplementation(Crc32Implementation impl);
+	static Crc32Implementation GetImplementation();
+	static bool IsSupported(Crc32Implementation impl);
+	static const char* GetImplementationName(Crc32Implementation impl);
+
+private:
+	uint32_t m_state;
+};
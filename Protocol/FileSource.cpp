@@ -0,0 +1,280 @@
+﻿#pragma execution_character_set("utf-8")
+
+#include "pch.h"
+#include "FileSource.h"
+#include <algorithm>
+#include <cstring>
+
+FileSource::FileSource()
+	: m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr), m_view(nullptr), m_viewOffset(0), m_viewSize(0), m_size(0), m_position(0), m_modifyTime(0), m_failed(false)
+{
+}
+
+FileSource::~FileSource()
+{
+	Close();
+}
+
+bool FileSource::Open(const std::string& filePath)
+{
+	Close();
+
+	return OpenHandle(CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+}
+
+bool FileSource::Open(const std::wstring& filePath)
+{
+	Close();
+
+	return OpenHandle(CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+}
+
+bool FileSource::OpenHandle(HANDLE file)
+{
+	m_file = file;
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size = {};
+	if (!GetFileSizeEx(m_file, &size))
+	{
+		Close();
+		return false;
+	}
+	m_size = size.QuadPart;
+
+	// FILETIME为1601年起的100ns计数，换算为Unix秒
+	FILETIME writeTime = {};
+	if (GetFileTime(m_file, nullptr, nullptr, &writeTime))
+	{
+		uint64_t ticks = (static_cast<uint64_t>(writeTime.dwHighDateTime) << 32) | writeTime.dwLowDateTime;
+		const uint64_t unixEpochTicks = 116444736000000000ULL;
+		m_modifyTime = (ticks > unixEpochTicks) ? (ticks - unixEpochTicks) / 10000000ULL : 0;
+	}
+
+	// 空文件无法映射；映射失败时保持流式读取
+	if (m_size > 0)
+	{
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	return true;
+}
+
+void FileSource::Close()
+{
+	UnmapView();
+	if (m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+	m_size = 0;
+	m_position = 0;
+	m_modifyTime = 0;
+	m_failed = false;
+}
+
+size_t FileSource::Read(uint8_t* buffer, size_t size)
+{
+	if (!IsOpen() || m_failed || m_position >= m_size || size == 0)
+	{
+		return 0;
+	}
+
+	if (!m_mapping)
+	{
+		DWORD bytesRead = 0;
+		DWORD request = static_cast<DWORD>((std::min)(size, static_cast<size_t>(MAXDWORD)));
+		if (!ReadFile(m_file, buffer, request, &bytesRead, nullptr))
+		{
+			m_failed = true;
+			return 0;
+		}
+		m_position += bytesRead;
+		return bytesRead;
+	}
+
+	size_t total = 0;
+	while (total < size && m_position < m_size)
+	{
+		if (!m_view || m_position < m_viewOffset || m_position >= m_viewOffset + static_cast<int64_t>(m_viewSize))
+		{
+			if (!MapViewAt(m_position))
+			{
+				m_failed = true;
+				break;
+			}
+		}
+
+		size_t viewPosition = static_cast<size_t>(m_position - m_viewOffset);
+		size_t length = (std::min)(size - total, m_viewSize - viewPosition);
+		memcpy(buffer + total, m_view + viewPosition, length);
+		total += length;
+		m_position += static_cast<int64_t>(length);
+	}
+	return total;
+}
+
+bool FileSource::Seek(int64_t position)
+{
+	if (!IsOpen() || position < 0 || position > m_size)
+	{
+		return false;
+	}
+
+	// 映射模式下仅移动读位置，下次读取时按需切换视图
+	if (!m_mapping)
+	{
+		LARGE_INTEGER distance = {};
+		distance.QuadPart = position;
+		if (!SetFilePointerEx(m_file, distance, nullptr, FILE_BEGIN))
+		{
+			return false;
+		}
+	}
+
+	m_position = position;
+	m_failed = false;
+	return true;
+}
+
+bool FileSource::MapViewAt(int64_t offset)
+{
+	UnmapView();
+
+	int64_t viewOffset = offset - (offset % static_cast<int64_t>(MAPPED_VIEW_SIZE));
+	size_t viewSize = static_cast<size_t>((std::min)(static_cast<int64_t>(MAPPED_VIEW_SIZE), m_size - viewOffset));
+
+	m_view = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ,
+		static_cast<DWORD>(static_cast<uint64_t>(viewOffset) >> 32),
+		static_cast<DWORD>(static_cast<uint64_t>(viewOffset) & 0xFFFFFFFF),
+		viewSize));
+	if (!m_view)
+	{
+		return false;
+	}
+
+	m_viewOffset = viewOffset;
+	m_viewSize = viewSize;
+	return true;
+}
+
+void FileSource::UnmapView()
+{
+	if (m_view)
+	{
+		UnmapViewOfFile(m_view);
+		m_view = nullptr;
+	}
+	m_viewOffset = 0;
+	m_viewSize = 0;
+}
+
+FileReadAhead::FileReadAhead(FileSource& source, PacketPool& pool, size_t chunkSize, size_t depth)
+	: m_source(source), m_pool(pool), m_chunkSize(chunkSize), m_depth((std::max)(depth, static_cast<size_t>(1))),
+	m_finished(false), m_stopRequested(false), m_failed(false), m_stalls(0)
+{
+}
+
+FileReadAhead::~FileReadAhead()
+{
+	Stop();
+}
+
+bool FileReadAhead::Start()
+{
+	if (m_thread.joinable() || m_chunkSize == 0)
+	{
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_ready.clear();
+		m_finished = false;
+		m_stopRequested = false;
+	}
+	m_failed = false;
+	m_thread = std::thread(&FileReadAhead::ReadThread, this);
+	return true;
+}
+
+void FileReadAhead::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopRequested = true;
+	}
+	m_condition.notify_all();
+
+	if (m_thread.joinable())
+	{
+		m_thread.join();
+	}
+
+	// 归还未取走的分块
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_ready.clear();
+}
+
+bool FileReadAhead::Next(PacketRef& chunk)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_ready.empty() && !m_finished && !m_stopRequested)
+	{
+		++m_stalls;
+		m_condition.wait(lock, [this] { return !m_ready.empty() || m_finished || m_stopRequested; });
+	}
+
+	if (m_ready.empty() || m_stopRequested)
+	{
+		return false;
+	}
+
+	chunk = std::move(m_ready.front());
+	m_ready.pop();
+	m_condition.notify_all();
+	return true;
+}
+
+void FileReadAhead::ReadThread()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this] { return m_ready.size() < m_depth || m_stopRequested; });
+			if (m_stopRequested)
+			{
+				break;
+			}
+		}
+
+		// 读盘在锁外进行，发送方可同时取走已就绪的分块
+		PacketRef chunk = m_pool.Acquire(m_chunkSize);
+		size_t bytesRead = m_source.Read(chunk->Payload(), m_chunkSize);
+		if (bytesRead == 0)
+		{
+			m_failed = m_source.HasFailed();
+			break;
+		}
+		chunk->SetPayloadSize(bytesRead);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_ready.push(std::move(chunk));
+		m_condition.notify_all();
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_finished = true;
+	m_condition.notify_all();
+}
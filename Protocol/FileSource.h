@@ -0,0 +1,106 @@
+﻿#pragma once
+#pragma execution_character_set("utf-8")
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <Windows.h>
+#include "PacketPool.h"
+
+// 发送文件数据源：优先以内存映射读取，按固定大小的视图顺序滑动，地址空间占用与文件大小无关（32位进程也可发送超大文件）
+// 映射失败（空文件、部分网络路径等）时退化为带顺序扫描提示的流式ReadFile。
+// 非线程安全，同一时刻只应由一个线程读取。
+class FileSource
+{
+public:
+	static const size_t MAPPED_VIEW_SIZE = 64 * 1024 * 1024; // 单个映射视图大小（需为分配粒度的整数倍）
+
+public:
+	FileSource();
+	~FileSource();
+
+	FileSource(const FileSource&) = delete;
+	FileSource& operator=(const FileSource&) = delete;
+
+	bool Open(const std::string& filePath);
+	bool Open(const std::wstring& filePath);   // 宽字符路径，支持当前代码页之外的文件名
+	void Close();
+
+	// 读取最多size字节，返回实际读取字节数；0表示已到文件末尾或读取失败（见HasFailed）
+	size_t Read(uint8_t* buffer, size_t size);
+	bool Seek(int64_t position);
+
+	// 状态查询
+	bool IsOpen() const { return m_file != INVALID_HANDLE_VALUE; }
+	bool IsMapped() const { return m_mapping != nullptr; }
+	bool HasFailed() const { return m_failed; }
+	int64_t GetSize() const { return m_size; }
+	int64_t GetPosition() const { return m_position; }
+	uint64_t GetModifyTime() const { return m_modifyTime; } // 最后修改时间（Unix秒）
+
+private:
+	bool OpenHandle(HANDLE file);   // 读取已打开文件的大小与修改时间并建立映射
+	bool MapViewAt(int64_t offset); // 映射包含offset的视图
+	void UnmapView();
+
+private:
+	HANDLE m_file;
+	HANDLE m_mapping;
+	const uint8_t* m_view;  // 当前映射视图
+	int64_t m_viewOffset;   // 视图在文件中的起始偏移
+	size_t m_viewSize;
+	int64_t m_size;
+	int64_t m_position;
+	uint64_t m_modifyTime;
+	bool m_failed;
+};
+
+// 文件预读：后台线程从FileSource读取数据直接填入包缓冲区，最多提前准备depth个分块
+// 发送窗口已满时预读继续进行，发送方取到的分块总是已就绪，只需等待链路。
+// 用法：
+//   FileReadAhead readAhead(source, pool, chunkSize, depth);
+//   readAhead.Start();
+//   PacketRef chunk;
+//   while (readAhead.Next(chunk)) { ... }   // 返回false表示已读完、读取失败或已Stop()
+class FileReadAhead
+{
+public:
+	FileReadAhead(FileSource& source, PacketPool& pool, size_t chunkSize, size_t depth);
+	~FileReadAhead();
+
+	FileReadAhead(const FileReadAhead&) = delete;
+	FileReadAhead& operator=(const FileReadAhead&) = delete;
+
+	bool Start();
+	void Stop();
+
+	// 取下一个分块，必要时等待预读线程
+	bool Next(PacketRef& chunk);
+
+	// 状态查询
+	bool HasFailed() const { return m_failed.load(); }
+	uint64_t GetStallCount() const { return m_stalls.load(); }
+
+private:
+	void ReadThread();
+
+private:
+	FileSource& m_source;
+	PacketPool& m_pool;
+	size_t m_chunkSize;
+	size_t m_depth;
+
+	std::thread m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	PacketQueue m_ready;                // 已读好的分块（m_mutex保护）
+	bool m_finished;                    // 预读线程已读到文件末尾或失败
+	bool m_stopRequested;
+
+	std::atomic<bool> m_failed;
+	std::atomic<uint64_t> m_stalls;     // 发送方等待预读的次数（磁盘慢于链路）
+};
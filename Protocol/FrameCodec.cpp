@@ -2,221 +2,389 @@
 
 #include "pch.h"
 #include "FrameCodec.h"
+#include "Crc32.h"
 #include "../Common/CommonTypes.h"
 #include <algorithm>
 #include <cstring>
 
-// 静态成员初始化
-uint32_t FrameCodec::s_crcTable[256];
-bool FrameCodec::s_crcTableInit = false;
-
 FrameCodec::FrameCodec()
-	: m_maxPayloadSize(MAX_PAYLOAD_SIZE)
+	: m_readPos(0), m_invalidFrames(0), m_maxPayloadSize(MAX_PAYLOAD_SIZE), m_frameVersion(PROTOCOL_VERSION_1)
 {
-	if (!s_crcTableInit)
-	{
-		InitCRCTable();
-	}
 }
 
 FrameCodec::~FrameCodec()
 {
 }
 
-void FrameCodec::InitCRCTable()
+uint32_t FrameCodec::CalculateCRC32(const uint8_t* data, size_t length)
 {
-	const uint32_t polynomial = 0xEDB88320;
+	return Crc32::Calculate(data, length);
+}
 
-	for (uint32_t i = 0; i < 256; i++)
+bool FrameCodec::VerifyCRC32(const uint8_t* data, size_t length, uint32_t crc)
+{
+	return CalculateCRC32(data, length) == crc;
+}
+
+uint32_t FrameCodec::CalculateFrameCRC32(uint8_t version, uint8_t type, uint32_t sequence, uint32_t length, const uint8_t* payload)
+{
+	// CRC覆盖范围：类型+序号(小端)+长度(小端)+数据，直接在原数据上计算，避免拼接临时缓冲
+	// v1序号/长度各2字节，v2各4字节
+	const size_t fieldWidth = (version >= PROTOCOL_VERSION_2) ? 4 : 2;
+	uint8_t fields[9];
+	size_t fieldCount = 0;
+
+	fields[fieldCount++] = type;
+	for (size_t i = 0; i < fieldWidth; i++)
 	{
-		uint32_t crc = i;
-		for (int j = 0; j < 8; j++)
-		{
-			if (crc & 1)
-			{
-				crc = (crc >> 1) ^ polynomial;
-			}
-			else
-			{
-				crc >>= 1;
-			}
-		}
-		s_crcTable[i] = crc;
+		fields[fieldCount++] = static_cast<uint8_t>((sequence >> (i * 8)) & 0xFF);
+	}
+	for (size_t i = 0; i < fieldWidth; i++)
+	{
+		fields[fieldCount++] = static_cast<uint8_t>((length >> (i * 8)) & 0xFF);
 	}
 
-	s_crcTableInit = true;
+	Crc32 crc;
+	crc.Update(fields, fieldCount);
+	if (length > 0)
+	{
+		crc.Update(payload, length);
+	}
+
+	return crc.Final();
 }
 
-uint32_t FrameCodec::CalculateCRC32(const uint8_t* data, size_t length)
+size_t FrameCodec::ClampPayloadSize(uint8_t version, size_t payloadSize) const
 {
-	if (!s_crcTableInit)
+	// 确保负载不超过最大限制及帧头长度字段的表示范围
+	const size_t formatLimit = (version >= PROTOCOL_VERSION_2) ? MAX_PAYLOAD_SIZE_V2 : MAX_PAYLOAD_SIZE_V1;
+	payloadSize = (std::min)(payloadSize, m_maxPayloadSize);
+	return (std::min)(payloadSize, formatLimit);
+}
+
+size_t FrameCodec::WriteFrameHeader(uint8_t version, FrameType type, uint32_t sequence, const uint8_t* payload, size_t payloadSize, uint8_t* frame)
+{
+	// 构建帧头并计算CRC32（类型+序号+长度+数据）
+	if (version >= PROTOCOL_VERSION_2)
 	{
-		InitCRCTable();
+		FrameHeaderV2 header;
+		header.magic = HEADER_MAGIC_V2;
+		header.type = static_cast<uint8_t>(type);
+		header.sequence = sequence;
+		header.length = static_cast<uint32_t>(payloadSize);
+		header.crc32 = CalculateFrameCRC32(version, header.type, header.sequence, header.length, payload);
+		memcpy(frame, &header, sizeof(header));
+		return sizeof(FrameHeaderV2);
 	}
+	else
+	{
+		FrameHeader header;
+		header.magic = HEADER_MAGIC;
+		header.type = static_cast<uint8_t>(type);
+		header.sequence = static_cast<uint16_t>(sequence & 0xFFFF);
+		header.length = static_cast<uint16_t>(payloadSize);
+		header.crc32 = CalculateFrameCRC32(version, header.type, header.sequence, header.length, payload);
+		memcpy(frame, &header, sizeof(header));
+		return sizeof(FrameHeader);
+	}
+}
 
-	uint32_t crc = 0xFFFFFFFF;
+void FrameCodec::WriteFrameTail(uint8_t* tailBuffer)
+{
+	FrameTail tail;
+	tail.magic = TAIL_MAGIC;
+	memcpy(tailBuffer, &tail, sizeof(tail));
+}
 
-	for (size_t i = 0; i < length; i++)
+size_t FrameCodec::WriteFrame(uint8_t version, FrameType type, uint32_t sequence, const uint8_t* payload, size_t payloadSize, uint8_t* frame)
+{
+	const size_t headerSize = WriteFrameHeader(version, type, sequence, payload, payloadSize, frame);
+
+	// 写入负载（原地编码时负载已在位）
+	if (payloadSize > 0 && payload != frame + headerSize)
 	{
-		uint8_t index = (uint8_t)(crc ^ data[i]);
-		crc = (crc >> 8) ^ s_crcTable[index];
+		memcpy(frame + headerSize, payload, payloadSize);
 	}
 
-	return crc ^ 0xFFFFFFFF;
+	WriteFrameTail(frame + headerSize + payloadSize);
+	return headerSize + payloadSize + sizeof(FrameTail);
 }
 
-bool FrameCodec::VerifyCRC32(const uint8_t* data, size_t length, uint32_t crc)
+std::vector<uint8_t> FrameCodec::EncodeFrame(FrameType type, uint32_t sequence, const std::vector<uint8_t>& payload)
 {
-	return CalculateCRC32(data, length) == crc;
+	const uint8_t version = m_frameVersion.load();
+	const size_t headerSize = (version >= PROTOCOL_VERSION_2) ? sizeof(FrameHeaderV2) : sizeof(FrameHeader);
+	const size_t payloadSize = ClampPayloadSize(version, payload.size());
+
+	// 一次性分配整帧空间
+	std::vector<uint8_t> frame(headerSize + payloadSize + sizeof(FrameTail));
+	WriteFrame(version, type, sequence, payload.data(), payloadSize, frame.data());
+	return frame;
 }
 
-std::vector<uint8_t> FrameCodec::EncodeFrame(FrameType type, uint16_t sequence, const std::vector<uint8_t>& payload)
+size_t FrameCodec::EncodeFrameInPlace(FrameType type, uint32_t sequence, uint8_t* payload, size_t payloadSize, uint8_t*& frameStart)
 {
-	std::vector<uint8_t> frame;
+	const uint8_t version = m_frameVersion.load();
+	const size_t headerSize = (version >= PROTOCOL_VERSION_2) ? sizeof(FrameHeaderV2) : sizeof(FrameHeader);
 
-	// 确保负载不超过最大限制
-	size_t payloadSize = (std::min)(payload.size(), m_maxPayloadSize);
+	frameStart = payload - headerSize;
+	return WriteFrame(version, type, sequence, payload, ClampPayloadSize(version, payloadSize), frameStart);
+}
 
-	// 预留空间
-	frame.reserve(sizeof(FrameHeader) + payloadSize + sizeof(FrameTail));
+size_t FrameCodec::EncodeFrameTo(FrameType type, uint32_t sequence, const uint8_t* payload, size_t payloadSize, uint8_t* buffer, size_t capacity)
+{
+	const uint8_t version = m_frameVersion.load();
+	const size_t headerSize = (version >= PROTOCOL_VERSION_2) ? sizeof(FrameHeaderV2) : sizeof(FrameHeader);
+	payloadSize = ClampPayloadSize(version, payloadSize);
 
-	// 构建帧头
-	FrameHeader header;
-	header.magic = HEADER_MAGIC;
-	header.type = static_cast<uint8_t>(type);
-	header.sequence = sequence;
-	header.length = static_cast<uint16_t>(payloadSize);
+	if (headerSize + payloadSize + sizeof(FrameTail) > capacity)
+	{
+		return 0;
+	}
+	return WriteFrame(version, type, sequence, payload, payloadSize, buffer);
+}
 
-	// 计算CRC32（类型+序号+长度+数据）
-	std::vector<uint8_t> crcData;
-	crcData.push_back(header.type);
-	crcData.push_back(header.sequence & 0xFF);
-	crcData.push_back((header.sequence >> 8) & 0xFF);
-	crcData.push_back(header.length & 0xFF);
-	crcData.push_back((header.length >> 8) & 0xFF);
-	crcData.insert(crcData.end(), payload.begin(), payload.begin() + payloadSize);
+size_t FrameCodec::EncodeFrameSegments(FrameType type, uint32_t sequence, const uint8_t* payload, size_t payloadSize,
+	uint8_t* headerBuffer, uint8_t* tailBuffer, WriteSegment* segments, size_t& frameSize)
+{
+	const uint8_t version = m_frameVersion.load();
+	payloadSize = ClampPayloadSize(version, payloadSize);
 
-	header.crc32 = CalculateCRC32(crcData.data(), crcData.size());
+	// 帧头CRC直接在调用方的负载上计算，负载本身不拷贝
+	const size_t headerSize = WriteFrameHeader(version, type, sequence, payload, payloadSize, headerBuffer);
+	WriteFrameTail(tailBuffer);
 
-	// 写入帧头
-	frame.insert(frame.end(), (uint8_t*)&header, (uint8_t*)&header + sizeof(header));
+	size_t count = 0;
+	segments[count++] = { headerBuffer, headerSize };
+	if (payloadSize > 0)
+	{
+		segments[count++] = { payload, payloadSize };
+	}
+	segments[count++] = { tailBuffer, sizeof(FrameTail) };
 
-	// 写入负载
-	frame.insert(frame.end(), payload.begin(), payload.begin() + payloadSize);
+	frameSize = headerSize + payloadSize + sizeof(FrameTail);
+	return count;
+}
 
-	// 写入帧尾
-	FrameTail tail;
-	tail.magic = TAIL_MAGIC;
-	frame.insert(frame.end(), (uint8_t*)&tail, (uint8_t*)&tail + sizeof(tail));
+size_t FrameCodec::EncodeSackFrameTo(uint32_t base, uint16_t windowSize, const uint8_t* bitmap, size_t bitmapSize, uint8_t* buffer, size_t capacity)
+{
+	const uint8_t version = m_frameVersion.load();
+	const size_t headerSize = (version >= PROTOCOL_VERSION_2) ? sizeof(FrameHeaderV2) : sizeof(FrameHeader);
+	const size_t payloadSize = 2 + bitmapSize;
 
-	return frame;
+	// 位图截断后对端无法解析，负载超限时不编码
+	if (ClampPayloadSize(version, payloadSize) < payloadSize || headerSize + payloadSize + sizeof(FrameTail) > capacity)
+	{
+		return 0;
+	}
+
+	// 负载直接写在帧头之后，与EncodeSackFrame布局一致
+	uint8_t* payload = buffer + headerSize;
+	payload[0] = windowSize & 0xFF;
+	payload[1] = (windowSize >> 8) & 0xFF;
+	if (bitmapSize > 0)
+	{
+		memcpy(payload + 2, bitmap, bitmapSize);
+	}
+	return WriteFrame(version, FrameType::FRAME_SACK, base, payload, payloadSize, buffer);
 }
 
-std::vector<uint8_t> FrameCodec::EncodeStartFrame(uint16_t sequence, const StartMetadata& metadata)
+std::vector<uint8_t> FrameCodec::EncodeStartFrame(uint32_t sequence, const StartMetadata& metadata)
 {
 	std::vector<uint8_t> payload = SerializeStartMetadata(metadata);
 	return EncodeFrame(FrameType::FRAME_START, sequence, payload);
 }
 
-std::vector<uint8_t> FrameCodec::EncodeDataFrame(uint16_t sequence, const std::vector<uint8_t>& data)
+std::vector<uint8_t> FrameCodec::EncodeDataFrame(uint32_t sequence, const std::vector<uint8_t>& data)
 {
 	return EncodeFrame(FrameType::FRAME_DATA, sequence, data);
 }
 
-std::vector<uint8_t> FrameCodec::EncodeEndFrame(uint16_t sequence)
+std::vector<uint8_t> FrameCodec::EncodeEndFrame(uint32_t sequence)
 {
 	std::vector<uint8_t> empty;
 	return EncodeFrame(FrameType::FRAME_END, sequence, empty);
 }
 
-std::vector<uint8_t> FrameCodec::EncodeAckFrame(uint16_t sequence)
+std::vector<uint8_t> FrameCodec::EncodeAckFrame(uint32_t sequence)
 {
 	std::vector<uint8_t> empty;
 	return EncodeFrame(FrameType::FRAME_ACK, sequence, empty);
 }
 
-std::vector<uint8_t> FrameCodec::EncodeNakFrame(uint16_t sequence)
+std::vector<uint8_t> FrameCodec::EncodeStartAckFrame(uint32_t sequence, const StartAckInfo& info)
+{
+	std::vector<uint8_t> payload;
+	payload.reserve(16);
+	payload.push_back(info.version);
+	payload.push_back(info.flags);
+	payload.push_back(info.windowSize & 0xFF);
+	payload.push_back((info.windowSize >> 8) & 0xFF);
+	for (int i = 0; i < 4; i++)
+	{
+		payload.push_back((info.maxPayloadSize >> (i * 8)) & 0xFF);
+	}
+
+	// 续传偏移（8字节小端），旧实现只解析前8字节
+	if (info.flags & START_FLAG_RESUME)
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			payload.push_back((info.resumeOffset >> (i * 8)) & 0xFF);
+		}
+	}
+	return EncodeFrame(FrameType::FRAME_ACK, sequence, payload);
+}
+
+std::vector<uint8_t> FrameCodec::EncodeNakFrame(uint32_t sequence)
 {
 	std::vector<uint8_t> empty;
 	return EncodeFrame(FrameType::FRAME_NAK, sequence, empty);
 }
 
-std::vector<uint8_t> FrameCodec::EncodeHeartbeatFrame(uint16_t sequence)
+std::vector<uint8_t> FrameCodec::EncodeHeartbeatFrame(uint32_t sequence)
 {
 	std::vector<uint8_t> empty;
 	return EncodeFrame(FrameType::FRAME_HEARTBEAT, sequence, empty);
 }
 
+std::vector<uint8_t> FrameCodec::EncodeSackFrame(uint32_t base, uint16_t windowSize, const std::vector<uint8_t>& bitmap)
+{
+	std::vector<uint8_t> payload;
+	payload.reserve(2 + bitmap.size());
+	payload.push_back(windowSize & 0xFF);
+	payload.push_back((windowSize >> 8) & 0xFF);
+	payload.insert(payload.end(), bitmap.begin(), bitmap.end());
+	return EncodeFrame(FrameType::FRAME_SACK, base, payload);
+}
+
 Frame FrameCodec::DecodeFrame(const std::vector<uint8_t>& data)
+{
+	return DecodeFrame(data.data(), data.size());
+}
+
+Frame FrameCodec::DecodeFrame(const uint8_t* data, size_t size)
 {
 	Frame frame;
+	FrameView view;
+	size_t frameSize = 0;
 
-	if (data.size() < MIN_FRAME_SIZE)
+	if (data == nullptr || ParseFrame(data, size, view, frameSize) != ParseResult::Complete)
 	{
 		frame.valid = false;
 		return frame;
 	}
 
-	// 读取帧头
-	const FrameHeader* header = reinterpret_cast<const FrameHeader*>(data.data());
+	// 填充帧信息
+	frame.type = view.type;
+	frame.sequence = view.sequence;
+	frame.crc32 = view.crc32;
+	frame.version = view.version;
+	frame.valid = true;
 
-	// 验证魔数
-	if (header->magic != HEADER_MAGIC)
+	if (view.payloadSize > 0)
 	{
-		frame.valid = false;
-		return frame;
+		frame.payload.assign(view.payload, view.payload + view.payloadSize);
 	}
 
-	// 验证长度
-	if (data.size() < sizeof(FrameHeader) + header->length + sizeof(FrameTail))
+	return frame;
+}
+
+FrameCodec::ParseResult FrameCodec::ParseFrame(const uint8_t* data, size_t available, FrameView& view, size_t& frameSize)
+{
+	if (available < sizeof(uint16_t))
 	{
-		frame.valid = false;
-		return frame;
+		return ParseResult::Incomplete;
 	}
 
-	// 验证帧尾魔数
-	const FrameTail* tail = reinterpret_cast<const FrameTail*>(
-		data.data() + sizeof(FrameHeader) + header->length);
+	// 按魔数识别帧头版本
+	uint16_t magic = 0;
+	memcpy(&magic, data, sizeof(magic));
 
-	if (tail->magic != TAIL_MAGIC)
+	uint8_t version = 0;
+	size_t headerSize = 0;
+	if (magic == HEADER_MAGIC)
 	{
-		frame.valid = false;
-		return frame;
+		version = PROTOCOL_VERSION_1;
+		headerSize = sizeof(FrameHeader);
+	}
+	else if (magic == HEADER_MAGIC_V2)
+	{
+		version = PROTOCOL_VERSION_2;
+		headerSize = sizeof(FrameHeaderV2);
+	}
+	else
+	{
+		return ParseResult::Invalid;
 	}
 
-	// 验证CRC32
-	std::vector<uint8_t> crcData;
-	crcData.push_back(header->type);
-	crcData.push_back(header->sequence & 0xFF);
-	crcData.push_back((header->sequence >> 8) & 0xFF);
-	crcData.push_back(header->length & 0xFF);
-	crcData.push_back((header->length >> 8) & 0xFF);
+	if (available < headerSize)
+	{
+		return ParseResult::Incomplete;
+	}
 
-	if (header->length > 0)
+	// 读取帧头（memcpy避免非对齐访问）
+	uint8_t type = 0;
+	uint32_t sequence = 0;
+	uint32_t length = 0;
+	uint32_t crc32 = 0;
+	if (version == PROTOCOL_VERSION_2)
 	{
-		const uint8_t* payloadPtr = data.data() + sizeof(FrameHeader);
-		crcData.insert(crcData.end(), payloadPtr, payloadPtr + header->length);
+		FrameHeaderV2 header;
+		memcpy(&header, data, sizeof(header));
+		type = header.type;
+		sequence = header.sequence;
+		length = header.length;
+		crc32 = header.crc32;
+
+		// 长度超出上限时视为误同步，避免为伪造的长度字段长时间等待
+		if (length > MAX_PAYLOAD_SIZE_V2)
+		{
+			return ParseResult::Invalid;
+		}
+	}
+	else
+	{
+		FrameHeader header;
+		memcpy(&header, data, sizeof(header));
+		type = header.type;
+		sequence = header.sequence;
+		length = header.length;
+		crc32 = header.crc32;
 	}
 
-	if (!VerifyCRC32(crcData.data(), crcData.size(), header->crc32))
+	// 验证长度
+	frameSize = headerSize + length + sizeof(FrameTail);
+	if (available < frameSize)
 	{
-		frame.valid = false;
-		return frame;
+		return ParseResult::Incomplete;
 	}
 
-	// 填充帧信息
-	frame.type = static_cast<FrameType>(header->type);
-	frame.sequence = header->sequence;
-	frame.crc32 = header->crc32;
-	frame.valid = true;
+	// 验证帧尾魔数
+	FrameTail tail;
+	memcpy(&tail, data + headerSize + length, sizeof(tail));
 
-	if (header->length > 0)
+	if (tail.magic != TAIL_MAGIC)
 	{
-		const uint8_t* payloadPtr = data.data() + sizeof(FrameHeader);
-		frame.payload.assign(payloadPtr, payloadPtr + header->length);
+		return ParseResult::Invalid;
 	}
 
-	return frame;
+	// 验证CRC32
+	const uint8_t* payloadPtr = data + headerSize;
+	if (CalculateFrameCRC32(version, type, sequence, length, payloadPtr) != crc32)
+	{
+		return ParseResult::Invalid;
+	}
+
+	view.type = static_cast<FrameType>(type);
+	view.sequence = sequence;
+	view.payload = length > 0 ? payloadPtr : nullptr;
+	view.payloadSize = length;
+	view.crc32 = crc32;
+	view.version = version;
+	view.valid = true;
+
+	return ParseResult::Complete;
 }
 
 bool FrameCodec::DecodeStartMetadata(const std::vector<uint8_t>& payload, StartMetadata& metadata)
@@ -229,21 +397,140 @@ bool FrameCodec::DecodeStartMetadata(const std::vector<uint8_t>& payload, StartM
 	return DeserializeStartMetadata(payload.data(), payload.size(), metadata);
 }
 
+bool FrameCodec::DecodeStartMetadata(const uint8_t* data, size_t size, StartMetadata& metadata)
+{
+	if (!data || size == 0)
+	{
+		return false;
+	}
+
+	return DeserializeStartMetadata(data, size, metadata);
+}
+
+std::vector<uint8_t> FrameCodec::EncodeStartMetadata(const StartMetadata& metadata)
+{
+	return SerializeStartMetadata(metadata);
+}
+
+bool FrameCodec::DecodeStartAck(const std::vector<uint8_t>& payload, StartAckInfo& info)
+{
+	// v1接收端回复空ACK，视为未协商
+	if (payload.size() < 8)
+	{
+		return false;
+	}
+
+	info.version = payload[0];
+	info.flags = payload[1];
+	info.windowSize = payload[2] | (payload[3] << 8);
+	info.maxPayloadSize = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		info.maxPayloadSize |= static_cast<uint32_t>(payload[4 + i]) << (i * 8);
+	}
+
+	// 续传偏移缺失时视为对端不支持续传
+	info.resumeOffset = 0;
+	if (info.flags & START_FLAG_RESUME)
+	{
+		if (payload.size() < 16)
+		{
+			info.flags &= static_cast<uint8_t>(~START_FLAG_RESUME);
+		}
+		else
+		{
+			for (int i = 0; i < 8; i++)
+			{
+				info.resumeOffset |= static_cast<uint64_t>(payload[8 + i]) << (i * 8);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool FrameCodec::DecodeSackPayload(const std::vector<uint8_t>& payload, uint16_t& windowSize, std::vector<uint8_t>& bitmap)
+{
+	if (payload.size() < 2)
+	{
+		return false;
+	}
+
+	windowSize = payload[0] | (payload[1] << 8);
+
+	// 位图长度必须覆盖声明的窗口
+	size_t bitmapSize = (static_cast<size_t>(windowSize) + 7) / 8;
+	if (payload.size() - 2 < bitmapSize)
+	{
+		return false;
+	}
+
+	bitmap.assign(payload.begin() + 2, payload.begin() + 2 + bitmapSize);
+	return true;
+}
+
 void FrameCodec::AppendData(const std::vector<uint8_t>& data)
 {
-	m_buffer.insert(m_buffer.end(), data.begin(), data.end());
+	AppendData(data.data(), data.size());
+}
+
+void FrameCodec::AppendData(const uint8_t* data, size_t size)
+{
+	if (data == nullptr || size == 0)
+	{
+		return;
+	}
+
+	CompactBuffer();
+	m_buffer.insert(m_buffer.end(), data, data + size);
 }
 
 bool FrameCodec::TryGetFrame(Frame& frame)
+{
+	FrameView view;
+
+	if (!TryGetFrameView(view))
+	{
+		return false;
+	}
+
+	// 仅此处拷贝一次负载
+	frame.type = view.type;
+	frame.sequence = view.sequence;
+	frame.crc32 = view.crc32;
+	frame.version = view.version;
+	frame.valid = true;
+	frame.payload.assign(view.payload, view.payload + view.payloadSize);
+
+	return true;
+}
+
+bool FrameCodec::TryGetFrameView(FrameView& view)
 {
 	size_t startPos = 0;
 
-	if (FindFrameStart(startPos))
+	while (FindFrameStart(startPos))
 	{
-		if (ExtractFrame(startPos, frame))
+		size_t frameSize = 0;
+		ParseResult result = ParseFrame(m_buffer.data() + startPos, m_buffer.size() - startPos, view, frameSize);
+
+		if (result == ParseResult::Complete)
 		{
+			// 消费已处理的帧，视图仍指向缓冲区中的原数据
+			m_readPos = startPos + frameSize;
 			return true;
 		}
+
+		if (result == ParseResult::Incomplete)
+		{
+			// 数据不完整，丢弃帧头之前的无效数据后等待
+			m_readPos = startPos;
+			return false;
+		}
+
+		// 无效帧，跳过帧头继续查找
+		m_invalidFrames++;
+		m_readPos = startPos + sizeof(uint16_t);
 	}
 
 	return false;
@@ -252,6 +539,7 @@ bool FrameCodec::TryGetFrame(Frame& frame)
 void FrameCodec::ClearBuffer()
 {
 	m_buffer.clear();
+	m_readPos = 0;
 }
 
 void FrameCodec::SetMaxPayloadSize(size_t size)
@@ -259,68 +547,68 @@ void FrameCodec::SetMaxPayloadSize(size_t size)
 	m_maxPayloadSize = size;
 }
 
-bool FrameCodec::FindFrameStart(size_t& startPos)
+void FrameCodec::SetFrameVersion(uint8_t version)
 {
-	if (m_buffer.size() < sizeof(FrameHeader))
+	m_frameVersion.store(version >= PROTOCOL_VERSION_2 ? PROTOCOL_VERSION_2 : PROTOCOL_VERSION_1);
+}
+
+void FrameCodec::CompactBuffer()
+{
+	if (m_readPos == 0)
 	{
-		return false;
+		return;
 	}
 
-	for (size_t i = 0; i <= m_buffer.size() - sizeof(FrameHeader); i++)
+	if (m_readPos >= m_buffer.size())
 	{
-		uint16_t magic = *(uint16_t*)(&m_buffer[i]);
-		if (magic == HEADER_MAGIC)
-		{
-			startPos = i;
-			return true;
-		}
+		// 全部已消费，直接复位（保留容量）
+		m_buffer.clear();
+		m_readPos = 0;
 	}
-
-	// 未找到帧头，清理无效数据
-	if (m_buffer.size() > sizeof(FrameHeader))
+	else if (m_readPos >= COMPACT_THRESHOLD || m_readPos * 2 >= m_buffer.size())
 	{
-		m_buffer.erase(m_buffer.begin(), m_buffer.end() - sizeof(FrameHeader) + 1);
+		// 延迟压缩：已消费部分足够大时才整体前移，摊销拷贝开销
+		m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_readPos);
+		m_readPos = 0;
 	}
-
-	return false;
 }
 
-bool FrameCodec::ExtractFrame(size_t startPos, Frame& frame)
+bool FrameCodec::FindFrameStart(size_t& startPos)
 {
-	if (m_buffer.size() - startPos < sizeof(FrameHeader))
+	const size_t size = m_buffer.size();
+	if (m_readPos + sizeof(uint16_t) > size)
 	{
 		return false;
 	}
 
-	const FrameHeader* header = reinterpret_cast<const FrameHeader*>(&m_buffer[startPos]);
+	// 魔数0xAA55/0xAA56按小端存储为 0x55/0x56 0xAA，两者高字节相同，
+	// 使用memchr快速定位高字节后回看低字节
+	const uint8_t* base = m_buffer.data();
+	const uint8_t magicHigh = static_cast<uint8_t>((HEADER_MAGIC >> 8) & 0xFF);
+	const uint8_t magicLowV1 = static_cast<uint8_t>(HEADER_MAGIC & 0xFF);
+	const uint8_t magicLowV2 = static_cast<uint8_t>(HEADER_MAGIC_V2 & 0xFF);
+	size_t pos = m_readPos + 1;
 
-	size_t frameSize = sizeof(FrameHeader) + header->length + sizeof(FrameTail);
-
-	if (m_buffer.size() - startPos < frameSize)
+	while (pos < size)
 	{
-		// 数据不完整
-		return false;
-	}
-
-	// 提取完整帧
-	std::vector<uint8_t> frameData(m_buffer.begin() + startPos,
-		m_buffer.begin() + startPos + frameSize);
-
-	// 解码帧
-	frame = DecodeFrame(frameData);
+		const uint8_t* hit = static_cast<const uint8_t*>(memchr(base + pos, magicHigh, size - pos));
+		if (hit == nullptr)
+		{
+			break;
+		}
 
-	if (frame.valid)
-	{
-		// 从缓冲区移除已处理的帧
-		m_buffer.erase(m_buffer.begin(), m_buffer.begin() + startPos + frameSize);
-		return true;
-	}
-	else
-	{
-		// 无效帧，跳过帧头继续查找
-		m_buffer.erase(m_buffer.begin(), m_buffer.begin() + startPos + sizeof(uint16_t));
-		return false;
+		pos = static_cast<size_t>(hit - base);
+		if (base[pos - 1] == magicLowV1 || base[pos - 1] == magicLowV2)
+		{
+			startPos = pos - 1;
+			return true;
+		}
+		pos++;
 	}
+
+	// 未找到帧头，清理无效数据（保留末字节，可能是下一个魔数的前半部分）
+	m_readPos = size - 1;
+	return false;
 }
 
 std::vector<uint8_t> FrameCodec::SerializeStartMetadata(const StartMetadata& metadata)
@@ -359,6 +647,26 @@ std::vector<uint8_t> FrameCodec::SerializeStartMetadata(const StartMetadata& met
 	data.push_back(metadata.sessionId & 0xFF);
 	data.push_back((metadata.sessionId >> 8) & 0xFF);
 
+	// v2扩展字段：窗口大小(2字节) + 最大负载(4字节)，v1解析端忽略尾部多余字节
+	if (metadata.version >= PROTOCOL_VERSION_2)
+	{
+		data.push_back(metadata.windowSize & 0xFF);
+		data.push_back((metadata.windowSize >> 8) & 0xFF);
+		for (int i = 0; i < 4; i++)
+		{
+			data.push_back((metadata.maxPayloadSize >> (i * 8)) & 0xFF);
+		}
+
+		// 续传扩展：文件前缀哈希(4字节)
+		if (metadata.flags & START_FLAG_RESUME)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				data.push_back((metadata.fileHash >> (i * 8)) & 0xFF);
+			}
+		}
+	}
+
 	return data;
 }
 
@@ -414,6 +722,37 @@ bool FrameCodec::DeserializeStartMetadata(const uint8_t* data, size_t size, Star
 
 	// 会话ID
 	metadata.sessionId = data[offset] | (data[offset + 1] << 8);
+	offset += 2;
+
+	// v2扩展字段（可选）
+	metadata.windowSize = 0;
+	metadata.maxPayloadSize = 0;
+	if (metadata.version >= PROTOCOL_VERSION_2 && offset + 6 <= size)
+	{
+		metadata.windowSize = data[offset] | (data[offset + 1] << 8);
+		offset += 2;
+		for (int i = 0; i < 4; i++)
+		{
+			metadata.maxPayloadSize |= static_cast<uint32_t>(data[offset++]) << (i * 8);
+		}
+	}
+
+	// 续传扩展（可选），缺失时视为发送端不支持续传
+	metadata.fileHash = 0;
+	if (metadata.flags & START_FLAG_RESUME)
+	{
+		if (metadata.version >= PROTOCOL_VERSION_2 && offset + 4 <= size)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				metadata.fileHash |= static_cast<uint32_t>(data[offset++]) << (i * 8);
+			}
+		}
+		else
+		{
+			metadata.flags &= static_cast<uint8_t>(~START_FLAG_RESUME);
+		}
+	}
 
 	return true;
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <vector>
 #include <cstdint>
 #include <string>
+#include <atomic>
+#include "../Transport/ITransport.h"
 
 // 帧类型定义
 enum class FrameType : uint8_t
@@ -11,12 +13,20 @@ enum class FrameType : uint8_t
 	FRAME_START = 0x01,    // 开始帧
 	FRAME_DATA = 0x02,    // 数据帧
 	FRAME_END = 0x03,    // 结束帧
+	FRAME_DATA_COMPRESSED = 0x04, // 压缩数据帧（负载为LzCodec压缩块，解压后按数据帧处理）
+	FRAME_DATA_STREAM = 0x05, // 流式压缩数据帧（负载为原始大小 + 引用前序帧字典的压缩块，按序交付时还原）
+	FRAME_PARITY = 0x06,  // 校验帧（序列号为组内首帧，负载为组内数据帧的异或校验，不进入发送窗口、不确认）
 	FRAME_ACK = 0x10,    // 确认帧
 	FRAME_NAK = 0x11,    // 否定帧
+	FRAME_SACK = 0x12,    // 选择确认帧（累计确认 + 乱序位图）
 	FRAME_HEARTBEAT = 0x20, // 心跳帧
 	FRAME_INVALID = 0xFF    // 无效帧
 };
 
+// 协议版本
+const uint8_t PROTOCOL_VERSION_1 = 1;  // 16位序列号/长度帧头
+const uint8_t PROTOCOL_VERSION_2 = 2;  // 32位序列号/长度帧头，支持大窗口与64KB负载
+
 // 帧头结构
 #pragma pack(push, 1)
 struct FrameHeader
@@ -28,6 +38,16 @@ struct FrameHeader
 	uint32_t crc32;        // CRC32校验值
 };
 
+// v2帧头：以独立魔数区分，解码端可同时接受两种格式
+struct FrameHeaderV2
+{
+	uint16_t magic;         // 魔数 0xAA56
+	uint8_t type;          // 帧类型
+	uint32_t sequence;     // 序列号
+	uint32_t length;       // 数据长度
+	uint32_t crc32;        // CRC32校验值
+};
+
 struct FrameTail
 {
 	uint16_t magic;        // 尾部魔数 0x55AA
@@ -38,14 +58,59 @@ struct FrameTail
 struct Frame
 {
 	FrameType type;
-	uint16_t sequence;
+	uint32_t sequence;
 	std::vector<uint8_t> payload;
 	uint32_t crc32;
+	uint8_t version;           // 帧头格式版本
 	bool valid;
 
-	Frame() : type(FrameType::FRAME_INVALID), sequence(0), crc32(0), valid(false) {}
+	Frame() : type(FrameType::FRAME_INVALID), sequence(0), crc32(0), version(PROTOCOL_VERSION_1), valid(false) {}
+};
+
+// 帧视图（负载直接指向接收缓冲区，不拷贝）
+// 注意：视图仅在下一次 AppendData/TryGetFrame/TryGetFrameView/ClearBuffer 调用前有效
+struct FrameView
+{
+	FrameType type;
+	uint32_t sequence;
+	const uint8_t* payload;    // 负载起始地址
+	size_t payloadSize;        // 负载长度
+	uint32_t crc32;
+	uint8_t version;           // 帧头格式版本
+	bool valid;
+
+	FrameView() : type(FrameType::FRAME_INVALID), sequence(0), payload(nullptr), payloadSize(0), crc32(0), version(PROTOCOL_VERSION_1), valid(false) {}
+};
+
+// START帧标志位
+const uint8_t START_FLAG_SELECTIVE_ACK = 0x01;  // 发送端支持SACK，接收端可用SACK代替逐帧ACK
+const uint8_t START_FLAG_RESUME = 0x02;         // 支持断点续传：START帧附带文件前缀哈希，ACK附带续传偏移（仅v2）
+const uint8_t START_FLAG_COMPRESSION = 0x04;    // 发送端请求压缩数据帧，接收端在ACK中确认后启用（仅v2）
+const uint8_t START_FLAG_STREAM_COMPRESSION = 0x08; // 发送端请求跨帧字典压缩（须同时带START_FLAG_COMPRESSION），接收端在ACK中确认
+
+const uint8_t START_FLAG_FEC = 0x10;            // 发送端请求前向纠错，接收端在ACK中确认后发送端开始附加校验帧（仅v2）
+const uint8_t START_FLAG_MULTIPLEX = 0x20;      // 发送端请求多路复用，接收端在ACK中确认后本会话的数据帧负载均以流头开头（仅v2）
+
+// 流式压缩数据帧负载头：原始负载大小（4字节小端）
+const size_t STREAM_FRAME_HEADER_SIZE = 4;
+
+// 校验帧负载头：组内帧数(1) + 帧类型异或(1) + 负载长度异或(4，小端)，其后为按最长负载补零后的负载异或
+const size_t FEC_PARITY_HEADER_SIZE = 6;
+
+// 多路复用流头：流ID(2，小端) + 记录类型(1)，位于数据帧明文负载开头（压缩、校验均作用于含流头的负载）
+// 流ID 0 为默认流（Send()的数据），其余流由OPEN记录建立、CLOSE记录结束；记录随数据帧按序交付，无需额外往返
+const size_t MUX_HEADER_SIZE = 3;
+
+enum class MuxRecordType : uint8_t
+{
+	MUX_DATA = 0x00,   // 流数据
+	MUX_OPEN = 0x01,   // 打开流：其后为START帧元数据格式的文件信息
+	MUX_CLOSE = 0x02   // 关闭流：其后1字节结果（1成功，0中止）
 };
 
+// 续传时用于识别同一文件的前缀长度（对前缀计算CRC32）
+const size_t RESUME_HASH_PREFIX_SIZE = 64 * 1024;
+
 // START帧元数据
 struct StartMetadata
 {
@@ -55,8 +120,23 @@ struct StartMetadata
 	uint64_t fileSize;        // 文件大小
 	uint64_t modifyTime;      // 修改时间
 	uint16_t sessionId;       // 会话ID
+	uint16_t windowSize;      // 发送端窗口大小（v2扩展字段，0表示未声明）
+	uint32_t maxPayloadSize;  // 发送端最大负载（v2扩展字段，0表示未声明）
+	uint32_t fileHash;        // 文件前缀CRC32（START_FLAG_RESUME时有效）
 
-	StartMetadata() : version(1), flags(0), fileSize(0), modifyTime(0), sessionId(0) {}
+	StartMetadata() : version(1), flags(0), fileSize(0), modifyTime(0), sessionId(0), windowSize(0), maxPayloadSize(0), fileHash(0) {}
+};
+
+// START帧ACK的协商结果（v2接收端附加在ACK负载中，v1接收端回复空ACK）
+struct StartAckInfo
+{
+	uint8_t version;          // 协商后的协议版本
+	uint8_t flags;            // 接收端标志位
+	uint16_t windowSize;      // 接收端窗口大小
+	uint32_t maxPayloadSize;  // 接收端最大负载
+	uint64_t resumeOffset;    // 接收端已落地的字节数，发送端从该偏移继续（START_FLAG_RESUME时有效）
+
+	StartAckInfo() : version(1), flags(0), windowSize(0), maxPayloadSize(0), resumeOffset(0) {}
 };
 
 // 帧编解码器
@@ -64,54 +144,103 @@ class FrameCodec
 {
 public:
 	static const uint16_t HEADER_MAGIC = 0xAA55;
+	static const uint16_t HEADER_MAGIC_V2 = 0xAA56;
 	static const uint16_t TAIL_MAGIC = 0x55AA;
 	static const size_t MAX_PAYLOAD_SIZE = 1024;
+	static const size_t MAX_PAYLOAD_SIZE_V1 = 0xFFFF;     // v1帧头长度字段为16位
+	static const size_t MAX_PAYLOAD_SIZE_V2 = 64 * 1024;  // v2允许的最大负载，超过视为无效帧
 	static const size_t MIN_FRAME_SIZE = sizeof(FrameHeader) + sizeof(FrameTail);
+	static const size_t MAX_FRAME_HEADER_SIZE = sizeof(FrameHeaderV2);
+	static const size_t MAX_FRAME_OVERHEAD = sizeof(FrameHeaderV2) + sizeof(FrameTail);
+	static const size_t COMPACT_THRESHOLD = 64 * 1024;  // 已消费数据超过该值时压缩缓冲区
 
 public:
 	FrameCodec();
 	~FrameCodec();
 
-	// 编码帧
-	std::vector<uint8_t> EncodeFrame(FrameType type, uint16_t sequence, const std::vector<uint8_t>& payload);
-	std::vector<uint8_t> EncodeStartFrame(uint16_t sequence, const StartMetadata& metadata);
-	std::vector<uint8_t> EncodeDataFrame(uint16_t sequence, const std::vector<uint8_t>& data);
-	std::vector<uint8_t> EncodeEndFrame(uint16_t sequence);
-	std::vector<uint8_t> EncodeAckFrame(uint16_t sequence);
-	std::vector<uint8_t> EncodeNakFrame(uint16_t sequence);
-	std::vector<uint8_t> EncodeHeartbeatFrame(uint16_t sequence);
+	// 编码帧（按当前帧格式版本选择帧头，v1格式下序列号截断为16位）
+	std::vector<uint8_t> EncodeFrame(FrameType type, uint32_t sequence, const std::vector<uint8_t>& payload);
+	std::vector<uint8_t> EncodeStartFrame(uint32_t sequence, const StartMetadata& metadata);
+	std::vector<uint8_t> EncodeDataFrame(uint32_t sequence, const std::vector<uint8_t>& data);
+	std::vector<uint8_t> EncodeEndFrame(uint32_t sequence);
+	std::vector<uint8_t> EncodeAckFrame(uint32_t sequence);
+	std::vector<uint8_t> EncodeStartAckFrame(uint32_t sequence, const StartAckInfo& info);
+	std::vector<uint8_t> EncodeNakFrame(uint32_t sequence);
+	std::vector<uint8_t> EncodeHeartbeatFrame(uint32_t sequence);
+	// SACK帧：帧头序列号为接收窗口基（之前的序列均已收到），
+	// 负载为窗口大小(2字节小端) + 位图（bit i 表示 base+i 已收到）
+	std::vector<uint8_t> EncodeSackFrame(uint32_t base, uint16_t windowSize, const std::vector<uint8_t>& bitmap);
+
+	// 无分配编码：
+	// EncodeFrameInPlace 要求负载前至少预留 MAX_FRAME_HEADER_SIZE 字节、其后预留 sizeof(FrameTail) 字节，
+	// 帧头帧尾直接写在负载两侧，frameStart 返回帧起始位置；
+	// EncodeFrameTo 将整帧写入调用方缓冲区（如栈上数组），容量不足时返回0。
+	// 两者均返回帧总长度。
+	size_t EncodeFrameInPlace(FrameType type, uint32_t sequence, uint8_t* payload, size_t payloadSize, uint8_t*& frameStart);
+	size_t EncodeFrameTo(FrameType type, uint32_t sequence, const uint8_t* payload, size_t payloadSize, uint8_t* buffer, size_t capacity);
+	// 分段编码（配合ITransport::WriteV）：帧头写入headerBuffer（至少MAX_FRAME_HEADER_SIZE字节），
+	// 帧尾写入tailBuffer（至少sizeof(FrameTail)字节），负载不拷贝；
+	// segments（至少3个）依次填入帧头、负载（为空时省略）、帧尾，返回段数，frameSize返回帧总长度。
+	size_t EncodeFrameSegments(FrameType type, uint32_t sequence, const uint8_t* payload, size_t payloadSize,
+		uint8_t* headerBuffer, uint8_t* tailBuffer, WriteSegment* segments, size_t& frameSize);
+	size_t EncodeSackFrameTo(uint32_t base, uint16_t windowSize, const uint8_t* bitmap, size_t bitmapSize, uint8_t* buffer, size_t capacity);
 
 	// 解码帧
 	Frame DecodeFrame(const std::vector<uint8_t>& data);
 	bool DecodeStartMetadata(const std::vector<uint8_t>& payload, StartMetadata& metadata);
+	bool DecodeStartMetadata(const uint8_t* data, size_t size, StartMetadata& metadata);
+	std::vector<uint8_t> EncodeStartMetadata(const StartMetadata& metadata); // 仅序列化元数据（多路复用OPEN记录复用该格式）
+	bool DecodeStartAck(const std::vector<uint8_t>& payload, StartAckInfo& info);
+	bool DecodeSackPayload(const std::vector<uint8_t>& payload, uint16_t& windowSize, std::vector<uint8_t>& bitmap);
+
+	Frame DecodeFrame(const uint8_t* data, size_t size);
 
 	// 添加数据到缓冲区并尝试解析帧
 	void AppendData(const std::vector<uint8_t>& data);
+	void AppendData(const uint8_t* data, size_t size);
 	bool TryGetFrame(Frame& frame);
+	bool TryGetFrameView(FrameView& view);
 	void ClearBuffer();
-	size_t GetBufferSize() const { return m_buffer.size(); }
+	size_t GetBufferSize() const { return m_buffer.size() - m_readPos; }
+	uint64_t GetInvalidFrameCount() const { return m_invalidFrames; }
 
 	// 设置最大负载大小
 	void SetMaxPayloadSize(size_t size);
 	size_t GetMaxPayloadSize() const { return m_maxPayloadSize; }
 
-	// CRC32计算
+	// 设置编码使用的帧格式版本（解码始终同时接受v1/v2）
+	void SetFrameVersion(uint8_t version);
+	uint8_t GetFrameVersion() const { return m_frameVersion.load(); }
+
+	// CRC32计算（委托给Crc32引擎，按CPU能力选择实现）
 	static uint32_t CalculateCRC32(const uint8_t* data, size_t length);
 	static bool VerifyCRC32(const uint8_t* data, size_t length, uint32_t crc);
 
 private:
+	// 帧解析结果
+	enum class ParseResult
+	{
+		Complete,    // 解析出完整有效帧
+		Incomplete,  // 数据不足，等待更多数据
+		Invalid      // 帧结构或校验错误
+	};
+
 	// 内部辅助函数
 	bool FindFrameStart(size_t& startPos);
-	bool ExtractFrame(size_t startPos, Frame& frame);
+	static ParseResult ParseFrame(const uint8_t* data, size_t available, FrameView& view, size_t& frameSize);
+	static uint32_t CalculateFrameCRC32(uint8_t version, uint8_t type, uint32_t sequence, uint32_t length, const uint8_t* payload);
+	size_t ClampPayloadSize(uint8_t version, size_t payloadSize) const;
+	static size_t WriteFrameHeader(uint8_t version, FrameType type, uint32_t sequence, const uint8_t* payload, size_t payloadSize, uint8_t* frame);
+	static void WriteFrameTail(uint8_t* tailBuffer);
+	static size_t WriteFrame(uint8_t version, FrameType type, uint32_t sequence, const uint8_t* payload, size_t payloadSize, uint8_t* frame);
+	void CompactBuffer();
 	std::vector<uint8_t> SerializeStartMetadata(const StartMetadata& metadata);
 	bool DeserializeStartMetadata(const uint8_t* data, size_t size, StartMetadata& metadata);
 
 private:
 	std::vector<uint8_t> m_buffer;     // 接收缓冲区
+	size_t m_readPos;                  // 缓冲区读取位置（之前的数据已消费）
+	uint64_t m_invalidFrames;          // 丢弃的无效帧计数
 	size_t m_maxPayloadSize;           // 最大负载大小
-	static uint32_t s_crcTable[256];   // CRC查找表
-	static bool s_crcTableInit;        // CRC表初始化标志
-
-	// 初始化CRC表
-	static void InitCRCTable();
+	std::atomic<uint8_t> m_frameVersion; // 编码帧格式版本
 };
\ No newline at end of file
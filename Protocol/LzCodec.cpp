@@ -0,0 +1,361 @@
+﻿#pragma execution_character_set("utf-8")
+
+#include "pch.h"
+#include "LzCodec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const int HASH_LOG = 12;
+	const size_t MIN_MATCH = 4;
+	const size_t LAST_LITERALS = 5;   // 块末尾至少保留的字面量
+	const size_t MF_LIMIT = 12;       // 最后一个匹配的起点距块末尾的最小距离
+	const size_t MAX_OFFSET = 0xFFFF;
+
+	inline uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HASH_LOG);
+	}
+
+	// 写入长度扩展字节（每字节255，最后一字节为余数）
+	inline uint8_t* WriteLength(uint8_t* op, size_t length)
+	{
+		while (length >= 255)
+		{
+			*op++ = 255;
+			length -= 255;
+		}
+		*op++ = static_cast<uint8_t>(length);
+		return op;
+	}
+
+	// 输出一个序列：字面量 + 可选匹配；matchLength为0表示末尾只有字面量
+	inline uint8_t* WriteSequence(uint8_t* op, uint8_t* opEnd, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+	{
+		// 最坏情况：token + 字面量长度扩展 + 字面量 + 偏移 + 匹配长度扩展
+		size_t worst = 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1;
+		if (static_cast<size_t>(opEnd - op) < worst)
+		{
+			return nullptr;
+		}
+
+		uint8_t* token = op++;
+		*token = static_cast<uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4);
+		if (literalLength >= 15)
+		{
+			op = WriteLength(op, literalLength - 15);
+		}
+		memcpy(op, literals, literalLength);
+		op += literalLength;
+
+		if (matchLength > 0)
+		{
+			*op++ = static_cast<uint8_t>(offset & 0xFF);
+			*op++ = static_cast<uint8_t>((offset >> 8) & 0xFF);
+
+			size_t code = matchLength - MIN_MATCH;
+			*token |= static_cast<uint8_t>(code >= 15 ? 15 : code);
+			if (code >= 15)
+			{
+				op = WriteLength(op, code - 15);
+			}
+		}
+		return op;
+	}
+
+	// 压缩base[start, end)：匹配可引用base中位于当前位置之前、距离不超过MAX_OFFSET的数据（含start之前的字典）
+	// table保存base内的位置，调用方负责在多次调用间保持或清空
+	template <typename Position>
+	size_t CompressBlock(const uint8_t* base, size_t start, size_t end, Position* table, uint8_t* dst, size_t dstCapacity)
+	{
+		uint8_t* op = dst;
+		uint8_t* const opEnd = dst + dstCapacity;
+		const uint8_t* const src = base + start;
+		const uint8_t* const srcEnd = base + end;
+		const uint8_t* anchor = src;
+
+		if (end - start > MF_LIMIT)
+		{
+			const uint8_t* const matchLimit = srcEnd - LAST_LITERALS;
+			const uint8_t* const mfLimit = srcEnd - MF_LIMIT;
+			const uint8_t* ip = (start == 0) ? src + 1 : src;
+
+			while (ip < mfLimit)
+			{
+				uint32_t sequence = Read32(ip);
+				uint32_t h = Hash(sequence);
+				const uint8_t* ref = base + table[h];
+				table[h] = static_cast<Position>(ip - base);
+
+				// 过期或冲突的表项由距离与内容比较排除
+				if (ref >= ip || static_cast<size_t>(ip - ref) > MAX_OFFSET || Read32(ref) != sequence)
+				{
+					// 长时间未命中时加大步长，快速跳过不可压缩数据
+					ip += 1 + ((ip - anchor) >> 6);
+					continue;
+				}
+
+				// 向前扩展匹配
+				while (ip > anchor && ref > base && ip[-1] == ref[-1])
+				{
+					ip--;
+					ref--;
+				}
+
+				size_t matchLength = MIN_MATCH;
+				while (ip + matchLength < matchLimit && ip[matchLength] == ref[matchLength])
+				{
+					matchLength++;
+				}
+
+				op = WriteSequence(op, opEnd, anchor, static_cast<size_t>(ip - anchor), static_cast<size_t>(ip - ref), matchLength);
+				if (!op)
+				{
+					return 0;
+				}
+
+				ip += matchLength;
+				anchor = ip;
+
+				if (ip < mfLimit)
+				{
+					table[Hash(Read32(ip - 2))] = static_cast<Position>(ip - 2 - base);
+				}
+			}
+		}
+
+		op = WriteSequence(op, opEnd, anchor, static_cast<size_t>(srcEnd - anchor), 0, 0);
+		return op ? static_cast<size_t>(op - dst) : 0;
+	}
+
+	// 解压到base[start, capacity)：匹配可引用base[0, start)中的字典
+	size_t DecompressBlock(const uint8_t* src, size_t srcSize, uint8_t* base, size_t start, size_t capacity)
+	{
+		const uint8_t* ip = src;
+		const uint8_t* const ipEnd = src + srcSize;
+		uint8_t* op = base + start;
+		uint8_t* const opEnd = base + capacity;
+
+		while (ip < ipEnd)
+		{
+			uint8_t token = *ip++;
+
+			size_t literalLength = token >> 4;
+			if (literalLength == 15)
+			{
+				uint8_t extra = 0;
+				do
+				{
+					if (ip >= ipEnd)
+					{
+						return LzCodec::DECOMPRESS_ERROR;
+					}
+					extra = *ip++;
+					literalLength += extra;
+				} while (extra == 255);
+			}
+
+			if (literalLength > static_cast<size_t>(ipEnd - ip) || literalLength > static_cast<size_t>(opEnd - op))
+			{
+				return LzCodec::DECOMPRESS_ERROR;
+			}
+			memcpy(op, ip, literalLength);
+			ip += literalLength;
+			op += literalLength;
+
+			// 最后一个序列只有字面量
+			if (ip == ipEnd)
+			{
+				break;
+			}
+
+			if (ipEnd - ip < 2)
+			{
+				return LzCodec::DECOMPRESS_ERROR;
+			}
+			size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+			ip += 2;
+			if (offset == 0 || offset > static_cast<size_t>(op - base))
+			{
+				return LzCodec::DECOMPRESS_ERROR;
+			}
+
+			size_t matchLength = token & 0x0F;
+			if (matchLength == 15)
+			{
+				uint8_t extra = 0;
+				do
+				{
+					if (ip >= ipEnd)
+					{
+						return LzCodec::DECOMPRESS_ERROR;
+					}
+					extra = *ip++;
+					matchLength += extra;
+				} while (extra == 255);
+			}
+			matchLength += MIN_MATCH;
+
+			if (matchLength > static_cast<size_t>(opEnd - op))
+			{
+				return LzCodec::DECOMPRESS_ERROR;
+			}
+
+			// 匹配可能与输出重叠（offset < matchLength），逐字节复制
+			const uint8_t* match = op - offset;
+			if (offset >= matchLength)
+			{
+				memcpy(op, match, matchLength);
+				op += matchLength;
+			}
+			else
+			{
+				for (size_t i = 0; i < matchLength; i++)
+				{
+					*op++ = *match++;
+				}
+			}
+		}
+
+		return static_cast<size_t>(op - (base + start));
+	}
+}
+
+size_t LzCodec::Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+{
+	if (srcSize == 0 || srcSize > MAX_INPUT_SIZE || dstCapacity == 0)
+	{
+		return 0;
+	}
+
+	// 输入不超过64KB，位置可用16位保存
+	uint16_t table[1 << HASH_LOG];
+	memset(table, 0, sizeof(table));
+	return CompressBlock(src, 0, srcSize, table, dst, dstCapacity);
+}
+
+size_t LzCodec::Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+{
+	return DecompressBlock(src, srcSize, dst, 0, dstCapacity);
+}
+
+LzStreamEncoder::LzStreamEncoder()
+	: m_historySize(0)
+{
+}
+
+void LzStreamEncoder::Reset()
+{
+	m_historySize = 0;
+	std::fill(m_table.begin(), m_table.end(), 0);
+}
+
+size_t LzStreamEncoder::Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+{
+	if (srcSize == 0 || srcSize > LzCodec::MAX_INPUT_SIZE)
+	{
+		return 0;
+	}
+
+	size_t start = Append(src, srcSize);
+	if (dstCapacity == 0)
+	{
+		return 0;
+	}
+	return CompressBlock(m_history.data(), start, start + srcSize, m_table.data(), dst, dstCapacity);
+}
+
+size_t LzStreamEncoder::Append(const uint8_t* data, size_t size)
+{
+	if (size > LzCodec::MAX_INPUT_SIZE)
+	{
+		Reset();
+		return 0;
+	}
+
+	// 首次使用时才分配，未启用流式压缩的通道不占用内存
+	if (m_history.empty())
+	{
+		m_history.resize(HISTORY_CAPACITY);
+		m_table.assign(static_cast<size_t>(1) << HASH_LOG, 0);
+	}
+
+	// 空间不足时只保留最近一个窗口的明文，哈希表位置随之平移
+	if (m_historySize + size > m_history.size())
+	{
+		size_t shift = m_historySize - WINDOW_SIZE;
+		memmove(m_history.data(), m_history.data() + shift, WINDOW_SIZE);
+		m_historySize = WINDOW_SIZE;
+		for (uint32_t& position : m_table)
+		{
+			position = (position >= shift) ? static_cast<uint32_t>(position - shift) : 0;
+		}
+	}
+
+	size_t start = m_historySize;
+	memcpy(m_history.data() + start, data, size);
+	m_historySize += size;
+	return start;
+}
+
+LzStreamDecoder::LzStreamDecoder()
+	: m_historySize(0)
+{
+}
+
+void LzStreamDecoder::Reset()
+{
+	m_historySize = 0;
+}
+
+size_t LzStreamDecoder::Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity)
+{
+	size_t capacity = (dstCapacity < LzCodec::MAX_INPUT_SIZE) ? dstCapacity : LzCodec::MAX_INPUT_SIZE;
+	Reserve(capacity);
+
+	size_t size = DecompressBlock(src, srcSize, m_history.data(), m_historySize, m_historySize + capacity);
+	if (size == LzCodec::DECOMPRESS_ERROR)
+	{
+		return LzCodec::DECOMPRESS_ERROR;
+	}
+
+	memcpy(dst, m_history.data() + m_historySize, size);
+	m_historySize += size;
+	return size;
+}
+
+void LzStreamDecoder::Append(const uint8_t* data, size_t size)
+{
+	if (size > LzCodec::MAX_INPUT_SIZE)
+	{
+		Reset();
+		return;
+	}
+
+	Reserve(size);
+	memcpy(m_history.data() + m_historySize, data, size);
+	m_historySize += size;
+}
+
+void LzStreamDecoder::Reserve(size_t size)
+{
+	if (m_history.empty())
+	{
+		m_history.resize(HISTORY_CAPACITY);
+	}
+
+	if (m_historySize + size > m_history.size())
+	{
+		size_t shift = m_historySize - WINDOW_SIZE;
+		memmove(m_history.data(), m_history.data() + shift, WINDOW_SIZE);
+		m_historySize = WINDOW_SIZE;
+	}
+}
@@ -0,0 +1,80 @@
+﻿#pragma once
+#pragma execution_character_set("utf-8")
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// 单帧LZ压缩（LZ4块格式：token + 字面量 + 2字节偏移 + 匹配长度扩展）
+// 每帧独立压缩，不依赖前后帧，丢帧重传不影响解压；输入上限64KB，与v2最大负载一致。
+// 面向打印数据（PCL/PostScript/ESC/P）中大量重复的控制序列与空白光栅行，压缩与解压均为单遍线性扫描。
+// 用法：
+//   size_t packed = LzCodec::Compress(src, srcSize, dst, dstCapacity); // 0表示放不下或不值得压缩
+//   size_t plain = LzCodec::Decompress(dst, packed, out, outCapacity);  // LzCodec::DECOMPRESS_ERROR表示数据损坏
+class LzCodec
+{
+public:
+	static const size_t MAX_INPUT_SIZE = 64 * 1024;
+	static const size_t DECOMPRESS_ERROR = static_cast<size_t>(-1);
+
+public:
+	// 压缩到dst，输出超过dstCapacity时返回0（调用方据此回退为不压缩）
+	static size_t Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+
+	// 解压到dst，越界或格式错误时返回DECOMPRESS_ERROR
+	static size_t Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+};
+
+// 流式字典压缩：编码端与解码端各自保存最近64KB已传输明文，新帧的匹配可引用之前各帧内容，
+// 适合大量小帧且帧间重复度高的流量（单帧压缩因每帧从空字典开始而收益有限）。
+// 双方须按相同顺序处理相同的明文序列：编码端每帧（无论最终是否压缩发送）都计入字典，
+// 解码端按序交付时对流式帧调用Decompress，对其他数据帧调用Append；任一端Reset后另一端也须Reset。
+class LzStreamEncoder
+{
+public:
+	static const size_t WINDOW_SIZE = 64 * 1024;
+	static const size_t HISTORY_CAPACITY = WINDOW_SIZE * 3; // 历史缓冲满时保留最近一个窗口并整体前移（首次使用时分配）
+
+public:
+	LzStreamEncoder();
+
+	void Reset();
+
+	// 将src计入字典并压缩到dst，输出超过dstCapacity时返回0（字典仍已更新）
+	size_t Compress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+
+	// 仅计入字典，返回数据在历史缓冲中的起始位置
+	size_t Append(const uint8_t* data, size_t size);
+
+	bool IsEmpty() const { return m_historySize == 0; }
+
+private:
+	std::vector<uint8_t> m_history;
+	size_t m_historySize;
+	std::vector<uint32_t> m_table;  // 哈希表，保存历史缓冲内的位置
+};
+
+class LzStreamDecoder
+{
+public:
+	static const size_t WINDOW_SIZE = LzStreamEncoder::WINDOW_SIZE;
+	static const size_t HISTORY_CAPACITY = LzStreamEncoder::HISTORY_CAPACITY;
+
+public:
+	LzStreamDecoder();
+
+	void Reset();
+
+	// 解压到dst并计入字典，越界或格式错误时返回LzCodec::DECOMPRESS_ERROR
+	size_t Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstCapacity);
+
+	// 未经流式压缩的明文也须计入字典，与编码端保持一致
+	void Append(const uint8_t* data, size_t size);
+
+private:
+	void Reserve(size_t size);
+
+private:
+	std::vector<uint8_t> m_history;
+	size_t m_historySize;
+};
@@ -0,0 +1,199 @@
+﻿#pragma execution_character_set("utf-8")
+
+#include "pch.h"
+#include "PacketPool.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// 缓冲区按缓存行对齐，避免相邻缓冲区伪共享
+	const size_t BUFFER_ALIGNMENT = 64;
+
+	size_t GetBufferStride(size_t payloadCapacity)
+	{
+		size_t size = PacketBuffer::HEADROOM + payloadCapacity + PacketBuffer::TAILROOM;
+		return (size + BUFFER_ALIGNMENT - 1) / BUFFER_ALIGNMENT * BUFFER_ALIGNMENT;
+	}
+}
+
+PacketBuffer::PacketBuffer()
+	: m_refCount(0), m_pool(nullptr), m_memory(nullptr), m_capacity(0), m_payloadSize(0), m_frame(nullptr), m_frameSize(0)
+{
+}
+
+void PacketBuffer::SetPayloadSize(size_t size)
+{
+	m_payloadSize = (std::min)(size, m_capacity);
+	m_frame = nullptr;
+	m_frameSize = 0;
+}
+
+void PacketBuffer::Assign(const uint8_t* data, size_t size)
+{
+	SetPayloadSize(size);
+	if (m_payloadSize > 0)
+	{
+		memcpy(Payload(), data, m_payloadSize);
+	}
+}
+
+void PacketBuffer::SetFrame(const uint8_t* frame, size_t size)
+{
+	m_frame = frame;
+	m_frameSize = size;
+}
+
+void PacketBuffer::Release()
+{
+	if (m_refCount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+	{
+		return;
+	}
+
+	if (m_pool)
+	{
+		m_pool->Recycle(this);
+	}
+	else
+	{
+		delete this;
+	}
+}
+
+PacketPool::PacketPool()
+	: m_payloadCapacity(0), m_count(0), m_overflows(0)
+{
+}
+
+PacketPool::~PacketPool()
+{
+}
+
+bool PacketPool::Initialize(size_t payloadCapacity, size_t count)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (payloadCapacity == m_payloadCapacity && count == m_count)
+	{
+		return true;
+	}
+
+	if (m_free.size() != m_count)
+	{
+		return false;
+	}
+
+	const size_t stride = GetBufferStride(payloadCapacity);
+
+	m_free.clear();
+	m_buffers.reset();
+	m_slab.reset();
+	m_payloadCapacity = payloadCapacity;
+	m_count = count;
+
+	if (count == 0)
+	{
+		return true;
+	}
+
+	// 多分配一个对齐单位，保证首个缓冲区按缓存行对齐
+	m_slab.reset(new uint8_t[stride * count + BUFFER_ALIGNMENT]);
+	uintptr_t base = reinterpret_cast<uintptr_t>(m_slab.get());
+	uint8_t* aligned = m_slab.get() + ((BUFFER_ALIGNMENT - base % BUFFER_ALIGNMENT) % BUFFER_ALIGNMENT);
+
+	m_buffers.reset(new PacketBuffer[count]);
+	m_free.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		PacketBuffer& buffer = m_buffers[i];
+		buffer.m_pool = this;
+		buffer.m_memory = aligned + i * stride;
+		buffer.m_capacity = payloadCapacity;
+		m_free.push_back(&buffer);
+	}
+
+	return true;
+}
+
+PacketRef PacketPool::Acquire(size_t payloadSize)
+{
+	PacketBuffer* buffer = nullptr;
+
+	if (payloadSize <= m_payloadCapacity)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_free.empty())
+		{
+			buffer = m_free.back();
+			m_free.pop_back();
+		}
+	}
+
+	if (!buffer)
+	{
+		// 池耗尽或超出容量时单独分配，容量至少为池缓冲区容量以便复用调用方的分块逻辑
+		m_overflows++;
+		size_t capacity = (std::max)(payloadSize, m_payloadCapacity);
+		buffer = new PacketBuffer();
+		buffer->m_ownedMemory.reset(new uint8_t[PacketBuffer::HEADROOM + capacity + PacketBuffer::TAILROOM]);
+		buffer->m_memory = buffer->m_ownedMemory.get();
+		buffer->m_capacity = capacity;
+	}
+
+	buffer->m_refCount.store(1, std::memory_order_relaxed);
+	buffer->SetPayloadSize(payloadSize);
+	return PacketRef(buffer);
+}
+
+size_t PacketPool::GetAvailableCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_free.size();
+}
+
+void PacketPool::Recycle(PacketBuffer* buffer)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_free.push_back(buffer);
+}
+
+void PacketQueue::push(PacketRef packet)
+{
+	if (m_count == m_items.size())
+	{
+		// 按顺序搬移到新数组，队首回到0
+		std::vector<PacketRef> items((std::max)(m_items.size() * 2, static_cast<size_t>(16)));
+		for (size_t i = 0; i < m_count; i++)
+		{
+			items[i] = std::move(m_items[(m_head + i) % m_items.size()]);
+		}
+		m_items.swap(items);
+		m_head = 0;
+	}
+
+	m_items[(m_head + m_count) % m_items.size()] = std::move(packet);
+	m_count++;
+}
+
+void PacketQueue::pop()
+{
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	m_items[m_head].reset();
+	m_head = (m_head + 1) % m_items.size();
+	m_count--;
+}
+
+void PacketQueue::clear()
+{
+	for (auto& item : m_items)
+	{
+		item.reset();
+	}
+	m_head = 0;
+	m_count = 0;
+}
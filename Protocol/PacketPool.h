@@ -0,0 +1,158 @@
+﻿#pragma once
+#pragma execution_character_set("utf-8")
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "FrameCodec.h"
+
+class PacketPool;
+
+// 包缓冲区：[帧头预留][负载][帧尾预留]，负载两侧留出空间以便原地编码帧
+// 生命周期由PacketRef引用计数管理，计数归零时归还所属的PacketPool（池外分配的缓冲区直接释放）
+class PacketBuffer
+{
+public:
+	static const size_t HEADROOM = FrameCodec::MAX_FRAME_HEADER_SIZE;
+	static const size_t TAILROOM = sizeof(FrameTail);
+
+public:
+	PacketBuffer();
+
+	PacketBuffer(const PacketBuffer&) = delete;
+	PacketBuffer& operator=(const PacketBuffer&) = delete;
+
+	// 负载
+	uint8_t* Payload() { return m_memory + HEADROOM; }
+	const uint8_t* Payload() const { return m_memory + HEADROOM; }
+	size_t GetPayloadSize() const { return m_payloadSize; }
+	size_t GetCapacity() const { return m_capacity; }
+	void SetPayloadSize(size_t size);
+	void Assign(const uint8_t* data, size_t size);
+
+	// 已编码的整帧（位于同一块内存中，负载修改后失效）
+	void SetFrame(const uint8_t* frame, size_t size);
+	const uint8_t* GetFrame() const { return m_frame; }
+	size_t GetFrameSize() const { return m_frameSize; }
+
+private:
+	friend class PacketPool;
+	friend class PacketRef;
+
+	void AddRef() { m_refCount.fetch_add(1, std::memory_order_relaxed); }
+	void Release();
+
+private:
+	std::atomic<uint32_t> m_refCount;
+	PacketPool* m_pool;                      // 所属缓冲池，池外分配时为空
+	uint8_t* m_memory;
+	size_t m_capacity;                       // 负载容量
+	size_t m_payloadSize;
+	const uint8_t* m_frame;
+	size_t m_frameSize;
+	std::unique_ptr<uint8_t[]> m_ownedMemory; // 池外分配时自有的内存
+};
+
+// 包缓冲区的侵入式引用，复制即增加引用，析构时释放
+class PacketRef
+{
+public:
+	PacketRef() : m_buffer(nullptr) {}
+	PacketRef(const PacketRef& other) : m_buffer(other.m_buffer)
+	{
+		if (m_buffer)
+		{
+			m_buffer->AddRef();
+		}
+	}
+	PacketRef(PacketRef&& other) : m_buffer(other.m_buffer) { other.m_buffer = nullptr; }
+	~PacketRef() { reset(); }
+
+	PacketRef& operator=(PacketRef other)
+	{
+		std::swap(m_buffer, other.m_buffer);
+		return *this;
+	}
+
+	void reset()
+	{
+		if (m_buffer)
+		{
+			m_buffer->Release();
+			m_buffer = nullptr;
+		}
+	}
+
+	PacketBuffer* get() const { return m_buffer; }
+	PacketBuffer* operator->() const { return m_buffer; }
+	PacketBuffer& operator*() const { return *m_buffer; }
+	explicit operator bool() const { return m_buffer != nullptr; }
+
+private:
+	friend class PacketPool;
+	explicit PacketRef(PacketBuffer* buffer) : m_buffer(buffer) {}
+
+	PacketBuffer* m_buffer;
+};
+
+// 定长包缓冲池：一次性分配一整块内存切分为等长缓冲区，收发路径复用，避免逐包分配
+// 池耗尽或请求超出容量时退化为单独分配并计入溢出次数，不会失败。
+// 池析构前所有PacketRef必须已释放。
+class PacketPool
+{
+public:
+	PacketPool();
+	~PacketPool();
+
+	PacketPool(const PacketPool&) = delete;
+	PacketPool& operator=(const PacketPool&) = delete;
+
+	// 按负载容量和缓冲区个数分配；仍有缓冲区未归还时返回false并保持原配置
+	bool Initialize(size_t payloadCapacity, size_t count);
+
+	// 获取负载大小为payloadSize的缓冲区
+	PacketRef Acquire(size_t payloadSize);
+
+	// 状态查询
+	size_t GetPayloadCapacity() const { return m_payloadCapacity; }
+	size_t GetCount() const { return m_count; }
+	size_t GetAvailableCount() const;
+	uint64_t GetOverflowCount() const { return m_overflows.load(); }
+
+private:
+	friend class PacketBuffer;
+	void Recycle(PacketBuffer* buffer);
+
+private:
+	mutable std::mutex m_mutex;
+	std::unique_ptr<uint8_t[]> m_slab;
+	std::unique_ptr<PacketBuffer[]> m_buffers;
+	std::vector<PacketBuffer*> m_free;
+	size_t m_payloadCapacity;
+	size_t m_count;
+	std::atomic<uint64_t> m_overflows; // 池外分配次数
+};
+
+// 包引用队列：环形数组实现，容量按需倍增后保留，稳态下入队出队不分配内存
+// 接口与std::queue一致，调用方负责加锁
+class PacketQueue
+{
+public:
+	PacketQueue() : m_head(0), m_count(0) {}
+
+	bool empty() const { return m_count == 0; }
+	size_t size() const { return m_count; }
+	PacketRef& front() { return m_items[m_head]; }
+
+	void push(PacketRef packet);
+	void pop();
+	void clear();
+
+private:
+	std::vector<PacketRef> m_items;
+	size_t m_head;
+	size_t m_count;
+};
@@ -0,0 +1,373 @@
+﻿#pragma execution_character_set("utf-8")
+
+#include "pch.h"
+#include "ReceiveSink.h"
+#include "Crc32.h"
+#include "FrameCodec.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace
+{
+	const uint32_t CHECKPOINT_MAGIC = 0x53524D50; // "PMRS"
+	const uint8_t CHECKPOINT_VERSION = 1;
+
+	void PutLittleEndian(std::vector<uint8_t>& data, uint64_t value, int bytes)
+	{
+		for (int i = 0; i < bytes; i++)
+		{
+			data.push_back(static_cast<uint8_t>((value >> (i * 8)) & 0xFF));
+		}
+	}
+
+	uint64_t GetLittleEndian(const uint8_t* data, int bytes)
+	{
+		uint64_t value = 0;
+		for (int i = 0; i < bytes; i++)
+		{
+			value |= static_cast<uint64_t>(data[i]) << (i * 8);
+		}
+		return value;
+	}
+
+	bool QueryFileSize(const std::string& filePath, int64_t& size)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA data = {};
+		if (!GetFileAttributesExA(filePath.c_str(), GetFileExInfoStandard, &data))
+		{
+			return false;
+		}
+		size = (static_cast<int64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+		return true;
+	}
+
+	// 截断到指定长度，丢弃检查点之后未确认落地的数据
+	bool TruncateFile(const std::string& filePath, int64_t size)
+	{
+		HANDLE file = CreateFileA(filePath.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		LARGE_INTEGER position = {};
+		position.QuadPart = size;
+		bool ok = SetFilePointerEx(file, position, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+		CloseHandle(file);
+		return ok;
+	}
+}
+
+FileReceiveSink::FileReceiveSink(const std::string& filePath, size_t batchSize, bool enableResume)
+	: m_filePath(filePath), m_batchSize((std::max)(batchSize, static_cast<size_t>(4096))), m_resumeEnabled(enableResume), m_checkpointEnabled(false),
+	m_writePending(false), m_stopRequested(false), m_open(false), m_failed(false), m_bytesWritten(0)
+{
+}
+
+FileReceiveSink::~FileReceiveSink()
+{
+	Close();
+}
+
+bool FileReceiveSink::IsOpen() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_open;
+}
+
+bool FileReceiveSink::Begin(const ReceiveFileInfo& info, int64_t& resumeOffset)
+{
+	resumeOffset = 0;
+
+	// 上一次传输未正常结束时先关闭，新传输覆盖原文件
+	Close();
+
+	m_fileInfo = info;
+	m_checkpointEnabled = m_resumeEnabled && info.resumable;
+	if (m_checkpointEnabled)
+	{
+		resumeOffset = LoadResumeOffset(info);
+	}
+
+	if (resumeOffset > 0 && TruncateFile(m_filePath, resumeOffset))
+	{
+		m_file.open(m_filePath, std::ios::binary | std::ios::in | std::ios::out);
+		if (m_file.is_open())
+		{
+			m_file.seekp(resumeOffset);
+		}
+	}
+	else
+	{
+		resumeOffset = 0;
+		m_file.open(m_filePath, std::ios::binary | std::ios::out | std::ios::trunc);
+	}
+
+	if (!m_file.is_open() || !m_file.good())
+	{
+		m_file.close();
+		m_failed = true;
+		resumeOffset = 0;
+		return false;
+	}
+
+	m_fillBuffer.clear();
+	m_fillBuffer.reserve(m_batchSize);
+	m_writeBuffer.clear();
+	m_writeBuffer.reserve(m_batchSize);
+	m_failed = false;
+	m_bytesWritten = resumeOffset;
+
+	// 新传输立即记录文件标识，之后随每批写盘更新偏移
+	if (m_checkpointEnabled)
+	{
+		SaveCheckpoint(resumeOffset);
+	}
+	else
+	{
+		RemoveCheckpoint();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_writePending = false;
+		m_stopRequested = false;
+		m_open = true;
+	}
+	m_writerThread = std::thread(&FileReceiveSink::WriterThread, this);
+	return true;
+}
+
+bool FileReceiveSink::Write(const uint8_t* data, size_t size)
+{
+	if (m_failed || !IsOpen())
+	{
+		return false;
+	}
+
+	while (size > 0)
+	{
+		size_t length = (std::min)(size, m_batchSize - m_fillBuffer.size());
+		m_fillBuffer.insert(m_fillBuffer.end(), data, data + length);
+		data += length;
+		size -= length;
+
+		if (m_fillBuffer.size() >= m_batchSize && !SubmitBatch(false))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FileReceiveSink::Finish(bool success)
+{
+	if (!IsOpen())
+	{
+		return false;
+	}
+
+	// 不完整的传输同样写出已收到的数据，检查点随之更新，下次可从此处续传
+	bool flushed = SubmitBatch(true);
+	Close();
+
+	bool ok = flushed && !m_failed;
+	if (success && ok)
+	{
+		RemoveCheckpoint();
+	}
+	return ok;
+}
+
+bool FileReceiveSink::SubmitBatch(bool waitForCompletion)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// 写线程仍在写上一批时等待，限制内存占用
+	m_condition.wait(lock, [this] { return !m_writePending || m_failed; });
+	if (m_failed)
+	{
+		return false;
+	}
+
+	if (!m_fillBuffer.empty())
+	{
+		m_fillBuffer.swap(m_writeBuffer);
+		m_writePending = true;
+		m_condition.notify_all();
+	}
+
+	if (waitForCompletion)
+	{
+		m_condition.wait(lock, [this] { return !m_writePending || m_failed; });
+	}
+	return !m_failed;
+}
+
+void FileReceiveSink::WriterThread()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true)
+	{
+		m_condition.wait(lock, [this] { return m_writePending || m_stopRequested; });
+		if (!m_writePending)
+		{
+			break;
+		}
+
+		// 写盘期间不持锁，交付线程可继续填充另一批缓冲
+		lock.unlock();
+		m_file.write(reinterpret_cast<const char*>(m_writeBuffer.data()), static_cast<std::streamsize>(m_writeBuffer.size()));
+		bool ok = m_file.good();
+		if (ok)
+		{
+			m_bytesWritten += static_cast<int64_t>(m_writeBuffer.size());
+
+			// 数据写入文件后再推进检查点，检查点偏移不会超过已落地的数据
+			if (m_checkpointEnabled)
+			{
+				m_file.flush();
+				ok = m_file.good() && SaveCheckpoint(m_bytesWritten.load());
+			}
+		}
+		m_writeBuffer.clear();
+		lock.lock();
+
+		if (!ok)
+		{
+			m_failed = true;
+		}
+		m_writePending = false;
+		m_condition.notify_all();
+	}
+}
+
+void FileReceiveSink::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_open)
+		{
+			return;
+		}
+		m_stopRequested = true;
+		m_open = false;
+	}
+	m_condition.notify_all();
+
+	// 写线程退出前会写完已提交的批次
+	if (m_writerThread.joinable())
+	{
+		m_writerThread.join();
+	}
+
+	m_file.flush();
+	if (!m_file.good())
+	{
+		m_failed = true;
+	}
+	m_file.close();
+
+	// 传输结束后释放批缓冲
+	std::vector<uint8_t>().swap(m_fillBuffer);
+	std::vector<uint8_t>().swap(m_writeBuffer);
+}
+
+int64_t FileReceiveSink::LoadResumeOffset(const ReceiveFileInfo& info) const
+{
+	std::ifstream checkpoint(GetCheckpointPath(), std::ios::binary);
+	if (!checkpoint.is_open())
+	{
+		return 0;
+	}
+
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(checkpoint)), std::istreambuf_iterator<char>());
+	checkpoint.close();
+
+	// 固定字段37字节 + 文件名 + CRC32
+	const size_t fixedSize = 37;
+	if (data.size() < fixedSize + 4)
+	{
+		return 0;
+	}
+
+	size_t bodySize = data.size() - 4;
+	if (Crc32::Calculate(data.data(), bodySize) != static_cast<uint32_t>(GetLittleEndian(data.data() + bodySize, 4)))
+	{
+		return 0;
+	}
+
+	const uint8_t* p = data.data();
+	if (GetLittleEndian(p, 4) != CHECKPOINT_MAGIC || p[4] != CHECKPOINT_VERSION)
+	{
+		return 0;
+	}
+
+	int64_t fileSize = static_cast<int64_t>(GetLittleEndian(p + 5, 8));
+	uint64_t modifyTime = GetLittleEndian(p + 13, 8);
+	uint32_t fileHash = static_cast<uint32_t>(GetLittleEndian(p + 21, 4));
+	int64_t committed = static_cast<int64_t>(GetLittleEndian(p + 27, 8));
+	size_t nameLen = static_cast<size_t>(GetLittleEndian(p + 35, 2));
+	if (fixedSize + nameLen != bodySize)
+	{
+		return 0;
+	}
+	std::string fileName(reinterpret_cast<const char*>(p + fixedSize), nameLen);
+
+	if (fileName != info.fileName || fileSize != info.fileSize || modifyTime != info.modifyTime || fileHash != info.fileHash)
+	{
+		return 0;
+	}
+
+	// 已落地部分不足一个哈希前缀时无法校验内容，重新开始
+	int64_t prefixSize = (std::min)(static_cast<int64_t>(RESUME_HASH_PREFIX_SIZE), fileSize);
+	int64_t diskSize = 0;
+	if (committed < prefixSize || committed > fileSize || !QueryFileSize(m_filePath, diskSize) || diskSize < committed)
+	{
+		return 0;
+	}
+
+	// 校验磁盘上的文件前缀与发送端一致
+	std::ifstream file(m_filePath, std::ios::binary);
+	std::vector<uint8_t> prefix(static_cast<size_t>(prefixSize));
+	if (!file.read(reinterpret_cast<char*>(prefix.data()), static_cast<std::streamsize>(prefix.size())) ||
+		Crc32::Calculate(prefix.data(), prefix.size()) != info.fileHash)
+	{
+		return 0;
+	}
+
+	return committed;
+}
+
+bool FileReceiveSink::SaveCheckpoint(int64_t committed) const
+{
+	std::vector<uint8_t> data;
+	data.reserve(64 + m_fileInfo.fileName.size());
+	PutLittleEndian(data, CHECKPOINT_MAGIC, 4);
+	data.push_back(CHECKPOINT_VERSION);
+	PutLittleEndian(data, static_cast<uint64_t>(m_fileInfo.fileSize), 8);
+	PutLittleEndian(data, m_fileInfo.modifyTime, 8);
+	PutLittleEndian(data, m_fileInfo.fileHash, 4);
+	PutLittleEndian(data, m_fileInfo.sessionId, 2);
+	PutLittleEndian(data, static_cast<uint64_t>(committed), 8);
+	PutLittleEndian(data, m_fileInfo.fileName.size() & 0xFFFF, 2);
+	data.insert(data.end(), m_fileInfo.fileName.begin(), m_fileInfo.fileName.begin() + (m_fileInfo.fileName.size() & 0xFFFF));
+	PutLittleEndian(data, Crc32::Calculate(data.data(), data.size()), 4);
+
+	// 检查点写入中途掉电时CRC校验失败，下次传输从头开始
+	std::ofstream checkpoint(GetCheckpointPath(), std::ios::binary | std::ios::trunc);
+	if (!checkpoint.is_open())
+	{
+		return false;
+	}
+	checkpoint.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	checkpoint.flush();
+	return checkpoint.good();
+}
+
+void FileReceiveSink::RemoveCheckpoint() const
+{
+	DeleteFileA(GetCheckpointPath().c_str());
+}
@@ -0,0 +1,101 @@
+﻿#pragma once
+#pragma execution_character_set("utf-8")
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// 接收文件信息（来自START帧）
+struct ReceiveFileInfo
+{
+	std::string fileName;
+	int64_t fileSize;         // 未知时为0
+	uint64_t modifyTime;
+	uint32_t fileHash;        // 文件前缀CRC32
+	uint16_t sessionId;
+	bool resumable;           // 发送端支持断点续传
+
+	ReceiveFileInfo() : fileSize(0), modifyTime(0), fileHash(0), sessionId(0), resumable(false) {}
+};
+
+// 接收数据落地接口：文件传输期间按序交付的负载依次写入，代替在内存中缓存整个文件
+// 调用顺序：Begin() → Write()* → Finish()，均在通道的交付线程（或反应器线程）中执行
+class IReceiveSink
+{
+public:
+	virtual ~IReceiveSink() = default;
+
+	// 新文件开始（收到START帧）；返回false时本次传输回退到内存缓冲
+	// info.resumable时可通过resumeOffset返回已落地的字节数，发送端从该偏移继续，Write()只收到其后的数据
+	virtual bool Begin(const ReceiveFileInfo& info, int64_t& resumeOffset) = 0;
+	// 写入按序到达的负载；返回false表示写入失败，通道报告错误并停止写入
+	virtual bool Write(const uint8_t* data, size_t size) = 0;
+	// 传输结束，success为false表示数据不完整或传输中止
+	virtual bool Finish(bool success) = 0;
+};
+
+// 文件落地：写入固定路径（忽略对端声明的文件名）
+// 后写批处理：负载先拷入批缓冲，攒满一批后交给写线程写盘，交付线程只在上一批尚未写完时等待。
+// 内存占用上限为两个批缓冲（2 * batchSize），与文件大小无关。
+// 断点续传：每批写盘后更新检查点文件（<filePath>.resume），记录已落地偏移、会话ID与文件标识；
+// 下次传输同一文件（文件名、大小、修改时间、前缀哈希一致）时从该偏移继续，传输成功后删除检查点。
+class FileReceiveSink : public IReceiveSink
+{
+public:
+	static const size_t DEFAULT_BATCH_SIZE = 1024 * 1024;
+
+public:
+	explicit FileReceiveSink(const std::string& filePath, size_t batchSize = DEFAULT_BATCH_SIZE, bool enableResume = true);
+	~FileReceiveSink() override;
+
+	FileReceiveSink(const FileReceiveSink&) = delete;
+	FileReceiveSink& operator=(const FileReceiveSink&) = delete;
+
+	bool Begin(const ReceiveFileInfo& info, int64_t& resumeOffset) override;
+	bool Write(const uint8_t* data, size_t size) override;
+	bool Finish(bool success) override;
+
+	// 状态查询
+	const std::string& GetFilePath() const { return m_filePath; }
+	std::string GetCheckpointPath() const { return m_filePath + ".resume"; }
+	int64_t GetBytesWritten() const { return m_bytesWritten.load(); }
+	bool IsOpen() const;
+	bool HasFailed() const { return m_failed.load(); }
+
+private:
+	void WriterThread();
+	bool SubmitBatch(bool waitForCompletion); // 将当前批缓冲交给写线程
+	void Close();
+
+	// 检查点
+	int64_t LoadResumeOffset(const ReceiveFileInfo& info) const; // 检查点与本次文件一致且已落地数据校验通过时返回续传偏移
+	bool SaveCheckpoint(int64_t committed) const;
+	void RemoveCheckpoint() const;
+
+private:
+	std::string m_filePath;
+	size_t m_batchSize;
+	bool m_resumeEnabled;
+	ReceiveFileInfo m_fileInfo;            // 本次传输的文件标识（Begin()后只读）
+	bool m_checkpointEnabled;              // 本次传输是否维护检查点
+	std::ofstream m_file;                  // 仅写线程在运行期间访问
+
+	std::vector<uint8_t> m_fillBuffer;     // 交付线程填充的批缓冲
+	std::vector<uint8_t> m_writeBuffer;    // 写线程正在写盘的批缓冲
+
+	std::thread m_writerThread;
+	mutable std::mutex m_mutex;            // 保护批缓冲交接与写线程状态
+	std::condition_variable m_condition;
+	bool m_writePending;                   // m_writeBuffer中有待写数据
+	bool m_stopRequested;
+	bool m_open;
+
+	std::atomic<bool> m_failed;
+	std::atomic<int64_t> m_bytesWritten;   // 已写入文件的字节数
+};
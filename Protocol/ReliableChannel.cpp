@@ -1,6 +1,10 @@
 ﻿#include "pch.h"
 #include "ReliableChannel.h"
+#include "ChannelReactor.h"
+#include "Crc32.h"
+#include "LzCodec.h"
 #include "../Common/CommonTypes.h"
+#include "../Common/Logger.h"
 #include <algorithm>
 #include <fstream>
 #include <sstream>
@@ -9,13 +13,36 @@
 #include <chrono>
 #include <array>
 
-void ReliableChannel::WriteVerbose(const std::string& message)
+// 详细日志：先判断开关，开启时只按值捕获参数入队，由Logger写入线程按"{}"占位符格式化
+#define VERBOSE_LOG(...) \
+	do \
+	{ \
+		if (m_verboseLoggingEnabled) \
+		{ \
+			PM_LOG(LogModule::Channel, LogLevel::LOG_LEVEL_DEBUG, __VA_ARGS__); \
+		} \
+	} while (0)
+
+namespace
 {
-	if (!m_verboseLoggingEnabled)
+	// dst ^= src，按8字节分组处理
+	void XorInto(uint8_t* dst, const uint8_t* src, size_t size)
 	{
-		return;
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+		{
+			uint64_t a;
+			uint64_t b;
+			memcpy(&a, dst + i, sizeof(a));
+			memcpy(&b, src + i, sizeof(b));
+			a ^= b;
+			memcpy(dst + i, &a, sizeof(a));
+		}
+		for (; i < size; i++)
+		{
+			dst[i] ^= src[i];
+		}
 	}
-	WriteLog(message);
 }
 
 void ReliableChannel::SetVerboseLoggingEnabled(bool enabled)
@@ -70,14 +97,16 @@ void ReliableChannel::WriteLog(const std::string& message)
 {
 	if (!m_verboseLoggingEnabled)
 	{
-		static const std::array<std::string, 14> noisyPrefixes = {
+		static const std::array<std::string, 16> noisyPrefixes = {
 			"ProcessThread",
 			"SendThread",
 			"ReceiveThread",
-			"HeartbeatThread",
+			"TimerThread",
 			"ProcessIncomingFrame",
 			"ProcessDataFrame",
 			"ProcessAckFrame",
+			"ProcessSackFrame",
+			"AcknowledgePacketLocked",
 			"ProcessNakFrame",
 			"ProcessStartFrame",
 			"ProcessEndFrame",
@@ -106,25 +135,13 @@ void ReliableChannel::WriteLog(const std::string& message)
 		}
 	}
 
-	try
-	{
-		// 打开日志文件（追加模式）
-		std::ofstream logFile("PortMaster_debug.log", std::ios::app);
-		if (logFile.is_open())
-		{
-			logFile << message << std::endl;
-			logFile.close();
-		}
-	}
-	catch (...)
-	{
-		// 忽略日志写入错误
-	}
+	// 异步写入日志文件（Logger写入线程批量落盘），调用线程不做文件I/O
+	Logger::Log(message);
 }
 
 // 构造函数
 ReliableChannel::ReliableChannel()
-	: m_initialized(false), m_connected(false), m_shutdown(false), m_retransmitting(false), m_sendBase(0), m_sendNext(0), m_receiveBase(0), m_receiveNext(0), m_heartbeatSequence(0), m_currentFileName(), m_currentFileSize(0), m_currentFileProgress(0), m_fileTransferActive(false), m_transferStartTime(std::chrono::steady_clock::now()), m_sendBytesAcked(0), m_sendTotalBytes(0), m_handshakeCompleted(false), m_handshakeSequence(0), m_sessionId(0), m_rttMs(100), m_timeoutMs(500), m_frameCodec(std::make_unique<FrameCodec>())
+	: m_initialized(false), m_connected(false), m_shutdown(false), m_retransmitting(false), m_sendBase(0), m_sendNext(0), m_receiveBase(0), m_receiveNext(0), m_heartbeatSequence(0), m_sequenceMask(0xFFFF), m_currentFileName(), m_currentFileSize(0), m_currentFileProgress(0), m_fileTransferActive(false), m_transferStartTime(std::chrono::steady_clock::now()), m_sendBytesAcked(0), m_sendTotalBytes(0), m_handshakeCompleted(false), m_handshakeSequence(0), m_sessionId(0), m_rttMs(100), m_timeoutMs(500), m_peerSelectiveAck(false), m_compressionActive(false), m_streamCompressionActive(false), m_fecActive(false), m_multiplexActive(false), m_protocolVersion(PROTOCOL_VERSION_1), m_peerMaxPayloadSize(0), m_resumeOffset(0), m_frameCodec(std::make_unique<FrameCodec>())
 {
 	m_lastActivity = std::chrono::steady_clock::now();
 	WriteLog("ReliableChannel constructor called");
@@ -156,10 +173,10 @@ bool ReliableChannel::Initialize(std::shared_ptr<ITransport> transport, const Re
 		return false;
 	}
 
-	if (config.windowSize > 256)
+	if (config.windowSize > MAX_WINDOW_SIZE)
 	{
-		WriteLog("ReliableChannel::Initialize failed: windowSize > 256 (" + std::to_string(config.windowSize) + ")");
-		ReportError("窗口大小不能超过256");
+		WriteLog("ReliableChannel::Initialize failed: windowSize > " + std::to_string(MAX_WINDOW_SIZE) + " (" + std::to_string(config.windowSize) + ")");
+		ReportError("窗口大小不能超过" + std::to_string(MAX_WINDOW_SIZE));
 		return false;
 	}
 
@@ -191,6 +208,19 @@ bool ReliableChannel::Initialize(std::shared_ptr<ITransport> transport, const Re
 	m_sendWindow.resize(config.windowSize);
 	m_receiveWindow.resize(config.windowSize);
 
+	// 包缓冲池：覆盖发送队列（10个窗口）、发送窗口与接收窗口，总量受内存上限约束，超出部分按需单独分配
+	size_t poolCount = static_cast<size_t>(config.windowSize) * 12 + 8;
+	if (config.enableFec)
+	{
+		poolCount += FEC_RECEIVE_CACHE_SIZE;
+	}
+	size_t poolLimit = PACKET_POOL_MEMORY_LIMIT / (config.maxPayloadSize + FrameCodec::MAX_FRAME_OVERHEAD);
+	poolCount = (std::min)(poolCount, (std::max)(poolLimit, static_cast<size_t>(config.windowSize) * 2));
+	if (!m_packetPool.Initialize(config.maxPayloadSize, poolCount))
+	{
+		WriteLog("ReliableChannel::Initialize: packet pool busy, keeping previous pool configuration");
+	}
+
 	// 重置序列号
 	m_sendBase = 0;
 	m_sendNext = 0;
@@ -198,6 +228,12 @@ bool ReliableChannel::Initialize(std::shared_ptr<ITransport> transport, const Re
 	m_receiveNext = 0;
 	m_heartbeatSequence = 0;  // 重置心跳序列号
 
+	// 未协商前按v1帧格式收发，等待握手确定版本
+	m_peerWindowSize = 0;
+	m_peerMaxPayloadSize = 0;
+	ApplyProtocolVersionLocked(PROTOCOL_VERSION_1);
+	ResetCongestionWindowLocked();
+
 	// 重置统计
 	ResetStats();
 
@@ -216,10 +252,29 @@ void ReliableChannel::Shutdown()
 
 	m_shutdown = true;
 
+	// 反应器模式：从反应器注销，返回后反应器不再访问本通道；私有反应器同时停止其线程
+	if (m_reactor)
+	{
+		m_reactor->Detach(this);
+		if (m_ownsReactor)
+		{
+			m_reactor->Stop();
+		}
+		if (m_transport)
+		{
+			m_transport->SetWritableCallback(nullptr);
+		}
+	}
+
 	// 通知所有等待的线程
 	m_sendCondition.notify_all();
 	m_receiveCondition.notify_all();
 	m_windowCondition.notify_all();
+	{
+		std::lock_guard<std::mutex> lock(m_windowMutex);
+	}
+	m_deliveryCondition.notify_all();
+	m_timerQueue.Stop();
 
 	// 停止所有线程
 	if (m_processThread.joinable())
@@ -234,10 +289,12 @@ void ReliableChannel::Shutdown()
 	{
 		m_receiveThread.join();
 	}
-	if (m_heartbeatThread.joinable())
+	if (m_timerThread.joinable())
 	{
-		m_heartbeatThread.join();
+		m_timerThread.join();
 	}
+	m_timerQueue.Clear();
+	FinishReceiveSink(false);
 
 	// 清理队列
 	{
@@ -246,6 +303,8 @@ void ReliableChannel::Shutdown()
 		{
 			m_sendQueue.pop();
 		}
+		m_muxSendStreams.clear();
+		m_muxUnsequencedStreamEnds = 0;
 	}
 
 	{
@@ -269,6 +328,7 @@ void ReliableChannel::Shutdown()
 			slot.inUse = false;
 			slot.packet.reset();
 		}
+		AbortReceiveStreamsLocked();
 	}
 	m_windowCondition.notify_all();
 
@@ -276,6 +336,20 @@ void ReliableChannel::Shutdown()
 	m_initialized = false;
 }
 
+// 设置反应器
+bool ReliableChannel::SetReactor(std::shared_ptr<ChannelReactor> reactor)
+{
+	if (m_connected)
+	{
+		WriteLog("SetReactor: channel already connected, reactor unchanged");
+		return false;
+	}
+
+	m_reactor = reactor;
+	m_ownsReactor = false;
+	return true;
+}
+
 // 连接
 bool ReliableChannel::Connect()
 {
@@ -289,14 +363,46 @@ bool ReliableChannel::Connect()
 		return true;
 	}
 
-	// 启动线程
 	m_shutdown = false;
-	m_processThread = std::thread(&ReliableChannel::ProcessThread, this);
-	m_sendThread = std::thread(&ReliableChannel::SendThread, this);
-	m_receiveThread = std::thread(&ReliableChannel::ReceiveThread, this);
-	m_heartbeatThread = std::thread(&ReliableChannel::HeartbeatThread, this);
 
-	m_connected = true;
+	// 心跳由定时器驱动，首次在一个心跳间隔后触发
+	m_timerQueue.Reset();
+	m_timerQueue.ScheduleAfter(m_config.heartbeatInterval, [this] { OnHeartbeatTimer(); });
+
+	if (m_config.enableReactor || m_reactor)
+	{
+		// 反应器模式：不创建工作线程，交由反应器线程轮询驱动
+		if (!m_reactor)
+		{
+			m_reactor = std::make_shared<ChannelReactor>();
+			m_ownsReactor = true;
+		}
+		m_reactorSendPacket.reset();
+		m_reactorSendPacketEndsStream = false;
+		m_reactor->Start();
+
+		// 传输层写队列回落到低水位时唤醒反应器继续发送
+		std::weak_ptr<ChannelReactor> reactor = m_reactor;
+		m_transport->SetWritableCallback([reactor]() {
+			if (auto owner = reactor.lock())
+			{
+				owner->Wake();
+			}
+		});
+
+		m_connected = true;
+		m_reactor->Attach(this);
+	}
+	else
+	{
+		// 启动线程
+		m_processThread = std::thread(&ReliableChannel::ProcessThread, this);
+		m_sendThread = std::thread(&ReliableChannel::SendThread, this);
+		m_receiveThread = std::thread(&ReliableChannel::ReceiveThread, this);
+		m_timerThread = std::thread(&ReliableChannel::TimerThread, this);
+
+		m_connected = true;
+	}
 	UpdateState(true);
 
 	return true;
@@ -313,10 +419,30 @@ bool ReliableChannel::Disconnect()
 	m_connected = false;
 	UpdateState(false);
 
+	if (m_reactor)
+	{
+		m_reactor->Detach(this);
+		if (m_ownsReactor)
+		{
+			m_reactor->Stop();
+		}
+		if (m_transport)
+		{
+			m_transport->SetWritableCallback(nullptr);
+		}
+	}
+
 	// 通知所有等待的线程
 	m_sendCondition.notify_all();
 	m_receiveCondition.notify_all();
 	m_windowCondition.notify_all();
+	{
+		std::lock_guard<std::mutex> lock(m_windowMutex);
+	}
+	m_deliveryCondition.notify_all();
+
+	// 连接断开时传输无法继续，已收到的数据写出后结束落地
+	FinishReceiveSink(false);
 
 	return true;
 }
@@ -342,47 +468,74 @@ bool ReliableChannel::Send(const std::vector<uint8_t>& data)
 		return false;
 	}
 
-	std::unique_lock<std::mutex> lock(m_sendMutex);
-
-	// 【修复】队列满时阻塞等待，而不是拒绝数据
+	// 入队时即按有效负载分块并拷入包缓冲区，发送路径此后不再拷贝；多路复用会话中作为默认流（流0）的数据
+	const bool multiplex = m_multiplexActive.load();
+	const size_t chunkSize = GetEffectivePayloadSize();
 	size_t maxQueueSize = m_config.windowSize * 10;
-	while (m_sendQueue.size() >= maxQueueSize)
+	size_t offset = 0;
+
+	do
 	{
-		// 检查通道状态
-		if (m_shutdown || !IsConnected())
+		size_t length = (std::min)(chunkSize, data.size() - offset);
+		PacketRef packet;
+		if (multiplex)
 		{
-			WriteLog("Send: 通道已关闭，无法发送数据");
-			return false;
+			packet = AcquireMuxPacket(0, MuxRecordType::MUX_DATA, length);
+			memcpy(packet->Payload() + MUX_HEADER_SIZE, data.data() + offset, length);
 		}
+		else
+		{
+			packet = m_packetPool.Acquire(length);
+			packet->Assign(data.data() + offset, length);
+		}
+		offset += length;
 
-		// 等待队列空间（超时1秒）
-		WriteLog("Send: 队列已满(size=" + std::to_string(m_sendQueue.size()) +
-			", max=" + std::to_string(maxQueueSize) + ")，等待空间...");
-
-		auto status = m_sendCondition.wait_for(
-			lock,
-			std::chrono::milliseconds(1000),
-			[this, maxQueueSize] {
-				return m_sendQueue.size() < maxQueueSize ||
-					m_shutdown ||
-					!IsConnected();
-			});
+		std::unique_lock<std::mutex> lock(m_sendMutex);
 
-		if (!status)
+		// 【修复】队列满时阻塞等待，而不是拒绝数据
+		while (m_sendQueue.size() >= maxQueueSize)
 		{
-			// 超时，继续等待（除非通道关闭）
+			// 检查通道状态
 			if (m_shutdown || !IsConnected())
 			{
-				WriteLog("Send: 等待期间通道关闭");
+				WriteLog("Send: 通道已关闭，无法发送数据");
 				return false;
 			}
-			WriteLog("Send: 等待超时，继续等待...");
+
+			// 等待队列空间（超时1秒）
+			WriteLog("Send: 队列已满(size=" + std::to_string(m_sendQueue.size()) +
+				", max=" + std::to_string(maxQueueSize) + ")，等待空间...");
+
+			auto status = m_sendCondition.wait_for(
+				lock,
+				std::chrono::milliseconds(1000),
+				[this, maxQueueSize] {
+					return m_sendQueue.size() < maxQueueSize ||
+						m_shutdown ||
+						!IsConnected();
+				});
+
+			if (!status)
+			{
+				// 超时，继续等待（除非通道关闭）
+				if (m_shutdown || !IsConnected())
+				{
+					WriteLog("Send: 等待期间通道关闭");
+					return false;
+				}
+				WriteLog("Send: 等待超时，继续等待...");
+			}
 		}
-	}
 
-	// 队列有空间，添加数据
-	m_sendQueue.push(data);
-	m_sendCondition.notify_one();
+		// 队列有空间，添加数据
+		m_sendQueue.push(std::move(packet));
+		m_sendCondition.notify_one();
+	} while (offset < data.size());
+
+	if (m_reactor)
+	{
+		m_reactor->Wake();
+	}
 
 	// WriteLog("Send: data queued successfully, queue size=" + std::to_string(m_sendQueue.size()));
 	return true;
@@ -402,6 +555,37 @@ bool ReliableChannel::Send(const void* data, size_t size)
 
 // 接收数据
 bool ReliableChannel::Receive(std::vector<uint8_t>& data, uint32_t timeout)
+{
+	PacketRef packet;
+	if (!PopReceived(packet, timeout))
+	{
+		return false;
+	}
+
+	data.assign(packet->Payload(), packet->Payload() + packet->GetPayloadSize());
+	return true;
+}
+
+size_t ReliableChannel::Receive(void* buffer, size_t size, uint32_t timeout)
+{
+	if (!buffer || size == 0)
+	{
+		return 0;
+	}
+
+	PacketRef packet;
+	if (!PopReceived(packet, timeout))
+	{
+		return 0;
+	}
+
+	size_t copySize = (std::min)(size, packet->GetPayloadSize());
+	std::memcpy(buffer, packet->Payload(), copySize);
+	return copySize;
+}
+
+// 从接收队列取出一个包，timeout为0时一直等待
+bool ReliableChannel::PopReceived(PacketRef& packet, uint32_t timeout)
 {
 	if (!IsConnected())
 	{
@@ -435,7 +619,7 @@ bool ReliableChannel::Receive(std::vector<uint8_t>& data, uint32_t timeout)
 
 	if (!m_receiveQueue.empty())
 	{
-		data = m_receiveQueue.front();
+		packet = std::move(m_receiveQueue.front());
 		m_receiveQueue.pop();
 		return true;
 	}
@@ -443,26 +627,8 @@ bool ReliableChannel::Receive(std::vector<uint8_t>& data, uint32_t timeout)
 	return false;
 }
 
-size_t ReliableChannel::Receive(void* buffer, size_t size, uint32_t timeout)
-{
-	if (!buffer || size == 0)
-	{
-		return 0;
-	}
-
-	std::vector<uint8_t> data;
-	if (!Receive(data, timeout))
-	{
-		return 0;
-	}
-
-	size_t copySize = (std::min)(size, data.size());
-	std::memcpy(buffer, data.data(), copySize);
-	return copySize;
-}
-
 // 发送文件
-bool ReliableChannel::SendFile(const std::string& filePath, std::function<void(int64_t, int64_t)> progressCallback)
+bool ReliableChannel::SendFile(const std::string& filePath, std::function<void(int64_t, int64_t)> progressCallback, const std::string& remoteName)
 {
 	if (!IsConnected())
 	{
@@ -479,22 +645,34 @@ bool ReliableChannel::SendFile(const std::string& filePath, std::function<void(i
 	}
 	WriteLog("SendFile: session confirmed, ready for file transmission");
 
-	std::ifstream file(filePath, std::ios::binary);
-	if (!file.is_open())
+	FileSource file;
+	if (!file.Open(filePath))
 	{
 		ReportError("无法打开文件: " + filePath);
 		return false;
 	}
 
 	// 获取文件信息
-	file.seekg(0, std::ios::end);
-	int64_t fileSize = file.tellg();
-	file.seekg(0, std::ios::beg);
+	int64_t fileSize = file.GetSize();
+	VERBOSE_LOG("SendFile: file source {}, size={}", file.IsMapped() ? "memory-mapped" : "streaming", fileSize);
+
+	// 断点续传标识：文件前缀哈希，接收端据此确认磁盘上的部分文件与本文件一致
+	uint32_t fileHash = 0;
+	if (m_config.enableResume)
+	{
+		std::vector<uint8_t> prefix(static_cast<size_t>((std::min)(fileSize, static_cast<int64_t>(RESUME_HASH_PREFIX_SIZE))));
+		if ((!prefix.empty() && file.Read(prefix.data(), prefix.size()) != prefix.size()) || !file.Seek(0))
+		{
+			ReportError("读取文件失败: " + filePath);
+			return false;
+		}
+		fileHash = Crc32::Calculate(prefix.data(), prefix.size());
+	}
 
 	// 设置文件传输状态
 	{
 		std::lock_guard<std::mutex> lock(m_receiveMutex);
-		m_currentFileName = filePath;
+		m_currentFileName = remoteName.empty() ? filePath : remoteName;
 		m_currentFileSize = fileSize;
 		m_currentFileProgress = 0;
 		m_fileTransferActive = true;
@@ -505,15 +683,12 @@ bool ReliableChannel::SendFile(const std::string& filePath, std::function<void(i
 		m_sendTotalBytes = fileSize;
 	}
 
-	// 发送开始帧（包含文件元数据）
-	auto modifyTime = std::chrono::duration_cast<std::chrono::seconds>(
-		std::chrono::system_clock::now().time_since_epoch())
-		.count();
+	// 发送开始帧（包含文件元数据，修改时间取文件实际值以便续传时识别同一文件）
+	uint64_t modifyTime = file.GetModifyTime();
 
 	WriteLog("SendFile: sending START frame with file metadata");
-	if (!SendStart(filePath, fileSize, modifyTime))
+	if (!SendStart(remoteName.empty() ? filePath : remoteName, fileSize, modifyTime, fileHash))
 	{
-		file.close();
 		m_fileTransferActive = false;
 		WriteLog("SendFile: ERROR - SendStart failed");
 		return false;
@@ -531,7 +706,6 @@ bool ReliableChannel::SendFile(const std::string& filePath, std::function<void(i
 	{
 		WriteLog("SendFile: ERROR - file START ACK timeout after " + std::to_string(fileStartTimeoutMs) + "ms");
 		ReportError("文件START帧ACK超时，接收端未响应");
-		file.close();
 		m_fileTransferActive = false;
 		return false;
 	}
@@ -539,44 +713,73 @@ bool ReliableChannel::SendFile(const std::string& filePath, std::function<void(i
 	if (!m_connected)
 	{
 		WriteLog("SendFile: ERROR - connection lost during file START handshake");
-		file.close();
 		m_fileTransferActive = false;
 		return false;
 	}
 
 	WriteLog("SendFile: file START frame acknowledged, starting data transmission");
 
-	// 发送文件数据
-	std::vector<uint8_t> buffer(m_config.maxPayloadSize);
-	int64_t bytesSent = 0;
+	// 发送文件数据（分块大小取握手协商后的有效负载）：预读线程提前把后续分块读入包缓冲区，
+	// 发送窗口满时继续预读，本线程只等待链路，分块原地编码后即进入发送窗口
+	const size_t chunkSize = GetEffectivePayloadSize();
 
-	while (!file.eof() && m_connected)
+	// 断点续传：接收端已落地的部分不再发送
+	int64_t resumeOffset = static_cast<int64_t>(m_resumeOffset.load());
+	if (resumeOffset > 0)
 	{
-		file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
-		size_t bytesRead = static_cast<size_t>(file.gcount());
+		if (resumeOffset > fileSize || !file.Seek(resumeOffset))
+		{
+			ReportError("续传偏移无效: " + std::to_string(resumeOffset));
+			m_fileTransferActive = false;
+			return false;
+		}
 
-		if (bytesRead > 0)
+		WriteLog("SendFile: resuming at offset " + std::to_string(resumeOffset) + "/" + std::to_string(fileSize));
+		m_sendBytesAcked = resumeOffset;
 		{
-			buffer.resize(bytesRead);
-			if (!SendPacket(AllocateSequence(), buffer))
-			{
-				ReportError("发送文件数据失败");
-				file.close();
-				m_fileTransferActive = false;
-				return false;
-			}
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			m_stats.resumedBytes += static_cast<uint64_t>(resumeOffset);
+		}
+		UpdateProgress(resumeOffset, fileSize);
+	}
 
-			bytesSent += bytesRead;
-			UpdateProgress(bytesSent, fileSize);
+	FileReadAhead readAhead(file, m_packetPool, chunkSize, (std::max)(static_cast<size_t>(m_config.windowSize), FILE_READ_AHEAD_MIN_CHUNKS));
+	readAhead.Start();
 
-			if (progressCallback)
-			{
-				progressCallback(bytesSent, fileSize);
-			}
+	int64_t bytesSent = resumeOffset;
+	PacketRef packet;
+
+	while (m_connected && readAhead.Next(packet))
+	{
+		size_t bytesRead = packet->GetPayloadSize();
+		if (!SendPacket(AllocateSequence(), std::move(packet)))
+		{
+			ReportError("发送文件数据失败");
+			readAhead.Stop();
+			RecordFileReadStalls(readAhead.GetStallCount());
+			m_fileTransferActive = false;
+			return false;
+		}
+
+		bytesSent += bytesRead;
+		UpdateProgress(bytesSent, fileSize);
+
+		if (progressCallback)
+		{
+			progressCallback(bytesSent, fileSize);
 		}
 	}
 
-	file.close();
+	readAhead.Stop();
+	RecordFileReadStalls(readAhead.GetStallCount());
+	file.Close();
+
+	if (readAhead.HasFailed())
+	{
+		ReportError("读取文件失败: " + filePath);
+		m_fileTransferActive = false;
+		return false;
+	}
 
 	// 发送结束帧
 	if (m_connected && !SendEnd())
@@ -598,6 +801,24 @@ bool ReliableChannel::ReceiveFile(const std::string& filePath, std::function<voi
 		return false;
 	}
 
+	// 提前验证路径可写（不截断，保留可续传的部分文件），数据在START帧到达后由落地sink写入
+	{
+		std::ofstream file(filePath, std::ios::binary | std::ios::app);
+		if (!file.is_open())
+		{
+			ReportError("无法创建文件: " + filePath);
+			return false;
+		}
+	}
+
+	auto sink = std::make_shared<FileReceiveSink>(filePath);
+	std::shared_ptr<IReceiveSink> previousSink;
+	{
+		std::lock_guard<std::mutex> lock(m_receiveMutex);
+		previousSink = m_receiveSink;
+	}
+	SetReceiveSink(sink);
+
 	// 设置文件传输状态
 	{
 		std::lock_guard<std::mutex> lock(m_receiveMutex);
@@ -608,15 +829,7 @@ bool ReliableChannel::ReceiveFile(const std::string& filePath, std::function<voi
 		m_transferStartTime = std::chrono::steady_clock::now(); // 记录传输开始时间
 	}
 
-	std::ofstream file(filePath, std::ios::binary);
-	if (!file.is_open())
-	{
-		ReportError("无法创建文件: " + filePath);
-		m_fileTransferActive = false;
-		return false;
-	}
-
-	// 等待文件传输完成
+	// 等待文件传输完成（传输结束前sink已写完并关闭文件）
 	while (m_fileTransferActive && m_connected)
 	{
 		std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -628,79 +841,449 @@ bool ReliableChannel::ReceiveFile(const std::string& filePath, std::function<voi
 		}
 	}
 
-	file.close();
-	return !m_fileTransferActive && m_connected;
+	SetReceiveSink(previousSink);
+	return !m_fileTransferActive && m_connected && !sink->HasFailed();
 }
 
-// 设置配置
-void ReliableChannel::SetConfig(const ReliableConfig& config)
+// 设置接收数据落地，正在写入的旧sink以未完成结束
+void ReliableChannel::SetReceiveSink(std::shared_ptr<IReceiveSink> sink)
 {
-	// 验证配置参数
-	if (config.windowSize == 0)
+	FinishReceiveSink(false);
+
+	std::lock_guard<std::mutex> lock(m_receiveMutex);
+	m_receiveSink = std::move(sink);
+}
+
+// 结束本次传输的数据落地：先交付窗口中已按序到达的数据，再通知sink
+void ReliableChannel::FinishReceiveSink(bool success)
+{
+	std::shared_ptr<IReceiveSink> sink;
+	bool failed = false;
 	{
-		ReportError("窗口大小不能为0");
-		return;
+		std::lock_guard<std::mutex> windowLock(m_windowMutex);
+		{
+			std::lock_guard<std::mutex> lock(m_receiveMutex);
+			if (!m_receiveSinkActive)
+			{
+				return;
+			}
+		}
+
+		DeliverReceivedLocked(false);
+
+		// 交付在窗口锁内进行，清除标志后不会再有新的写入
+		std::lock_guard<std::mutex> lock(m_receiveMutex);
+		sink = m_receiveSink;
+		failed = m_receiveSinkFailed;
+		m_receiveSinkActive = false;
 	}
 
-	if (config.windowSize > 256)
+	if (!sink)
 	{
-		ReportError("窗口大小不能超过256");
 		return;
 	}
 
-	if (config.maxPayloadSize == 0)
+	if (!sink->Finish(success && !failed) && !failed)
 	{
-		ReportError("最大负载大小不能为0");
-		return;
+		ReportError("接收数据落地失败: " + m_currentFileName);
 	}
+}
 
-	if (config.maxPayloadSize > 65536)
+// 批量发送文件：多路复用会话中最多同时打开MUX_MAX_ACTIVE_STREAMS个流，每轮每个流发送一个分块，
+// 读完的流排入CLOSE记录后补开下一个文件；进度按全部文件的累计字节回调
+bool ReliableChannel::SendFiles(const std::vector<std::string>& filePaths, std::function<void(int64_t, int64_t)> progressCallback)
+{
+	if (!IsConnected())
 	{
-		ReportError("最大负载大小不能超过65536");
-		return;
+		return false;
 	}
 
-	std::lock_guard<std::mutex> lock(m_windowMutex);
-	m_config = config;
-	m_frameCodec->SetMaxPayloadSize(config.maxPayloadSize);
+	if (!EnsureMultiplexSession())
+	{
+		WriteLog("SendFiles: multiplexing not negotiated, sending " + std::to_string(filePaths.size()) + " files sequentially");
+		for (const std::string& filePath : filePaths)
+		{
+			if (!SendFile(filePath, progressCallback))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
 
-	// 调整窗口大小
-	if (m_sendWindow.size() != config.windowSize)
+	// 先取得全部文件大小，进度以总字节数为分母
+	std::vector<int64_t> fileSizes;
+	int64_t totalBytes = 0;
+	for (const std::string& filePath : filePaths)
 	{
-		m_sendWindow.resize(config.windowSize);
-		m_receiveWindow.resize(config.windowSize);
+		WIN32_FILE_ATTRIBUTE_DATA data = {};
+		if (!GetFileAttributesExA(filePath.c_str(), GetFileExInfoStandard, &data))
+		{
+			ReportError("无法打开文件: " + filePath);
+			return false;
+		}
+		int64_t size = (static_cast<int64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+		fileSizes.push_back(size);
+		totalBytes += size;
 	}
-}
 
-// 获取配置
-ReliableConfig ReliableChannel::GetConfig() const
-{
-	std::lock_guard<std::mutex> lock(m_windowMutex);
-	return m_config;
-}
+	{
+		std::lock_guard<std::mutex> lock(m_receiveMutex);
+		m_currentFileName = filePaths.empty() ? std::string() : filePaths.front();
+		m_currentFileSize = totalBytes;
+		m_currentFileProgress = 0;
+		m_fileTransferActive = true;
+		m_transferStartTime = std::chrono::steady_clock::now();
+		m_sendBytesAcked = 0;
+		m_sendTotalBytes = totalBytes;
+	}
 
-// 获取统计信息
-ReliableStats ReliableChannel::GetStats() const
-{
-	std::lock_guard<std::mutex> lock(m_statsMutex);
-	return m_stats;
-}
+	struct ActiveFile
+	{
+		FileSource source;
+		size_t index = 0;
+		uint16_t streamId = 0;
+	};
+	std::vector<std::unique_ptr<ActiveFile>> active;
+	std::vector<uint16_t> openedStreams;
+	const size_t chunkSize = GetEffectivePayloadSize();
+	size_t nextFile = 0;
+	int64_t bytesSent = 0;
+	bool success = true;
 
-// 重置统计信息
-void ReliableChannel::ResetStats()
-{
-	std::lock_guard<std::mutex> lock(m_statsMutex);
-	m_stats = ReliableStats();
-}
+	while (success && m_connected && (nextFile < filePaths.size() || !active.empty()))
+	{
+		// 补足同时打开的流
+		while (nextFile < filePaths.size() && active.size() < MUX_MAX_ACTIVE_STREAMS)
+		{
+			std::unique_ptr<ActiveFile> file(new ActiveFile());
+			file->index = nextFile++;
+			const std::string& filePath = filePaths[file->index];
+			if (!file->source.Open(filePath))
+			{
+				ReportError("无法打开文件: " + filePath);
+				success = false;
+				break;
+			}
 
-// 设置回调函数
-void ReliableChannel::SetDataReceivedCallback(std::function<void(const std::vector<uint8_t>&)> callback)
-{
-	m_dataReceivedCallback = callback;
-}
+			file->streamId = OpenStream(filePath, static_cast<uint64_t>(fileSizes[file->index]), file->source.GetModifyTime());
+			if (file->streamId == 0)
+			{
+				ReportError("打开传输流失败: " + filePath);
+				success = false;
+				break;
+			}
+			openedStreams.push_back(file->streamId);
+			active.push_back(std::move(file));
+		}
 
-void ReliableChannel::SetStateChangedCallback(std::function<void(bool)> callback)
-{
+		// 每个流发送一个分块，读完的流关闭
+		for (auto it = active.begin(); success && it != active.end();)
+		{
+			ActiveFile& file = **it;
+			PacketRef packet = AcquireMuxPacket(file.streamId, MuxRecordType::MUX_DATA, chunkSize);
+			size_t bytesRead = file.source.Read(packet->Payload() + MUX_HEADER_SIZE, chunkSize);
+			if (bytesRead > 0)
+			{
+				packet->SetPayloadSize(MUX_HEADER_SIZE + bytesRead);
+				if (!EnqueueStreamPacket(file.streamId, std::move(packet)))
+				{
+					ReportError("发送文件数据失败: " + filePaths[file.index]);
+					success = false;
+					break;
+				}
+
+				bytesSent += static_cast<int64_t>(bytesRead);
+				UpdateProgress(bytesSent, totalBytes);
+				if (progressCallback)
+				{
+					progressCallback(bytesSent, totalBytes);
+				}
+				++it;
+				continue;
+			}
+
+			if (file.source.HasFailed())
+			{
+				ReportError("读取文件失败: " + filePaths[file.index]);
+				success = false;
+			}
+			CloseStream(file.streamId, success);
+			it = active.erase(it);
+		}
+	}
+
+	for (const auto& file : active)
+	{
+		CloseStream(file->streamId, false);
+	}
+
+	// END帧直接进入发送窗口，须等本批各流的记录全部出队并分配序列号后再发送，
+	// 否则END可能先于流的最后一条记录取得序列号，接收端按序交付时该记录被END截断
+	{
+		std::unique_lock<std::mutex> lock(m_sendMutex);
+		m_sendCondition.wait(lock, [this, &openedStreams] {
+			if (m_shutdown || !IsConnected())
+			{
+				return true;
+			}
+			if (m_muxUnsequencedStreamEnds != 0)
+			{
+				return false;
+			}
+			for (uint16_t streamId : openedStreams)
+			{
+				if (m_muxSendStreams.count(streamId) != 0)
+				{
+					return false;
+				}
+			}
+			return true;
+		});
+	}
+
+	if (success && m_connected && !SendEnd())
+	{
+		ReportError("发送文件结束帧失败");
+		success = false;
+	}
+
+	m_fileTransferActive = false;
+	return success && m_connected;
+}
+
+// 打开发送流：OPEN记录携带文件信息（START帧元数据格式），与数据一起按序到达，无需等待确认
+uint16_t ReliableChannel::OpenStream(const std::string& fileName, uint64_t fileSize, uint64_t modifyTime)
+{
+	if (!IsConnected() || !EnsureMultiplexSession())
+	{
+		return 0;
+	}
+
+	uint16_t streamId = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_sendMutex);
+		if (m_muxSendStreams.size() >= 0xFFFF)
+		{
+			return 0;
+		}
+		while (m_muxNextStreamId == 0 || m_muxSendStreams.count(m_muxNextStreamId) != 0)
+		{
+			m_muxNextStreamId++;
+		}
+		streamId = m_muxNextStreamId++;
+		m_muxSendStreams[streamId];
+	}
+
+	StartMetadata metadata;
+	metadata.fileName = fileName;
+	metadata.fileSize = fileSize;
+	metadata.modifyTime = modifyTime;
+	metadata.sessionId = streamId;
+	std::vector<uint8_t> body = m_frameCodec->EncodeStartMetadata(metadata);
+
+	// OPEN记录须放进一帧：文件名过长时保留末尾部分
+	size_t limit = GetEffectivePayloadSize();
+	if (body.size() > limit && body.size() - limit < fileName.size())
+	{
+		metadata.fileName = fileName.substr(body.size() - limit);
+		body = m_frameCodec->EncodeStartMetadata(metadata);
+	}
+
+	PacketRef packet = AcquireMuxPacket(streamId, MuxRecordType::MUX_OPEN, body.size());
+	memcpy(packet->Payload() + MUX_HEADER_SIZE, body.data(), body.size());
+	if (body.size() > limit || !EnqueueStreamPacket(streamId, std::move(packet)))
+	{
+		std::lock_guard<std::mutex> lock(m_sendMutex);
+		m_muxSendStreams.erase(streamId);
+		return 0;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.muxStreamsOpened++;
+	}
+	VERBOSE_LOG("OpenStream: stream {} opened for {}", streamId, metadata.fileName);
+	return streamId;
+}
+
+bool ReliableChannel::SendStream(uint16_t streamId, const void* data, size_t size)
+{
+	if (!data || size == 0)
+	{
+		return false;
+	}
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	const size_t chunkSize = GetEffectivePayloadSize();
+	size_t offset = 0;
+	while (offset < size)
+	{
+		size_t length = (std::min)(chunkSize, size - offset);
+		PacketRef packet = AcquireMuxPacket(streamId, MuxRecordType::MUX_DATA, length);
+		memcpy(packet->Payload() + MUX_HEADER_SIZE, bytes + offset, length);
+		if (!EnqueueStreamPacket(streamId, std::move(packet)))
+		{
+			return false;
+		}
+		offset += length;
+	}
+	return true;
+}
+
+bool ReliableChannel::CloseStream(uint16_t streamId, bool success)
+{
+	PacketRef packet = AcquireMuxPacket(streamId, MuxRecordType::MUX_CLOSE, 1);
+	packet->Payload()[MUX_HEADER_SIZE] = success ? 1 : 0;
+	bool queued = EnqueueStreamPacket(streamId, std::move(packet));
+
+	// CLOSE之后不再接受该流的写入，队列发完后由PopSendPacketLocked移除
+	std::lock_guard<std::mutex> lock(m_sendMutex);
+	auto it = m_muxSendStreams.find(streamId);
+	if (it != m_muxSendStreams.end())
+	{
+		if (it->second.queue.empty())
+		{
+			m_muxSendStreams.erase(it);
+			m_sendCondition.notify_all();
+		}
+		else
+		{
+			it->second.closed = true;
+		}
+	}
+	return queued;
+}
+
+bool ReliableChannel::IsMultiplexActive() const
+{
+	return m_multiplexActive.load();
+}
+
+void ReliableChannel::SetStreamSinkFactory(std::function<std::shared_ptr<IReceiveSink>(const ReceiveFileInfo&)> factory)
+{
+	std::lock_guard<std::mutex> lock(m_windowMutex);
+	m_streamSinkFactory = std::move(factory);
+}
+
+void ReliableChannel::SetStreamCompleteCallback(std::function<void(uint16_t, const ReceiveFileInfo&, const std::vector<uint8_t>&, bool)> callback)
+{
+	std::lock_guard<std::mutex> lock(m_windowMutex);
+	m_streamCompleteCallback = std::move(callback);
+}
+
+// 设置配置
+void ReliableChannel::SetConfig(const ReliableConfig& config)
+{
+	// 验证配置参数
+	if (config.windowSize == 0)
+	{
+		ReportError("窗口大小不能为0");
+		return;
+	}
+
+	if (config.windowSize > MAX_WINDOW_SIZE)
+	{
+		ReportError("窗口大小不能超过" + std::to_string(MAX_WINDOW_SIZE));
+		return;
+	}
+
+	if (config.maxPayloadSize == 0)
+	{
+		ReportError("最大负载大小不能为0");
+		return;
+	}
+
+	if (config.maxPayloadSize > 65536)
+	{
+		ReportError("最大负载大小不能超过65536");
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_windowMutex);
+	m_config = config;
+	m_frameCodec->SetMaxPayloadSize(config.maxPayloadSize);
+
+	// 调整窗口大小
+	if (m_sendWindow.size() != config.windowSize)
+	{
+		m_sendWindow.resize(config.windowSize);
+		m_receiveWindow.resize(config.windowSize);
+	}
+
+	ResetCongestionWindowLocked();
+}
+
+// 获取配置
+ReliableConfig ReliableChannel::GetConfig() const
+{
+	std::lock_guard<std::mutex> lock(m_windowMutex);
+	return m_config;
+}
+
+// 获取统计信息
+ReliableStats ReliableChannel::GetStats() const
+{
+	// 先取窗口状态再取统计，保持与其他路径一致的加锁顺序（窗口锁 → 统计锁）
+	uint32_t sendWindow = 0;
+	uint32_t rttMs = 0;
+	uint32_t fecGroupSize = 0;
+	{
+		std::lock_guard<std::mutex> windowLock(m_windowMutex);
+		sendWindow = GetSendWindowLimitLocked();
+		rttMs = m_rttMs;
+		fecGroupSize = m_fecActive.load() ? m_fecGroupSize : 0;
+	}
+
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	ReliableStats stats = m_stats;
+	stats.rttMs = rttMs;
+	stats.fecGroupSize = fecGroupSize;
+	stats.sendWindow = sendWindow;
+	stats.protocolVersion = m_protocolVersion.load();
+	if (stats.packetsSent > 0)
+	{
+		stats.packetLossRate = static_cast<uint8_t>((std::min)(stats.packetsRetransmitted * 100 / stats.packetsSent, static_cast<uint64_t>(100)));
+	}
+	if (!m_retransmitLatencyUs.empty())
+	{
+		std::vector<uint32_t> samples = m_retransmitLatencyUs;
+		auto percentile = [&samples](size_t percent) {
+			size_t rank = (samples.size() - 1) * percent / 100;
+			std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+			return samples[rank];
+		};
+		stats.retransmitLatencyP50Us = percentile(50);
+		stats.retransmitLatencyP99Us = percentile(99);
+	}
+	stats.timerWakeups = m_reactor ? m_reactor->GetWakeupCount() : m_timerQueue.GetWakeupCount();
+	stats.packetPoolOverflows = m_packetPool.GetOverflowCount();
+	return stats;
+}
+
+// 重置统计信息
+void ReliableChannel::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats = ReliableStats();
+	m_retransmitLatencyUs.clear();
+	m_retransmitLatencyNext = 0;
+}
+
+void ReliableChannel::RecordFileReadStalls(uint64_t stalls)
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats.fileReadStalls += stalls;
+}
+
+// 设置回调函数
+void ReliableChannel::SetDataReceivedCallback(std::function<void(const std::vector<uint8_t>&)> callback)
+{
+	m_dataReceivedCallback = callback;
+}
+
+void ReliableChannel::SetStateChangedCallback(std::function<void(bool)> callback)
+{
 	m_stateChangedCallback = callback;
 }
 
@@ -721,22 +1304,33 @@ void ReliableChannel::SetCompleteCallback(std::function<void(bool)> callback)
 }
 
 // 获取本地序列号
-uint16_t ReliableChannel::GetLocalSequence() const
+uint32_t ReliableChannel::GetLocalSequence() const
 {
 	return m_sendNext;
 }
 
 // 获取远端序列号
-uint16_t ReliableChannel::GetRemoteSequence() const
+uint32_t ReliableChannel::GetRemoteSequence() const
 {
 	return m_receiveNext;
 }
 
+// 获取协商后的协议版本
+uint8_t ReliableChannel::GetProtocolVersion() const
+{
+	return m_protocolVersion.load();
+}
+
 // 获取发送队列大小
 size_t ReliableChannel::GetSendQueueSize() const
 {
 	std::lock_guard<std::mutex> lock(m_sendMutex);
-	return m_sendQueue.size();
+	size_t size = m_sendQueue.size();
+	for (const auto& stream : m_muxSendStreams)
+	{
+		size += stream.second.queue.size();
+	}
+	return size;
 }
 
 // 获取接收队列大小
@@ -763,7 +1357,7 @@ bool ReliableChannel::IsFileTransferActive() const
 // 处理线程
 void ReliableChannel::ProcessThread()
 {
-	WriteVerbose("ProcessThread started");
+	VERBOSE_LOG("ProcessThread started");
 
 	std::vector<uint8_t> buffer(4096);
 
@@ -777,56 +1371,26 @@ void ReliableChannel::ProcessThread()
 		{
 			if (noDataReadCount % NO_DATA_LOG_THRESHOLD == 0)
 			{
-				WriteVerbose("ProcessThread: [节流日志] 未连接，已跳过 " + std::to_string(noDataReadCount) + " 次循环");
+				VERBOSE_LOG("ProcessThread: [节流日志] 未连接，已跳过 {} 次循环", noDataReadCount);
 			}
 			noDataReadCount++;
 			std::this_thread::sleep_for(std::chrono::milliseconds(100));
 			continue;
 		}
 
-		// 接收数据
+		// 接收数据（有待发送的SACK时不阻塞，以便在数据流暂停时立即确认）
 		size_t bytesReceived = 0;
-		TransportError error = m_transport->Read(buffer.data(), buffer.size(), &bytesReceived, 100);
+		DWORD readTimeout = m_sackPending ? 0 : 100;
+		TransportError error = ReadIncoming(buffer, readTimeout, bytesReceived);
 
 		if (error == TransportError::Success && bytesReceived > 0)
 		{
-			// 【关键事件】接收到数据，总是输出日志（不节流）
-			WriteVerbose("ProcessThread: 接收到 " + std::to_string(bytesReceived) + " 字节数据，正在处理...");
-
 			// 重置无数据计数器
 			if (noDataReadCount > 0)
 			{
-				WriteVerbose("ProcessThread: 结束空闲周期，共 " + std::to_string(noDataReadCount) + " 次无数据读取");
+				VERBOSE_LOG("ProcessThread: 结束空闲周期，共 {} 次无数据读取", noDataReadCount);
 				noDataReadCount = 0;
 			}
-
-			// 添加到帧编解码器
-			std::vector<uint8_t> data(buffer.begin(), buffer.begin() + bytesReceived);
-			m_frameCodec->AppendData(data);
-
-			// 处理可用的帧
-			Frame frame;
-			int frameCount = 0;
-			while (m_frameCodec->TryGetFrame(frame))
-			{
-				frameCount++;
-				// 【关键事件】处理帧，总是输出日志
-				WriteVerbose("ProcessThread: 处理帧 #" + std::to_string(frameCount) +
-					", 类型=" + std::to_string(static_cast<int>(frame.type)) +
-					", 序列号=" + std::to_string(frame.sequence));
-				ProcessIncomingFrame(frame);
-			}
-
-			if (frameCount > 0)
-			{
-				WriteVerbose("ProcessThread: 共处理 " + std::to_string(frameCount) + " 个帧");
-			}
-
-			// 更新统计
-			{
-				std::lock_guard<std::mutex> lock(m_statsMutex);
-				m_stats.bytesReceived += bytesReceived;
-			}
 		}
 		else
 		{
@@ -836,189 +1400,182 @@ void ReliableChannel::ProcessThread()
 			// 【日志节流】100次无数据后输出一次汇总
 			if (noDataReadCount % NO_DATA_LOG_THRESHOLD == 0)
 			{
-				WriteVerbose("ProcessThread: [节流日志] 连续 " + std::to_string(noDataReadCount) +
-					" 次无数据读取，错误码=" + std::to_string(static_cast<int>(error)));
+				VERBOSE_LOG("ProcessThread: [节流日志] 连续 {} 次无数据读取，错误码={}", noDataReadCount, static_cast<int>(error));
 			}
 		}
+	}
+
+	VERBOSE_LOG("ProcessThread exiting");
+}
+
+// 读取一次传输层数据并处理其中的完整帧；无数据时立即发送挂起的SACK
+TransportError ReliableChannel::ReadIncoming(std::vector<uint8_t>& buffer, DWORD timeoutMs, size_t& bytesReceived)
+{
+	// 读缓冲区至少容纳一个最大帧，避免按包读取的传输层截断大负载帧
+	size_t requiredBufferSize = m_config.maxPayloadSize + FrameCodec::MAX_FRAME_OVERHEAD;
+	if (buffer.size() < requiredBufferSize)
+	{
+		buffer.resize(requiredBufferSize);
+	}
+
+	bytesReceived = 0;
+	TransportError error = m_transport->Read(buffer.data(), buffer.size(), &bytesReceived, timeoutMs);
 
-		// 处理重传
+	if (error != TransportError::Success || bytesReceived == 0)
+	{
+		// 【SACK】数据流暂停，立即发送挂起的确认
+		if (m_sackPending)
 		{
-			std::lock_guard<std::mutex> lock(m_windowMutex);
-			auto now = std::chrono::steady_clock::now();
+			FlushPendingAck();
+		}
+		return error;
+	}
 
-			int retransmitCount = 0;
-			int activeSlotCount = 0;
+	// 【关键事件】接收到数据，总是输出日志（不节流）
+	VERBOSE_LOG("ProcessThread: 接收到 {} 字节数据，正在处理...", bytesReceived);
 
-			for (auto& slot : m_sendWindow)
-			{
-				if (slot.inUse && slot.packet && !slot.packet->acknowledged)
-				{
-					activeSlotCount++;
-					auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-						now - slot.packet->timestamp)
-						.count();
+	// 添加到帧编解码器（直接追加读缓冲区，避免中间拷贝）
+	m_frameCodec->AppendData(buffer.data(), bytesReceived);
 
-					if (elapsed > CalculateTimeout())
-					{
-						if (slot.packet->retryCount < m_config.maxRetries)
-						{
-							// 【关键事件】重传包，总是输出日志
-							WriteVerbose("ProcessThread: 重传数据包 sequence=" + std::to_string(slot.packet->sequence) +
-								", 尝试 " + std::to_string(slot.packet->retryCount + 1) + "/" + std::to_string(m_config.maxRetries));
-							m_retransmitting = true; // 设置重传标志
-							RetransmitPacketInternal(slot.packet->sequence); // 使用内部版本，已持有锁
-							m_retransmitting = false; // 清除重传标志
-							retransmitCount++;
-						}
-						else
-						{
-							// 【关键修复】超过最大重试次数，标记包为失败并清理
-							uint16_t failedSequence = slot.packet->sequence; // 保存序列号用于后续处理
-							// 【关键事件】包失败，总是输出日志
-							WriteVerbose("ProcessThread: 数据包 sequence=" + std::to_string(failedSequence) +
-								" 超过最大重试次数 (" + std::to_string(m_config.maxRetries) + ")，标记为失败");
-
-							// 更新统计
-							{
-								std::lock_guard<std::mutex> statsLock(m_statsMutex);
-								m_stats.timeouts++;
-							}
-
-							// 报告传输错误（在清理之前）
-							ReportError("数据包重传失败，序列号: " + std::to_string(failedSequence));
-
-							// 检查是否需要推进发送窗口（在清理之前）
-							bool shouldAdvanceWindow = (failedSequence == m_sendBase);
-
-							// 清理失败的包
-							slot.inUse = false;
-							slot.packet.reset();
-							m_windowCondition.notify_all();
-
-							// 推进发送窗口（如果这个包是窗口基）
-							if (shouldAdvanceWindow)
-							{
-								// 【关键事件】推进发送窗口，总是输出日志
-								WriteVerbose("ProcessThread: 由于失败包推进发送窗口，base sequence " + std::to_string(failedSequence));
-								AdvanceSendWindow();
-							}
-						}
-					}
-				}
-			}
+	// 处理可用的帧（复用成员帧对象，负载容量跨读取保留）
+	Frame& frame = m_incomingFrame;
+	int frameCount = 0;
+	while (m_frameCodec->TryGetFrame(frame))
+	{
+		frameCount++;
+		// 【关键事件】处理帧，总是输出日志
+		VERBOSE_LOG("ProcessThread: 处理帧 #{}, 类型={}, 序列号={}", frameCount, static_cast<int>(frame.type), frame.sequence);
+		ProcessIncomingFrame(frame);
+	}
 
-			// 【日志节流】仅在有重传或有活动slot时输出汇总
-			if (retransmitCount > 0 || (activeSlotCount > 0 && noDataReadCount % NO_DATA_LOG_THRESHOLD == 0))
-			{
-				WriteVerbose("ProcessThread: 重传检查完成，重传数=" + std::to_string(retransmitCount) +
-					", 活动slot数=" + std::to_string(activeSlotCount));
-			}
-		}
+	if (frameCount > 0)
+	{
+		VERBOSE_LOG("ProcessThread: 共处理 {} 个帧", frameCount);
+	}
+
+	// 【SACK】累计足够多的数据帧后合并发送一次确认
+	uint32_t sackThreshold = (std::max)(1u, static_cast<uint32_t>(m_config.windowSize / 4));
+	if (m_sackPending && m_sackPendingCount >= sackThreshold)
+	{
+		FlushPendingAck();
+	}
+
+	// 更新统计
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.bytesReceived += bytesReceived;
 	}
 
-	WriteVerbose("ProcessThread exiting");
+	return error;
 }
 
 // 发送线程
 void ReliableChannel::SendThread()
 {
-	WriteVerbose("SendThread started");
+	VERBOSE_LOG("SendThread started");
 
 	while (!m_shutdown)
 	{
-		WriteVerbose("SendThread: waiting for data or shutdown...");
+		VERBOSE_LOG("SendThread: waiting for data or shutdown...");
 
-		std::vector<uint8_t> data;
+		PacketRef packet;
+		bool endsStream = false;
 
 		// 获取要发送的数据（原子操作）
 		{
 			std::unique_lock<std::mutex> lock(m_sendMutex);
 
 			// 等待发送数据
-			WriteVerbose("SendThread: waiting on condition variable...");
+			VERBOSE_LOG("SendThread: waiting on condition variable...");
 			m_sendCondition.wait(lock, [this]
-				{ return !m_sendQueue.empty() || !m_connected || m_shutdown; });
+				{ return HasPendingSendLocked() || !m_connected || m_shutdown; });
 
-			WriteVerbose("SendThread: condition variable triggered");
+			VERBOSE_LOG("SendThread: condition variable triggered");
 
 			if (m_shutdown)
 			{
-				WriteVerbose("SendThread: shutdown detected, exiting");
+				VERBOSE_LOG("SendThread: shutdown detected, exiting");
 				lock.unlock(); // 显式释放锁
 				break;
 			}
 
 			if (!m_connected)
 			{
-				WriteVerbose("SendThread: not connected, continuing");
+				VERBOSE_LOG("SendThread: not connected, continuing");
 				lock.unlock(); // 显式释放锁
 				continue;
 			}
 
-			if (m_sendQueue.empty())
+			// 获取数据并从队列移除（多路复用时各流轮转）
+			if (!PopSendPacketLocked(packet, endsStream))
 			{
-				WriteVerbose("SendThread: queue is empty, continuing");
+				VERBOSE_LOG("SendThread: queue is empty, continuing");
 				lock.unlock(); // 显式释放锁
 				continue;
 			}
-
-			// 获取数据并从队列移除
-			WriteVerbose("SendThread: getting data from queue, queue size: " + std::to_string(m_sendQueue.size()));
-			data = m_sendQueue.front();
-			m_sendQueue.pop();
-			WriteVerbose("SendThread: data extracted, size: " + std::to_string(data.size()) + " bytes");
+			VERBOSE_LOG("SendThread: data extracted, size: {} bytes", packet->GetPayloadSize());
 
 			// 【修复】唤醒可能等待队列空间的Send()调用
 			m_sendCondition.notify_all();
 			lock.unlock(); // 显式释放锁
 		}
 
+		// 传输层写队列达到高水位时，不持锁等待其回落，而不是写入失败或让队列无限增长
+		while (!m_shutdown && m_connected && !m_transport->WaitWritable(TRANSPORT_WRITABLE_WAIT_MS))
+		{
+		}
+
 		// 【修复】将AllocateSequence和SendPacket合并到一个临界区内，避免重复锁定
 		try
 		{
-			WriteVerbose("SendThread: entering critical section for sequence allocation and packet sending...");
+			VERBOSE_LOG("SendThread: entering critical section for sequence allocation and packet sending...");
 
 			// 合并到一个临界区内，只获取一次m_windowMutex锁
 			std::unique_lock<std::mutex> lock(m_windowMutex);
 
-			WriteVerbose("SendThread: allocating sequence number...");
+			VERBOSE_LOG("SendThread: allocating sequence number...");
 			// 分配序列号（使用内部版本，避免重复锁定）
-			uint16_t sequence = AllocateSequenceLocked(lock);
-			WriteVerbose("SendThread: allocated sequence " + std::to_string(sequence) + ", sending packet...");
+			uint32_t sequence = AllocateSequenceLocked(lock);
+			VERBOSE_LOG("SendThread: allocated sequence {}, sending packet...", sequence);
 
-			// 发送数据包（使用内部版本，避免重复锁定）
-			if (!SendPacketLocked(lock, sequence, data))
+			// 发送数据包（使用内部版本，避免重复锁定；队列中的包已在Send()中按负载分块）
+			if (!SendPacketLocked(lock, sequence, std::move(packet)))
 			{
-				WriteVerbose("SendThread: SendPacketLocked failed");
+				VERBOSE_LOG("SendThread: SendPacketLocked failed");
 				ReportError("发送数据包失败");
 			}
 			else
 			{
-				WriteVerbose("SendThread: SendPacketLocked succeeded");
+				VERBOSE_LOG("SendThread: SendPacketLocked succeeded");
 			}
 
 			// lock会在作用域结束时自动释放
-			WriteVerbose("SendThread: exiting critical section");
+			VERBOSE_LOG("SendThread: exiting critical section");
 		}
 		catch (const std::exception& e)
 		{
-			WriteVerbose("SendThread: exception caught: " + std::string(e.what()));
+			VERBOSE_LOG("SendThread: exception caught: {}", e.what());
 			ReportError("发送线程异常: " + std::string(e.what()));
 		}
 		catch (...)
 		{
-			WriteVerbose("SendThread: unknown exception caught");
+			VERBOSE_LOG("SendThread: unknown exception caught");
 			ReportError("发送线程未知异常");
 		}
+
+		if (endsStream)
+		{
+			OnStreamLastPacketSequenced();
+		}
 	}
 
-	WriteVerbose("SendThread exiting");
+	VERBOSE_LOG("SendThread exiting");
 }
 
 // 接收线程
 void ReliableChannel::ReceiveThread()
 {
-	WriteVerbose("ReceiveThread started");
+	VERBOSE_LOG("ReceiveThread started");
 
 	// 【修复空闲日志泛滥】日志节流：每50次循环（500ms）输出一次空闲状态日志
 	static uint32_t idleLoopCount = 0;
@@ -1030,15 +1587,14 @@ void ReliableChannel::ReceiveThread()
 
 		if (shouldLogThisCycle)
 		{
-			WriteVerbose("ReceiveThread: [节流日志] 循环计数=" + std::to_string(idleLoopCount) +
-				", 连接状态=" + (m_connected ? "已连接" : "未连接"));
+			VERBOSE_LOG("ReceiveThread: [节流日志] 循环计数={}, 连接状态={}", idleLoopCount, (m_connected ? "已连接" : "未连接"));
 		}
 
 		if (!m_connected)
 		{
 			if (shouldLogThisCycle)
 			{
-				WriteVerbose("ReceiveThread: [节流日志] 未连接，休眠100ms");
+				VERBOSE_LOG("ReceiveThread: [节流日志] 未连接，休眠100ms");
 			}
 			idleLoopCount++;
 			std::this_thread::sleep_for(std::chrono::milliseconds(100));
@@ -1046,1373 +1602,3016 @@ void ReliableChannel::ReceiveThread()
 		}
 
 		// 检查接收窗口
+		int deliveredCount = 0;
 		{
-			std::lock_guard<std::mutex> lock(m_windowMutex);
+			std::unique_lock<std::mutex> lock(m_windowMutex);
 
-			while (true)
-			{
-				uint16_t expected = m_receiveBase;
-				bool found = false;
+			// 等待窗口基对应的包到达（由ProcessDataFrame唤醒），取代固定间隔轮询
+			m_deliveryCondition.wait(lock, [this] {
+				return m_shutdown || !m_connected || IsReceiveSlotReadyLocked();
+				});
 
-				if (shouldLogThisCycle)
-				{
-					WriteVerbose("ReceiveThread: [节流日志] 查找序列号 " + std::to_string(expected));
-				}
+			deliveredCount = DeliverReceivedLocked(shouldLogThisCycle);
+		}
 
-				for (auto& slot : m_receiveWindow)
-				{
-					if (slot.inUse && slot.packet && slot.packet->sequence == expected)
-					{
-						// 【关键事件】找到匹配包，总是输出日志（不节流）
-						WriteVerbose("ReceiveThread: 找到匹配数据包，sequence=" + std::to_string(slot.packet->sequence));
+		// 【SACK】交付后接收窗口前移，通告对端以便其继续发送
+		if (deliveredCount > 0 && m_peerSelectiveAck.load())
+		{
+			SendSack();
+		}
 
-						// 将数据放入接收队列
-						int64_t updatedProgress = -1;
-						int64_t progressTotal = 0;
-						size_t chunkSize = slot.packet->data.size();
+		idleLoopCount++;
+	}
 
-						{
-							std::lock_guard<std::mutex> receiveLock(m_receiveMutex);
-							// 【关键事件】推送数据到接收队列，总是输出日志
-							WriteVerbose("ReceiveThread: 推送数据到接收队列, size=" + std::to_string(chunkSize));
-							m_receiveQueue.push(slot.packet->data);
-
-							if (m_fileTransferActive)
-							{
-								m_completedFileBuffer.insert(
-									m_completedFileBuffer.end(),
-									slot.packet->data.begin(),
-									slot.packet->data.end());
-
-								m_currentFileProgress += static_cast<int64_t>(chunkSize);
-								if (m_currentFileSize > 0 && m_currentFileProgress > m_currentFileSize)
-								{
-									m_currentFileProgress = m_currentFileSize;
-								}
-
-								updatedProgress = m_currentFileProgress;
-								progressTotal = (m_currentFileSize > 0) ? m_currentFileSize : m_currentFileProgress;
-							}
-
-							m_receiveCondition.notify_one();
-						}
+	VERBOSE_LOG("ReceiveThread exiting");
+}
 
-						if (updatedProgress >= 0)
-						{
-							UpdateProgress(updatedProgress, progressTotal);
-						}
+// 将接收窗口中按序到达的包交付到接收队列，返回交付个数
+int ReliableChannel::DeliverReceivedLocked(bool logThisCycle)
+{
+	int deliveredCount = 0;
 
-						// 【关键事件】更新接收窗口，总是输出日志
-						WriteVerbose("ReceiveThread: 更新接收窗口 " + std::to_string(m_receiveBase) +
-							" → " + std::to_string((m_receiveBase + 1) % 65536));
-						slot.inUse = false;
-						slot.packet.reset();
-						m_receiveBase = (m_receiveBase + 1) % 65536;
-						found = true;
-						break;
-					}
-				}
+	while (true)
+	{
+		uint32_t expected = m_receiveBase;
+		bool found = false;
+
+		if (logThisCycle)
+		{
+			VERBOSE_LOG("ReceiveThread: [节流日志] 查找序列号 {}", expected);
+		}
+
+		// 序列号按 sequence % windowSize 映射到槽位，直接定位，大窗口下无需遍历
+		if (!m_receiveWindow.empty())
+		{
+			WindowSlot& slot = m_receiveWindow[expected % m_receiveWindow.size()];
+			if (slot.inUse && slot.packet && slot.packet->sequence == expected)
+			{
+				// 【关键事件】找到匹配包，总是输出日志（不节流）
+				VERBOSE_LOG("ReceiveThread: 找到匹配数据包，sequence={}", slot.packet->sequence);
 
-				if (!found)
+				// 流式帧还原失败说明双方字典已不一致，该帧数据无法恢复
+				if (!DecodeStreamPayloadLocked(*slot.packet))
 				{
-					if (shouldLogThisCycle)
 					{
-						WriteVerbose("ReceiveThread: [节流日志] 未找到匹配数据包，退出内层循环");
+						std::lock_guard<std::mutex> lock(m_statsMutex);
+						m_stats.packetsInvalid++;
 					}
-					break;
+					WriteLog("ReceiveThread: ERROR - failed to decode stream frame sequence=" + std::to_string(expected));
+					ReportError("流式压缩数据还原失败，序列号: " + std::to_string(expected));
+					slot.Release();
+					m_receiveBase = NextSequence(m_receiveBase);
+					deliveredCount++;
+					continue;
 				}
-			}
-		}
 
-		idleLoopCount++;
-		std::this_thread::sleep_for(std::chrono::milliseconds(10));
-	}
+				// 多路复用：各流的记录交给对应的流，默认流的数据去掉流头后按原路径交付
+				if (m_muxReceiveActive && !DeliverMuxRecordLocked(*slot.packet))
+				{
+					slot.Release();
+					m_receiveBase = NextSequence(m_receiveBase);
+					deliveredCount++;
+					continue;
+				}
 
-	WriteVerbose("ReceiveThread exiting");
-}
+				// 将数据放入接收队列（文件传输设置了落地sink时直接写入sink）
+				int64_t updatedProgress = -1;
+				int64_t progressTotal = 0;
+				const PacketRef& buffer = slot.packet->buffer;
+				size_t chunkSize = buffer->GetPayloadSize();
+				IReceiveSink* sink = nullptr;
 
-// 心跳线程
-void ReliableChannel::HeartbeatThread()
-{
-	WriteVerbose("HeartbeatThread started");
+				{
+					std::lock_guard<std::mutex> receiveLock(m_receiveMutex);
+					if (m_receiveSinkActive)
+					{
+						if (!m_receiveSinkFailed)
+						{
+							sink = m_receiveSink.get();
+						}
+					}
+					else
+					{
+						// 【关键事件】推送数据到接收队列，总是输出日志
+						VERBOSE_LOG("ReceiveThread: 推送数据到接收队列, size={}", chunkSize);
+						m_receiveQueue.push(buffer);
 
-	// 【修复空闲日志泛滥】日志节流：每10次心跳（10秒）输出一次空闲状态日志
-	static uint32_t heartbeatCount = 0;
-	const uint32_t LOG_THROTTLE_INTERVAL = 10; // 10次心跳 * 1000ms = 10秒
+						if (m_fileTransferActive)
+						{
+							m_completedFileBuffer.insert(
+								m_completedFileBuffer.end(),
+								buffer->Payload(),
+								buffer->Payload() + chunkSize);
+						}
+					}
 
-	while (!m_shutdown)
-	{
-		bool shouldLogThisCycle = (heartbeatCount % LOG_THROTTLE_INTERVAL == 0);
+					// 进度已在ProcessDataFrame中按首次到达累计，此处仅通知
+					if (m_fileTransferActive)
+					{
+						updatedProgress = m_currentFileProgress;
+						progressTotal = (m_currentFileSize > 0) ? m_currentFileSize : m_currentFileProgress;
+					}
+				}
 
-		if (m_connected)
-		{
-			// 在重传期间跳过心跳发送，避免序列冲突
-			if (m_retransmitting)
-			{
-				// 【关键事件】跳过心跳，总是输出日志
-				WriteVerbose("HeartbeatThread: 重传期间跳过心跳发送");
-			}
-			else
-			{
-				if (shouldLogThisCycle)
+				// sink写入在接收锁外进行，窗口锁保证与FinishReceiveSink()互斥
+				if (sink && !sink->Write(buffer->Payload(), chunkSize))
 				{
-					WriteVerbose("HeartbeatThread: [节流日志] 发送心跳，计数=" + std::to_string(heartbeatCount));
+					{
+						std::lock_guard<std::mutex> receiveLock(m_receiveMutex);
+						m_receiveSinkFailed = true;
+					}
+					ReportError("接收数据写入失败: " + m_currentFileName);
 				}
-				SendHeartbeat();
-			}
 
-			// 检查连接超时
-			auto now = std::chrono::steady_clock::now();
-			auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-				now - m_lastActivity)
-				.count();
+				if (updatedProgress >= 0)
+				{
+					UpdateProgress(updatedProgress, progressTotal);
+				}
 
-			if (elapsed > m_config.timeoutMax * 3)
-			{
-				// 【关键事件】连接超时，总是输出日志
-				WriteVerbose("HeartbeatThread: 检测到连接超时，elapsed=" + std::to_string(elapsed) +
-					"ms, timeoutMax=" + std::to_string(m_config.timeoutMax) + "ms");
-				ReportError("连接超时");
-				Disconnect();
-			}
-			else if (shouldLogThisCycle)
-			{
-				WriteVerbose("HeartbeatThread: [节流日志] 连接正常，最后活动距今 " + std::to_string(elapsed) + "ms");
+				// 【关键事件】更新接收窗口，总是输出日志
+				VERBOSE_LOG("ReceiveThread: 更新接收窗口 {} → {}", m_receiveBase, NextSequence(m_receiveBase));
+				slot.Release();
+				m_receiveBase = NextSequence(m_receiveBase);
+				deliveredCount++;
+				found = true;
 			}
 		}
-		else if (shouldLogThisCycle)
+
+		if (!found)
 		{
-			WriteVerbose("HeartbeatThread: [节流日志] 未连接，跳过心跳");
+			if (logThisCycle)
+			{
+				VERBOSE_LOG("ReceiveThread: [节流日志] 未找到匹配数据包，退出内层循环");
+			}
+			break;
 		}
+	}
 
-		heartbeatCount++;
-		std::this_thread::sleep_for(std::chrono::milliseconds(m_config.heartbeatInterval));
+	// 整批交付后统一唤醒Receive()，避免逐包唤醒
+	if (deliveredCount > 0)
+	{
+		std::lock_guard<std::mutex> receiveLock(m_receiveMutex);
+		m_receiveCondition.notify_all();
 	}
 
-	WriteVerbose("HeartbeatThread exiting");
+	return deliveredCount;
 }
 
-// 处理入站帧
-void ReliableChannel::ProcessIncomingFrame(const Frame& frame)
+// 定时器线程：重传、心跳、窗口探测与短超时均由定时器队列按截止时间触发，无到期事件时不唤醒
+void ReliableChannel::TimerThread()
 {
-	WriteVerbose("ProcessIncomingFrame called: type=" + std::to_string(static_cast<int>(frame.type)) +
-		", sequence=" + std::to_string(frame.sequence) +
-		", payload.size()=" + std::to_string(frame.payload.size()) +
-		", valid=" + std::to_string(frame.valid));
+	VERBOSE_LOG("TimerThread started");
+	m_timerQueue.Run();
+	VERBOSE_LOG("TimerThread exiting");
+}
 
-	if (!frame.valid)
+// 反应器单轮处理：读取并处理传输层数据、发送队列、按序交付与到期定时器，均不阻塞
+bool ReliableChannel::PollReactor()
+{
+	if (m_shutdown || !m_connected)
 	{
-		WriteVerbose("ProcessIncomingFrame: frame is invalid, incrementing invalid packet count");
+		return false;
+	}
 
-		// 记录无效帧统计
+	bool progressed = false;
+
+	// 读取本轮已到达的数据（限制次数，避免单个通道独占共享反应器）
+	for (int i = 0; i < REACTOR_READ_BUDGET; ++i)
+	{
+		size_t bytesReceived = 0;
+		if (ReadIncoming(m_reactorReadBuffer, 0, bytesReceived) != TransportError::Success || bytesReceived == 0)
 		{
-			std::lock_guard<std::mutex> lock(m_statsMutex);
-			m_stats.packetsInvalid++;
-			WriteVerbose("ProcessIncomingFrame: invalid packet count now " + std::to_string(m_stats.packetsInvalid));
+			break;
 		}
-		return;
+		progressed = true;
 	}
 
-	WriteVerbose("ProcessIncomingFrame: frame is valid, updating activity time");
-
-	// 更新活动时间
-	m_lastActivity = std::chrono::steady_clock::now();
-
-	// 更新统计
+	// ACK处理后窗口可能已前移，继续发送队列中的数据
+	if (DrainSendQueue())
 	{
-		std::lock_guard<std::mutex> lock(m_statsMutex);
-		m_stats.packetsReceived++;
-		WriteVerbose("ProcessIncomingFrame: received packet count now " + std::to_string(m_stats.packetsReceived));
+		progressed = true;
 	}
 
-	WriteVerbose("ProcessIncomingFrame: processing frame type " + std::to_string(static_cast<int>(frame.type)));
-
-	// 根据帧类型处理
-	switch (frame.type)
+	int deliveredCount = 0;
 	{
-	case FrameType::FRAME_DATA:
-		WriteVerbose("ProcessIncomingFrame: calling ProcessDataFrame");
-		ProcessDataFrame(frame);
-		WriteVerbose("ProcessIncomingFrame: ProcessDataFrame completed");
-		break;
-
-	case FrameType::FRAME_ACK:
-		WriteVerbose("ProcessIncomingFrame: calling ProcessAckFrame with sequence " + std::to_string(frame.sequence));
-		ProcessAckFrame(frame.sequence);
-		WriteVerbose("ProcessIncomingFrame: ProcessAckFrame completed");
-		break;
-
-	case FrameType::FRAME_NAK:
-		WriteVerbose("ProcessIncomingFrame: calling ProcessNakFrame with sequence " + std::to_string(frame.sequence));
-		ProcessNakFrame(frame.sequence);
-		WriteVerbose("ProcessIncomingFrame: ProcessNakFrame completed");
-		break;
-
-	case FrameType::FRAME_START:
-		WriteVerbose("ProcessIncomingFrame: calling ProcessStartFrame");
-		ProcessStartFrame(frame);
-		WriteVerbose("ProcessIncomingFrame: ProcessStartFrame completed");
-		break;
-
-	case FrameType::FRAME_END:
-		WriteVerbose("ProcessIncomingFrame: calling ProcessEndFrame");
-		ProcessEndFrame(frame);
-		WriteVerbose("ProcessIncomingFrame: ProcessEndFrame completed");
-		break;
+		std::lock_guard<std::mutex> lock(m_windowMutex);
+		deliveredCount = DeliverReceivedLocked(false);
+	}
 
-	case FrameType::FRAME_HEARTBEAT:
-		WriteVerbose("ProcessIncomingFrame: calling ProcessHeartbeatFrame");
-		ProcessHeartbeatFrame(frame);
-		WriteVerbose("ProcessIncomingFrame: ProcessHeartbeatFrame completed");
-		break;
+	// 【SACK】交付后接收窗口前移，通告对端以便其继续发送
+	if (deliveredCount > 0)
+	{
+		progressed = true;
+		if (m_peerSelectiveAck.load())
+		{
+			SendSack();
+		}
+	}
 
-	default:
-		WriteLog("ProcessIncomingFrame: unknown frame type " + std::to_string(static_cast<int>(frame.type)));
-		// 未知帧类型，记录错误
-		ReportError("未知帧类型: " + std::to_string(static_cast<int>(frame.type)));
-		break;
+	if (m_timerQueue.RunExpired(TimerQueue::Clock::now()) > 0)
+	{
+		progressed = true;
 	}
 
-	WriteVerbose("ProcessIncomingFrame: completed processing frame");
+	return progressed;
 }
 
-// 处理数据帧
-void ReliableChannel::ProcessDataFrame(const Frame& frame)
+// 反应器模式的发送：在发送窗口允许范围内发送队列数据，窗口满时保留已出队的包留待下一轮
+bool ReliableChannel::DrainSendQueue()
 {
-	WriteVerbose("ProcessDataFrame called: sequence=" + std::to_string(frame.sequence) +
-		", payload.size()=" + std::to_string(frame.payload.size()) +
-		", receiveBase=" + std::to_string(m_receiveBase) +
-		", windowSize=" + std::to_string(m_config.windowSize));
-
-	// 检查序列号是否在接收窗口内
-	bool inWindow = IsSequenceInWindow(frame.sequence, m_receiveBase, m_config.windowSize);
-	WriteVerbose("ProcessDataFrame: sequence in window check: " + std::to_string(inWindow) +
-		", window range=[" + std::to_string(m_receiveBase) + "," + std::to_string(m_receiveBase + m_config.windowSize) + ")");
+	bool progressed = false;
+	bool dequeued = false;
 
-	if (!inWindow)
-	{
-		uint16_t expected = m_receiveBase;
-		uint16_t lastAck = (expected == 0) ? 65535 : static_cast<uint16_t>(expected - 1);
-
-		WriteVerbose("ProcessDataFrame: sequence outside window, expected=" + std::to_string(expected) +
-			", received=" + std::to_string(frame.sequence) + ", sending duplicate ACK");
-
-		// 再次确认最后一次成功的序列，提示对端重发缺失的数据
-		SendAck(lastAck);
-		return;
-	}
-
-	WriteVerbose("ProcessDataFrame: sequence in window, processing...");
-
-	// 将数据放入接收窗口
+	while (!m_shutdown && m_connected)
 	{
-		std::lock_guard<std::mutex> lock(m_windowMutex);
-		WriteVerbose("ProcessDataFrame: locked window mutex");
-
-		// 确保窗口大小有效
-		if (m_config.windowSize == 0 || m_receiveWindow.empty())
+		// 传输层不可写时留待可写回调唤醒反应器
+		if (!m_transport->IsWritable())
 		{
-			WriteLog("ProcessDataFrame: ERROR - receive window not initialized or size is 0");
-			ReportError("接收窗口未初始化或大小为0");
-			return;
+			break;
 		}
 
-		uint16_t index = frame.sequence % m_config.windowSize;
-		WriteVerbose("ProcessDataFrame: calculated index=" + std::to_string(index) +
-			", receiveWindow.size()=" + std::to_string(m_receiveWindow.size()));
-
-		// 边界检查
-		if (index >= m_receiveWindow.size())
+		if (!m_reactorSendPacket)
 		{
-			WriteLog("ProcessDataFrame: ERROR - receive window index out of bounds: " + std::to_string(index) +
-				" >= " + std::to_string(m_receiveWindow.size()));
-			ReportError("接收窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_receiveWindow.size()));
-			return;
+			std::lock_guard<std::mutex> lock(m_sendMutex);
+			if (!PopSendPacketLocked(m_reactorSendPacket, m_reactorSendPacketEndsStream))
+			{
+				break;
+			}
+			dequeued = true;
 		}
 
-		// 【P0修复】检查窗口slot是否已有该序列号的数据（去重保护）
-		if (m_receiveWindow[index].inUse &&
-			m_receiveWindow[index].packet &&
-			m_receiveWindow[index].packet->sequence == frame.sequence)
+		std::unique_lock<std::mutex> lock(m_windowMutex);
+		if (IsSendWindowFullLocked())
 		{
-			// 这是重传数据，已经处理过，只需重新发送ACK
-			WriteVerbose("ProcessDataFrame: 检测到重传数据seq=" + std::to_string(frame.sequence) +
-				"，跳过重复处理，仅发送ACK");
-			SendAck(frame.sequence);
-			return;
+			break;
 		}
 
-		// 【P0修复】只有新数据才更新slot和进度
-		WriteVerbose("ProcessDataFrame: setting window slot " + std::to_string(index) + " to inUse=true");
-		m_receiveWindow[index].inUse = true;
+		// 队列中的包已在Send()中按负载分块，与SendThread一致
+		uint32_t sequence = AllocateSequenceLocked(lock);
+		const bool sent = SendPacketLocked(lock, sequence, std::move(m_reactorSendPacket));
+		lock.unlock();
 
-		if (!m_receiveWindow[index].packet)
+		if (m_reactorSendPacketEndsStream)
 		{
-			WriteVerbose("ProcessDataFrame: creating new packet for slot " + std::to_string(index));
-			m_receiveWindow[index].packet = std::make_shared<Packet>();
+			m_reactorSendPacketEndsStream = false;
+			OnStreamLastPacketSequenced();
 		}
 
-		m_receiveWindow[index].packet->sequence = frame.sequence;
-		m_receiveWindow[index].packet->data = frame.payload;
-
-		// ✅ 只有首次接收才更新进度
-		m_currentFileProgress += frame.payload.size();
-		if (m_currentFileSize > 0 && m_currentFileProgress > m_currentFileSize)
+		if (!sent)
 		{
-			m_currentFileProgress = m_currentFileSize;
+			VERBOSE_LOG("DrainSendQueue: SendPacketLocked failed");
+			ReportError("发送数据包失败");
+			break;
 		}
-
-		WriteVerbose("ProcessDataFrame: 新数据seq=" + std::to_string(frame.sequence) +
-			", size=" + std::to_string(frame.payload.size()) +
-			", progress=" + std::to_string(m_currentFileProgress) + "/" +
-			std::to_string(m_currentFileSize));
+		progressed = true;
 	}
 
-	WriteVerbose("ProcessDataFrame: window update completed, sending ACK");
-
-	// 发送ACK
-	SendAck(frame.sequence);
-
-	// 更新统计
+	// 本轮结束后统一唤醒等待队列空间的Send()调用，避免逐包唤醒抢占反应器线程
+	if (dequeued)
 	{
-		std::lock_guard<std::mutex> lock(m_statsMutex);
-		m_stats.bytesReceived += frame.payload.size();
-		WriteVerbose("ProcessDataFrame: stats updated, bytesReceived=" + std::to_string(m_stats.bytesReceived));
+		m_sendCondition.notify_all();
 	}
 
-	WriteVerbose("ProcessDataFrame: completed successfully");
+	return progressed;
 }
 
-// 处理ACK帧
-void ReliableChannel::ProcessAckFrame(uint16_t sequence)
+bool ReliableChannel::GetNextTimerDeadline(TimerQueue::Clock::time_point& deadline)
 {
-	WriteVerbose("ProcessAckFrame called: sequence=" + std::to_string(sequence) +
-		", sendBase=" + std::to_string(m_sendBase) +
-		", windowSize=" + std::to_string(m_config.windowSize));
-
-	std::lock_guard<std::mutex> lock(m_windowMutex);
-	WriteVerbose("ProcessAckFrame: locked window mutex");
+	return m_timerQueue.GetNextDeadline(deadline);
+}
 
-	// 确保窗口大小有效
-	if (m_config.windowSize == 0 || m_sendWindow.empty())
+// 心跳定时器
+void ReliableChannel::OnHeartbeatTimer()
+{
+	if (m_shutdown)
 	{
-		WriteLog("ProcessAckFrame: ERROR - send window not initialized or size is 0");
-		ReportError("发送窗口未初始化或大小为0");
 		return;
 	}
 
-	// 在发送窗口中查找对应的包
-	uint16_t index = sequence % m_config.windowSize;
-	WriteVerbose("ProcessAckFrame: calculated index=" + std::to_string(index) +
-		", sendWindow.size()=" + std::to_string(m_sendWindow.size()));
-
-	// 边界检查
-	if (index >= m_sendWindow.size())
-	{
-		WriteLog("ProcessAckFrame: ERROR - send window index out of bounds: " + std::to_string(index) +
-			" >= " + std::to_string(m_sendWindow.size()));
-		ReportError("发送窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_sendWindow.size()));
-		return;
-	}
+	// 【修复空闲日志泛滥】日志节流：每10次心跳（10秒）输出一次空闲状态日志
+	static uint32_t heartbeatCount = 0;
+	const uint32_t LOG_THROTTLE_INTERVAL = 10; // 10次心跳 * 1000ms = 10秒
 
-	WriteVerbose("ProcessAckFrame: checking slot " + std::to_string(index) +
-		", inUse=" + std::to_string(m_sendWindow[index].inUse));
+	bool shouldLogThisCycle = (heartbeatCount % LOG_THROTTLE_INTERVAL == 0);
 
-	if (m_sendWindow[index].inUse && m_sendWindow[index].packet &&
-		m_sendWindow[index].packet->sequence == sequence && !m_sendWindow[index].packet->acknowledged)
+	if (m_connected)
 	{
-		WriteVerbose("ProcessAckFrame: processing ACK for packet " + std::to_string(sequence));
-
-		// 标记为已确认
-		m_sendWindow[index].packet->acknowledged = true;
-		WriteVerbose("ProcessAckFrame: packet marked as acknowledged");
+		// 在重传期间跳过心跳发送，避免序列冲突
+		if (m_retransmitting)
+		{
+			// 【关键事件】跳过心跳，总是输出日志
+			VERBOSE_LOG("OnHeartbeatTimer: 重传期间跳过心跳发送");
+		}
+		else
+		{
+			if (shouldLogThisCycle)
+			{
+				VERBOSE_LOG("OnHeartbeatTimer: [节流日志] 发送心跳，计数={}", heartbeatCount);
+			}
+			SendHeartbeat();
+		}
 
-		// 更新RTT
+		// 检查连接超时
 		auto now = std::chrono::steady_clock::now();
-		auto rtt = std::chrono::duration_cast<std::chrono::milliseconds>(
-			now - m_sendWindow[index].packet->timestamp)
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+			now - m_lastActivity)
 			.count();
-		WriteVerbose("ProcessAckFrame: calculated RTT=" + std::to_string(rtt) + "ms");
-		UpdateRTT(static_cast<uint32_t>(rtt));
-
-		// 【P1优化】更新发送进度（基于ACK）
-		size_t dataSize = m_sendWindow[index].packet->data.size();
-		int64_t ackedBytes = m_sendBytesAcked.fetch_add(dataSize) + dataSize;
 
-		// 回调进度更新（仅在文件传输活跃时）
-		if (m_fileTransferActive && m_progressCallback && m_sendTotalBytes > 0)
+		if (elapsed > m_config.timeoutMax * 3)
 		{
-			UpdateProgress(ackedBytes, m_sendTotalBytes);
-			WriteVerbose("ProcessAckFrame: 发送进度=" +
-				std::to_string(ackedBytes) + "/" +
-				std::to_string(m_sendTotalBytes) +
-				" (" + std::to_string((ackedBytes * 100) / m_sendTotalBytes) + "%)");
+			// 【关键事件】连接超时，总是输出日志
+			VERBOSE_LOG("OnHeartbeatTimer: 检测到连接超时，elapsed={}ms, timeoutMax={}ms", elapsed, m_config.timeoutMax);
+			ReportError("连接超时");
+			Disconnect();
 		}
-
-		// 【关键修复4】检查是否为握手帧的ACK
-		uint16_t handshakeSeq = m_handshakeSequence.load();
-		if (sequence == handshakeSeq && !m_handshakeCompleted.load())
+		else if (shouldLogThisCycle)
 		{
-			WriteLog("ProcessAckFrame: received ACK for handshake START frame (sequence=" + std::to_string(sequence) + ")");
-
-			// 设置握手完成标志
-			m_handshakeCompleted.store(true);
-
-			// 通知等待握手完成的线程
-			{
-				std::lock_guard<std::mutex> handshakeLock(m_handshakeMutex);
-				m_handshakeCondition.notify_all();
-			}
-
-			WriteLog("ProcessAckFrame: handshake completed, sessionId=" + std::to_string(m_sessionId.load()));
+			VERBOSE_LOG("OnHeartbeatTimer: [节流日志] 连接正常，最后活动距今 {}ms", elapsed);
 		}
-
-		// 推进发送窗口
-		WriteVerbose("ProcessAckFrame: calling AdvanceSendWindow");
-		AdvanceSendWindow();
-		WriteVerbose("ProcessAckFrame: AdvanceSendWindow completed");
 	}
-	else
+	else if (shouldLogThisCycle)
 	{
-		WriteVerbose("ProcessAckFrame: ACK not processed - inUse=" + std::to_string(m_sendWindow[index].inUse) +
-			", hasPacket=" + std::to_string(m_sendWindow[index].packet != nullptr) +
-			", sequenceMatch=" + std::to_string(m_sendWindow[index].packet && m_sendWindow[index].packet->sequence == sequence) +
-			", alreadyAcked=" + std::to_string(m_sendWindow[index].packet && m_sendWindow[index].packet->acknowledged));
-		if (m_sendWindow[index].packet)
-		{
-			WriteVerbose("ProcessAckFrame: slot sequence=" + std::to_string(m_sendWindow[index].packet->sequence) +
-				", expected=" + std::to_string(sequence));
-		}
+		VERBOSE_LOG("OnHeartbeatTimer: [节流日志] 未连接，跳过心跳");
 	}
 
-	WriteVerbose("ProcessAckFrame: completed");
+	heartbeatCount++;
+	m_timerQueue.ScheduleAfter(m_config.heartbeatInterval, [this] { OnHeartbeatTimer(); });
 }
 
-// 处理NAK帧
-void ReliableChannel::ProcessNakFrame(uint16_t sequence)
+// 重传定时器：包在截止时间前仍未确认则重传，超过最大重试次数则判定失败
+void ReliableChannel::OnRetransmitTimer(uint32_t sequence)
 {
-	WriteLog("ProcessNakFrame called: sequence=" + std::to_string(sequence) +
-		", sendBase=" + std::to_string(m_sendBase) +
-		", windowSize=" + std::to_string(m_config.windowSize));
-
 	std::lock_guard<std::mutex> lock(m_windowMutex);
-	WriteLog("ProcessNakFrame: locked window mutex");
 
-	// 确保窗口大小有效
 	if (m_config.windowSize == 0 || m_sendWindow.empty())
 	{
-		WriteLog("ProcessNakFrame: ERROR - send window not initialized or size is 0");
-		ReportError("发送窗口未初始化或大小为0");
 		return;
 	}
 
-	// 重传对应的包
-	uint16_t index = sequence % m_config.windowSize;
-	WriteLog("ProcessNakFrame: calculated index=" + std::to_string(index) +
-		", sendWindow.size()=" + std::to_string(m_sendWindow.size()));
+	WindowSlot& slot = m_sendWindow[sequence % m_config.windowSize];
+	if (!slot.inUse || !slot.packet || slot.packet->sequence != sequence || slot.packet->acknowledged)
+	{
+		return;
+	}
+	slot.packet->retransmitTimer = TimerQueue::INVALID_TIMER;
 
-	// 边界检查
-	if (index >= m_sendWindow.size())
+	// 期间发生过快速重传或超时时间缩短/延长时，按最新发送时间重新计时
+	auto now = std::chrono::steady_clock::now();
+	auto deadline = slot.packet->timestamp + std::chrono::milliseconds(CalculateTimeout());
+	if (now < deadline)
 	{
-		WriteLog("ProcessNakFrame: ERROR - send window index out of bounds: " + std::to_string(index) +
-			" >= " + std::to_string(m_sendWindow.size()));
-		ReportError("发送窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_sendWindow.size()));
+		ArmRetransmitTimerLocked(slot.packet);
 		return;
 	}
 
-	WriteLog("ProcessNakFrame: checking slot " + std::to_string(index) +
-		", inUse=" + std::to_string(m_sendWindow[index].inUse));
+	RecordRetransmitLatency(static_cast<uint32_t>(
+		std::chrono::duration_cast<std::chrono::microseconds>(now - deadline).count()));
 
-	if (m_sendWindow[index].inUse && m_sendWindow[index].packet &&
-		m_sendWindow[index].packet->sequence == sequence)
+	if (slot.packet->retryCount < m_config.maxRetries)
 	{
-		WriteLog("ProcessNakFrame: retransmitting packet " + std::to_string(sequence));
+		// 【关键事件】重传包，总是输出日志
+		VERBOSE_LOG("OnRetransmitTimer: 重传数据包 sequence={}, 尝试 {}/{}", sequence, slot.packet->retryCount + 1, m_config.maxRetries);
 		m_retransmitting = true; // 设置重传标志
 		RetransmitPacketInternal(sequence); // 使用内部版本，已持有锁
 		m_retransmitting = false; // 清除重传标志
-		WriteLog("ProcessNakFrame: retransmission completed");
+
+		// 【AIMD】超时重传视为拥塞信号
+		OnCongestionLossLocked();
+		return;
 	}
-	else
+
+	// 【关键修复】超过最大重试次数，标记包为失败并清理
+	// 【关键事件】包失败，总是输出日志
+	VERBOSE_LOG("OnRetransmitTimer: 数据包 sequence={} 超过最大重试次数 ({})，标记为失败", sequence, m_config.maxRetries);
+
+	// 更新统计
 	{
-		WriteLog("ProcessNakFrame: NAK not processed - inUse=" + std::to_string(m_sendWindow[index].inUse) +
-			", hasPacket=" + std::to_string(m_sendWindow[index].packet != nullptr) +
-			", sequenceMatch=" + std::to_string(m_sendWindow[index].packet && m_sendWindow[index].packet->sequence == sequence));
+		std::lock_guard<std::mutex> statsLock(m_statsMutex);
+		m_stats.timeouts++;
 	}
 
-	WriteLog("ProcessNakFrame: completed");
-}
+	// 报告传输错误（在清理之前）
+	ReportError("数据包重传失败，序列号: " + std::to_string(sequence));
 
-// 处理开始帧
-void ReliableChannel::ProcessStartFrame(const Frame& frame)
-{
-	WriteLog("ProcessStartFrame called: sequence=" + std::to_string(frame.sequence) +
-		", payload.size()=" + std::to_string(frame.payload.size()));
+	// 检查是否需要推进发送窗口（在清理之前）
+	bool shouldAdvanceWindow = (sequence == m_sendBase);
 
-	StartMetadata metadata;
-	if (m_frameCodec->DecodeStartMetadata(frame.payload, metadata))
-	{
-		WriteLog("ProcessStartFrame: metadata decoded successfully - fileName=" + metadata.fileName +
-			", fileSize=" + std::to_string(metadata.fileSize) +
-			", version=" + std::to_string(metadata.version));
+	// 放弃失败的包：按已确认处理并释放缓冲区，槽位保留到窗口基越过该序列，避免窗口基停滞
+	slot.packet->acknowledged = true;
+	slot.packet->buffer.reset();
+	m_windowCondition.notify_all();
+
+	// 推进发送窗口（如果这个包是窗口基）
+	if (shouldAdvanceWindow)
+	{
+		// 【关键事件】推进发送窗口，总是输出日志
+		VERBOSE_LOG("OnRetransmitTimer: 由于失败包推进发送窗口，base sequence {}", sequence);
+		AdvanceSendWindow();
+	}
+}
+
+// 窗口探测定时器
+void ReliableChannel::OnWindowProbeTimer()
+{
+	std::lock_guard<std::mutex> lock(m_windowMutex);
+	m_windowProbeTimer = TimerQueue::INVALID_TIMER;
+
+	// 【SACK】所有包均已确认但对端接收窗口仍满时，窗口更新可能丢失，发送心跳探测
+	if (m_connected && IsPeerWindowStalledLocked())
+	{
+		VERBOSE_LOG("OnWindowProbeTimer: 对端接收窗口已满，发送窗口探测");
+		SendHeartbeat();
+		ArmWindowProbeLocked();
+	}
+}
+
+// 短超时定时器：到期后重新执行END帧的完整性判断
+void ReliableChannel::OnShortTimeoutTimer()
+{
+	if (!m_shortTimeoutActive || !m_fileTransferActive)
+	{
+		return;
+	}
+
+	WriteLog("OnShortTimeoutTimer: 短超时到期，重新检查传输完整性");
+	ProcessEndFrame(Frame());
+}
+
+void ReliableChannel::ArmRetransmitTimerLocked(const std::shared_ptr<Packet>& packet)
+{
+	CancelRetransmitTimerLocked(packet);
+
+	uint32_t sequence = packet->sequence;
+	auto deadline = packet->timestamp + std::chrono::milliseconds(CalculateTimeout());
+	packet->retransmitTimer = m_timerQueue.Schedule(deadline, [this, sequence] { OnRetransmitTimer(sequence); });
+}
+
+void ReliableChannel::CancelRetransmitTimerLocked(const std::shared_ptr<Packet>& packet)
+{
+	if (packet && packet->retransmitTimer != TimerQueue::INVALID_TIMER)
+	{
+		m_timerQueue.Cancel(packet->retransmitTimer);
+		packet->retransmitTimer = TimerQueue::INVALID_TIMER;
+	}
+}
+
+void ReliableChannel::ArmWindowProbeLocked()
+{
+	if (m_windowProbeTimer == TimerQueue::INVALID_TIMER && IsPeerWindowStalledLocked())
+	{
+		m_windowProbeTimer = m_timerQueue.ScheduleAfter(CalculateTimeout(), [this] { OnWindowProbeTimer(); });
+	}
+}
+
+// 本端已无未确认包，但对端通告的接收窗口已被占满
+bool ReliableChannel::IsPeerWindowStalledLocked() const
+{
+	if (!m_peerWindowKnown || m_sendBase != m_sendNext)
+	{
+		return false;
+	}
+
+	uint32_t peerWindow = m_peerWindowSize > 0 ? m_peerWindowSize : m_config.windowSize;
+	return GetWindowDistance(m_peerReceiveBase, m_sendNext) >= peerWindow;
+}
+
+bool ReliableChannel::IsReceiveSlotReadyLocked() const
+{
+	if (m_receiveWindow.empty())
+	{
+		return false;
+	}
+
+	const WindowSlot& slot = m_receiveWindow[m_receiveBase % m_receiveWindow.size()];
+	return slot.inUse && slot.packet && slot.packet->sequence == m_receiveBase;
+}
+
+void ReliableChannel::RecordRetransmitLatency(uint32_t latencyUs)
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+
+	if (m_retransmitLatencyUs.size() < RETRANSMIT_LATENCY_SAMPLES)
+	{
+		m_retransmitLatencyUs.push_back(latencyUs);
+	}
+	else
+	{
+		m_retransmitLatencyUs[m_retransmitLatencyNext] = latencyUs;
+	}
+	m_retransmitLatencyNext = (m_retransmitLatencyNext + 1) % RETRANSMIT_LATENCY_SAMPLES;
+}
+
+// 处理入站帧
+void ReliableChannel::ProcessIncomingFrame(const Frame& frame)
+{
+	VERBOSE_LOG("ProcessIncomingFrame called: type={}, sequence={}, payload.size()={}, valid={}",
+		static_cast<int>(frame.type), frame.sequence, frame.payload.size(), frame.valid);
+
+	if (!frame.valid)
+	{
+		VERBOSE_LOG("ProcessIncomingFrame: frame is invalid, incrementing invalid packet count");
+
+		// 记录无效帧统计
+		{
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			m_stats.packetsInvalid++;
+			VERBOSE_LOG("ProcessIncomingFrame: invalid packet count now {}", m_stats.packetsInvalid);
+		}
+		return;
+	}
+
+	VERBOSE_LOG("ProcessIncomingFrame: frame is valid, updating activity time");
+
+	// 更新活动时间
+	m_lastActivity = std::chrono::steady_clock::now();
+
+	// 更新统计
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.packetsReceived++;
+		VERBOSE_LOG("ProcessIncomingFrame: received packet count now {}", m_stats.packetsReceived);
+	}
+
+	VERBOSE_LOG("ProcessIncomingFrame: processing frame type {}", static_cast<int>(frame.type));
+
+	// 根据帧类型处理
+	switch (frame.type)
+	{
+	case FrameType::FRAME_DATA:
+	case FrameType::FRAME_DATA_STREAM:
+		if (m_fecReceiveActive)
+		{
+			RememberFecFrame(frame);
+		}
+		VERBOSE_LOG("ProcessIncomingFrame: calling ProcessDataFrame");
+		ProcessDataFrame(frame);
+		VERBOSE_LOG("ProcessIncomingFrame: ProcessDataFrame completed");
+		break;
+
+	case FrameType::FRAME_DATA_COMPRESSED:
+		if (m_fecReceiveActive)
+		{
+			RememberFecFrame(frame);
+		}
+		VERBOSE_LOG("ProcessIncomingFrame: decompressing data frame");
+		if (DecompressFrame(frame, m_decompressedFrame))
+		{
+			ProcessDataFrame(m_decompressedFrame);
+		}
+		else
+		{
+			// 解压失败按无效帧处理，不确认，由发送端超时重传
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			m_stats.packetsInvalid++;
+			WriteLog("ProcessIncomingFrame: ERROR - failed to decompress frame sequence=" + std::to_string(frame.sequence));
+		}
+		break;
+
+	case FrameType::FRAME_ACK:
+		VERBOSE_LOG("ProcessIncomingFrame: calling ProcessAckFrame with sequence {}", frame.sequence);
+		ProcessAckFrame(frame);
+		VERBOSE_LOG("ProcessIncomingFrame: ProcessAckFrame completed");
+		break;
+
+	case FrameType::FRAME_SACK:
+		VERBOSE_LOG("ProcessIncomingFrame: calling ProcessSackFrame with base {}", frame.sequence);
+		ProcessSackFrame(frame);
+		VERBOSE_LOG("ProcessIncomingFrame: ProcessSackFrame completed");
+		break;
+
+	case FrameType::FRAME_NAK:
+		VERBOSE_LOG("ProcessIncomingFrame: calling ProcessNakFrame with sequence {}", frame.sequence);
+		ProcessNakFrame(frame.sequence);
+		VERBOSE_LOG("ProcessIncomingFrame: ProcessNakFrame completed");
+		break;
+
+	case FrameType::FRAME_START:
+		VERBOSE_LOG("ProcessIncomingFrame: calling ProcessStartFrame");
+		ProcessStartFrame(frame);
+		VERBOSE_LOG("ProcessIncomingFrame: ProcessStartFrame completed");
+		break;
+
+	case FrameType::FRAME_END:
+		VERBOSE_LOG("ProcessIncomingFrame: calling ProcessEndFrame");
+		ProcessEndFrame(frame);
+		VERBOSE_LOG("ProcessIncomingFrame: ProcessEndFrame completed");
+		break;
+
+	case FrameType::FRAME_HEARTBEAT:
+		VERBOSE_LOG("ProcessIncomingFrame: calling ProcessHeartbeatFrame");
+		ProcessHeartbeatFrame(frame);
+		VERBOSE_LOG("ProcessIncomingFrame: ProcessHeartbeatFrame completed");
+		break;
+
+	case FrameType::FRAME_PARITY:
+		ProcessParityFrame(frame);
+		break;
+
+	default:
+		VERBOSE_LOG("ProcessIncomingFrame: unknown frame type {}", static_cast<int>(frame.type));
+		// 未知帧类型，记录错误
+		ReportError("未知帧类型: " + std::to_string(static_cast<int>(frame.type)));
+		break;
+	}
+
+	VERBOSE_LOG("ProcessIncomingFrame: completed processing frame");
+}
+
+// 处理数据帧
+void ReliableChannel::ProcessDataFrame(const Frame& frame)
+{
+	VERBOSE_LOG("ProcessDataFrame called: sequence={}, payload.size()={}, receiveBase={}, windowSize={}",
+		frame.sequence, frame.payload.size(), m_receiveBase, m_config.windowSize);
+
+	// 流式压缩帧依赖前序帧字典，暂存压缩形式，按序交付时还原；进度按原始大小统计
+	const bool streamEncoded = (frame.type == FrameType::FRAME_DATA_STREAM);
+	size_t dataSize = frame.payload.size();
+	if (streamEncoded)
+	{
+		dataSize = 0;
+		if (frame.payload.size() > STREAM_FRAME_HEADER_SIZE)
+		{
+			dataSize = static_cast<size_t>(frame.payload[0]) |
+				(static_cast<size_t>(frame.payload[1]) << 8) |
+				(static_cast<size_t>(frame.payload[2]) << 16) |
+				(static_cast<size_t>(frame.payload[3]) << 24);
+		}
+
+		// 原始大小不超过本端最大负载（握手时已告知对端）
+		if (dataSize == 0 || dataSize > (std::min)(static_cast<size_t>(m_config.maxPayloadSize), FrameCodec::MAX_PAYLOAD_SIZE_V2))
+		{
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			m_stats.packetsInvalid++;
+			WriteLog("ProcessDataFrame: ERROR - invalid stream frame header, sequence=" + std::to_string(frame.sequence));
+			return;
+		}
+	}
+
+	// 检查序列号是否在接收窗口内
+	bool inWindow = IsSequenceInWindow(frame.sequence, m_receiveBase, m_config.windowSize);
+	VERBOSE_LOG("ProcessDataFrame: sequence in window check: {}, window range=[{},{})", inWindow, m_receiveBase, m_receiveBase + m_config.windowSize);
+
+	if (!inWindow)
+	{
+		uint32_t expected = m_receiveBase;
+		uint32_t lastAck = (expected - 1) & m_sequenceMask.load();
+
+		VERBOSE_LOG("ProcessDataFrame: sequence outside window, expected={}, received={}, sending duplicate ACK", expected, frame.sequence);
+
+		// 已交付的旧包说明其ACK丢失，直接确认该序列；否则再次确认最后一次成功的序列，提示对端重发缺失的数据
+		ScheduleAck(IsSequenceBefore(frame.sequence, expected) ? frame.sequence : lastAck);
+		return;
+	}
+
+	VERBOSE_LOG("ProcessDataFrame: sequence in window, processing...");
+
+	// 将数据放入接收窗口
+	{
+		std::lock_guard<std::mutex> lock(m_windowMutex);
+		VERBOSE_LOG("ProcessDataFrame: locked window mutex");
+
+		// 确保窗口大小有效
+		if (m_config.windowSize == 0 || m_receiveWindow.empty())
+		{
+			WriteLog("ProcessDataFrame: ERROR - receive window not initialized or size is 0");
+			ReportError("接收窗口未初始化或大小为0");
+			return;
+		}
+
+		uint32_t index = frame.sequence % m_config.windowSize;
+		VERBOSE_LOG("ProcessDataFrame: calculated index={}, receiveWindow.size()={}", index, m_receiveWindow.size());
+
+		// 边界检查
+		if (index >= m_receiveWindow.size())
+		{
+			WriteLog("ProcessDataFrame: ERROR - receive window index out of bounds: " + std::to_string(index) +
+				" >= " + std::to_string(m_receiveWindow.size()));
+			ReportError("接收窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_receiveWindow.size()));
+			return;
+		}
+
+		// 【P0修复】检查窗口slot是否已有该序列号的数据（去重保护）
+		if (m_receiveWindow[index].inUse &&
+			m_receiveWindow[index].packet &&
+			m_receiveWindow[index].packet->sequence == frame.sequence)
+		{
+			// 这是重传数据，已经处理过，只需重新发送ACK
+			VERBOSE_LOG("ProcessDataFrame: 检测到重传数据seq={}，跳过重复处理，仅发送ACK", frame.sequence);
+			ScheduleAck(frame.sequence);
+			return;
+		}
+
+		// 【P0修复】只有新数据才更新slot和进度
+		VERBOSE_LOG("ProcessDataFrame: setting window slot {} to inUse=true", index);
+		m_receiveWindow[index].inUse = true;
+
+		if (!m_receiveWindow[index].packet)
+		{
+			VERBOSE_LOG("ProcessDataFrame: creating new packet for slot {}", index);
+			m_receiveWindow[index].packet = std::make_shared<Packet>();
+		}
+
+		// 负载拷入包缓冲区，此后交付到接收队列只传递引用
+		PacketRef buffer = m_packetPool.Acquire(frame.payload.size());
+		buffer->Assign(frame.payload.data(), frame.payload.size());
+		m_receiveWindow[index].packet->sequence = frame.sequence;
+		m_receiveWindow[index].packet->buffer = std::move(buffer);
+		m_receiveWindow[index].packet->dataSize = dataSize;
+		m_receiveWindow[index].packet->streamEncoded = streamEncoded;
+
+		// 有序包到达，唤醒接收线程交付
+		if (frame.sequence == m_receiveBase)
+		{
+			m_deliveryCondition.notify_one();
+		}
+
+		// ✅ 只有首次接收才更新进度（交付时不再重复累计）
+		{
+			std::lock_guard<std::mutex> receiveLock(m_receiveMutex);
+			m_currentFileProgress += dataSize;
+			if (m_currentFileSize > 0 && m_currentFileProgress > m_currentFileSize)
+			{
+				m_currentFileProgress = m_currentFileSize;
+			}
+		}
+
+		VERBOSE_LOG("ProcessDataFrame: 新数据seq={}, size={}, progress={}/{}", frame.sequence, dataSize, m_currentFileProgress, m_currentFileSize);
+	}
+
+	VERBOSE_LOG("ProcessDataFrame: window update completed, sending ACK");
+
+	// 发送ACK（SACK模式下合并发送）
+	ScheduleAck(frame.sequence);
+
+	// 更新统计
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.bytesReceived += frame.payload.size();
+		VERBOSE_LOG("ProcessDataFrame: stats updated, bytesReceived={}", m_stats.bytesReceived);
+	}
+
+	VERBOSE_LOG("ProcessDataFrame: completed successfully");
+}
+
+// 处理ACK帧
+void ReliableChannel::ProcessAckFrame(const Frame& frame)
+{
+	uint32_t sequence = frame.sequence;
+	VERBOSE_LOG("ProcessAckFrame called: sequence={}, sendBase={}, windowSize={}", sequence, m_sendBase, m_config.windowSize);
+
+	std::lock_guard<std::mutex> lock(m_windowMutex);
+	VERBOSE_LOG("ProcessAckFrame: locked window mutex");
+
+	// 确保窗口大小有效
+	if (m_config.windowSize == 0 || m_sendWindow.empty())
+	{
+		WriteLog("ProcessAckFrame: ERROR - send window not initialized or size is 0");
+		ReportError("发送窗口未初始化或大小为0");
+		return;
+	}
+
+	// 在发送窗口中查找对应的包
+	uint32_t index = sequence % m_config.windowSize;
+	VERBOSE_LOG("ProcessAckFrame: calculated index={}, sendWindow.size()={}", index, m_sendWindow.size());
+
+	// 边界检查
+	if (index >= m_sendWindow.size())
+	{
+		WriteLog("ProcessAckFrame: ERROR - send window index out of bounds: " + std::to_string(index) +
+			" >= " + std::to_string(m_sendWindow.size()));
+		ReportError("发送窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_sendWindow.size()));
+		return;
+	}
+
+	VERBOSE_LOG("ProcessAckFrame: checking slot {}, inUse={}", index, m_sendWindow[index].inUse);
+
+	if (m_sendWindow[index].inUse && m_sendWindow[index].packet &&
+		m_sendWindow[index].packet->sequence == sequence && !m_sendWindow[index].packet->acknowledged)
+	{
+		VERBOSE_LOG("ProcessAckFrame: processing ACK for packet {}", sequence);
+
+		// START帧的ACK携带对端协商结果，须在唤醒握手等待方之前生效
+		if (sequence == m_handshakeSequence.load() && !m_handshakeCompleted.load())
+		{
+			ApplyStartAckLocked(frame.payload);
+		}
+
+		AcknowledgePacketLocked(index);
+
+		// 推进发送窗口
+		VERBOSE_LOG("ProcessAckFrame: calling AdvanceSendWindow");
+		AdvanceSendWindow();
+		VERBOSE_LOG("ProcessAckFrame: AdvanceSendWindow completed");
+	}
+	else
+	{
+		VERBOSE_LOG("ProcessAckFrame: ACK not processed - inUse={}, hasPacket={}, sequenceMatch={}, alreadyAcked={}",
+			m_sendWindow[index].inUse, m_sendWindow[index].packet != nullptr, m_sendWindow[index].packet && m_sendWindow[index].packet->sequence == sequence, m_sendWindow[index].packet && m_sendWindow[index].packet->acknowledged);
+		if (m_sendWindow[index].packet)
+		{
+			VERBOSE_LOG("ProcessAckFrame: slot sequence={}, expected={}", m_sendWindow[index].packet->sequence, sequence);
+		}
+	}
+
+	VERBOSE_LOG("ProcessAckFrame: completed");
+}
+
+// 确认发送窗口中的包（调用方已持有窗口锁），返回是否为新确认
+bool ReliableChannel::AcknowledgePacketLocked(size_t index)
+{
+	if (index >= m_sendWindow.size() || !m_sendWindow[index].inUse || !m_sendWindow[index].packet ||
+		m_sendWindow[index].packet->acknowledged)
+	{
+		return false;
+	}
+
+	const std::shared_ptr<Packet>& packet = m_sendWindow[index].packet;
+	uint32_t sequence = packet->sequence;
+
+	// 标记为已确认
+	packet->acknowledged = true;
+	CancelRetransmitTimerLocked(packet);
+	VERBOSE_LOG("AcknowledgePacketLocked: packet marked as acknowledged");
+
+	// 更新RTT（Karn算法：重传过的包无法区分确认对应哪次发送，不参与采样）
+	auto now = std::chrono::steady_clock::now();
+	auto rtt = std::chrono::duration_cast<std::chrono::milliseconds>(
+		now - packet->timestamp)
+		.count();
+	bool rttSampleValid = (packet->retryCount == 0);
+	VERBOSE_LOG("AcknowledgePacketLocked: calculated RTT={}ms, sampleValid={}", rtt, rttSampleValid);
+	if (rttSampleValid)
+	{
+		UpdateRTT(static_cast<uint32_t>(rtt));
+	}
+	OnCongestionAckLocked(static_cast<uint32_t>(rtt), rttSampleValid);
+
+	// 【P1优化】更新发送进度（基于ACK）
+	size_t dataSize = packet->dataSize;
+	int64_t ackedBytes = m_sendBytesAcked.fetch_add(dataSize) + dataSize;
+
+	// 回调进度更新（仅在文件传输活跃时）
+	if (m_fileTransferActive && m_progressCallback && m_sendTotalBytes > 0)
+	{
+		UpdateProgress(ackedBytes, m_sendTotalBytes);
+		VERBOSE_LOG("AcknowledgePacketLocked: 发送进度={}/{} ({}%)", ackedBytes, m_sendTotalBytes, (ackedBytes * 100) / m_sendTotalBytes);
+	}
+
+	// 【关键修复4】检查是否为握手帧的ACK
+	uint32_t handshakeSeq = m_handshakeSequence.load();
+	if (sequence == handshakeSeq && !m_handshakeCompleted.load())
+	{
+		VERBOSE_LOG("AcknowledgePacketLocked: received ACK for handshake START frame (sequence={})", sequence);
+
+		// 设置握手完成标志
+		m_handshakeCompleted.store(true);
+
+		// 通知等待握手完成的线程
+		{
+			std::lock_guard<std::mutex> handshakeLock(m_handshakeMutex);
+			m_handshakeCondition.notify_all();
+		}
+
+		VERBOSE_LOG("AcknowledgePacketLocked: handshake completed, sessionId={}", m_sessionId.load());
+	}
+
+	return true;
+}
+
+// 处理SACK帧：累计确认base之前的所有包，按位图确认乱序到达的包，并快速重传空洞
+void ReliableChannel::ProcessSackFrame(const Frame& frame)
+{
+	uint32_t base = frame.sequence;
+	uint16_t bitmapWindow = 0;
+	std::vector<uint8_t>& bitmap = m_sackBitmap;
+
+	if (!m_frameCodec->DecodeSackPayload(frame.payload, bitmapWindow, bitmap))
+	{
+		WriteLog("ProcessSackFrame: ERROR - invalid SACK payload, size=" + std::to_string(frame.payload.size()));
+		std::lock_guard<std::mutex> statsLock(m_statsMutex);
+		m_stats.packetsInvalid++;
+		return;
+	}
+
+	VERBOSE_LOG("ProcessSackFrame called: base={}, bitmapWindow={}, sendBase={}", base, bitmapWindow, m_sendBase);
+
+	std::lock_guard<std::mutex> lock(m_windowMutex);
+
+	if (m_config.windowSize == 0 || m_sendWindow.empty())
+	{
+		WriteLog("ProcessSackFrame: ERROR - send window not initialized or size is 0");
+		ReportError("发送窗口未初始化或大小为0");
+		return;
+	}
+
+	// 记录对端接收窗口基（只前移）及窗口大小，窗口前移时唤醒等待发送的线程
+	if (!m_peerWindowKnown || IsSequenceBefore(m_peerReceiveBase, base))
+	{
+		m_peerWindowKnown = true;
+		m_peerReceiveBase = base;
+		m_windowCondition.notify_all();
+	}
+	if (bitmapWindow > 0)
+	{
+		m_peerWindowSize = bitmapWindow;
+	}
+
+	auto isBitSet = [&bitmap, bitmapWindow](uint16_t offset) {
+		return offset < bitmapWindow && (bitmap[offset / 8] & (1u << (offset % 8))) != 0;
+	};
+
+	// 位图中最高的已收到位置，低于它的未确认包视为丢失
+	int highestReceived = -1;
+	for (int offset = static_cast<int>(bitmapWindow) - 1; offset >= 0; offset--)
+	{
+		if (isBitSet(static_cast<uint16_t>(offset)))
+		{
+			highestReceived = offset;
+			break;
+		}
+	}
+
+	int ackedCount = 0;
+	int retransmitCount = 0;
+	auto now = std::chrono::steady_clock::now();
+
+	for (size_t index = 0; index < m_sendWindow.size(); index++)
+	{
+		WindowSlot& slot = m_sendWindow[index];
+		if (!slot.inUse || !slot.packet || slot.packet->acknowledged)
+		{
+			continue;
+		}
+
+		uint32_t sequence = slot.packet->sequence;
+		uint32_t offset = GetWindowDistance(base, sequence);
+
+		// 序列号位于base之前（半个序列空间内）即为累计确认
+		bool cumulative = IsSequenceBefore(sequence, base);
+		if (cumulative || (offset < bitmapWindow && isBitSet(static_cast<uint16_t>(offset))))
+		{
+			if (AcknowledgePacketLocked(index))
+			{
+				ackedCount++;
+			}
+			continue;
+		}
+
+		// 空洞：其后已有包到达，且距上次发送已超过一个RTT，立即重传而不等待超时
+		if (static_cast<int>(offset) < highestReceived && slot.packet->retryCount < m_config.maxRetries)
+		{
+			auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - slot.packet->timestamp).count();
+			if (elapsed >= static_cast<long long>((std::max)(m_rttMs, 1u)))
+			{
+				VERBOSE_LOG("ProcessSackFrame: fast retransmit hole sequence={}", sequence);
+				m_retransmitting = true;
+				RetransmitPacketInternal(sequence);
+				m_retransmitting = false;
+				retransmitCount++;
+			}
+		}
+	}
+
+	if (retransmitCount > 0)
+	{
+		// 【AIMD】SACK空洞表明链路丢包，按拥塞处理
+		OnCongestionLossLocked();
+
+		std::lock_guard<std::mutex> statsLock(m_statsMutex);
+		m_stats.fastRetransmits += retransmitCount;
+	}
+
+	VERBOSE_LOG("ProcessSackFrame: acked={}, fastRetransmits={}", ackedCount, retransmitCount);
+
+	if (ackedCount > 0)
+	{
+		AdvanceSendWindow();
+	}
+
+	ArmWindowProbeLocked();
+}
+
+// 处理NAK帧
+void ReliableChannel::ProcessNakFrame(uint32_t sequence)
+{
+	VERBOSE_LOG("ProcessNakFrame called: sequence={}, sendBase={}, windowSize={}", sequence, m_sendBase, m_config.windowSize);
+
+	std::lock_guard<std::mutex> lock(m_windowMutex);
+	VERBOSE_LOG("ProcessNakFrame: locked window mutex");
+
+	// 确保窗口大小有效
+	if (m_config.windowSize == 0 || m_sendWindow.empty())
+	{
+		WriteLog("ProcessNakFrame: ERROR - send window not initialized or size is 0");
+		ReportError("发送窗口未初始化或大小为0");
+		return;
+	}
+
+	// 重传对应的包
+	uint32_t index = sequence % m_config.windowSize;
+	VERBOSE_LOG("ProcessNakFrame: calculated index={}, sendWindow.size()={}", index, m_sendWindow.size());
+
+	// 边界检查
+	if (index >= m_sendWindow.size())
+	{
+		WriteLog("ProcessNakFrame: ERROR - send window index out of bounds: " + std::to_string(index) +
+			" >= " + std::to_string(m_sendWindow.size()));
+		ReportError("发送窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_sendWindow.size()));
+		return;
+	}
+
+	VERBOSE_LOG("ProcessNakFrame: checking slot {}, inUse={}", index, m_sendWindow[index].inUse);
+
+	if (m_sendWindow[index].inUse && m_sendWindow[index].packet &&
+		m_sendWindow[index].packet->sequence == sequence)
+	{
+		VERBOSE_LOG("ProcessNakFrame: retransmitting packet {}", sequence);
+		m_retransmitting = true; // 设置重传标志
+		RetransmitPacketInternal(sequence); // 使用内部版本，已持有锁
+		m_retransmitting = false; // 清除重传标志
+		VERBOSE_LOG("ProcessNakFrame: retransmission completed");
+	}
+	else
+	{
+		VERBOSE_LOG("ProcessNakFrame: NAK not processed - inUse={}, hasPacket={}, sequenceMatch={}",
+			m_sendWindow[index].inUse, m_sendWindow[index].packet != nullptr, m_sendWindow[index].packet && m_sendWindow[index].packet->sequence == sequence);
+	}
+
+	VERBOSE_LOG("ProcessNakFrame: completed");
+}
+
+// 处理开始帧
+void ReliableChannel::ProcessStartFrame(const Frame& frame)
+{
+	VERBOSE_LOG("ProcessStartFrame called: sequence={}, payload.size()={}", frame.sequence, frame.payload.size());
+
+	StartMetadata metadata;
+	if (m_frameCodec->DecodeStartMetadata(frame.payload, metadata))
+	{
+		VERBOSE_LOG("ProcessStartFrame: metadata decoded successfully - fileName={}, fileSize={}, version={}",
+			metadata.fileName, metadata.fileSize, metadata.version);
+
+		// 【SACK】对端声明支持且本端启用时，改用SACK合并确认
+		m_peerSelectiveAck.store(m_config.enableSelectiveAck && (metadata.flags & START_FLAG_SELECTIVE_ACK) != 0);
+		VERBOSE_LOG("ProcessStartFrame: selective ACK {}", m_peerSelectiveAck.load() ? "enabled" : "disabled");
+
+		// 【协议协商】双方均支持v2时切换为32位序列号帧格式，并记录对端窗口与负载上限
+		uint8_t negotiatedVersion = (m_config.version >= PROTOCOL_VERSION_2 && metadata.version >= PROTOCOL_VERSION_2)
+			? PROTOCOL_VERSION_2 : PROTOCOL_VERSION_1;
+		{
+			std::lock_guard<std::mutex> lock(m_windowMutex);
+			ApplyProtocolVersionLocked(negotiatedVersion);
+			m_peerWindowSize = metadata.windowSize;
+			m_peerMaxPayloadSize = metadata.maxPayloadSize;
+
+			// 新会话的流式帧只引用本会话的数据，字典随START重置
+			m_streamDecoder.Reset();
+			m_streamDecodeActive = (metadata.flags & START_FLAG_COMPRESSION) && (metadata.flags & START_FLAG_STREAM_COMPRESSION);
+
+			// 流不跨会话，上一会话未结束的流以失败结束
+			AbortReceiveStreamsLocked();
+			m_muxReceiveActive = m_config.enableMultiplexing && negotiatedVersion >= PROTOCOL_VERSION_2 &&
+				(metadata.flags & START_FLAG_MULTIPLEX) != 0;
+		}
+
+		// 校验组不跨会话
+		m_fecReceiveActive = (metadata.flags & START_FLAG_FEC) != 0;
+		for (FecCacheEntry& entry : m_fecCache)
+		{
+			entry.payload.reset();
+		}
+		if (m_fecReceiveActive && m_fecCache.empty())
+		{
+			m_fecCache.resize(FEC_RECEIVE_CACHE_SIZE);
+		}
+		VERBOSE_LOG("ProcessStartFrame: negotiated protocol version={}, peerWindow={}, peerMaxPayload={}",
+			negotiatedVersion, metadata.windowSize, metadata.maxPayloadSize);
+
+		// 数据落地（空文件名为纯握手，不涉及文件）：上一次传输未结束时先以未完成结束，再为本次传输打开sink
+		// 断点续传：sink从检查点恢复时给出已落地的字节数，经START帧ACK通知发送端
+		bool sinkReady = false;
+		int64_t resumeOffset = 0;
+		if (!metadata.fileName.empty())
+		{
+			FinishReceiveSink(false);
+			std::shared_ptr<IReceiveSink> sink;
+			{
+				std::lock_guard<std::mutex> lock(m_receiveMutex);
+				sink = m_receiveSink;
+			}
+
+			ReceiveFileInfo info;
+			info.fileName = metadata.fileName;
+			info.fileSize = static_cast<int64_t>(metadata.fileSize);
+			info.modifyTime = metadata.modifyTime;
+			info.fileHash = metadata.fileHash;
+			info.sessionId = metadata.sessionId;
+			info.resumable = m_config.enableResume && (metadata.flags & START_FLAG_RESUME) != 0;
+
+			sinkReady = sink && sink->Begin(info, resumeOffset);
+			if (sink && !sinkReady)
+			{
+				ReportError("接收数据落地打开失败，改用内存缓冲: " + metadata.fileName);
+			}
+			if (!sinkReady || !info.resumable || resumeOffset < 0 || resumeOffset > info.fileSize)
+			{
+				resumeOffset = 0;
+			}
+			if (resumeOffset > 0)
+			{
+				WriteLog("ProcessStartFrame: resuming " + metadata.fileName + " at offset " + std::to_string(resumeOffset));
+			}
+		}
+
+		// 设置文件传输信息
+		{
+			std::lock_guard<std::mutex> lock(m_receiveMutex);
+			m_currentFileName = metadata.fileName;
+			m_currentFileSize = metadata.fileSize;
+			m_currentFileProgress = resumeOffset;
+			m_fileTransferActive = true; // 激活文件传输状态
+			m_transferStartTime = std::chrono::steady_clock::now(); // 记录传输开始时间
+			m_completedFileBuffer.clear();
+			m_hasCompletedFile = false;
+			m_receiveSinkActive = sinkReady;
+			m_receiveSinkFailed = false;
+		}
+
+		// 更新进度显示
+		UpdateProgress(resumeOffset, metadata.fileSize);
+
+		// 【关键修复】发送 ACK 响应，建立握手闭环
+		VERBOSE_LOG("ProcessStartFrame: sending ACK response to establish handshake");
+		if (SendStartAck(frame.sequence, metadata, static_cast<uint64_t>(resumeOffset)))
+		{
+			VERBOSE_LOG("ProcessStartFrame: ACK sent successfully, handshake established");
+
+			// 【新增】同步接收窗口基准到START帧序列号 - 解决NAK风暴问题
+			{
+				std::lock_guard<std::mutex> lock(m_windowMutex);
+				VERBOSE_LOG("ProcessStartFrame: synchronizing receive window base from {} to {}", m_receiveBase, NextSequence(frame.sequence));
+
+				// 将接收基准设置为START帧的下一个序列号，确保与发送方一致
+				uint32_t newBase = NextSequence(frame.sequence);
+				m_receiveBase = newBase;
+				m_receiveNext = newBase;
+
+				VERBOSE_LOG("ProcessStartFrame: receive window synchronized, new base={}, new next={}", m_receiveBase, m_receiveNext);
+			}
+
+			// 推动接收端状态机 - 准备接收数据
+			VERBOSE_LOG("ProcessStartFrame: receiver ready for data transmission");
+		}
+		else
+		{
+			WriteLog("ProcessStartFrame: ERROR - failed to send ACK response");
+			ReportError("START帧ACK响应发送失败");
+		}
+	}
+	else
+	{
+		WriteLog("ProcessStartFrame: ERROR - failed to decode START metadata");
+		ReportError("START帧元数据解析失败");
+
+		// 发送 NAK 表示协商失败
+		SendNak(frame.sequence);
+	}
+}
+
+// 处理结束帧
+void ReliableChannel::ProcessEndFrame(const Frame& frame)
+{
+	VERBOSE_LOG("ProcessEndFrame: 收到END帧，验证传输完整性...");
+
+	// 检查是否有预期的文件大小信息
+	if (m_currentFileSize > 0)
+	{
+		// 【修复】计算字节差异
+		int64_t byteDifference = static_cast<int64_t>(m_currentFileSize) - static_cast<int64_t>(m_currentFileProgress);
+
+		// 【修复】±1KB 容错范围
+		const int64_t TOLERANCE_BYTES = 1024; // 1KB 容错
+		bool withinTolerance = (byteDifference >= -TOLERANCE_BYTES && byteDifference <= TOLERANCE_BYTES);
+
+		VERBOSE_LOG("ProcessEndFrame: 字节差异 = {} 字节，容错范围 ±{} 字节", byteDifference, TOLERANCE_BYTES);
+
+		// 验证实际接收字节数与预期文件大小是否匹配（带容错）
+		if (withinTolerance)
+		{
+			VERBOSE_LOG("ProcessEndFrame: 传输完整性验证通过（容错范围内） - {}/{} 字节", m_currentFileProgress, m_currentFileSize);
+
+			// 清除传输活跃状态（先写完落地数据，等待方看到结束时文件已完整）
+			FinishReceiveSink(true);
+			m_fileTransferActive = false;
+			m_shortTimeoutActive = false;
+
+			// 更新进度到100%
+			UpdateProgress(m_currentFileSize, m_currentFileSize);
+			m_hasCompletedFile = true;
+
+			VERBOSE_LOG("ProcessEndFrame: 文件传输正常完成");
+
+			// 【新增】触发传输完成回调
+			if (m_completeCallback)
+			{
+				VERBOSE_LOG("ProcessEndFrame: 调用完成回调，成功=true");
+				m_completeCallback(true);
+			}
+		}
+		else if (byteDifference > TOLERANCE_BYTES)
+		{
+			// 数据不足，启动短超时机制
+			if (!m_shortTimeoutActive)
+			{
+				VERBOSE_LOG("ProcessEndFrame: 传输不完整（差 {} 字节），启动30秒短超时等待更多数据", byteDifference);
+				m_shortTimeoutActive = true;
+				m_shortTimeoutStart = std::chrono::steady_clock::now();
+
+				// 到期时由定时器重新检查，无需等待对端再次发送END帧
+				m_timerQueue.Schedule(m_shortTimeoutStart + std::chrono::seconds(m_shortTimeoutDuration),
+					[this] { OnShortTimeoutTimer(); });
+			}
+			else
+			{
+				// 检查短超时是否到期
+				auto now = std::chrono::steady_clock::now();
+				auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - m_shortTimeoutStart);
+
+				if (elapsed.count() >= m_shortTimeoutDuration)
+				{
+					VERBOSE_LOG("ProcessEndFrame: 短超时到期（{}秒），强制结束传输，数据差异 {} 字节", elapsed.count(), byteDifference);
+
+					// 强制结束传输
+					FinishReceiveSink(false);
+					m_fileTransferActive = false;
+					m_shortTimeoutActive = false;
+					m_hasCompletedFile = true;  // 标记为有数据（尽管不完整）
+
+					ReportError("文件传输不完整（短超时），预期 " + std::to_string(m_currentFileSize) +
+						" 字节，实际接收 " + std::to_string(m_currentFileProgress) + " 字节");
+
+					// 【新增】触发传输完成回调（失败）
+					if (m_completeCallback)
+					{
+						VERBOSE_LOG("ProcessEndFrame: 调用完成回调，成功=false（短超时）");
+						m_completeCallback(false);
+					}
+				}
+				else
+				{
+					VERBOSE_LOG("ProcessEndFrame: 短超时进行中（{}/{}秒），继续等待数据", elapsed.count(), m_shortTimeoutDuration);
+				}
+			}
+		}
+		else
+		{
+			// 数据超过预期（负差异超过容错）
+			VERBOSE_LOG("ProcessEndFrame: 接收数据超过预期（多 {} 字节），仍认为传输完成", -byteDifference);
+
+			// 清除传输活跃状态
+			FinishReceiveSink(true);
+			m_fileTransferActive = false;
+			m_shortTimeoutActive = false;
+
+			// 更新进度
+			UpdateProgress(m_currentFileProgress, m_currentFileProgress);
+			m_hasCompletedFile = true;
+
+			VERBOSE_LOG("ProcessEndFrame: 文件传输完成（数据超额）");
+
+			// 【新增】触发传输完成回调
+			if (m_completeCallback)
+			{
+				VERBOSE_LOG("ProcessEndFrame: 调用完成回调，成功=true（数据超额）");
+				m_completeCallback(true);
+			}
+		}
+	}
+	else
+	{
+		VERBOSE_LOG("ProcessEndFrame: 无文件大小信息，使用传统逻辑结束传输");
+		FinishReceiveSink(true);
+		m_fileTransferActive = false;
+		m_shortTimeoutActive = false;
+		UpdateProgress(m_currentFileProgress, m_currentFileProgress);
+		{
+			std::lock_guard<std::mutex> lock(m_receiveMutex);
+			m_hasCompletedFile = !m_completedFileBuffer.empty();
+		}
+		VERBOSE_LOG("ProcessEndFrame: 传统模式传输结束");
+
+		// 【新增】触发传输完成回调
+		if (m_completeCallback)
+		{
+			VERBOSE_LOG("ProcessEndFrame: 调用完成回调，成功=true（传统模式）");
+			m_completeCallback(true);
+		}
+	}
+
+	VERBOSE_LOG("ProcessEndFrame: 处理完成，当前传输状态 = {}", m_fileTransferActive ? "活跃" : "已结束");
+}
+
+// 处理心跳帧
+void ReliableChannel::ProcessHeartbeatFrame(const Frame& frame)
+{
+	// 心跳帧不需要特殊处理，只需要更新活动时间
+
+	// 【SACK】心跳兼作窗口探测：回复当前接收窗口，防止窗口更新丢失导致对端停滞
+	if (m_peerSelectiveAck.load())
+	{
+		m_sackPending = true;
+	}
+}
+
+// 发送数据包
+bool ReliableChannel::SendPacket(uint32_t sequence, PacketRef packet, FrameType type)
+{
+	std::unique_lock<std::mutex> lock(m_windowMutex);
+	return SendPacketLocked(lock, sequence, std::move(packet), type);
+}
+
+// 【新增】内部版本：要求调用方必须已经持有m_windowMutex锁
+bool ReliableChannel::SendPacketLocked(std::unique_lock<std::mutex>& lock, uint32_t sequence, PacketRef packet, FrameType type)
+{
+	VERBOSE_LOG("SendPacketLocked called: sequence={}, data.size()={}, type={}", sequence, packet->GetPayloadSize(), static_cast<int>(type));
+
+	switch (type)
+	{
+	case FrameType::FRAME_DATA:
+	case FrameType::FRAME_START:
+	case FrameType::FRAME_END:
+	case FrameType::FRAME_HEARTBEAT:
+		break;
+	default:
+		WriteLog("SendPacketLocked: ERROR - unknown frame type " + std::to_string(static_cast<int>(type)));
+		return false;
+	}
+
+	// 数据帧在编码前压缩（对端已确认支持时），无收益的帧按原样发送；进度按未压缩大小统计
+	const bool isData = (type == FrameType::FRAME_DATA);
+	size_t dataSize = packet->GetPayloadSize();
+	if (isData && m_multiplexActive.load())
+	{
+		// 多路复用时进度只统计流数据，不含流头与OPEN/CLOSE记录
+		bool streamData = dataSize > MUX_HEADER_SIZE && packet->Payload()[2] == static_cast<uint8_t>(MuxRecordType::MUX_DATA);
+		dataSize = streamData ? dataSize - MUX_HEADER_SIZE : 0;
+	}
+	if (isData && m_streamCompressionActive.load())
+	{
+		type = StreamCompressPayloadLocked(*packet, sequence);
+	}
+	else if (isData && m_compressionActive.load())
+	{
+		type = CompressPayloadLocked(*packet);
+	}
+
+	// 编码帧：帧头帧尾直接写在包缓冲区负载两侧，重传时原样写出
+	VERBOSE_LOG("SendPacketLocked: encoding frame...");
+	uint8_t* frameStart = nullptr;
+	size_t frameSize = m_frameCodec->EncodeFrameInPlace(type, sequence, packet->Payload(), packet->GetPayloadSize(), frameStart);
+	packet->SetFrame(frameStart, frameSize);
+
+	VERBOSE_LOG("SendPacketLocked: frame encoded, frameData.size()={}", frameSize);
+
+	// 对于数据帧，需要保存到发送窗口（调用方已持有m_windowMutex锁）
+	// 【修复】先入窗口再写传输层，避免低延迟链路上ACK先于窗口更新到达而被丢弃，引发假重传
+	uint32_t index = 0;
+	if (isData)
+	{
+		VERBOSE_LOG("SendPacketLocked: saving to send window (caller already holds lock)...");
+
+		// 确保窗口大小有效
+		if (m_config.windowSize == 0 || m_sendWindow.empty())
+		{
+			WriteLog("SendPacketLocked: ERROR - window not initialized or size is 0");
+			ReportError("发送窗口未初始化或大小为0");
+			return false;
+		}
+
+		index = sequence % m_config.windowSize;
+		VERBOSE_LOG("SendPacketLocked: calculated index={}, windowSize={}", index, m_config.windowSize);
+
+		// 边界检查
+		if (index >= m_sendWindow.size())
+		{
+			WriteLog("SendPacketLocked: ERROR - index out of bounds: " + std::to_string(index) +
+				" >= " + std::to_string(m_sendWindow.size()));
+			ReportError("发送窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_sendWindow.size()));
+			return false;
+		}
+
+		VERBOSE_LOG("SendPacketLocked: setting window slot {} to inUse=true", index);
+		m_sendWindow[index].inUse = true;
+
+		if (!m_sendWindow[index].packet)
+		{
+			VERBOSE_LOG("SendPacketLocked: creating new packet for slot {}", index);
+			m_sendWindow[index].packet = std::make_shared<Packet>();
+		}
+
+		m_sendWindow[index].packet->sequence = sequence;
+		m_sendWindow[index].packet->buffer = packet; // 保存已编码的帧，重传直接复用
+		m_sendWindow[index].packet->dataSize = dataSize;
+		m_sendWindow[index].packet->timestamp = std::chrono::steady_clock::now();
+		m_sendWindow[index].packet->retryCount = 0;
+		m_sendWindow[index].packet->acknowledged = false;
+		ArmRetransmitTimerLocked(m_sendWindow[index].packet);
+
+		VERBOSE_LOG("SendPacketLocked: window slot {} updated successfully", index);
+	}
+
+	// 发送数据
+	VERBOSE_LOG("SendPacketLocked: writing to transport...");
+	size_t written = 0;
+	if (m_transport->Write(packet->GetFrame(), frameSize, &written) != TransportError::Success || written != frameSize)
+	{
+		WriteLog("SendPacketLocked: ERROR - transport write failed or incomplete");
+
+		// 写入失败，释放刚占用的窗口槽位
+		if (isData)
+		{
+			CancelRetransmitTimerLocked(m_sendWindow[index].packet);
+			m_sendWindow[index].Release();
+			m_windowCondition.notify_all();
+		}
+		return false;
+	}
+
+	VERBOSE_LOG("SendPacketLocked: transport write succeeded, {} bytes written", written);
+
+	// 首次发送的数据帧按线路形式计入校验组（重传不经过此处）
+	if (isData && m_fecActive.load())
+	{
+		AccumulateParityLocked(sequence, type, packet->Payload(), packet->GetPayloadSize());
+	}
+
+	// 更新统计
+	{
+		std::lock_guard<std::mutex> statsLock(m_statsMutex); // 使用不同的锁名避免冲突
+		m_stats.packetsSent++;
+		m_stats.bytesSent += frameSize;
+		VERBOSE_LOG("SendPacketLocked: stats updated - packetsSent={}, bytesSent={}", m_stats.packetsSent, m_stats.bytesSent);
+	}
+
+	VERBOSE_LOG("SendPacketLocked: completed successfully");
+	return true;
+}
+
+// 发送ACK
+bool ReliableChannel::SendAck(uint32_t sequence)
+{
+	VERBOSE_LOG("SendAck called: sequence={}", sequence);
+
+	// 确认帧无负载，编码到栈上缓冲区
+	uint8_t frameData[FrameCodec::MAX_FRAME_OVERHEAD];
+	size_t frameSize = m_frameCodec->EncodeFrameTo(FrameType::FRAME_ACK, sequence, nullptr, 0, frameData, sizeof(frameData));
+	VERBOSE_LOG("SendAck: frame encoded, size={}", frameSize);
+
+	size_t written = 0;
+	TransportError error = m_transport->Write(frameData, frameSize, &written);
+	bool success = (error == TransportError::Success && written == frameSize);
+
+	VERBOSE_LOG("SendAck: transport write result: error={}, written={}, success={}", static_cast<int>(error), written, success);
+
+	if (success)
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.acksSent++;
+	}
+
+	return success;
+}
+
+// 回复START帧：v2发起方附带协商结果，v1发起方仅回复普通ACK
+bool ReliableChannel::SendStartAck(uint32_t sequence, const StartMetadata& metadata, uint64_t resumeOffset)
+{
+	if (metadata.version < PROTOCOL_VERSION_2)
+	{
+		return SendAck(sequence);
+	}
+
+	StartAckInfo info;
+	info.version = m_protocolVersion.load();
+	info.flags = m_config.enableSelectiveAck ? START_FLAG_SELECTIVE_ACK : 0;
+	info.windowSize = m_config.windowSize;
+	info.maxPayloadSize = m_config.maxPayloadSize;
+
+	// 解压能力总是具备，发送端请求压缩即确认
+	if (metadata.flags & START_FLAG_COMPRESSION)
+	{
+		info.flags |= START_FLAG_COMPRESSION;
+		if (metadata.flags & START_FLAG_STREAM_COMPRESSION)
+		{
+			info.flags |= START_FLAG_STREAM_COMPRESSION;
+		}
+	}
+
+	if (m_config.enableResume && (metadata.flags & START_FLAG_RESUME))
+	{
+		info.flags |= START_FLAG_RESUME;
+		info.resumeOffset = resumeOffset;
+	}
+
+	// 校验帧的恢复只依赖已收到的帧，接收能力总是具备
+	if (metadata.flags & START_FLAG_FEC)
+	{
+		info.flags |= START_FLAG_FEC;
+	}
+
+	if (m_config.enableMultiplexing && info.version >= PROTOCOL_VERSION_2 && (metadata.flags & START_FLAG_MULTIPLEX))
+	{
+		info.flags |= START_FLAG_MULTIPLEX;
+	}
+
+	std::vector<uint8_t> frameData = m_frameCodec->EncodeStartAckFrame(sequence, info);
+
+	size_t written = 0;
+	TransportError error = m_transport->Write(frameData.data(), frameData.size(), &written);
+	bool success = (error == TransportError::Success && written == frameData.size());
+
+	WriteLog("SendStartAck: sequence=" + std::to_string(sequence) + ", version=" + std::to_string(info.version) +
+		", resumeOffset=" + std::to_string(info.resumeOffset) + ", success=" + std::to_string(success));
+
+	if (success)
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.acksSent++;
+	}
+
+	return success;
+}
+
+// 发送SACK：一帧确认整个接收窗口
+bool ReliableChannel::SendSack()
+{
+	uint32_t base = 0;
+	uint16_t windowSize = 0;
+	uint8_t bitmap[MAX_WINDOW_SIZE / 8];
+
+	{
+		std::lock_guard<std::mutex> lock(m_windowMutex);
+
+		if (m_config.windowSize == 0 || m_receiveWindow.empty())
+		{
+			return false;
+		}
+
+		base = m_receiveBase;
+		windowSize = m_config.windowSize;
+		memset(bitmap, 0, (windowSize + 7) / 8);
+
+		for (uint16_t offset = 0; offset < windowSize; offset++)
+		{
+			uint32_t sequence = (base + offset) & m_sequenceMask.load();
+			const WindowSlot& slot = m_receiveWindow[sequence % windowSize];
+			if (slot.inUse && slot.packet && slot.packet->sequence == sequence)
+			{
+				bitmap[offset / 8] |= static_cast<uint8_t>(1u << (offset % 8));
+			}
+		}
+	}
+
+	// 编码到栈上缓冲区，避免每次确认分配内存
+	uint8_t frameData[FrameCodec::MAX_FRAME_OVERHEAD + 2 + MAX_WINDOW_SIZE / 8];
+	size_t frameSize = m_frameCodec->EncodeSackFrameTo(base, windowSize, bitmap, (windowSize + 7) / 8, frameData, sizeof(frameData));
+	if (frameSize == 0)
+	{
+		WriteLog("SendSack: ERROR - SACK frame exceeds max payload size, windowSize=" + std::to_string(windowSize));
+		return false;
+	}
+
+	size_t written = 0;
+	TransportError error = m_transport->Write(frameData, frameSize, &written);
+	bool success = (error == TransportError::Success && written == frameSize);
+
+	VERBOSE_LOG("SendSack: base={}, size={}, success={}", base, frameSize, success);
+
+	if (success)
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.acksSent++;
+	}
+
+	return success;
+}
+
+// 安排确认：SACK模式下仅标记挂起，由处理线程合并发送
+void ReliableChannel::ScheduleAck(uint32_t sequence)
+{
+	if (!m_peerSelectiveAck.load())
+	{
+		SendAck(sequence);
+		return;
+	}
+
+	m_sackPending = true;
+	m_sackPendingCount++;
+}
+
+// 发送挂起的SACK
+void ReliableChannel::FlushPendingAck()
+{
+	if (!m_sackPending)
+	{
+		return;
+	}
+
+	m_sackPending = false;
+	m_sackPendingCount = 0;
+	SendSack();
+}
+
+// 发送NAK
+bool ReliableChannel::SendNak(uint32_t sequence)
+{
+	VERBOSE_LOG("SendNak called: sequence={}", sequence);
+
+	std::vector<uint8_t> frameData = m_frameCodec->EncodeNakFrame(sequence);
+	VERBOSE_LOG("SendNak: frame encoded, size={}", frameData.size());
+
+	size_t written = 0;
+	TransportError error = m_transport->Write(frameData.data(), frameData.size(), &written);
+	bool success = (error == TransportError::Success && written == frameData.size());
+
+	VERBOSE_LOG("SendNak: transport write result: error={}, written={}, success={}", static_cast<int>(error), written, success);
+
+	return success;
+}
+
+// 发送心跳
+bool ReliableChannel::SendHeartbeat()
+{
+	// 使用独立的心跳序列号，不占用数据传输序列号
+	uint32_t sequence = m_heartbeatSequence++;
+	VERBOSE_LOG("SendHeartbeat: using independent heartbeat sequence {}", sequence);
+
+	uint8_t frameData[FrameCodec::MAX_FRAME_OVERHEAD];
+	size_t frameSize = m_frameCodec->EncodeFrameTo(FrameType::FRAME_HEARTBEAT, sequence, nullptr, 0, frameData, sizeof(frameData));
+	size_t written = 0;
+	return m_transport->Write(frameData, frameSize, &written) == TransportError::Success && written == frameSize;
+}
+
+// 发送开始帧
+bool ReliableChannel::SendStart(const std::string& fileName, uint64_t fileSize, uint64_t modifyTime, uint32_t fileHash, uint8_t extraFlags)
+{
+	WriteLog("SendStart called: fileName=" + fileName +
+		", fileSize=" + std::to_string(fileSize) +
+		", modifyTime=" + std::to_string(modifyTime));
+
+	// 【关键修复1】动态生成会话ID，不再写死为0
+	uint16_t sessionId = GenerateSessionId();
+	WriteLog("SendStart: generated sessionId=" + std::to_string(sessionId));
+
+	// 【关键修复2】重置握手状态，准备新的握手过程
+	m_handshakeCompleted.store(false);
+	WriteLog("SendStart: handshake state reset");
+
+	StartMetadata metadata;
+	FillStartMetadata(metadata);
+	metadata.fileName = fileName;
+	metadata.fileSize = fileSize;
+	metadata.modifyTime = modifyTime;
+	metadata.sessionId = sessionId;
+	metadata.flags |= extraFlags;
+
+	// 断点续传：文件传输附带前缀哈希，续传偏移由START帧ACK带回
+	if (m_config.enableResume && metadata.version >= PROTOCOL_VERSION_2 && !fileName.empty())
+	{
+		metadata.flags |= START_FLAG_RESUME;
+		metadata.fileHash = fileHash;
+	}
+	m_resumeOffset = 0;
+
+	// 分配序列号用于START控制帧
+	uint32_t sequence = AllocateSequence();
+	m_handshakeSequence.store(sequence); // 保存握手序列号
+	WriteLog("SendStart: allocated sequence=" + std::to_string(sequence) + " for START frame");
+
+	// 编码开始帧
+	WriteLog("SendStart: encoding START frame...");
+	std::vector<uint8_t> frameData = m_frameCodec->EncodeStartFrame(sequence, metadata);
+	WriteLog("SendStart: frame encoded, size=" + std::to_string(frameData.size()));
+
+	// 【关键修复3】将START帧也存储到发送窗口中以支持ACK匹配
+	{
+		std::lock_guard<std::mutex> lock(m_windowMutex);
+		uint32_t index = sequence % m_config.windowSize;
+
+		// 新会话，等待对端重新通告接收窗口
+		m_peerWindowKnown = false;
+
+		if (index < m_sendWindow.size())
+		{
+			// 创建START控制帧的数据包
+			auto packet = std::make_shared<Packet>(sequence, StoreEncodedFrame(frameData));
+			packet->acknowledged = false;
+
+			m_sendWindow[index].packet = packet;
+			m_sendWindow[index].inUse = true;
+			ArmRetransmitTimerLocked(packet);
+
+			WriteLog("SendStart: START frame stored in send window at index=" + std::to_string(index));
+		}
+		else
+		{
+			WriteLog("SendStart: ERROR - window index out of bounds: " + std::to_string(index));
+			ReportError("发送窗口索引越界");
+			return false;
+		}
+	}
+
+	// 发送帧数据
+	WriteLog("SendStart: sending START frame to transport...");
+	size_t written = 0;
+	TransportError error = m_transport->Write(frameData.data(), frameData.size(), &written);
+	bool success = (error == TransportError::Success && written == frameData.size());
+
+	if (success)
+	{
+		WriteLog("SendStart: START frame sent successfully, " + std::to_string(written) + " bytes written");
+
+		// 更新统计
+		{
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			m_stats.packetsSent++;
+			m_stats.bytesSent += frameData.size();
+		}
+
+		WriteLog("SendStart: START control frame stored in send window for ACK tracking");
+	}
+	else
+	{
+		WriteLog("SendStart: ERROR - failed to send START frame, error=" +
+			std::to_string(static_cast<int>(error)) + ", written=" + std::to_string(written));
+
+		// 发送失败时清理发送窗口
+		{
+			std::lock_guard<std::mutex> lock(m_windowMutex);
+			uint32_t index = sequence % m_config.windowSize;
+			if (index < m_sendWindow.size())
+			{
+				CancelRetransmitTimerLocked(m_sendWindow[index].packet);
+				m_sendWindow[index].Release();
+				m_windowCondition.notify_all();
+			}
+		}
+
+		ReportError("START帧发送失败");
+	}
+
+	return success;
+}
+
+// 发送结束帧
+bool ReliableChannel::SendEnd()
+{
+	std::unique_lock<std::mutex> lock(m_windowMutex);
+	uint32_t sequence = AllocateSequenceLocked(lock);
+	bool sent = SendPacketLocked(lock, sequence, m_packetPool.Acquire(0), FrameType::FRAME_END);
+
+	// 【修复】END帧不等待确认，但占用了发送序列号：登记为已确认的槽位，使发送窗口基能够越过该序列，
+	// 否则窗口基停在END序列，后续传输的在途包数只增不减，拥塞窗口收缩后发送永久阻塞
+	uint32_t index = sequence % m_config.windowSize;
+	if (index < m_sendWindow.size())
+	{
+		WindowSlot& slot = m_sendWindow[index];
+		if (!slot.packet)
+		{
+			slot.packet = std::make_shared<Packet>();
+		}
+		slot.packet->sequence = sequence;
+		slot.packet->buffer.reset();
+		slot.packet->retryCount = 0;
+		slot.packet->acknowledged = true;
+		slot.inUse = true;
+		AdvanceSendWindow();
+	}
+
+	return sent;
+}
+
+// 将已编码的START帧存入包缓冲区，重传时原样写出
+PacketRef ReliableChannel::StoreEncodedFrame(const std::vector<uint8_t>& frameData)
+{
+	PacketRef buffer = m_packetPool.Acquire(frameData.size());
+	buffer->Assign(frameData.data(), frameData.size());
+	buffer->SetFrame(buffer->Payload(), buffer->GetPayloadSize());
+	return buffer;
+}
+
+// 重传数据包（内部版本，假设已持有窗口锁）
+void ReliableChannel::RetransmitPacketInternal(uint32_t sequence)
+{
+	VERBOSE_LOG("RetransmitPacketInternal called: sequence={}", sequence);
+
+	// 确保窗口大小有效
+	if (m_config.windowSize == 0 || m_sendWindow.empty())
+	{
+		WriteLog("RetransmitPacketInternal: ERROR - send window not initialized or size is 0");
+		ReportError("发送窗口未初始化或大小为0");
+		return;
+	}
+
+	uint32_t index = sequence % m_config.windowSize;
+	VERBOSE_LOG("RetransmitPacketInternal: calculated index={}, sendWindow.size()={}", index, m_sendWindow.size());
+
+	// 边界检查
+	if (index >= m_sendWindow.size())
+	{
+		WriteLog("RetransmitPacketInternal: ERROR - send window index out of bounds: " + std::to_string(index) +
+			" >= " + std::to_string(m_sendWindow.size()));
+		ReportError("发送窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_sendWindow.size()));
+		return;
+	}
+
+	VERBOSE_LOG("RetransmitPacketInternal: checking slot {}, inUse={}", index, m_sendWindow[index].inUse);
+
+	if (m_sendWindow[index].inUse && m_sendWindow[index].packet && m_sendWindow[index].packet->buffer)
+	{
+		VERBOSE_LOG("RetransmitPacketInternal: incrementing retry count from {}", m_sendWindow[index].packet->retryCount);
+		m_sendWindow[index].packet->retryCount++;
+		m_sendWindow[index].packet->timestamp = std::chrono::steady_clock::now();
+		ArmRetransmitTimerLocked(m_sendWindow[index].packet);
+		VERBOSE_LOG("RetransmitPacketInternal: new retry count={}", m_sendWindow[index].packet->retryCount);
+
+		// 重新发送数据包：直接写出首次发送时编码好的帧（START帧保持原帧类型）
+		try
+		{
+			const PacketRef& buffer = m_sendWindow[index].packet->buffer;
+			VERBOSE_LOG("RetransmitPacketInternal: resending encoded frame, size={}", buffer->GetFrameSize());
+
+			size_t written = 0;
+			VERBOSE_LOG("RetransmitPacketInternal: writing to transport...");
+			TransportError error = m_transport->Write(buffer->GetFrame(), buffer->GetFrameSize(), &written);
+			VERBOSE_LOG("RetransmitPacketInternal: transport write completed, written={}, error={}", written, static_cast<int>(error));
+
+			if (error != TransportError::Success)
+			{
+				WriteLog("RetransmitPacketInternal: ERROR - transport write failed with error: " + std::to_string(static_cast<int>(error)));
+				ReportError("重传数据包失败，传输错误: " + std::to_string(static_cast<int>(error)));
+				return;
+			}
+
+			// 更新统计
+			{
+				std::lock_guard<std::mutex> statsLock(m_statsMutex);
+				m_stats.packetsRetransmitted++;
+				VERBOSE_LOG("RetransmitPacketInternal: stats updated, packetsRetransmitted={}", m_stats.packetsRetransmitted);
+			}
+
+			VERBOSE_LOG("RetransmitPacketInternal: retransmission completed successfully");
+		}
+		catch (const std::exception& e)
+		{
+			VERBOSE_LOG("RetransmitPacketInternal: EXCEPTION during retransmission: {}", e.what());
+			ReportError("重传数据包异常: " + std::string(e.what()));
+		}
+		catch (...)
+		{
+			VERBOSE_LOG("RetransmitPacketInternal: UNKNOWN EXCEPTION during retransmission");
+			ReportError("重传数据包未知异常");
+		}
+	}
+	else
+	{
+		WriteLog("RetransmitPacketInternal: ERROR - slot not in use or no packet: inUse=" + std::to_string(m_sendWindow[index].inUse) +
+			", hasPacket=" + std::to_string(m_sendWindow[index].packet != nullptr));
+	}
+
+	VERBOSE_LOG("RetransmitPacketInternal: completed");
+}
+
+// 重传数据包（外部版本，负责获取锁）
+void ReliableChannel::RetransmitPacket(uint32_t sequence)
+{
+	VERBOSE_LOG("RetransmitPacket called: sequence={}", sequence);
+
+	std::lock_guard<std::mutex> lock(m_windowMutex);
+	VERBOSE_LOG("RetransmitPacket: locked window mutex");
+
+	RetransmitPacketInternal(sequence);
+
+	VERBOSE_LOG("RetransmitPacket: completed");
+}
+
+// 推进发送窗口
+void ReliableChannel::AdvanceSendWindow()
+{
+	VERBOSE_LOG("AdvanceSendWindow called");
+
+	int advanceCount = 0;
+	while (true)
+	{
+		VERBOSE_LOG("AdvanceSendWindow: checking window, sendBase={}, windowSize={}", m_sendBase, m_config.windowSize);
+
+		// 确保窗口大小有效
+		if (m_config.windowSize == 0 || m_sendWindow.empty())
+		{
+			WriteLog("AdvanceSendWindow: ERROR - window not initialized or size is 0");
+			ReportError("发送窗口未初始化或大小为0");
+			break;
+		}
+
+		uint32_t index = m_sendBase % m_config.windowSize;
+		VERBOSE_LOG("AdvanceSendWindow: calculated index={}, sendWindow.size()={}", index, m_sendWindow.size());
+
+		// 边界检查
+		if (index >= m_sendWindow.size())
+		{
+			WriteLog("AdvanceSendWindow: ERROR - index out of bounds: " + std::to_string(index) +
+				" >= " + std::to_string(m_sendWindow.size()));
+			ReportError("发送窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_sendWindow.size()));
+			break;
+		}
+
+		VERBOSE_LOG("AdvanceSendWindow: checking slot {}, inUse={}", index, m_sendWindow[index].inUse);
+
+		if (m_sendWindow[index].inUse && m_sendWindow[index].packet &&
+			m_sendWindow[index].packet->acknowledged)
+		{
+			VERBOSE_LOG("AdvanceSendWindow: advancing window, old sendBase={}", m_sendBase);
+			m_sendWindow[index].Release();
+			m_sendBase = NextSequence(m_sendBase);
+			advanceCount++;
+			VERBOSE_LOG("AdvanceSendWindow: new sendBase={}, advanceCount={}", m_sendBase, advanceCount);
+		}
+		else
+		{
+			VERBOSE_LOG("AdvanceSendWindow: no more slots to advance, breaking");
+			break;
+		}
+	}
+
+	VERBOSE_LOG("AdvanceSendWindow: completed, advanced {} slots", advanceCount);
+
+	if (advanceCount > 0)
+	{
+		m_windowCondition.notify_all();
+	}
+}
+
+// 更新接收窗口
+void ReliableChannel::UpdateReceiveWindow(uint32_t sequence)
+{
+	// 这里可以实现更复杂的接收窗口管理逻辑
+}
+
+// 分配序列号
+bool ReliableChannel::IsSendWindowFullLocked() const
+{
+	if (m_config.windowSize == 0 || m_sendWindow.empty())
+	{
+		return false;
+	}
 
-		// 设置文件传输信息
+	// 【SACK】对端已确认但尚未交付的包仍占用其接收窗口，超出对端窗口的包会被丢弃
+	if (m_peerWindowKnown)
+	{
+		uint32_t peerWindow = m_peerWindowSize > 0 ? m_peerWindowSize : m_config.windowSize;
+		uint32_t peerOutstanding = GetWindowDistance(m_peerReceiveBase, m_sendNext);
+		if (peerOutstanding <= (m_sequenceMask.load() >> 1) && peerOutstanding >= peerWindow)
 		{
-			std::lock_guard<std::mutex> lock(m_receiveMutex);
-			m_currentFileName = metadata.fileName;
-			m_currentFileSize = metadata.fileSize;
-			m_currentFileProgress = 0;
-			m_fileTransferActive = true; // 激活文件传输状态
-			m_transferStartTime = std::chrono::steady_clock::now(); // 记录传输开始时间
-			m_completedFileBuffer.clear();
-			m_hasCompletedFile = false;
+			return true;
 		}
+	}
 
-		// 更新进度显示
-		UpdateProgress(0, metadata.fileSize);
+	uint32_t outstanding = GetWindowDistance(m_sendBase, m_sendNext);
+	uint32_t limit = GetSendWindowLimitLocked();
+	if (outstanding < limit)
+	{
+		return false;
+	}
 
-		// 【关键修复】发送 ACK 响应，建立握手闭环
-		WriteLog("ProcessStartFrame: sending ACK response to establish handshake");
-		if (SendAck(frame.sequence))
-		{
-			WriteLog("ProcessStartFrame: ACK sent successfully, handshake established");
+	// 受对端窗口或拥塞窗口限制时，在途包数达到上限即视为窗口满
+	if (limit < m_config.windowSize)
+	{
+		return true;
+	}
 
-			// 【新增】同步接收窗口基准到START帧序列号 - 解决NAK风暴问题
-			{
-				std::lock_guard<std::mutex> lock(m_windowMutex);
-				WriteLog("ProcessStartFrame: synchronizing receive window base from " +
-					std::to_string(m_receiveBase) + " to " + std::to_string(frame.sequence + 1));
+	uint32_t index = m_sendNext % m_config.windowSize;
+	if (index >= m_sendWindow.size())
+	{
+		return true;
+	}
 
-				// 将接收基准设置为START帧的下一个序列号，确保与发送方一致
-				uint16_t newBase = (frame.sequence + 1) % 65536;
-				m_receiveBase = newBase;
-				m_receiveNext = newBase;
+	const auto& slot = m_sendWindow[index];
+	bool slotBusy = slot.inUse && (!slot.packet || !slot.packet->acknowledged);
+	return slotBusy;
+}
 
-				WriteLog("ProcessStartFrame: receive window synchronized, new base=" +
-					std::to_string(m_receiveBase) + ", new next=" + std::to_string(m_receiveNext));
-			}
+uint32_t ReliableChannel::AllocateSequence()
+{
+	VERBOSE_LOG("AllocateSequence called");
 
-			// 推动接收端状态机 - 准备接收数据
-			WriteLog("ProcessStartFrame: receiver ready for data transmission");
-		}
-		else
-		{
-			WriteLog("ProcessStartFrame: ERROR - failed to send ACK response");
-			ReportError("START帧ACK响应发送失败");
-		}
+	std::unique_lock<std::mutex> lock(m_windowMutex);
+
+	return AllocateSequenceLocked(lock);
+}
+
+// 【新增】内部版本：要求调用方必须已经持有m_windowMutex锁
+uint32_t ReliableChannel::AllocateSequenceLocked(std::unique_lock<std::mutex>& lock)
+{
+	VERBOSE_LOG("AllocateSequenceLocked called (caller already holds lock)");
+
+	VERBOSE_LOG("AllocateSequenceLocked: sendWindow.size()={}, windowSize={}", m_sendWindow.size(), m_config.windowSize);
+
+	// 确保窗口已初始化
+	if (m_sendWindow.empty() || m_config.windowSize == 0)
+	{
+		WriteLog("AllocateSequenceLocked: ERROR - window not initialized or size is 0");
+		ReportError("发送窗口未初始化或大小为0");
+		return 0;
 	}
-	else
+
+	while (!m_shutdown.load() && m_connected.load() && IsSendWindowFullLocked())
 	{
-		WriteLog("ProcessStartFrame: ERROR - failed to decode START metadata");
-		ReportError("START帧元数据解析失败");
+		VERBOSE_LOG("AllocateSequenceLocked: send window full (sendBase={}, sendNext={}), waiting for availability", m_sendBase, m_sendNext);
 
-		// 发送 NAK 表示协商失败
-		SendNak(frame.sequence);
+		m_windowCondition.wait(lock, [this]() {
+			return m_shutdown.load() || !m_connected.load() || !IsSendWindowFullLocked();
+			});
+
+		VERBOSE_LOG("AllocateSequenceLocked: wake, current sendBase={}, sendNext={}", m_sendBase, m_sendNext);
 	}
+
+	uint32_t sequence = m_sendNext;
+	m_sendNext = NextSequence(m_sendNext);
+	VERBOSE_LOG("AllocateSequenceLocked: returning sequence {}, next will be {}", sequence, m_sendNext);
+	return sequence;
 }
 
-// 处理结束帧
-void ReliableChannel::ProcessEndFrame(const Frame& frame)
+// 有效发送窗口
+uint32_t ReliableChannel::GetSendWindowLimitLocked() const
 {
-	WriteLog("ProcessEndFrame: 收到END帧，验证传输完整性...");
+	uint32_t limit = m_config.windowSize;
 
-	// 检查是否有预期的文件大小信息
-	if (m_currentFileSize > 0)
+	if (m_peerWindowSize > 0)
 	{
-		// 【修复】计算字节差异
-		int64_t byteDifference = static_cast<int64_t>(m_currentFileSize) - static_cast<int64_t>(m_currentFileProgress);
+		limit = (std::min)(limit, static_cast<uint32_t>(m_peerWindowSize));
+	}
 
-		// 【修复】±1KB 容错范围
-		const int64_t TOLERANCE_BYTES = 1024; // 1KB 容错
-		bool withinTolerance = (byteDifference >= -TOLERANCE_BYTES && byteDifference <= TOLERANCE_BYTES);
+	if (m_config.enableAdaptiveWindow)
+	{
+		limit = (std::min)(limit, static_cast<uint32_t>(m_congestionWindow));
+	}
 
-		WriteLog("ProcessEndFrame: 字节差异 = " + std::to_string(byteDifference) +
-			" 字节，容错范围 ±" + std::to_string(TOLERANCE_BYTES) + " 字节");
+	return (std::max)(limit, 1u);
+}
 
-		// 验证实际接收字节数与预期文件大小是否匹配（带容错）
-		if (withinTolerance)
-		{
-			WriteLog("ProcessEndFrame: 传输完整性验证通过（容错范围内） - " +
-				std::to_string(m_currentFileProgress) + "/" +
-				std::to_string(m_currentFileSize) + " 字节");
+// 检查序列号是否在窗口内
+bool ReliableChannel::IsSequenceInWindow(uint32_t sequence, uint32_t base, uint32_t windowSize) const
+{
+	return GetWindowDistance(base, sequence) < windowSize;
+}
 
-			// 清除传输活跃状态
-			m_fileTransferActive = false;
+// 获取窗口距离（按当前序列号空间回绕）
+uint32_t ReliableChannel::GetWindowDistance(uint32_t from, uint32_t to) const
+{
+	return (to - from) & m_sequenceMask.load();
+}
 
-			// 更新进度到100%
-			UpdateProgress(m_currentFileSize, m_currentFileSize);
-			m_hasCompletedFile = true;
+// 判断sequence是否在reference之前（距离位于半个序列空间内）
+bool ReliableChannel::IsSequenceBefore(uint32_t sequence, uint32_t reference) const
+{
+	uint32_t distance = GetWindowDistance(sequence, reference);
+	return distance > 0 && distance <= (m_sequenceMask.load() >> 1);
+}
 
-			WriteLog("ProcessEndFrame: 文件传输正常完成");
+// 下一个序列号
+uint32_t ReliableChannel::NextSequence(uint32_t sequence) const
+{
+	return (sequence + 1) & m_sequenceMask.load();
+}
 
-			// 【新增】触发传输完成回调
-			if (m_completeCallback)
-			{
-				WriteLog("ProcessEndFrame: 调用完成回调，成功=true");
-				m_completeCallback(true);
-			}
-		}
-		else if (byteDifference > TOLERANCE_BYTES)
-		{
-			// 数据不足，启动短超时机制
-			if (!m_shortTimeoutActive)
-			{
-				WriteLog("ProcessEndFrame: 传输不完整（差 " + std::to_string(byteDifference) +
-					" 字节），启动30秒短超时等待更多数据");
-				m_shortTimeoutActive = true;
-				m_shortTimeoutStart = std::chrono::steady_clock::now();
-			}
-			else
-			{
-				// 检查短超时是否到期
-				auto now = std::chrono::steady_clock::now();
-				auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - m_shortTimeoutStart);
+// 计算超时时间
+uint32_t ReliableChannel::CalculateTimeout() const
+{
+	// 【P0修复】应用最小超时地板值，避免近零延迟环境下的假超时
+	uint32_t result = m_timeoutMs;
+	result = (std::max)(result, m_config.timeoutMin); // 应用最小超时保护
+	result = (std::min)(result, m_config.timeoutMax); // 应用最大超时限制
+	return result;
+}
 
-				if (elapsed.count() >= m_shortTimeoutDuration)
-				{
-					WriteLog("ProcessEndFrame: 短超时到期（" + std::to_string(elapsed.count()) +
-						"秒），强制结束传输，数据差异 " + std::to_string(byteDifference) + " 字节");
+// 更新RTT
+void ReliableChannel::UpdateRTT(uint32_t rttMs)
+{
+	// 记录最小RTT作为无排队时的基线
+	if (m_minRttMs == 0 || rttMs < m_minRttMs)
+	{
+		m_minRttMs = (std::max)(rttMs, 1u);
+	}
 
-					// 强制结束传输
-					m_fileTransferActive = false;
-					m_shortTimeoutActive = false;
-					m_hasCompletedFile = true;  // 标记为有数据（尽管不完整）
+	// 使用指数加权移动平均
+	m_rttMs = (m_rttMs * 7 + rttMs) / 8;
+	m_timeoutMs = m_rttMs * 2; // 超时时间是RTT的两倍
 
-					ReportError("文件传输不完整（短超时），预期 " + std::to_string(m_currentFileSize) +
-						" 字节，实际接收 " + std::to_string(m_currentFileProgress) + " 字节");
+	// 【P0修复】限制超时时间范围，添加最小超时地板值保护
+	m_timeoutMs = (std::max)(m_timeoutMs, m_config.timeoutMin);  // 应用最小超时保护
+	m_timeoutMs = (std::max)(m_timeoutMs, m_config.timeoutBase); // 应用基础超时保护
+	m_timeoutMs = (std::min)(m_timeoutMs, m_config.timeoutMax);  // 应用最大超时限制
+}
 
-					// 【新增】触发传输完成回调（失败）
-					if (m_completeCallback)
-					{
-						WriteLog("ProcessEndFrame: 调用完成回调，成功=false（短超时）");
-						m_completeCallback(false);
-					}
-				}
-				else
-				{
-					WriteLog("ProcessEndFrame: 短超时进行中（" + std::to_string(elapsed.count()) +
-						"/" + std::to_string(m_shortTimeoutDuration) + "秒），继续等待数据");
-				}
-			}
-		}
-		else
-		{
-			// 数据超过预期（负差异超过容错）
-			WriteLog("ProcessEndFrame: 接收数据超过预期（多 " + std::to_string(-byteDifference) +
-				" 字节），仍认为传输完成");
+// 重置拥塞窗口：从较小的初始窗口慢启动，阈值取本端窗口
+void ReliableChannel::ResetCongestionWindowLocked()
+{
+	uint32_t minWindow = (std::max)(1u, (std::min)(static_cast<uint32_t>(m_config.minWindowSize), static_cast<uint32_t>(m_config.windowSize)));
+	uint32_t initialWindow = (std::min)(static_cast<uint32_t>(INITIAL_CONGESTION_WINDOW), static_cast<uint32_t>(m_config.windowSize));
 
-			// 清除传输活跃状态
-			m_fileTransferActive = false;
-			m_shortTimeoutActive = false;
+	m_congestionWindow = (std::max)(initialWindow, minWindow);
+	m_slowStartThreshold = m_config.windowSize;
+	m_minRttMs = 0;
+	m_lastCongestionEvent = std::chrono::steady_clock::time_point();
+}
 
-			// 更新进度
-			UpdateProgress(m_currentFileProgress, m_currentFileProgress);
-			m_hasCompletedFile = true;
+// 收到新确认：慢启动阶段每个ACK加1，拥塞避免阶段每个RTT约加1（加性增长）
+void ReliableChannel::OnCongestionAckLocked(uint32_t rttSampleMs, bool rttSampleValid)
+{
+	if (!m_config.enableAdaptiveWindow)
+	{
+		return;
+	}
 
-			WriteLog("ProcessEndFrame: 文件传输完成（数据超额）");
+	// RTT明显高于基线说明链路队列正在积压，保持窗口不再增长
+	if (rttSampleValid && m_minRttMs > 0 && rttSampleMs > m_minRttMs * 2 + m_config.timeoutMin)
+	{
+		return;
+	}
 
-			// 【新增】触发传输完成回调
-			if (m_completeCallback)
-			{
-				WriteLog("ProcessEndFrame: 调用完成回调，成功=true（数据超额）");
-				m_completeCallback(true);
-			}
-		}
+	if (m_congestionWindow < m_slowStartThreshold)
+	{
+		m_congestionWindow += 1.0;
 	}
 	else
 	{
-		WriteLog("ProcessEndFrame: 无文件大小信息，使用传统逻辑结束传输");
-		m_fileTransferActive = false;
-		m_shortTimeoutActive = false;
-		UpdateProgress(m_currentFileProgress, m_currentFileProgress);
-		{
-			std::lock_guard<std::mutex> lock(m_receiveMutex);
-			m_hasCompletedFile = !m_completedFileBuffer.empty();
-		}
-		WriteLog("ProcessEndFrame: 传统模式传输结束");
+		m_congestionWindow += 1.0 / m_congestionWindow;
+	}
 
-		// 【新增】触发传输完成回调
-		if (m_completeCallback)
-		{
-			WriteLog("ProcessEndFrame: 调用完成回调，成功=true（传统模式）");
-			m_completeCallback(true);
-		}
+	m_congestionWindow = (std::min)(m_congestionWindow, static_cast<double>(m_config.windowSize));
+	m_windowCondition.notify_all();
+}
+
+// 检测到丢包：窗口减半（乘性减少），同一RTT内的多次丢包只减一次
+void ReliableChannel::OnCongestionLossLocked()
+{
+	if (!m_config.enableAdaptiveWindow)
+	{
+		return;
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - m_lastCongestionEvent < std::chrono::milliseconds((std::max)(m_rttMs, 1u)))
+	{
+		return;
 	}
+	m_lastCongestionEvent = now;
+
+	uint32_t minWindow = (std::max)(1u, (std::min)(static_cast<uint32_t>(m_config.minWindowSize), static_cast<uint32_t>(m_config.windowSize)));
+	m_slowStartThreshold = (std::max)(static_cast<uint32_t>(m_congestionWindow / 2), minWindow);
+	m_congestionWindow = m_slowStartThreshold;
 
-	WriteLog("ProcessEndFrame: 处理完成，当前传输状态 = " + std::string(m_fileTransferActive ? "活跃" : "已结束"));
+	VERBOSE_LOG("OnCongestionLossLocked: congestion window reduced to {}", m_slowStartThreshold);
+
+	std::lock_guard<std::mutex> statsLock(m_statsMutex);
+	m_stats.congestionEvents++;
 }
 
-// 处理心跳帧
-void ReliableChannel::ProcessHeartbeatFrame(const Frame& frame)
+// 切换协议版本：编码帧格式与序列号空间同步变化
+void ReliableChannel::ApplyProtocolVersionLocked(uint8_t version)
 {
-	// 心跳帧不需要特殊处理，只需要更新活动时间
+	uint8_t applied = (version >= PROTOCOL_VERSION_2) ? PROTOCOL_VERSION_2 : PROTOCOL_VERSION_1;
+	uint32_t mask = (applied == PROTOCOL_VERSION_2) ? 0xFFFFFFFFu : 0xFFFFu;
+
+	m_protocolVersion = applied;
+	m_frameCodec->SetFrameVersion(applied);
+	m_sequenceMask = mask;
+
+	// 回落到16位序列号空间时截断现有序号，保持与对端一致
+	m_sendBase &= mask;
+	m_sendNext &= mask;
+	m_receiveBase &= mask;
+	m_receiveNext &= mask;
 }
 
-// 发送数据包
-bool ReliableChannel::SendPacket(uint16_t sequence, const std::vector<uint8_t>& data, FrameType type)
+// 处理START帧ACK中的协商结果；空负载表示对端为v1实现
+void ReliableChannel::ApplyStartAckLocked(const std::vector<uint8_t>& payload)
+{
+	StartAckInfo info;
+	if (!m_frameCodec->DecodeStartAck(payload, info))
+	{
+		ApplyProtocolVersionLocked(PROTOCOL_VERSION_1);
+		m_peerWindowSize = 0;
+		m_peerMaxPayloadSize = 0;
+		m_resumeOffset = 0;
+		m_compressionActive = false;
+		m_streamCompressionActive = false;
+		m_fecActive = false;
+		m_multiplexActive = false;
+		ResetParityGroupLocked();
+		WriteLog("ApplyStartAckLocked: peer did not negotiate, using protocol version 1");
+		return;
+	}
+
+	uint8_t version = (std::min)(info.version, m_config.version);
+	ApplyProtocolVersionLocked(version);
+	m_peerWindowSize = info.windowSize;
+	m_peerMaxPayloadSize = info.maxPayloadSize;
+	m_resumeOffset = (info.flags & START_FLAG_RESUME) ? info.resumeOffset : 0;
+	m_compressionActive = m_config.enableCompression && (info.flags & START_FLAG_COMPRESSION) != 0;
+	m_streamCompressionActive = m_compressionActive.load() && m_config.enableStreamCompression && (info.flags & START_FLAG_STREAM_COMPRESSION) != 0;
+	m_multiplexActive = m_config.enableMultiplexing && version >= PROTOCOL_VERSION_2 && (info.flags & START_FLAG_MULTIPLEX) != 0;
+
+	// 新会话从空字典开始，与接收端处理START帧时的重置对应
+	m_streamEncoder.Reset();
+	m_streamNextSequence = m_sendNext;
+
+	// 校验组从新会话的首个数据帧开始；固定组大小或重新开始丢包率估计
+	m_fecActive = m_config.enableFec && (info.flags & START_FLAG_FEC) != 0;
+	ResetParityGroupLocked();
+	m_fecLossRate = 0.0;
+	m_fecGroupSize = (m_config.fecGroupSize > 0)
+		? (std::max)((std::min)(static_cast<uint32_t>(m_config.fecGroupSize), FEC_MAX_GROUP_SIZE), FEC_MIN_GROUP_SIZE)
+		: FEC_INITIAL_GROUP_SIZE;
+	{
+		std::lock_guard<std::mutex> statsLock(m_statsMutex);
+		m_fecSentSnapshot = m_stats.packetsSent;
+		m_fecRetransmitSnapshot = m_stats.packetsRetransmitted;
+	}
+
+	WriteLog("ApplyStartAckLocked: negotiated protocol version=" + std::to_string(m_protocolVersion.load()) +
+		", peerWindow=" + std::to_string(info.windowSize) +
+		", peerMaxPayload=" + std::to_string(info.maxPayloadSize) +
+		", resumeOffset=" + std::to_string(m_resumeOffset.load()) +
+		", compression=" + std::to_string(m_compressionActive.load()) +
+		", streamCompression=" + std::to_string(m_streamCompressionActive.load()) +
+		", fec=" + std::to_string(m_fecActive.load()) +
+		", multiplex=" + std::to_string(m_multiplexActive.load()));
+}
+
+// 有效负载大小：本端配置、对端声明与帧格式上限的最小值
+size_t ReliableChannel::GetEffectivePayloadSize() const
 {
-	WriteVerbose("SendPacket called: sequence=" + std::to_string(sequence) +
-		", data.size()=" + std::to_string(data.size()) +
-		", type=" + std::to_string(static_cast<int>(type)));
+	size_t size = m_config.maxPayloadSize;
 
-	// 压缩数据（如果启用）
-	std::vector<uint8_t> payload = data;
+	uint32_t peerMaxPayload = m_peerMaxPayloadSize.load();
+	if (peerMaxPayload > 0)
+	{
+		size = (std::min)(size, static_cast<size_t>(peerMaxPayload));
+	}
 
-	// 【分类5.1注记】本版本不支持压缩/加密功能
-	// 虽然m_config中保留了enableCompression/enableEncryption标志以保持兼容性，
-	// 但根据需求范围，这些功能已明确标注为"本版本不包含"
-	// 如需启用压缩/加密，请参考CompressData/EncryptData/EncryptData/DecryptData的实现提示
+	size_t formatLimit = (m_protocolVersion.load() >= PROTOCOL_VERSION_2) ? FrameCodec::MAX_PAYLOAD_SIZE_V2 : FrameCodec::MAX_PAYLOAD_SIZE_V1;
+	size = (std::min)(size, formatLimit);
 
-	// 编码帧
-	WriteVerbose("SendPacket: encoding frame...");
-	std::vector<uint8_t> frameData;
-	switch (type)
+	// 前向纠错：为校验帧头预留空间，校验帧负载不超过数据帧上限
+	if (m_fecActive.load() && size > FEC_PARITY_HEADER_SIZE)
 	{
-	case FrameType::FRAME_DATA:
-		frameData = m_frameCodec->EncodeDataFrame(sequence, payload);
-		break;
-	case FrameType::FRAME_START:
-		frameData = m_frameCodec->EncodeFrame(type, sequence, payload);
-		break;
-	case FrameType::FRAME_END:
-		frameData = m_frameCodec->EncodeEndFrame(sequence);
-		break;
-	case FrameType::FRAME_HEARTBEAT:
-		frameData = m_frameCodec->EncodeHeartbeatFrame(sequence);
-		break;
-	default:
-		WriteLog("SendPacket: ERROR - unknown frame type " + std::to_string(static_cast<int>(type)));
-		return false;
+		size -= FEC_PARITY_HEADER_SIZE;
+	}
+
+	// 多路复用：数据帧负载以流头开头
+	if (m_multiplexActive.load() && size > MUX_HEADER_SIZE)
+	{
+		size -= MUX_HEADER_SIZE;
 	}
+	return (std::max)(size, static_cast<size_t>(1));
+}
 
-	WriteVerbose("SendPacket: frame encoded, frameData.size()=" + std::to_string(frameData.size()));
+// 压缩数据帧负载：压缩结果至少节省1/32才采用，否则保持原样（不可压缩的数据不付出解压代价）
+FrameType ReliableChannel::CompressPayloadLocked(PacketBuffer& buffer)
+{
+	size_t size = buffer.GetPayloadSize();
+	if (size < COMPRESSION_MIN_PAYLOAD)
+	{
+		return FrameType::FRAME_DATA;
+	}
 
-	// 发送数据
-	WriteVerbose("SendPacket: writing to transport...");
-	size_t written = 0;
-	if (m_transport->Write(frameData.data(), frameData.size(), &written) != TransportError::Success || written != frameData.size())
+	if (m_compressBuffer.size() < size)
+	{
+		m_compressBuffer.resize(size);
+	}
+
+	size_t limit = size - size / 32 - 1;
+	size_t compressed = LzCodec::Compress(buffer.Payload(), size, m_compressBuffer.data(), limit);
+	if (compressed == 0)
 	{
-		WriteLog("SendPacket: ERROR - transport write failed or incomplete");
-		return false;
+		return FrameType::FRAME_DATA;
 	}
 
-	WriteVerbose("SendPacket: transport write succeeded, " + std::to_string(written) + " bytes written");
+	memcpy(buffer.Payload(), m_compressBuffer.data(), compressed);
+	buffer.SetPayloadSize(compressed);
 
-	// 更新统计
 	{
 		std::lock_guard<std::mutex> lock(m_statsMutex);
-		m_stats.packetsSent++;
-		m_stats.bytesSent += frameData.size();
-		WriteVerbose("SendPacket: stats updated - packetsSent=" + std::to_string(m_stats.packetsSent) +
-			", bytesSent=" + std::to_string(m_stats.bytesSent));
+		m_stats.compressedFrames++;
+		m_stats.compressionSavedBytes += size - compressed;
 	}
+	return FrameType::FRAME_DATA_COMPRESSED;
+}
 
-	// 对于数据帧，需要保存到发送窗口
-	if (type == FrameType::FRAME_DATA)
+// 流式压缩数据帧负载：[原始大小][引用字典的压缩块]，连同4字节头至少节省1/32才采用
+// 无论是否采用，明文都计入字典；字典只覆盖连续序列号的数据，序列不连续时重置，
+// 此时发送端字典仍是接收端字典的后缀（匹配偏移均相对当前位置），接收端无需感知重置。
+// 重传帧原样复用首次编码结果，接收端按序还原时字典内容与首次编码时一致。
+FrameType ReliableChannel::StreamCompressPayloadLocked(PacketBuffer& buffer, uint32_t sequence)
+{
+	if (sequence != m_streamNextSequence)
 	{
-		WriteVerbose("SendPacket: saving to send window...");
-		std::lock_guard<std::mutex> lock(m_windowMutex);
-
-		// 确保窗口大小有效
-		if (m_config.windowSize == 0 || m_sendWindow.empty())
+		if (!m_streamEncoder.IsEmpty())
 		{
-			WriteLog("SendPacket: ERROR - window not initialized or size is 0");
-			ReportError("发送窗口未初始化或大小为0");
-			return false;
+			m_streamEncoder.Reset();
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			m_stats.streamDictionaryResets++;
 		}
+	}
+	m_streamNextSequence = NextSequence(sequence);
 
-		uint16_t index = sequence % m_config.windowSize;
-		WriteVerbose("SendPacket: calculated index=" + std::to_string(index) +
-			", windowSize=" + std::to_string(m_config.windowSize));
+	size_t size = buffer.GetPayloadSize();
+	if (size == 0)
+	{
+		return FrameType::FRAME_DATA;
+	}
 
-		// 边界检查
-		if (index >= m_sendWindow.size())
-		{
-			WriteLog("SendPacket: ERROR - index out of bounds: " + std::to_string(index) +
-				" >= " + std::to_string(m_sendWindow.size()));
-			ReportError("发送窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_sendWindow.size()));
-			return false;
-		}
+	size_t limit = size - size / 32 - 1;
+	if (size < COMPRESSION_MIN_PAYLOAD || limit <= STREAM_FRAME_HEADER_SIZE)
+	{
+		m_streamEncoder.Append(buffer.Payload(), size);
+		return FrameType::FRAME_DATA;
+	}
 
-		WriteVerbose("SendPacket: setting window slot " + std::to_string(index) + " to inUse=true");
-		m_sendWindow[index].inUse = true;
+	if (m_compressBuffer.size() < size)
+	{
+		m_compressBuffer.resize(size);
+	}
 
-		if (!m_sendWindow[index].packet)
-		{
-			WriteVerbose("SendPacket: creating new packet for slot " + std::to_string(index));
-			m_sendWindow[index].packet = std::make_shared<Packet>();
-		}
+	size_t compressed = m_streamEncoder.Compress(buffer.Payload(), size,
+		m_compressBuffer.data() + STREAM_FRAME_HEADER_SIZE, limit - STREAM_FRAME_HEADER_SIZE);
+	if (compressed == 0)
+	{
+		return FrameType::FRAME_DATA;
+	}
 
-		m_sendWindow[index].packet->sequence = sequence;
-		m_sendWindow[index].packet->data = data; // 保存原始数据
-		m_sendWindow[index].packet->timestamp = std::chrono::steady_clock::now();
-		m_sendWindow[index].packet->retryCount = 0;
-		m_sendWindow[index].packet->acknowledged = false;
+	m_compressBuffer[0] = static_cast<uint8_t>(size & 0xFF);
+	m_compressBuffer[1] = static_cast<uint8_t>((size >> 8) & 0xFF);
+	m_compressBuffer[2] = static_cast<uint8_t>((size >> 16) & 0xFF);
+	m_compressBuffer[3] = static_cast<uint8_t>((size >> 24) & 0xFF);
+	compressed += STREAM_FRAME_HEADER_SIZE;
 
-		WriteVerbose("SendPacket: window slot " + std::to_string(index) + " updated successfully");
-	}
+	memcpy(buffer.Payload(), m_compressBuffer.data(), compressed);
+	buffer.SetPayloadSize(compressed);
 
-	WriteVerbose("SendPacket: completed successfully");
-	return true;
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.compressedFrames++;
+		m_stats.streamCompressedFrames++;
+		m_stats.compressionSavedBytes += size - compressed;
+	}
+	return FrameType::FRAME_DATA_STREAM;
 }
 
-// 【新增】内部版本：要求调用方必须已经持有m_windowMutex锁
-bool ReliableChannel::SendPacketLocked(std::unique_lock<std::mutex>& lock, uint16_t sequence, const std::vector<uint8_t>& data, FrameType type)
+// 按序交付前处理流式字典：流式帧解压替换负载，其他数据帧的明文计入字典
+bool ReliableChannel::DecodeStreamPayloadLocked(Packet& packet)
 {
-	WriteVerbose("SendPacketLocked called: sequence=" + std::to_string(sequence) +
-		", data.size()=" + std::to_string(data.size()) +
-		", type=" + std::to_string(static_cast<int>(type)));
+	if (!packet.streamEncoded)
+	{
+		if (m_streamDecodeActive && packet.buffer)
+		{
+			m_streamDecoder.Append(packet.buffer->Payload(), packet.buffer->GetPayloadSize());
+		}
+		return true;
+	}
 
-	// 压缩数据（如果启用）
-	std::vector<uint8_t> payload = data;
+	packet.streamEncoded = false;
+	if (!packet.buffer || packet.buffer->GetPayloadSize() <= STREAM_FRAME_HEADER_SIZE)
+	{
+		return false;
+	}
 
-	// 编码帧
-	WriteVerbose("SendPacketLocked: encoding frame...");
-	std::vector<uint8_t> frameData;
-	switch (type)
+	PacketRef plain = m_packetPool.Acquire(packet.dataSize);
+	size_t size = m_streamDecoder.Decompress(packet.buffer->Payload() + STREAM_FRAME_HEADER_SIZE,
+		packet.buffer->GetPayloadSize() - STREAM_FRAME_HEADER_SIZE, plain->Payload(), packet.dataSize);
+	if (size != packet.dataSize)
 	{
-	case FrameType::FRAME_DATA:
-		frameData = m_frameCodec->EncodeDataFrame(sequence, payload);
-		break;
-	case FrameType::FRAME_START:
-		frameData = m_frameCodec->EncodeFrame(type, sequence, payload);
-		break;
-	case FrameType::FRAME_END:
-		frameData = m_frameCodec->EncodeEndFrame(sequence);
-		break;
-	case FrameType::FRAME_HEARTBEAT:
-		frameData = m_frameCodec->EncodeHeartbeatFrame(sequence);
-		break;
-	default:
-		WriteLog("SendPacketLocked: ERROR - unknown frame type " + std::to_string(static_cast<int>(type)));
 		return false;
 	}
 
-	WriteVerbose("SendPacketLocked: frame encoded, frameData.size()=" + std::to_string(frameData.size()));
+	plain->SetPayloadSize(size);
+	packet.buffer = std::move(plain);
+	return true;
+}
 
-	// 发送数据
-	WriteVerbose("SendPacketLocked: writing to transport...");
-	size_t written = 0;
-	if (m_transport->Write(frameData.data(), frameData.size(), &written) != TransportError::Success || written != frameData.size())
+// 还原压缩数据帧：解压后的帧与普通数据帧一致，交由ProcessDataFrame处理
+bool ReliableChannel::DecompressFrame(const Frame& frame, Frame& decoded) const
+{
+	// 解压上限取本端最大负载：握手时已告知对端，发送端的原始负载不会超过该大小
+	decoded.payload.resize((std::min)(static_cast<size_t>(m_config.maxPayloadSize), FrameCodec::MAX_PAYLOAD_SIZE_V2));
+	size_t size = LzCodec::Decompress(frame.payload.data(), frame.payload.size(), decoded.payload.data(), decoded.payload.size());
+	if (size == LzCodec::DECOMPRESS_ERROR)
 	{
-		WriteLog("SendPacketLocked: ERROR - transport write failed or incomplete");
 		return false;
 	}
 
-	WriteVerbose("SendPacketLocked: transport write succeeded, " + std::to_string(written) + " bytes written");
+	decoded.payload.resize(size);
+	decoded.type = FrameType::FRAME_DATA;
+	decoded.sequence = frame.sequence;
+	decoded.crc32 = frame.crc32;
+	decoded.version = frame.version;
+	decoded.valid = true;
+	return true;
+}
 
-	// 更新统计
+// 已发送的数据帧计入当前校验组：负载按线路形式（压缩后）异或，帧类型与长度一并异或，
+// 接收端由此可还原组内任意一个丢失帧的完整内容。组满后立即发送校验帧。
+void ReliableChannel::AccumulateParityLocked(uint32_t sequence, FrameType type, const uint8_t* payload, size_t size)
+{
+	// 序列不连续时丢弃未完成的组
+	if (m_fecGroupCount > 0 && sequence != ((m_fecGroupFirst + m_fecGroupCount) & m_sequenceMask.load()))
 	{
-		std::lock_guard<std::mutex> statsLock(m_statsMutex); // 使用不同的锁名避免冲突
-		m_stats.packetsSent++;
-		m_stats.bytesSent += frameData.size();
-		WriteVerbose("SendPacketLocked: stats updated - packetsSent=" + std::to_string(m_stats.packetsSent) +
-			", bytesSent=" + std::to_string(m_stats.bytesSent));
+		ResetParityGroupLocked();
 	}
 
-	// 对于数据帧，需要保存到发送窗口（调用方已持有m_windowMutex锁）
-	if (type == FrameType::FRAME_DATA)
+	// 校验帧负载超出编码上限时该帧不受保护（握手前已分块的数据），先结束当前组
+	if (size + FEC_PARITY_HEADER_SIZE > (std::min)(m_frameCodec->GetMaxPayloadSize(), FrameCodec::MAX_PAYLOAD_SIZE_V2))
 	{
-		WriteVerbose("SendPacketLocked: saving to send window (caller already holds lock)...");
-
-		// 确保窗口大小有效
-		if (m_config.windowSize == 0 || m_sendWindow.empty())
-		{
-			WriteLog("SendPacketLocked: ERROR - window not initialized or size is 0");
-			ReportError("发送窗口未初始化或大小为0");
-			return false;
-		}
-
-		uint16_t index = sequence % m_config.windowSize;
-		WriteVerbose("SendPacketLocked: calculated index=" + std::to_string(index) +
-			", windowSize=" + std::to_string(m_config.windowSize));
-
-		// 边界检查
-		if (index >= m_sendWindow.size())
-		{
-			WriteLog("SendPacketLocked: ERROR - index out of bounds: " + std::to_string(index) +
-				" >= " + std::to_string(m_sendWindow.size()));
-			ReportError("发送窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_sendWindow.size()));
-			return false;
-		}
-
-		WriteVerbose("SendPacketLocked: setting window slot " + std::to_string(index) + " to inUse=true");
-		m_sendWindow[index].inUse = true;
+		SendParityLocked();
+		return;
+	}
 
-		if (!m_sendWindow[index].packet)
-		{
-			WriteVerbose("SendPacketLocked: creating new packet for slot " + std::to_string(index));
-			m_sendWindow[index].packet = std::make_shared<Packet>();
-		}
+	if (m_fecGroupCount == 0)
+	{
+		m_fecGroupFirst = sequence;
+	}
 
-		m_sendWindow[index].packet->sequence = sequence;
-		m_sendWindow[index].packet->data = data; // 保存原始数据
-		m_sendWindow[index].packet->timestamp = std::chrono::steady_clock::now();
-		m_sendWindow[index].packet->retryCount = 0;
-		m_sendWindow[index].packet->acknowledged = false;
+	// 超出已有长度的部分保持为零，等价于较短负载补零
+	if (m_fecParity.size() < FEC_PARITY_HEADER_SIZE + size)
+	{
+		m_fecParity.resize(FEC_PARITY_HEADER_SIZE + size, 0);
+	}
+	XorInto(m_fecParity.data() + FEC_PARITY_HEADER_SIZE, payload, size);
+	m_fecParityLength = (std::max)(m_fecParityLength, size);
+	m_fecLengthXor ^= static_cast<uint32_t>(size);
+	m_fecTypeXor ^= static_cast<uint8_t>(type);
+	m_fecGroupCount++;
 
-		WriteVerbose("SendPacketLocked: window slot " + std::to_string(index) + " updated successfully");
+	if (m_fecGroupCount >= m_fecGroupSize)
+	{
+		SendParityLocked();
+		return;
 	}
 
-	WriteVerbose("SendPacketLocked: completed successfully");
-	return true;
+	// 发送持续空闲时为未满的组补发校验帧：只占用链路空闲时段，保护突发末尾的几帧。
+	// 已有待触发的定时器时只记录本帧时间，到期时再按最近一帧顺延，不为每帧取消并重新调度
+	m_fecLastFrameTime = TimerQueue::Clock::now();
+	if (m_fecFlushTimer == TimerQueue::INVALID_TIMER)
+	{
+		m_fecFlushTimer = m_timerQueue.ScheduleAfter(FEC_FLUSH_DELAY_MS, [this] { OnFecFlushTimer(); });
+	}
 }
 
-// 发送ACK
-bool ReliableChannel::SendAck(uint16_t sequence)
+// 校验帧不进入发送窗口，丢失不重发：其作用只是让接收端少等一次重传超时
+void ReliableChannel::SendParityLocked()
 {
-	WriteVerbose("SendAck called: sequence=" + std::to_string(sequence));
+	if (m_fecGroupCount == 0)
+	{
+		return;
+	}
 
-	std::vector<uint8_t> frameData = m_frameCodec->EncodeAckFrame(sequence);
-	WriteVerbose("SendAck: frame encoded, size=" + std::to_string(frameData.size()));
+	uint8_t* header = m_fecParity.data();
+	header[0] = static_cast<uint8_t>(m_fecGroupCount);
+	header[1] = m_fecTypeXor;
+	header[2] = static_cast<uint8_t>(m_fecLengthXor & 0xFF);
+	header[3] = static_cast<uint8_t>((m_fecLengthXor >> 8) & 0xFF);
+	header[4] = static_cast<uint8_t>((m_fecLengthXor >> 16) & 0xFF);
+	header[5] = static_cast<uint8_t>((m_fecLengthXor >> 24) & 0xFF);
+
+	// 帧头帧尾写在栈上，校验负载直接作为发送段，不拷入帧缓冲区
+	size_t payloadSize = FEC_PARITY_HEADER_SIZE + m_fecParityLength;
+	uint8_t frameHeader[FrameCodec::MAX_FRAME_HEADER_SIZE];
+	uint8_t frameTail[sizeof(FrameTail)];
+	WriteSegment segments[3];
+	size_t frameSize = 0;
+	size_t segmentCount = m_frameCodec->EncodeFrameSegments(FrameType::FRAME_PARITY, m_fecGroupFirst,
+		m_fecParity.data(), payloadSize, frameHeader, frameTail, segments, frameSize);
 
 	size_t written = 0;
-	TransportError error = m_transport->Write(frameData.data(), frameData.size(), &written);
-	bool success = (error == TransportError::Success && written == frameData.size());
+	bool success = m_transport->WriteV(segments, segmentCount, &written) == TransportError::Success && written == frameSize;
 
-	WriteVerbose("SendAck: transport write result: error=" + std::to_string(static_cast<int>(error)) +
-		", written=" + std::to_string(written) + ", success=" + std::to_string(success));
+	ResetParityGroupLocked();
+	UpdateFecGroupSizeLocked();
 
-	return success;
+	if (success)
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.fecParityFrames++;
+		m_stats.bytesSent += frameSize;
+	}
 }
 
-// 发送NAK
-bool ReliableChannel::SendNak(uint16_t sequence)
+void ReliableChannel::ResetParityGroupLocked()
 {
-	WriteVerbose("SendNak called: sequence=" + std::to_string(sequence));
+	if (!m_fecParity.empty())
+	{
+		memset(m_fecParity.data(), 0, FEC_PARITY_HEADER_SIZE + m_fecParityLength);
+	}
+	m_fecGroupCount = 0;
+	m_fecParityLength = 0;
+	m_fecLengthXor = 0;
+	m_fecTypeXor = 0;
 
-	std::vector<uint8_t> frameData = m_frameCodec->EncodeNakFrame(sequence);
-	WriteVerbose("SendNak: frame encoded, size=" + std::to_string(frameData.size()));
+	if (m_fecFlushTimer != TimerQueue::INVALID_TIMER)
+	{
+		m_timerQueue.Cancel(m_fecFlushTimer);
+		m_fecFlushTimer = TimerQueue::INVALID_TIMER;
+	}
+}
 
-	size_t written = 0;
-	TransportError error = m_transport->Write(frameData.data(), frameData.size(), &written);
-	bool success = (error == TransportError::Success && written == frameData.size());
+// 丢包率取区间重传率的指数平均。单个异或校验只能恢复组内一个丢失帧，组大小应使一组内丢失两帧以上的概率保持较低；
+// 被校验帧恢复的丢包不再引发重传，重传率低于实际丢包率，因此取约1/(4p)而非1/(2p)
+void ReliableChannel::UpdateFecGroupSizeLocked()
+{
+	if (m_config.fecGroupSize > 0)
+	{
+		return;
+	}
 
-	WriteVerbose("SendNak: transport write result: error=" + std::to_string(static_cast<int>(error)) +
-		", written=" + std::to_string(written) + ", success=" + std::to_string(success));
+	uint64_t sent = 0;
+	uint64_t retransmitted = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		sent = m_stats.packetsSent;
+		retransmitted = m_stats.packetsRetransmitted;
+	}
 
-	return success;
-}
+	uint64_t sentDelta = sent - m_fecSentSnapshot;
+	if (sentDelta < FEC_LOSS_SAMPLE_PACKETS)
+	{
+		return;
+	}
 
-// 发送心跳
-bool ReliableChannel::SendHeartbeat()
-{
-	// 使用独立的心跳序列号，不占用数据传输序列号
-	uint16_t sequence = m_heartbeatSequence++;
-	WriteVerbose("SendHeartbeat: using independent heartbeat sequence " + std::to_string(sequence));
+	double sample = static_cast<double>(retransmitted - m_fecRetransmitSnapshot) / static_cast<double>(sentDelta);
+	m_fecLossRate = m_fecLossRate * 0.75 + sample * 0.25;
+	m_fecSentSnapshot = sent;
+	m_fecRetransmitSnapshot = retransmitted;
 
-	std::vector<uint8_t> frameData = m_frameCodec->EncodeHeartbeatFrame(sequence);
-	size_t written = 0;
-	return m_transport->Write(frameData.data(), frameData.size(), &written) == TransportError::Success && written == frameData.size();
+	uint32_t groupSize = FEC_MAX_GROUP_SIZE;
+	if (m_fecLossRate * FEC_MAX_GROUP_SIZE > 0.25)
+	{
+		groupSize = static_cast<uint32_t>(0.25 / m_fecLossRate);
+	}
+	m_fecGroupSize = (std::max)((std::min)(groupSize, FEC_MAX_GROUP_SIZE), FEC_MIN_GROUP_SIZE);
 }
 
-// 发送开始帧
-bool ReliableChannel::SendStart(const std::string& fileName, uint64_t fileSize, uint64_t modifyTime)
+void ReliableChannel::OnFecFlushTimer()
 {
-	WriteLog("SendStart called: fileName=" + fileName +
-		", fileSize=" + std::to_string(fileSize) +
-		", modifyTime=" + std::to_string(modifyTime));
-
-	// 【关键修复1】动态生成会话ID，不再写死为0
-	uint16_t sessionId = GenerateSessionId();
-	WriteLog("SendStart: generated sessionId=" + std::to_string(sessionId));
-
-	// 【关键修复2】重置握手状态，准备新的握手过程
-	m_handshakeCompleted.store(false);
-	WriteLog("SendStart: handshake state reset");
+	std::lock_guard<std::mutex> lock(m_windowMutex);
+	m_fecFlushTimer = TimerQueue::INVALID_TIMER;
 
-	StartMetadata metadata;
-	metadata.version = m_config.version;
-	metadata.flags = 0;
-	metadata.fileName = fileName;
-	metadata.fileSize = fileSize;
-	metadata.modifyTime = modifyTime;
-	metadata.sessionId = sessionId;
+	if (!m_connected || !m_fecActive.load() || m_fecGroupCount == 0)
+	{
+		return;
+	}
 
-	// 分配序列号用于START控制帧
-	uint16_t sequence = AllocateSequence();
-	m_handshakeSequence.store(sequence); // 保存握手序列号
-	WriteLog("SendStart: allocated sequence=" + std::to_string(sequence) + " for START frame");
+	// 定时器调度后仍有帧加入本组：发送尚未空闲满FEC_FLUSH_DELAY_MS，顺延到最近一帧之后
+	TimerQueue::Clock::time_point idleDeadline = m_fecLastFrameTime + std::chrono::milliseconds(FEC_FLUSH_DELAY_MS);
+	if (TimerQueue::Clock::now() < idleDeadline)
+	{
+		m_fecFlushTimer = m_timerQueue.Schedule(idleDeadline, [this] { OnFecFlushTimer(); });
+		return;
+	}
 
-	// 编码开始帧
-	WriteLog("SendStart: encoding START frame...");
-	std::vector<uint8_t> frameData = m_frameCodec->EncodeStartFrame(sequence, metadata);
-	WriteLog("SendStart: frame encoded, size=" + std::to_string(frameData.size()));
+	VERBOSE_LOG("OnFecFlushTimer: 发送空闲，补发未满校验组 first={}, count={}", m_fecGroupFirst, m_fecGroupCount);
+	SendParityLocked();
+}
 
-	// 【关键修复3】将START帧也存储到发送窗口中以支持ACK匹配
+// 缓存数据帧的线路形式；重传帧内容与首次相同，已缓存时跳过
+void ReliableChannel::RememberFecFrame(const Frame& frame)
+{
+	if (m_fecCache.empty())
 	{
-		std::lock_guard<std::mutex> lock(m_windowMutex);
-		uint16_t index = sequence % m_config.windowSize;
+		return;
+	}
 
-		if (index < m_sendWindow.size())
-		{
-			// 创建START控制帧的数据包
-			auto packet = std::make_shared<Packet>(sequence, frameData);
-			packet->acknowledged = false;
+	FecCacheEntry& entry = m_fecCache[frame.sequence % m_fecCache.size()];
+	if (entry.payload && entry.sequence == frame.sequence)
+	{
+		return;
+	}
 
-			m_sendWindow[index].packet = packet;
-			m_sendWindow[index].inUse = true;
+	PacketRef payload = m_packetPool.Acquire(frame.payload.size());
+	payload->Assign(frame.payload.data(), frame.payload.size());
+	entry.sequence = frame.sequence;
+	entry.type = frame.type;
+	entry.payload = std::move(payload);
+}
 
-			WriteLog("SendStart: START frame stored in send window at index=" + std::to_string(index));
-		}
-		else
-		{
-			WriteLog("SendStart: ERROR - window index out of bounds: " + std::to_string(index));
-			ReportError("发送窗口索引越界");
-			return false;
-		}
+// 组内恰好缺一帧时由校验帧与其余各帧异或还原，按正常到达的数据帧处理（随后照常确认）；
+// 无缺失或缺失多帧时忽略，由重传机制兜底
+void ReliableChannel::ProcessParityFrame(const Frame& frame)
+{
+	if (!m_fecReceiveActive || m_fecCache.empty())
+	{
+		return;
 	}
 
-	// 发送帧数据
-	WriteLog("SendStart: sending START frame to transport...");
-	size_t written = 0;
-	TransportError error = m_transport->Write(frameData.data(), frameData.size(), &written);
-	bool success = (error == TransportError::Success && written == frameData.size());
+	if (frame.payload.size() < FEC_PARITY_HEADER_SIZE)
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.packetsInvalid++;
+		return;
+	}
 
-	if (success)
+	const uint8_t* header = frame.payload.data();
+	uint32_t count = header[0];
+	uint8_t type = header[1];
+	uint32_t length = static_cast<uint32_t>(header[2]) |
+		(static_cast<uint32_t>(header[3]) << 8) |
+		(static_cast<uint32_t>(header[4]) << 16) |
+		(static_cast<uint32_t>(header[5]) << 24);
+	if (count == 0 || count > FEC_MAX_GROUP_SIZE)
 	{
-		WriteLog("SendStart: START frame sent successfully, " + std::to_string(written) + " bytes written");
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.packetsInvalid++;
+		return;
+	}
 
-		// 更新统计
+	uint32_t mask = m_sequenceMask.load();
+	uint32_t missing = 0;
+	uint32_t missingCount = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t sequence = (frame.sequence + i) & mask;
+		const FecCacheEntry& entry = m_fecCache[sequence % m_fecCache.size()];
+		if (!entry.payload || entry.sequence != sequence)
 		{
-			std::lock_guard<std::mutex> lock(m_statsMutex);
-			m_stats.packetsSent++;
-			m_stats.bytesSent += frameData.size();
+			missing = sequence;
+			if (++missingCount > 1)
+			{
+				return;
+			}
 		}
-
-		WriteLog("SendStart: START control frame stored in send window for ACK tracking");
 	}
-	else
+	if (missingCount == 0)
 	{
-		WriteLog("SendStart: ERROR - failed to send START frame, error=" +
-			std::to_string(static_cast<int>(error)) + ", written=" + std::to_string(written));
+		return;
+	}
 
-		// 发送失败时清理发送窗口
+	Frame& recovered = m_fecRecoveredFrame;
+	recovered.payload.assign(frame.payload.begin() + FEC_PARITY_HEADER_SIZE, frame.payload.end());
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t sequence = (frame.sequence + i) & mask;
+		if (sequence == missing)
 		{
-			std::lock_guard<std::mutex> lock(m_windowMutex);
-			uint16_t index = sequence % m_config.windowSize;
-			if (index < m_sendWindow.size())
-			{
-				m_sendWindow[index].inUse = false;
-				m_sendWindow[index].packet.reset();
-				m_windowCondition.notify_all();
-			}
+			continue;
+		}
+
+		const FecCacheEntry& entry = m_fecCache[sequence % m_fecCache.size()];
+		size_t size = entry.payload->GetPayloadSize();
+		if (size > recovered.payload.size())
+		{
+			std::lock_guard<std::mutex> lock(m_statsMutex);
+			m_stats.packetsInvalid++;
+			return;
 		}
+		XorInto(recovered.payload.data(), entry.payload->Payload(), size);
+		type ^= static_cast<uint8_t>(entry.type);
+		length ^= static_cast<uint32_t>(size);
+	}
 
-		ReportError("START帧发送失败");
+	FrameType recoveredType = static_cast<FrameType>(type);
+	if (length > recovered.payload.size() ||
+		(recoveredType != FrameType::FRAME_DATA && recoveredType != FrameType::FRAME_DATA_COMPRESSED && recoveredType != FrameType::FRAME_DATA_STREAM))
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.packetsInvalid++;
+		WriteLog("ProcessParityFrame: ERROR - inconsistent parity group first=" + std::to_string(frame.sequence));
+		return;
 	}
 
-	return success;
-}
+	recovered.payload.resize(length);
+	recovered.type = recoveredType;
+	recovered.sequence = missing;
+	recovered.version = frame.version;
+	recovered.valid = true;
 
-// 发送结束帧
-bool ReliableChannel::SendEnd()
-{
-	uint16_t sequence = AllocateSequence();
-	return SendPacket(sequence, {}, FrameType::FRAME_END);
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.fecRecoveredFrames++;
+	}
+	VERBOSE_LOG("ProcessParityFrame: recovered sequence={} from group first={}, count={}", missing, frame.sequence, count);
+
+	ProcessIncomingFrame(recovered);
 }
 
-// 重传数据包（内部版本，假设已持有窗口锁）
-void ReliableChannel::RetransmitPacketInternal(uint16_t sequence)
+// 多路复用会话：带START_FLAG_MULTIPLEX的START握手，对端确认后本会话的数据帧均带流头
+bool ReliableChannel::EnsureMultiplexSession()
 {
-	WriteLog("RetransmitPacketInternal called: sequence=" + std::to_string(sequence));
+	if (!m_config.enableMultiplexing || m_config.version < PROTOCOL_VERSION_2)
+	{
+		return false;
+	}
+	if (m_multiplexActive.load() && m_handshakeCompleted.load())
+	{
+		return true;
+	}
 
-	// 确保窗口大小有效
-	if (m_config.windowSize == 0 || m_sendWindow.empty())
+	std::lock_guard<std::mutex> lock(m_muxSessionMutex);
+	if (m_multiplexActive.load() && m_handshakeCompleted.load())
 	{
-		WriteLog("RetransmitPacketInternal: ERROR - send window not initialized or size is 0");
-		ReportError("发送窗口未初始化或大小为0");
-		return;
+		return true;
 	}
 
-	uint16_t index = sequence % m_config.windowSize;
-	WriteLog("RetransmitPacketInternal: calculated index=" + std::to_string(index) +
-		", sendWindow.size()=" + std::to_string(m_sendWindow.size()));
+	uint64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count();
+	if (!SendStart("", 0, now, 0, START_FLAG_MULTIPLEX))
+	{
+		return false;
+	}
 
-	// 边界检查
-	if (index >= m_sendWindow.size())
+	if (!WaitForHandshakeCompletion(m_config.timeoutMax * 2))
 	{
-		WriteLog("RetransmitPacketInternal: ERROR - send window index out of bounds: " + std::to_string(index) +
-			" >= " + std::to_string(m_sendWindow.size()));
-		ReportError("发送窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_sendWindow.size()));
-		return;
+		ReportError("多路复用会话START帧ACK超时，接收端未响应");
+		return false;
 	}
 
-	WriteLog("RetransmitPacketInternal: checking slot " + std::to_string(index) +
-		", inUse=" + std::to_string(m_sendWindow[index].inUse));
+	WriteLog("EnsureMultiplexSession: multiplex " + std::string(m_multiplexActive.load() ? "enabled" : "declined by peer"));
+	return m_multiplexActive.load();
+}
 
-	if (m_sendWindow[index].inUse && m_sendWindow[index].packet)
-	{
-		WriteLog("RetransmitPacketInternal: incrementing retry count from " + std::to_string(m_sendWindow[index].packet->retryCount));
-		m_sendWindow[index].packet->retryCount++;
-		m_sendWindow[index].packet->timestamp = std::chrono::steady_clock::now();
-		WriteLog("RetransmitPacketInternal: new retry count=" + std::to_string(m_sendWindow[index].packet->retryCount));
+PacketRef ReliableChannel::AcquireMuxPacket(uint16_t streamId, MuxRecordType type, size_t bodySize)
+{
+	PacketRef packet = m_packetPool.Acquire(MUX_HEADER_SIZE + bodySize);
+	uint8_t* header = packet->Payload();
+	header[0] = static_cast<uint8_t>(streamId & 0xFF);
+	header[1] = static_cast<uint8_t>((streamId >> 8) & 0xFF);
+	header[2] = static_cast<uint8_t>(type);
+	return packet;
+}
 
-		// 重新发送数据包
-		WriteLog("RetransmitPacketInternal: encoding data frame for retransmission");
-		try
+// 放入流的发送队列：每个流最多MUX_STREAM_QUEUE_PACKETS个包，单个流写得快只会等待自己的队列，
+// 不会挤占其他流的出队机会（出队按流轮转）
+bool ReliableChannel::EnqueueStreamPacket(uint16_t streamId, PacketRef packet)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_sendMutex);
+		while (true)
 		{
-			std::vector<uint8_t> frameData = m_frameCodec->EncodeDataFrame(
-				sequence, m_sendWindow[index].packet->data);
-			WriteLog("RetransmitPacketInternal: frame encoded, size=" + std::to_string(frameData.size()));
-
-			size_t written = 0;
-			WriteLog("RetransmitPacketInternal: writing to transport...");
-			TransportError error = m_transport->Write(frameData.data(), frameData.size(), &written);
-			WriteLog("RetransmitPacketInternal: transport write completed, written=" + std::to_string(written) +
-				", error=" + std::to_string(static_cast<int>(error)));
+			if (m_shutdown || !IsConnected())
+			{
+				return false;
+			}
 
-			if (error != TransportError::Success)
+			auto it = m_muxSendStreams.find(streamId);
+			if (it == m_muxSendStreams.end() || it->second.closed)
 			{
-				WriteLog("RetransmitPacketInternal: ERROR - transport write failed with error: " + std::to_string(static_cast<int>(error)));
-				ReportError("重传数据包失败，传输错误: " + std::to_string(static_cast<int>(error)));
-				return;
+				WriteLog("EnqueueStreamPacket: stream " + std::to_string(streamId) + " is not open");
+				return false;
 			}
 
-			// 更新统计
+			if (it->second.queue.size() < MUX_STREAM_QUEUE_PACKETS)
 			{
-				std::lock_guard<std::mutex> statsLock(m_statsMutex);
-				m_stats.packetsRetransmitted++;
-				WriteLog("RetransmitPacketInternal: stats updated, packetsRetransmitted=" + std::to_string(m_stats.packetsRetransmitted));
+				it->second.queue.push(std::move(packet));
+				break;
 			}
 
-			WriteLog("RetransmitPacketInternal: retransmission completed successfully");
-		}
-		catch (const std::exception& e)
-		{
-			WriteLog("RetransmitPacketInternal: EXCEPTION during retransmission: " + std::string(e.what()));
-			ReportError("重传数据包异常: " + std::string(e.what()));
-		}
-		catch (...)
-		{
-			WriteLog("RetransmitPacketInternal: UNKNOWN EXCEPTION during retransmission");
-			ReportError("重传数据包未知异常");
+			// 流队列满：等待发送线程出队（超时后重新检查通道状态）
+			m_sendCondition.wait_for(lock, std::chrono::milliseconds(1000));
 		}
+
+		// 发送线程与等待队列空间的写入方共用条件变量，须全部唤醒
+		m_sendCondition.notify_all();
 	}
-	else
+
+	if (m_reactor)
 	{
-		WriteLog("RetransmitPacketInternal: ERROR - slot not in use or no packet: inUse=" + std::to_string(m_sendWindow[index].inUse) +
-			", hasPacket=" + std::to_string(m_sendWindow[index].packet != nullptr));
+		m_reactor->Wake();
 	}
-
-	WriteLog("RetransmitPacketInternal: completed");
-}
-
-// 重传数据包（外部版本，负责获取锁）
-void ReliableChannel::RetransmitPacket(uint16_t sequence)
-{
-	WriteLog("RetransmitPacket called: sequence=" + std::to_string(sequence));
-
-	std::lock_guard<std::mutex> lock(m_windowMutex);
-	WriteLog("RetransmitPacket: locked window mutex");
-
-	RetransmitPacketInternal(sequence);
-
-	WriteLog("RetransmitPacket: completed");
+	return true;
 }
 
-// 推进发送窗口
-void ReliableChannel::AdvanceSendWindow()
+// 轮转出队：从m_muxNextTurn起找第一个有数据的流，越过最大ID后轮到流0（m_sendQueue），再从最小ID继续；
+// 每次只取一个包，各流的帧在窗口中交替出现。未使用多路复用时只有m_sendQueue。
+bool ReliableChannel::PopSendPacketLocked(PacketRef& packet, bool& streamFinished)
 {
-	WriteLog("AdvanceSendWindow called");
-
-	int advanceCount = 0;
-	while (true)
-	{
-		WriteLog("AdvanceSendWindow: checking window, sendBase=" + std::to_string(m_sendBase) +
-			", windowSize=" + std::to_string(m_config.windowSize));
-
-		// 确保窗口大小有效
-		if (m_config.windowSize == 0 || m_sendWindow.empty())
+	streamFinished = false;
+	auto takeFrom = [this, &packet, &streamFinished](std::map<uint16_t, MuxSendStream>::iterator it) {
+		if (it->second.queue.empty())
 		{
-			WriteLog("AdvanceSendWindow: ERROR - window not initialized or size is 0");
-			ReportError("发送窗口未初始化或大小为0");
-			break;
+			return false;
 		}
 
-		uint16_t index = m_sendBase % m_config.windowSize;
-		WriteLog("AdvanceSendWindow: calculated index=" + std::to_string(index) +
-			", sendWindow.size()=" + std::to_string(m_sendWindow.size()));
-
-		// 边界检查
-		if (index >= m_sendWindow.size())
+		packet = std::move(it->second.queue.front());
+		it->second.queue.pop();
+		m_muxNextTurn = static_cast<uint32_t>(it->first) + 1;
+		if (it->second.closed && it->second.queue.empty())
 		{
-			WriteLog("AdvanceSendWindow: ERROR - index out of bounds: " + std::to_string(index) +
-				" >= " + std::to_string(m_sendWindow.size()));
-			ReportError("发送窗口索引越界: " + std::to_string(index) + " >= " + std::to_string(m_sendWindow.size()));
-			break;
+			// 流已从表中移除，但最后一个包尚未分配序列号，由OnStreamLastPacketSequenced计数归零
+			m_muxSendStreams.erase(it);
+			m_muxUnsequencedStreamEnds++;
+			streamFinished = true;
 		}
+		return true;
+	};
 
-		WriteLog("AdvanceSendWindow: checking slot " + std::to_string(index) +
-			", inUse=" + std::to_string(m_sendWindow[index].inUse));
+	auto turn = (m_muxNextTurn > 0xFFFF) ? m_muxSendStreams.end() : m_muxSendStreams.lower_bound(static_cast<uint16_t>(m_muxNextTurn));
 
-		if (m_sendWindow[index].inUse && m_sendWindow[index].packet &&
-			m_sendWindow[index].packet->acknowledged)
-		{
-			WriteLog("AdvanceSendWindow: advancing window, old sendBase=" + std::to_string(m_sendBase));
-			m_sendWindow[index].inUse = false;
-			m_sendWindow[index].packet.reset();
-			m_sendBase = (m_sendBase + 1) % 65536;
-			advanceCount++;
-			WriteLog("AdvanceSendWindow: new sendBase=" + std::to_string(m_sendBase) + ", advanceCount=" + std::to_string(advanceCount));
-		}
-		else
+	for (auto it = turn; it != m_muxSendStreams.end(); ++it)
+	{
+		if (takeFrom(it))
 		{
-			WriteLog("AdvanceSendWindow: no more slots to advance, breaking");
-			break;
+			return true;
 		}
 	}
 
-	WriteLog("AdvanceSendWindow: completed, advanced " + std::to_string(advanceCount) + " slots");
+	if (!m_sendQueue.empty())
+	{
+		packet = std::move(m_sendQueue.front());
+		m_sendQueue.pop();
+		m_muxNextTurn = 1;
+		return true;
+	}
 
-	if (advanceCount > 0)
+	for (auto it = m_muxSendStreams.begin(); it != turn; ++it)
 	{
-		m_windowCondition.notify_all();
+		if (takeFrom(it))
+		{
+			return true;
+		}
 	}
+	return false;
 }
 
-// 更新接收窗口
-void ReliableChannel::UpdateReceiveWindow(uint16_t sequence)
+void ReliableChannel::OnStreamLastPacketSequenced()
 {
-	// 这里可以实现更复杂的接收窗口管理逻辑
+	std::lock_guard<std::mutex> lock(m_sendMutex);
+	if (m_muxUnsequencedStreamEnds > 0)
+	{
+		m_muxUnsequencedStreamEnds--;
+	}
+	m_sendCondition.notify_all();
 }
 
-// 分配序列号
-bool ReliableChannel::IsSendWindowFullLocked() const
+bool ReliableChannel::HasPendingSendLocked() const
 {
-	if (m_config.windowSize == 0 || m_sendWindow.empty())
+	if (!m_sendQueue.empty())
 	{
-		return false;
+		return true;
+	}
+	for (const auto& stream : m_muxSendStreams)
+	{
+		if (!stream.second.queue.empty())
+		{
+			return true;
+		}
 	}
+	return false;
+}
 
-	uint16_t outstanding = GetWindowDistance(m_sendBase, m_sendNext);
-	if (outstanding < m_config.windowSize)
+// 处理按序交付的流记录（已还原流式压缩）。默认流的数据去掉流头后返回true，由调用方按原路径交付；
+// 其他记录在此消费，返回false
+bool ReliableChannel::DeliverMuxRecordLocked(Packet& packet)
+{
+	size_t size = packet.buffer ? packet.buffer->GetPayloadSize() : 0;
+	if (size < MUX_HEADER_SIZE)
 	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.packetsInvalid++;
+		WriteLog("DeliverMuxRecordLocked: ERROR - frame too short for stream header, sequence=" + std::to_string(packet.sequence));
 		return false;
 	}
 
-	uint16_t index = m_sendNext % m_config.windowSize;
-	if (index >= m_sendWindow.size())
+	uint8_t* payload = packet.buffer->Payload();
+	uint16_t streamId = static_cast<uint16_t>(payload[0] | (payload[1] << 8));
+	MuxRecordType type = static_cast<MuxRecordType>(payload[2]);
+	const uint8_t* body = payload + MUX_HEADER_SIZE;
+	size_t bodySize = size - MUX_HEADER_SIZE;
+
+	if (streamId == 0 && type == MuxRecordType::MUX_DATA)
 	{
+		memmove(payload, body, bodySize);
+		packet.buffer->SetPayloadSize(bodySize);
 		return true;
 	}
 
-	const auto& slot = m_sendWindow[index];
-	bool slotBusy = slot.inUse && (!slot.packet || !slot.packet->acknowledged);
-	return slotBusy;
-}
-
-uint16_t ReliableChannel::AllocateSequence()
-{
-	WriteLog("AllocateSequence called");
-
-	std::unique_lock<std::mutex> lock(m_windowMutex);
-
-	return AllocateSequenceLocked(lock);
-}
+	switch (type)
+	{
+	case MuxRecordType::MUX_OPEN:
+		OpenReceiveStreamLocked(streamId, body, bodySize);
+		break;
 
-// 【新增】内部版本：要求调用方必须已经持有m_windowMutex锁
-uint16_t ReliableChannel::AllocateSequenceLocked(std::unique_lock<std::mutex>& lock)
-{
-	WriteLog("AllocateSequenceLocked called (caller already holds lock)");
+	case MuxRecordType::MUX_DATA:
+	{
+		auto it = m_muxReceiveStreams.find(streamId);
+		if (it == m_muxReceiveStreams.end())
+		{
+			WriteLog("DeliverMuxRecordLocked: data for unknown stream " + std::to_string(streamId));
+			break;
+		}
 
-	WriteLog("AllocateSequenceLocked: sendWindow.size()=" + std::to_string(m_sendWindow.size()) +
-		", windowSize=" + std::to_string(m_config.windowSize));
+		MuxReceiveStream& stream = it->second;
+		if (!stream.sink)
+		{
+			stream.data.insert(stream.data.end(), body, body + bodySize);
+		}
+		else if (!stream.failed && !stream.sink->Write(body, bodySize))
+		{
+			stream.failed = true;
+			ReportError("接收数据写入失败: " + stream.info.fileName);
+		}
+		break;
+	}
 
-	// 确保窗口已初始化
-	if (m_sendWindow.empty() || m_config.windowSize == 0)
+	case MuxRecordType::MUX_CLOSE:
 	{
-		WriteLog("AllocateSequenceLocked: ERROR - window not initialized or size is 0");
-		ReportError("发送窗口未初始化或大小为0");
-		return 0;
+		auto it = m_muxReceiveStreams.find(streamId);
+		if (it != m_muxReceiveStreams.end())
+		{
+			FinishReceiveStreamLocked(streamId, it->second, bodySize > 0 && body[0] != 0);
+			m_muxReceiveStreams.erase(it);
+		}
+		break;
 	}
 
-	while (!m_shutdown.load() && m_connected.load() && IsSendWindowFullLocked())
+	default:
 	{
-		WriteLog("AllocateSequenceLocked: send window full (sendBase=" + std::to_string(m_sendBase) +
-			", sendNext=" + std::to_string(m_sendNext) + "), waiting for availability");
-
-		m_windowCondition.wait(lock, [this]() {
-			return m_shutdown.load() || !m_connected.load() || !IsSendWindowFullLocked();
-			});
-
-		WriteLog("AllocateSequenceLocked: wake, current sendBase=" + std::to_string(m_sendBase) +
-			", sendNext=" + std::to_string(m_sendNext));
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.packetsInvalid++;
+		WriteLog("DeliverMuxRecordLocked: ERROR - unknown record type " + std::to_string(static_cast<int>(type)));
+		break;
 	}
-
-	uint16_t sequence = m_sendNext;
-	WriteLog("AllocateSequenceLocked: returning sequence " + std::to_string(sequence) +
-		", next will be " + std::to_string((m_sendNext + 1) % 65536));
-	m_sendNext = (m_sendNext + 1) % 65536;
-	return sequence;
+	}
+	return false;
 }
 
-// 检查序列号是否在窗口内
-bool ReliableChannel::IsSequenceInWindow(uint16_t sequence, uint16_t base, uint16_t windowSize) const
+void ReliableChannel::OpenReceiveStreamLocked(uint16_t streamId, const uint8_t* body, size_t bodySize)
 {
-	bool result;
-	if (sequence >= base)
-	{
-		uint16_t diff = sequence - base;
-		result = diff < windowSize;
-	}
-	else
+	StartMetadata metadata;
+	if (!m_frameCodec->DecodeStartMetadata(body, bodySize, metadata))
 	{
-		uint16_t diff = 65536 - base + sequence;
-		result = diff < windowSize;
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.packetsInvalid++;
+		WriteLog("OpenReceiveStreamLocked: ERROR - failed to decode OPEN record for stream " + std::to_string(streamId));
+		return;
 	}
-	return result;
-}
 
-// 获取窗口距离
-uint16_t ReliableChannel::GetWindowDistance(uint16_t from, uint16_t to) const
-{
-	uint16_t result;
-	if (to >= from)
+	// 同ID的旧流未收到CLOSE即被复用，说明其数据已不完整
+	auto existing = m_muxReceiveStreams.find(streamId);
+	if (existing != m_muxReceiveStreams.end())
 	{
-		result = to - from;
+		FinishReceiveStreamLocked(streamId, existing->second, false);
+		m_muxReceiveStreams.erase(existing);
 	}
-	else
+
+	MuxReceiveStream& stream = m_muxReceiveStreams[streamId];
+	stream.info.fileName = metadata.fileName;
+	stream.info.fileSize = static_cast<int64_t>(metadata.fileSize);
+	stream.info.modifyTime = metadata.modifyTime;
+	stream.info.sessionId = streamId;
+	stream.info.resumable = false; // OPEN记录不等待回复，流不支持续传
+
+	if (m_streamSinkFactory)
 	{
-		result = 65536 - from + to;
+		stream.sink = m_streamSinkFactory(stream.info);
+		int64_t resumeOffset = 0;
+		if (stream.sink && !stream.sink->Begin(stream.info, resumeOffset))
+		{
+			ReportError("接收数据落地打开失败，改用内存缓冲: " + stream.info.fileName);
+			stream.sink.reset();
+		}
 	}
-	return result;
-}
 
-// 计算超时时间
-uint32_t ReliableChannel::CalculateTimeout() const
-{
-	// 【P0修复】应用最小超时地板值，避免近零延迟环境下的假超时
-	uint32_t result = m_timeoutMs;
-	result = (std::max)(result, m_config.timeoutMin); // 应用最小超时保护
-	result = (std::min)(result, m_config.timeoutMax); // 应用最大超时限制
-	return result;
+	VERBOSE_LOG("OpenReceiveStreamLocked: stream {} opened for {}, size={}", streamId, stream.info.fileName, stream.info.fileSize);
 }
 
-// 更新RTT
-void ReliableChannel::UpdateRTT(uint32_t rttMs)
+void ReliableChannel::FinishReceiveStreamLocked(uint16_t streamId, MuxReceiveStream& stream, bool success)
 {
-	// 使用指数加权移动平均
-	m_rttMs = (m_rttMs * 7 + rttMs) / 8;
-	m_timeoutMs = m_rttMs * 2; // 超时时间是RTT的两倍
+	if (stream.sink && !stream.sink->Finish(success && !stream.failed) && !stream.failed)
+	{
+		ReportError("接收数据落地失败: " + stream.info.fileName);
+		stream.failed = true;
+	}
+	success = success && !stream.failed;
 
-	// 【P0修复】限制超时时间范围，添加最小超时地板值保护
-	m_timeoutMs = (std::max)(m_timeoutMs, m_config.timeoutMin);  // 应用最小超时保护
-	m_timeoutMs = (std::max)(m_timeoutMs, m_config.timeoutBase); // 应用基础超时保护
-	m_timeoutMs = (std::min)(m_timeoutMs, m_config.timeoutMax);  // 应用最大超时限制
-}
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.muxStreamsReceived++;
+	}
 
-// 压缩数据
-std::vector<uint8_t> ReliableChannel::CompressData(const std::vector<uint8_t>& data) const
-{
-	// 本版本不包含数据压缩功能
-	return data;
+	WriteLog("FinishReceiveStreamLocked: stream " + std::to_string(streamId) + " (" + stream.info.fileName + ") " +
+		(success ? "completed" : "aborted"));
+
+	if (m_streamCompleteCallback)
+	{
+		m_streamCompleteCallback(streamId, stream.info, stream.data, success);
+	}
 }
 
-// 解压缩数据
-std::vector<uint8_t> ReliableChannel::DecompressData(const std::vector<uint8_t>& data) const
+void ReliableChannel::AbortReceiveStreamsLocked()
 {
-	// 本版本不包含数据解压缩功能
-	return data;
+	for (auto& entry : m_muxReceiveStreams)
+	{
+		FinishReceiveStreamLocked(entry.first, entry.second, false);
+	}
+	m_muxReceiveStreams.clear();
 }
 
 // 加密数据
@@ -2437,17 +4636,17 @@ void ReliableChannel::ReportError(const std::string& error)
 	{
 		std::lock_guard<std::mutex> lock(m_statsMutex);
 		m_stats.errors++;
-		WriteVerbose("ReportError: error count incremented to " + std::to_string(m_stats.errors));
+		VERBOSE_LOG("ReportError: error count incremented to {}", m_stats.errors);
 	}
 
 	if (m_errorCallback)
 	{
-		WriteVerbose("ReportError: calling error callback");
+		VERBOSE_LOG("ReportError: calling error callback");
 		m_errorCallback(error);
 	}
 	else
 	{
-		WriteVerbose("ReportError: no error callback set");
+		VERBOSE_LOG("ReportError: no error callback set");
 	}
 }
 
@@ -2515,6 +4714,7 @@ bool ReliableChannel::CheckTransferTimeout()
 			lastLogTime = now; // 更新最后日志时间
 		}
 
+		FinishReceiveSink(false);
 		m_fileTransferActive = false;
 
 		// 【保留】错误报告始终执行（不受节流限制），确保UI能及时得到通知
@@ -2545,6 +4745,27 @@ uint16_t ReliableChannel::GenerateSessionId()
 	return sessionId;
 }
 
+// 填充START帧的协议参数
+void ReliableChannel::FillStartMetadata(StartMetadata& metadata) const
+{
+	metadata.version = m_config.version;
+	metadata.flags = m_config.enableSelectiveAck ? START_FLAG_SELECTIVE_ACK : 0;
+	if (m_config.enableCompression && m_config.version >= PROTOCOL_VERSION_2)
+	{
+		metadata.flags |= START_FLAG_COMPRESSION;
+		if (m_config.enableStreamCompression)
+		{
+			metadata.flags |= START_FLAG_STREAM_COMPRESSION;
+		}
+	}
+	if (m_config.enableFec && m_config.version >= PROTOCOL_VERSION_2)
+	{
+		metadata.flags |= START_FLAG_FEC;
+	}
+	metadata.windowSize = m_config.windowSize;
+	metadata.maxPayloadSize = m_config.maxPayloadSize;
+}
+
 // 等待握手完成
 bool ReliableChannel::WaitForHandshakeCompletion(uint32_t timeoutMs)
 {
@@ -2574,7 +4795,7 @@ bool ReliableChannel::WaitForHandshakeCompletion(uint32_t timeoutMs)
 // 【P0修复】确保会话已启动，如果未启动则自动执行握手
 bool ReliableChannel::EnsureSessionStarted()
 {
-	WriteLog("EnsureSessionStarted: checking session status");
+	VERBOSE_LOG("EnsureSessionStarted: checking session status");
 
 	// 检查是否已经连接
 	if (!IsConnected())
@@ -2586,24 +4807,23 @@ bool ReliableChannel::EnsureSessionStarted()
 	// 检查握手是否已完成
 	if (m_handshakeCompleted.load())
 	{
-		WriteLog("EnsureSessionStarted: handshake already completed, sessionId=" + std::to_string(m_sessionId.load()));
+		VERBOSE_LOG("EnsureSessionStarted: handshake already completed, sessionId={}", m_sessionId.load());
 		return true;
 	}
 
-	WriteLog("EnsureSessionStarted: handshake not completed, initiating new handshake");
+	VERBOSE_LOG("EnsureSessionStarted: handshake not completed, initiating new handshake");
 
 	// 生成会话ID
 	uint16_t sessionId = GenerateSessionId();
-	WriteLog("EnsureSessionStarted: generated sessionId=" + std::to_string(sessionId));
+	VERBOSE_LOG("EnsureSessionStarted: generated sessionId={}", sessionId);
 
 	// 重置握手状态
 	m_handshakeCompleted.store(false);
-	WriteLog("EnsureSessionStarted: handshake state reset");
+	VERBOSE_LOG("EnsureSessionStarted: handshake state reset");
 
 	// 构造START帧的元数据（用于握手，不包含文件信息）
 	StartMetadata metadata;
-	metadata.version = m_config.version;
-	metadata.flags = 0;
+	FillStartMetadata(metadata);
 	metadata.fileName = ""; // 空文件名表示纯握手
 	metadata.fileSize = 0;
 	metadata.modifyTime = std::chrono::duration_cast<std::chrono::seconds>(
@@ -2611,34 +4831,41 @@ bool ReliableChannel::EnsureSessionStarted()
 	metadata.sessionId = sessionId;
 
 	// 【修复】统一管理锁操作，避免递归锁定
-	uint16_t sequence;
+	uint32_t sequence;
 	std::vector<uint8_t> frameData;
 
 	{
 		std::unique_lock<std::mutex> lock(m_windowMutex);
 
+		// 新会话从初始拥塞窗口开始探测链路容量
+		ResetCongestionWindowLocked();
+
 		// 分配序列号用于START控制帧（使用内部版本，避免重复锁定）
 		sequence = AllocateSequenceLocked(lock);
 		m_handshakeSequence.store(sequence);
-		WriteLog("EnsureSessionStarted: allocated sequence=" + std::to_string(sequence) + " for handshake START frame");
+		VERBOSE_LOG("EnsureSessionStarted: allocated sequence={} for handshake START frame", sequence);
 
 		// 编码开始帧
-		WriteLog("EnsureSessionStarted: encoding handshake START frame");
+		VERBOSE_LOG("EnsureSessionStarted: encoding handshake START frame");
 		frameData = m_frameCodec->EncodeStartFrame(sequence, metadata);
-		WriteLog("EnsureSessionStarted: frame encoded, size=" + std::to_string(frameData.size()));
+		VERBOSE_LOG("EnsureSessionStarted: frame encoded, size={}", frameData.size());
 
 		// 将START帧存储到发送窗口中以支持ACK匹配
-		uint16_t index = sequence % m_config.windowSize;
+		uint32_t index = sequence % m_config.windowSize;
+
+		// 新会话，等待对端重新通告接收窗口
+		m_peerWindowKnown = false;
 
 		if (index < m_sendWindow.size())
 		{
-			auto packet = std::make_shared<Packet>(sequence, frameData);
+			auto packet = std::make_shared<Packet>(sequence, StoreEncodedFrame(frameData));
 			packet->acknowledged = false;
 
 			m_sendWindow[index].packet = packet;
 			m_sendWindow[index].inUse = true;
+			ArmRetransmitTimerLocked(packet);
 
-			WriteLog("EnsureSessionStarted: handshake START frame stored in send window at index=" + std::to_string(index));
+			VERBOSE_LOG("EnsureSessionStarted: handshake START frame stored in send window at index={}", index);
 		}
 		else
 		{
@@ -2649,7 +4876,7 @@ bool ReliableChannel::EnsureSessionStarted()
 	}
 
 	// 发送握手帧
-	WriteLog("EnsureSessionStarted: sending handshake START frame to transport");
+	VERBOSE_LOG("EnsureSessionStarted: sending handshake START frame to transport");
 	size_t written = 0;
 	TransportError error = m_transport->Write(frameData.data(), frameData.size(), &written);
 	bool success = (error == TransportError::Success && written == frameData.size());
@@ -2662,18 +4889,18 @@ bool ReliableChannel::EnsureSessionStarted()
 		// 发送失败时清理发送窗口
 		{
 			std::lock_guard<std::mutex> lock(m_windowMutex);
-			uint16_t index = sequence % m_config.windowSize;
+			uint32_t index = sequence % m_config.windowSize;
 			if (index < m_sendWindow.size())
 			{
-				m_sendWindow[index].inUse = false;
-				m_sendWindow[index].packet.reset();
+				CancelRetransmitTimerLocked(m_sendWindow[index].packet);
+				m_sendWindow[index].Release();
 				m_windowCondition.notify_all();
 			}
 		}
 		return false;
 	}
 
-	WriteLog("EnsureSessionStarted: handshake START frame sent successfully, " + std::to_string(written) + " bytes written");
+	VERBOSE_LOG("EnsureSessionStarted: handshake START frame sent successfully, {} bytes written", written);
 
 	// 更新统计
 	{
@@ -2684,13 +4911,13 @@ bool ReliableChannel::EnsureSessionStarted()
 
 	// 等待握手完成，使用配置的超时时间
 	uint32_t timeoutMs = m_config.timeoutMax; // 使用最大超时时间
-	WriteLog("EnsureSessionStarted: waiting for handshake completion, timeout=" + std::to_string(timeoutMs) + "ms");
+	VERBOSE_LOG("EnsureSessionStarted: waiting for handshake completion, timeout={}ms", timeoutMs);
 
 	bool handshakeSuccess = WaitForHandshakeCompletion(timeoutMs);
 
 	if (handshakeSuccess)
 	{
-		WriteLog("EnsureSessionStarted: handshake completed successfully, sessionId=" + std::to_string(m_sessionId.load()));
+		VERBOSE_LOG("EnsureSessionStarted: handshake completed successfully, sessionId={}", m_sessionId.load());
 	}
 	else
 	{
@@ -2699,11 +4926,11 @@ bool ReliableChannel::EnsureSessionStarted()
 		// 握手失败时清理发送窗口
 		{
 			std::lock_guard<std::mutex> lock(m_windowMutex);
-			uint16_t index = sequence % m_config.windowSize;
+			uint32_t index = sequence % m_config.windowSize;
 			if (index < m_sendWindow.size())
 			{
-				m_sendWindow[index].inUse = false;
-				m_sendWindow[index].packet.reset();
+				CancelRetransmitTimerLocked(m_sendWindow[index].packet);
+				m_sendWindow[index].Release();
 				m_windowCondition.notify_all();
 			}
 		}
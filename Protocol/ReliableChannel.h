@@ -2,6 +2,11 @@
 #pragma execution_character_set("utf-8")
 
 #include "FrameCodec.h"
+#include "TimerQueue.h"
+#include "PacketPool.h"
+#include "ReceiveSink.h"
+#include "FileSource.h"
+#include "LzCodec.h"
 #include "../Transport/ITransport.h"
 #include "../Common/RingBuffer.h"
 #include <memory>
@@ -10,23 +15,35 @@
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <map>
 #include <chrono>
 #include <functional>
 
+class ChannelReactor;
+
 // 可靠传输配置
 struct ReliableConfig
 {
-	uint8_t version = 1;               // 协议版本
-	uint16_t windowSize = 4;           // 滑动窗口大小
+	uint8_t version = 2;               // 协议版本（握手时与对端协商，取双方较低者）
+	uint16_t windowSize = 4;           // 滑动窗口大小（建议取2的幂）
 	uint16_t maxRetries = 3;           // 最大重试次数
 	uint32_t timeoutBase = 500;        // 基础超时时间(ms)
 	uint32_t timeoutMin = 100;         // 【P0修复】最小超时时间(ms)，避免近零延迟环境下的假超时
 	uint32_t timeoutMax = 2000;        // 最大超时时间(ms)
 	uint32_t heartbeatInterval = 1000; // 心跳间隔(ms)
 	uint32_t maxPayloadSize = 1024;    // 最大负载大小
-	bool enableCompression = false;    // 启用压缩
+	bool enableCompression = false;    // 启用压缩：数据帧逐帧LZ压缩，无收益的帧按原样发送（需对端在START握手中确认）
+	bool enableStreamCompression = false; // 跨帧字典压缩：以最近64KB已发送数据为字典，小负载帧收益明显（需同时启用enableCompression）
 	bool enableEncryption = false;     // 启用加密
 	std::string encryptionKey;         // 加密密钥
+	bool enableSelectiveAck = true;    // 启用选择确认(SACK)，需对端在START帧中声明支持
+	bool enableAdaptiveWindow = true;  // 启用AIMD拥塞窗口，按RTT和丢包调整在途包数
+	uint16_t minWindowSize = 2;        // 拥塞窗口下限
+	bool enableReactor = false;        // 单线程反应器模式：不创建工作线程，由ChannelReactor驱动（见SetReactor）
+	bool enableResume = true;          // 断点续传：接收端落地到文件时记录检查点，START握手协商续传偏移（需v2）
+	bool enableFec = false;            // 前向纠错：每K个数据帧附加一个异或校验帧，接收端无需重传即可恢复组内单个丢失帧（需v2，对端在START握手中确认）
+	uint8_t fecGroupSize = 0;          // 校验组大小K（0表示按观测到的丢包率自适应）
+	bool enableMultiplexing = false;   // 多路复用：SendFiles在一个会话内并发传输多个文件，各文件占一个流（需v2，对端在START握手中确认）
 };
 
 // 可靠传输统计信息
@@ -40,14 +57,52 @@ struct ReliableStats
 	uint64_t bytesReceived = 0;        // 接收字节数
 	uint64_t timeouts = 0;             // 超时次数
 	uint64_t errors = 0;               // 错误次数
+	uint64_t acksSent = 0;             // 发送的确认帧数（ACK/SACK）
+	uint64_t fastRetransmits = 0;      // SACK触发的快速重传次数
+	uint64_t congestionEvents = 0;     // 拥塞窗口减半次数
 	double throughputBps = 0.0;        // 吞吐率
 	uint32_t rttMs = 0;                // 往返时延
 	uint8_t packetLossRate = 0;        // 丢包率(百分比)
+	uint32_t sendWindow = 0;           // 当前有效发送窗口（包数）
+	uint8_t protocolVersion = 1;       // 协商后的协议版本
+	uint32_t retransmitLatencyP50Us = 0; // 超时重传相对截止时间的延迟（中位数，微秒）
+	uint32_t retransmitLatencyP99Us = 0; // 超时重传相对截止时间的延迟（P99，微秒）
+	uint64_t timerWakeups = 0;         // 定时器线程唤醒次数（反应器模式下为反应器唤醒次数）
+	uint64_t packetPoolOverflows = 0;  // 包缓冲池耗尽或超出容量时的单独分配次数
+	uint64_t fileReadStalls = 0;       // 发送文件时等待磁盘预读的次数
+	uint64_t resumedBytes = 0;         // 断点续传跳过（无需重发）的字节数
+	uint64_t compressedFrames = 0;     // 以压缩形式发送的数据帧数（含流式压缩）
+	uint64_t streamCompressedFrames = 0; // 其中以流式压缩发送的数据帧数
+	uint64_t streamDictionaryResets = 0; // 发送端因序列不连续重置字典的次数
+	uint64_t fecParityFrames = 0;      // 发送的校验帧数
+	uint64_t fecRecoveredFrames = 0;   // 由校验帧恢复（免于等待重传）的数据帧数
+	uint32_t fecGroupSize = 0;         // 当前校验组大小（未启用前向纠错时为0）
+	uint64_t compressionSavedBytes = 0; // 压缩节省的负载字节数
+	uint64_t muxStreamsOpened = 0;     // 发送端打开的多路复用流数
+	uint64_t muxStreamsReceived = 0;   // 接收端结束（收到CLOSE或被新会话中止）的流数
 };
 
 // 可靠传输通道
 class ReliableChannel
 {
+public:
+	static const uint16_t MAX_WINDOW_SIZE = 1024;        // 窗口大小上限
+	static const uint16_t INITIAL_CONGESTION_WINDOW = 4; // 拥塞窗口初始值
+	static const size_t RETRANSMIT_LATENCY_SAMPLES = 256; // 重传延迟统计样本数
+	static const int REACTOR_READ_BUDGET = 64;           // 反应器每轮对单个通道的最大读取次数
+	static const size_t PACKET_POOL_MEMORY_LIMIT = 16 * 1024 * 1024; // 包缓冲池内存上限
+	static const size_t FILE_READ_AHEAD_MIN_CHUNKS = 8;              // 发送文件时预读分块数下限（不小于窗口大小）
+	static const size_t COMPRESSION_MIN_PAYLOAD = 64;                // 小于该大小的数据帧不压缩
+	static const uint32_t FEC_MIN_GROUP_SIZE = 2;                    // 自适应校验组大小下限（丢包严重时）
+	static const uint32_t FEC_MAX_GROUP_SIZE = 16;                   // 校验组大小上限（丢包轻微时）
+	static const uint32_t FEC_INITIAL_GROUP_SIZE = 8;                // 尚无丢包观测时的校验组大小
+	static const uint64_t FEC_LOSS_SAMPLE_PACKETS = 64;              // 每累计发送该数量的包更新一次丢包率估计
+	static const size_t FEC_RECEIVE_CACHE_SIZE = 32;                 // 接收端保留的最近数据帧数（不小于两个最大组）
+	static const uint32_t FEC_FLUSH_DELAY_MS = 20;                   // 发送空闲该时长后为未满的组补发校验帧
+	static const size_t MUX_STREAM_QUEUE_PACKETS = 16;               // 每个流在发送队列中的包数上限，超出时该流的写入方等待（流级流控）
+	static const size_t MUX_MAX_ACTIVE_STREAMS = 16;                 // SendFiles同时打开的流数上限
+	static const DWORD TRANSPORT_WRITABLE_WAIT_MS = 100;             // 传输层写队列超过高水位时每次等待可写的时长（期间检查关闭）
+
 public:
 	// 构造函数和析构函数
 	ReliableChannel();
@@ -57,6 +112,9 @@ public:
 	bool Initialize(std::shared_ptr<ITransport> transport, const ReliableConfig& config);
 	void Shutdown();
 
+	// 反应器模式：Connect()前设置，多个通道可共享同一反应器
+	bool SetReactor(std::shared_ptr<ChannelReactor> reactor);
+
 	// 连接管理
 	bool Connect();
 	bool Disconnect();
@@ -69,9 +127,27 @@ public:
 	size_t Receive(void* buffer, size_t size, uint32_t timeout = 0);
 
 	// 文件传输
-	bool SendFile(const std::string& filePath, std::function<void(int64_t, int64_t)> progressCallback = nullptr);
+	// remoteName为START帧中告知对端的文件名，为空时使用filePath
+	bool SendFile(const std::string& filePath, std::function<void(int64_t, int64_t)> progressCallback = nullptr, const std::string& remoteName = std::string());
 	bool ReceiveFile(const std::string& filePath, std::function<void(int64_t, int64_t)> progressCallback = nullptr);
 
+	// 接收数据落地：设置后文件传输的数据按序写入sink，不再进入接收队列与完整文件缓冲；传入nullptr恢复内存缓冲
+	void SetReceiveSink(std::shared_ptr<IReceiveSink> sink);
+
+	// 多路复用（需双方启用enableMultiplexing）：多个文件各占一个流，共享发送窗口与传输，各流按ID轮转出队。
+	// 流的OPEN/CLOSE记录与数据按序交付，无需逐文件握手；对端未确认时SendFiles逐个调用SendFile。
+	// 多路复用会话进行中不要同时调用SendFile（其START帧会结束多路复用会话）。
+	bool SendFiles(const std::vector<std::string>& filePaths, std::function<void(int64_t, int64_t)> progressCallback = nullptr);
+	uint16_t OpenStream(const std::string& fileName, uint64_t fileSize, uint64_t modifyTime = 0); // 返回流ID，0表示失败
+	bool SendStream(uint16_t streamId, const void* data, size_t size); // 该流待发送包数达到上限时等待
+	bool CloseStream(uint16_t streamId, bool success = true);
+	bool IsMultiplexActive() const;
+
+	// 接收端：为新流创建落地sink（未设置或返回nullptr时该流缓存在内存中）；
+	// 流结束时在交付线程中回调（data为内存缓存的内容，落地到sink时为空），回调内不得阻塞等待本通道
+	void SetStreamSinkFactory(std::function<std::shared_ptr<IReceiveSink>(const ReceiveFileInfo&)> factory);
+	void SetStreamCompleteCallback(std::function<void(uint16_t, const ReceiveFileInfo&, const std::vector<uint8_t>&, bool)> callback);
+
 	// 配置和统计
 	void SetConfig(const ReliableConfig& config);
 	ReliableConfig GetConfig() const;
@@ -95,8 +171,9 @@ public:
 	void ClearCompletedFileBuffer();
 
 	// 状态查询
-	uint16_t GetLocalSequence() const;
-	uint16_t GetRemoteSequence() const;
+	uint32_t GetLocalSequence() const;
+	uint32_t GetRemoteSequence() const;
+	uint8_t GetProtocolVersion() const;
 	size_t GetSendQueueSize() const;
 	size_t GetReceiveQueueSize() const;
 
@@ -104,18 +181,23 @@ public:
 	bool IsFileTransferActive() const;
 
 private:
+	friend class ChannelReactor;
+
 	// 内部类型定义
 	struct Packet
 	{
-		uint16_t sequence;
-		std::vector<uint8_t> data;
+		uint32_t sequence;
+		PacketRef buffer;                    // 负载（发送端同时保存已编码的帧）
+		size_t dataSize;                     // 未压缩的负载大小（发送进度统计、流式帧还原用）
+		bool streamEncoded;                  // 接收端：负载仍为流式压缩形式，交付时按序还原
 		std::chrono::steady_clock::time_point timestamp;
 		uint32_t retryCount;
 		bool acknowledged;
+		TimerQueue::TimerId retransmitTimer; // 重传定时器
 
-		Packet() : sequence(0), retryCount(0), acknowledged(false) {}
-		Packet(uint16_t seq, const std::vector<uint8_t>& d)
-			: sequence(seq), data(d), retryCount(0), acknowledged(false)
+		Packet() : sequence(0), dataSize(0), streamEncoded(false), retryCount(0), acknowledged(false), retransmitTimer(TimerQueue::INVALID_TIMER) {}
+		Packet(uint32_t seq, PacketRef b)
+			: sequence(seq), buffer(std::move(b)), dataSize(0), streamEncoded(false), retryCount(0), acknowledged(false), retransmitTimer(TimerQueue::INVALID_TIMER)
 		{
 			timestamp = std::chrono::steady_clock::now();
 		}
@@ -127,58 +209,143 @@ private:
 		bool inUse;
 
 		WindowSlot() : inUse(false) {}
+
+		// 释放槽位：归还包缓冲区，保留Packet对象供该槽位后续复用
+		void Release()
+		{
+			inUse = false;
+			if (packet)
+			{
+				packet->buffer.reset();
+			}
+		}
 	};
 
 	// 内部方法
 	void ProcessThread();
 	void SendThread();
 	void ReceiveThread();
-	void HeartbeatThread();
+	void TimerThread();
+
+	// 工作线程与反应器共用的处理步骤
+	TransportError ReadIncoming(std::vector<uint8_t>& buffer, DWORD timeoutMs, size_t& bytesReceived); // 读取一次并处理完整帧
+	int DeliverReceivedLocked(bool logThisCycle); // 按序交付接收窗口中的包，要求调用方已持有窗口锁
+	bool PopReceived(PacketRef& packet, uint32_t timeout); // 从接收队列取出一个包
+	void FinishReceiveSink(bool success); // 交付剩余按序数据后结束本次落地，调用方不得持有窗口锁
+	void RecordFileReadStalls(uint64_t stalls); // 累计发送文件时的预读等待次数
+
+	// 反应器驱动（在反应器线程中执行，均不阻塞）
+	bool PollReactor(); // 返回本轮是否有进展
+	bool DrainSendQueue();
+	bool GetNextTimerDeadline(TimerQueue::Clock::time_point& deadline);
+
+	// 定时器事件（在定时器线程中执行）
+	void OnHeartbeatTimer();
+	void OnRetransmitTimer(uint32_t sequence);
+	void OnWindowProbeTimer();
+	void OnShortTimeoutTimer();
+	void ArmRetransmitTimerLocked(const std::shared_ptr<Packet>& packet); // 要求调用方已持有窗口锁
+	void CancelRetransmitTimerLocked(const std::shared_ptr<Packet>& packet);
+	void ArmWindowProbeLocked();
+	bool IsPeerWindowStalledLocked() const;
+	bool IsReceiveSlotReadyLocked() const; // 接收窗口基对应的包已到达
+	void RecordRetransmitLatency(uint32_t latencyUs);
 
 	// 日志函数
 	void WriteLog(const std::string& message);
-	void WriteVerbose(const std::string& message);
 
 	// 【P0修复】传输类型检测辅助函数
 	bool IsLoopbackTransport() const;
 
 	void ProcessIncomingFrame(const Frame& frame);
 	void ProcessDataFrame(const Frame& frame);
-	void ProcessAckFrame(uint16_t sequence);
-	void ProcessNakFrame(uint16_t sequence);
+	void ProcessAckFrame(const Frame& frame);
+	void ProcessSackFrame(const Frame& frame);
+	bool AcknowledgePacketLocked(size_t index); // 确认发送窗口中的包，要求调用方已持有窗口锁
+	void ProcessNakFrame(uint32_t sequence);
 	void ProcessStartFrame(const Frame& frame);
 	void ProcessEndFrame(const Frame& frame);
 	void ProcessHeartbeatFrame(const Frame& frame);
 
-	bool SendPacket(uint16_t sequence, const std::vector<uint8_t>& data, FrameType type = FrameType::FRAME_DATA);
-	bool SendPacketLocked(std::unique_lock<std::mutex>& lock, uint16_t sequence, const std::vector<uint8_t>& data, FrameType type = FrameType::FRAME_DATA); // 内部版本，要求调用方已持有锁
-	bool SendAck(uint16_t sequence);
-	bool SendNak(uint16_t sequence);
+	bool SendPacket(uint32_t sequence, PacketRef packet, FrameType type = FrameType::FRAME_DATA);
+	bool SendPacketLocked(std::unique_lock<std::mutex>& lock, uint32_t sequence, PacketRef packet, FrameType type = FrameType::FRAME_DATA); // 内部版本，要求调用方已持有锁
+	PacketRef StoreEncodedFrame(const std::vector<uint8_t>& frameData);
+	bool SendAck(uint32_t sequence);
+	bool SendStartAck(uint32_t sequence, const StartMetadata& metadata, uint64_t resumeOffset); // 回复START帧，v2对端附带协商结果与续传偏移
+	bool SendSack();
+	void ScheduleAck(uint32_t sequence); // SACK模式下合并确认，否则立即发送ACK
+	void FlushPendingAck();
+	bool SendNak(uint32_t sequence);
 	bool SendHeartbeat();
-	bool SendStart(const std::string& fileName, uint64_t fileSize, uint64_t modifyTime);
+	bool SendStart(const std::string& fileName, uint64_t fileSize, uint64_t modifyTime, uint32_t fileHash = 0, uint8_t extraFlags = 0);
 	bool SendEnd();
 
-	void RetransmitPacket(uint16_t sequence);
-	void RetransmitPacketInternal(uint16_t sequence); // 内部版本，假设已持有窗口锁
+	void RetransmitPacket(uint32_t sequence);
+	void RetransmitPacketInternal(uint32_t sequence); // 内部版本，假设已持有窗口锁
 	void AdvanceSendWindow();
-	void UpdateReceiveWindow(uint16_t sequence);
+	void UpdateReceiveWindow(uint32_t sequence);
 
-	uint16_t AllocateSequence();
-	uint16_t AllocateSequenceLocked(std::unique_lock<std::mutex>& lock); // 内部版本，要求调用方已持有锁
+	uint32_t AllocateSequence();
+	uint32_t AllocateSequenceLocked(std::unique_lock<std::mutex>& lock); // 内部版本，要求调用方已持有锁
 	bool IsSendWindowFullLocked() const;
-	bool IsSequenceInWindow(uint16_t sequence, uint16_t base, uint16_t windowSize) const;
-	uint16_t GetWindowDistance(uint16_t from, uint16_t to) const;
+	uint32_t GetSendWindowLimitLocked() const; // 有效发送窗口：本端窗口、对端窗口与拥塞窗口的最小值
+	bool IsSequenceInWindow(uint32_t sequence, uint32_t base, uint32_t windowSize) const;
+	uint32_t GetWindowDistance(uint32_t from, uint32_t to) const;
+	bool IsSequenceBefore(uint32_t sequence, uint32_t reference) const; // sequence在reference之前（半个序列空间内）
+	uint32_t NextSequence(uint32_t sequence) const;
+
+	// 协议版本协商
+	void ApplyProtocolVersionLocked(uint8_t version); // 切换帧格式与序列号空间，要求调用方已持有窗口锁
+	void ApplyStartAckLocked(const std::vector<uint8_t>& payload);
+	size_t GetEffectivePayloadSize() const;
+
+	// AIMD拥塞窗口（均要求调用方已持有窗口锁）
+	void ResetCongestionWindowLocked();
+	void OnCongestionAckLocked(uint32_t rttSampleMs, bool rttSampleValid);
+	void OnCongestionLossLocked();
 
 	// 握手管理
 	uint16_t GenerateSessionId();
+	void FillStartMetadata(StartMetadata& metadata) const;
 	bool WaitForHandshakeCompletion(uint32_t timeoutMs);
 	bool EnsureSessionStarted(); // 【P0修复】确保会话已启动，如果未启动则自动执行握手
 
 	uint32_t CalculateTimeout() const;
 	void UpdateRTT(uint32_t rttMs);
 
-	std::vector<uint8_t> CompressData(const std::vector<uint8_t>& data) const;
-	std::vector<uint8_t> DecompressData(const std::vector<uint8_t>& data) const;
+	FrameType CompressPayloadLocked(PacketBuffer& buffer); // 压缩数据帧负载（原地替换），无收益时保持原样并返回FRAME_DATA
+	bool DecompressFrame(const Frame& frame, Frame& decoded) const; // 压缩数据帧还原为数据帧
+	FrameType StreamCompressPayloadLocked(PacketBuffer& buffer, uint32_t sequence); // 以跨帧字典压缩数据帧负载（原地替换）
+	bool DecodeStreamPayloadLocked(Packet& packet); // 按序交付前还原流式帧，并将明文计入接收端字典
+
+	// 前向纠错
+	void AccumulateParityLocked(uint32_t sequence, FrameType type, const uint8_t* payload, size_t size); // 已发送的数据帧计入当前校验组
+	void SendParityLocked();          // 发送当前组的校验帧并开始新组
+	void ResetParityGroupLocked();
+	void UpdateFecGroupSizeLocked();  // 按观测到的丢包率调整组大小
+	void OnFecFlushTimer();
+	void RememberFecFrame(const Frame& frame);  // 接收端缓存数据帧的线路形式，供校验帧恢复使用
+	void ProcessParityFrame(const Frame& frame);
+
+	// 多路复用
+	struct MuxReceiveStream
+	{
+		ReceiveFileInfo info;
+		std::shared_ptr<IReceiveSink> sink;    // 为空时数据缓存在data中
+		std::vector<uint8_t> data;
+		bool failed = false;                   // 写入sink失败
+	};
+
+	bool EnsureMultiplexSession();             // 以带多路复用标志的START握手开始新会话（已激活时直接返回）
+	PacketRef AcquireMuxPacket(uint16_t streamId, MuxRecordType type, size_t bodySize); // 写好流头的包缓冲区
+	bool EnqueueStreamPacket(uint16_t streamId, PacketRef packet); // 放入流的发送队列，队列满时等待
+	bool PopSendPacketLocked(PacketRef& packet, bool& streamFinished); // 按流轮转取出下一个待发送包，要求调用方已持有发送锁；streamFinished表示取出的是已关闭流的最后一个包
+	void OnStreamLastPacketSequenced();        // 已关闭流的最后一个包分配序列号之后调用（不持锁）
+	bool HasPendingSendLocked() const;
+	bool DeliverMuxRecordLocked(Packet& packet); // 处理按序交付的流记录，默认流数据去掉流头后返回true继续原交付路径
+	void OpenReceiveStreamLocked(uint16_t streamId, const uint8_t* body, size_t bodySize);
+	void FinishReceiveStreamLocked(uint16_t streamId, MuxReceiveStream& stream, bool success);
+	void AbortReceiveStreamsLocked();         // 中止所有未结束的接收流（新会话或关闭时）
 
 	std::vector<uint8_t> EncryptData(const std::vector<uint8_t>& data) const;
 	std::vector<uint8_t> DecryptData(const std::vector<uint8_t>& data) const;
@@ -212,20 +379,87 @@ private:
 	std::thread m_processThread;   // 处理线程
 	std::thread m_sendThread;      // 发送线程
 	std::thread m_receiveThread;   // 接收线程
-	std::thread m_heartbeatThread; // 心跳线程
+	std::thread m_timerThread;     // 定时器线程（重传、心跳、短超时）
+
+	// 包缓冲池（先于窗口与队列声明，保证析构时最后释放）
+	PacketPool m_packetPool;
+	Frame m_incomingFrame;                     // 解码帧（仅读取方访问）
+	Frame m_decompressedFrame;                 // 压缩数据帧解压结果（仅读取方访问）
+	std::vector<uint8_t> m_compressBuffer;     // 压缩输出暂存（窗口锁保护）
+	LzStreamEncoder m_streamEncoder;           // 发送端跨帧字典（窗口锁保护）
+	uint32_t m_streamNextSequence = 0;         // 字典末尾对应的下一个序列号，不连续时重置字典（窗口锁保护）
+	LzStreamDecoder m_streamDecoder;           // 接收端跨帧字典（窗口锁保护）
+	bool m_streamDecodeActive = false;         // 对端START帧请求了流式压缩，交付的明文需计入字典（窗口锁保护）
+
+	// 前向纠错：发送端校验组（窗口锁保护）
+	std::vector<uint8_t> m_fecParity;          // 校验帧负载：校验帧头 + 组内负载异或
+	uint32_t m_fecGroupFirst = 0;              // 组内首帧序列号
+	uint32_t m_fecGroupCount = 0;              // 组内已发送帧数
+	size_t m_fecParityLength = 0;              // 组内最长负载
+	uint32_t m_fecLengthXor = 0;
+	uint8_t m_fecTypeXor = 0;
+	uint32_t m_fecGroupSize = FEC_INITIAL_GROUP_SIZE;
+	double m_fecLossRate = 0.0;                // 丢包率估计（区间重传率的指数平均）
+	uint64_t m_fecSentSnapshot = 0;            // 上次估计时的发送包数
+	uint64_t m_fecRetransmitSnapshot = 0;      // 上次估计时的重传包数
+	TimerQueue::TimerId m_fecFlushTimer = TimerQueue::INVALID_TIMER;
+	TimerQueue::Clock::time_point m_fecLastFrameTime; // 组内最近一帧的加入时间，补发定时器据此顺延
+
+	// 前向纠错：接收端最近数据帧（仅读取方访问）
+	struct FecCacheEntry
+	{
+		uint32_t sequence = 0;
+		FrameType type = FrameType::FRAME_DATA;
+		PacketRef payload;                     // 线路上的负载（压缩帧保持压缩形式）
+	};
+	std::vector<FecCacheEntry> m_fecCache;     // 按 sequence % FEC_RECEIVE_CACHE_SIZE 存放
+	bool m_fecReceiveActive = false;           // 对端START帧请求了前向纠错
+	Frame m_fecRecoveredFrame;                 // 由校验帧恢复的数据帧
+
+	// 多路复用：发送端（发送锁保护）
+	struct MuxSendStream
+	{
+		PacketQueue queue;                     // 该流待发送的包（已带流头）
+		bool closed = false;                   // 已排入CLOSE记录，队列发完后移除
+	};
+	std::map<uint16_t, MuxSendStream> m_muxSendStreams;
+	uint32_t m_muxUnsequencedStreamEnds = 0;   // 已出队但尚未分配序列号的流末包数，END帧须等其归零后再分配序列号
+	uint32_t m_muxNextTurn = 0;                // 轮转位置：下一次从ID不小于该值的流开始，越过末尾后轮到流0（m_sendQueue）
+	uint16_t m_muxNextStreamId = 1;
+	std::mutex m_muxSessionMutex;              // 串行化多路复用会话握手
+
+	// 多路复用：接收端（窗口锁保护）
+	std::map<uint16_t, MuxReceiveStream> m_muxReceiveStreams;
+	bool m_muxReceiveActive = false;           // 对端START帧请求了多路复用，交付的数据帧负载带流头
+	std::function<std::shared_ptr<IReceiveSink>(const ReceiveFileInfo&)> m_streamSinkFactory;
+	std::function<void(uint16_t, const ReceiveFileInfo&, const std::vector<uint8_t>&, bool)> m_streamCompleteCallback;
+
+	// 反应器模式
+	std::shared_ptr<ChannelReactor> m_reactor; // 驱动本通道的反应器（为空时使用工作线程）
+	bool m_ownsReactor = false;                // m_reactor是Connect()创建的私有反应器，断开/关闭时随之停止
+	std::vector<uint8_t> m_reactorReadBuffer;  // 反应器读缓冲区
+	PacketRef m_reactorSendPacket;             // 发送窗口满时已出队、待发送的包
+	bool m_reactorSendPacketEndsStream = false; // m_reactorSendPacket是已关闭流的最后一个包
+
+	// 定时器
+	TimerQueue m_timerQueue;                           // 重传/心跳/短超时截止时间
+	TimerQueue::TimerId m_windowProbeTimer = TimerQueue::INVALID_TIMER; // 窗口探测定时器（窗口锁保护）
+	std::vector<uint32_t> m_retransmitLatencyUs;       // 重传延迟样本环（统计锁保护）
+	size_t m_retransmitLatencyNext = 0;                // 下一个样本写入位置
 
 	// 滑动窗口
 	std::vector<WindowSlot> m_sendWindow;    // 发送窗口
 	std::vector<WindowSlot> m_receiveWindow; // 接收窗口
-	uint16_t m_sendBase;                     // 发送窗口基
-	uint16_t m_sendNext;                     // 下一个发送序列
-	uint16_t m_receiveBase;                  // 接收窗口基
-	uint16_t m_receiveNext;                  // 下一个接收序列
-	uint16_t m_heartbeatSequence;            // 心跳包独立序列号
+	uint32_t m_sendBase;                     // 发送窗口基
+	uint32_t m_sendNext;                     // 下一个发送序列
+	uint32_t m_receiveBase;                  // 接收窗口基
+	uint32_t m_receiveNext;                  // 下一个接收序列
+	uint32_t m_heartbeatSequence;            // 心跳包独立序列号
+	std::atomic<uint32_t> m_sequenceMask;    // 序列号空间掩码（v1为0xFFFF，v2为0xFFFFFFFF）
 
 	// 队列
-	std::queue<std::vector<uint8_t>> m_sendQueue;    // 发送队列
-	std::queue<std::vector<uint8_t>> m_receiveQueue; // 接收队列
+	PacketQueue m_sendQueue;    // 发送队列（已按负载分块）
+	PacketQueue m_receiveQueue; // 接收队列
 
 	// 同步对象
 	mutable std::mutex m_sendMutex;             // 发送锁
@@ -235,6 +469,7 @@ private:
 	std::condition_variable m_sendCondition;    // 发送条件变量
 	std::condition_variable m_receiveCondition; // 接收条件变量
 	std::condition_variable m_windowCondition;  // 发送窗口条件变量
+	std::condition_variable m_deliveryCondition; // 有序包到达条件变量（配合窗口锁）
 
 	// 文件传输相关 - 发送端状态
 	std::string m_sendFileName;     // 发送文件名
@@ -256,8 +491,11 @@ private:
 	int64_t m_currentFileProgress;  // 当前传输文件进度
 	bool m_fileTransferActive;      // 文件传输是否活跃
 	std::chrono::steady_clock::time_point m_transferStartTime; // 当前传输开始时间
-	std::vector<uint8_t> m_completedFileBuffer; // 最近一次完整文件缓冲
+	std::vector<uint8_t> m_completedFileBuffer; // 最近一次完整文件缓冲（未设置落地sink时使用）
 	bool m_hasCompletedFile = false;
+	std::shared_ptr<IReceiveSink> m_receiveSink; // 接收数据落地（接收锁保护）
+	bool m_receiveSinkActive = false;            // 本次传输的数据正在写入sink（接收锁保护，写入时另需窗口锁）
+	bool m_receiveSinkFailed = false;            // 本次传输写入sink失败，已报告错误
 
 	// 【P1优化】发送端真实进度跟踪（基于ACK确认）
 	std::atomic<int64_t> m_sendBytesAcked;  // 已ACK确认的字节数
@@ -265,7 +503,7 @@ private:
 
 	// 握手状态管理
 	std::atomic<bool> m_handshakeCompleted;    // 握手完成标志
-	std::atomic<uint16_t> m_handshakeSequence; // 当前握手帧的序列号
+	std::atomic<uint32_t> m_handshakeSequence; // 当前握手帧的序列号
 	std::atomic<uint16_t> m_sessionId;         // 当前会话ID
 	mutable std::mutex m_handshakeMutex;       // 握手状态锁
 	std::condition_variable m_handshakeCondition; // 握手完成条件变量
@@ -275,6 +513,30 @@ private:
 	uint32_t m_timeoutMs;                                 // 当前超时时间
 	std::chrono::steady_clock::time_point m_lastActivity; // 最后活动时间
 
+	// 选择确认(SACK)
+	std::atomic<bool> m_peerSelectiveAck;  // 对端START帧声明支持SACK
+	std::atomic<bool> m_compressionActive;  // 对端已在START帧ACK中确认接受压缩数据帧
+	std::atomic<bool> m_streamCompressionActive; // 对端已确认接受流式压缩数据帧
+	std::atomic<bool> m_fecActive;          // 对端已在START帧ACK中确认接受校验帧
+	std::atomic<bool> m_multiplexActive;    // 对端已在START帧ACK中确认多路复用，发送的数据帧负载带流头
+	bool m_sackPending = false;            // 有待发送的SACK（仅处理线程访问）
+	uint32_t m_sackPendingCount = 0;       // 自上次SACK以来收到的数据帧数
+	bool m_peerWindowKnown = false;        // 已收到对端SACK，可按其接收窗口限流（窗口锁保护）
+	uint32_t m_peerReceiveBase = 0;        // 对端SACK通告的接收窗口基（窗口锁保护）
+	std::vector<uint8_t> m_sackBitmap;     // 解码SACK位图的复用缓冲（仅读取方访问）
+
+	// 协议协商结果
+	std::atomic<uint8_t> m_protocolVersion;      // 协商后的协议版本
+	uint16_t m_peerWindowSize = 0;               // 对端接收窗口大小，0表示未知（窗口锁保护）
+	std::atomic<uint32_t> m_peerMaxPayloadSize;  // 对端最大负载，0表示未知
+	std::atomic<uint64_t> m_resumeOffset;        // 对端在START帧ACK中给出的续传偏移
+
+	// AIMD拥塞控制（窗口锁保护）
+	double m_congestionWindow = INITIAL_CONGESTION_WINDOW; // 拥塞窗口（包数，可为小数以实现加性增长）
+	uint32_t m_slowStartThreshold = MAX_WINDOW_SIZE;       // 慢启动阈值
+	uint32_t m_minRttMs = 0;                               // 观测到的最小RTT，作为排队时延基线
+	std::chrono::steady_clock::time_point m_lastCongestionEvent; // 上次窗口减半时间
+
 	// 帧编解码器
 	std::unique_ptr<FrameCodec> m_frameCodec; // 帧编解码器
 
@@ -0,0 +1,269 @@
+﻿#pragma execution_character_set("utf-8")
+
+#include "pch.h"
+#include "TimerQueue.h"
+#include <algorithm>
+
+TimerQueue::TimerQueue()
+	: m_pending(0), m_nextOrder(0), m_stopped(false), m_wakeups(0)
+{
+}
+
+TimerQueue::~TimerQueue()
+{
+	Stop();
+}
+
+TimerQueue::TimerId TimerQueue::Schedule(Clock::time_point deadline, Callback callback)
+{
+	if (!callback)
+	{
+		return INVALID_TIMER;
+	}
+
+	bool wakeRunner = false;
+	TimerId id = INVALID_TIMER;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		uint32_t index = 0;
+		if (!m_freeSlots.empty())
+		{
+			index = m_freeSlots.back();
+			m_freeSlots.pop_back();
+		}
+		else
+		{
+			index = static_cast<uint32_t>(m_slots.size());
+			m_slots.emplace_back();
+		}
+
+		Slot& slot = m_slots[index];
+		slot.callback = std::move(callback);
+		slot.active = true;
+		m_pending++;
+		id = (static_cast<TimerId>(slot.generation) << 32) | (index + 1);
+
+		// 新定时器早于当前堆顶时需唤醒Run()重新计算等待时长
+		wakeRunner = m_heap.empty() || deadline < m_heap.front().deadline;
+
+		Entry entry;
+		entry.deadline = deadline;
+		entry.order = m_nextOrder++;
+		entry.id = id;
+		PushEntryLocked(entry);
+	}
+
+	if (wakeRunner)
+	{
+		m_condition.notify_one();
+	}
+	return id;
+}
+
+TimerQueue::TimerId TimerQueue::ScheduleAfter(uint32_t delayMs, Callback callback)
+{
+	return Schedule(Clock::now() + std::chrono::milliseconds(delayMs), std::move(callback));
+}
+
+bool TimerQueue::Cancel(TimerId id)
+{
+	if (id == INVALID_TIMER)
+	{
+		return false;
+	}
+
+	// 堆中的条目延迟清理，回调立即释放
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!IsActiveLocked(id))
+	{
+		return false;
+	}
+
+	ReleaseSlotLocked(static_cast<uint32_t>(id & 0xFFFFFFFFu) - 1);
+
+	// 每个有效定时器在堆中恰有一个条目，其余均为失效条目
+	size_t stale = m_heap.size() - m_pending;
+	if (stale >= COMPACT_MIN_STALE && stale > m_pending)
+	{
+		CompactLocked();
+	}
+	return true;
+}
+
+void TimerQueue::Clear()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_heap.clear();
+	for (uint32_t index = 0; index < m_slots.size(); index++)
+	{
+		if (m_slots[index].active)
+		{
+			ReleaseSlotLocked(index);
+		}
+	}
+}
+
+void TimerQueue::Run()
+{
+	std::vector<Callback> expired;
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (!m_stopped)
+	{
+		DiscardCancelledLocked();
+
+		if (m_heap.empty())
+		{
+			m_condition.wait(lock);
+		}
+		else
+		{
+			// 复制截止时间：等待期间锁被释放，Schedule()可能使堆的底层vector重新分配，引用会悬空
+			const Clock::time_point deadline = m_heap.front().deadline;
+			m_condition.wait_until(lock, deadline);
+		}
+		m_wakeups++;
+
+		if (m_stopped)
+		{
+			break;
+		}
+
+		CollectExpiredLocked(Clock::now(), expired);
+		if (expired.empty())
+		{
+			continue;
+		}
+
+		// 在锁外执行回调，允许回调重新调度
+		lock.unlock();
+		for (auto& callback : expired)
+		{
+			callback();
+		}
+		expired.clear();
+		lock.lock();
+	}
+}
+
+void TimerQueue::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopped = true;
+	}
+	m_condition.notify_all();
+}
+
+void TimerQueue::Reset()
+{
+	Clear();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_stopped = false;
+}
+
+size_t TimerQueue::RunExpired(Clock::time_point now)
+{
+	// 外部驱动时只有一个调用方，到期回调缓冲跨调用复用
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		CollectExpiredLocked(now, m_expired);
+	}
+
+	size_t count = m_expired.size();
+	for (auto& callback : m_expired)
+	{
+		callback();
+	}
+	m_expired.clear();
+	return count;
+}
+
+bool TimerQueue::GetNextDeadline(Clock::time_point& deadline)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	DiscardCancelledLocked();
+
+	if (m_heap.empty())
+	{
+		return false;
+	}
+
+	deadline = m_heap.front().deadline;
+	return true;
+}
+
+size_t TimerQueue::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pending;
+}
+
+bool TimerQueue::IsActiveLocked(TimerId id) const
+{
+	uint32_t index = static_cast<uint32_t>(id & 0xFFFFFFFFu);
+	if (index == 0 || index > m_slots.size())
+	{
+		return false;
+	}
+
+	const Slot& slot = m_slots[index - 1];
+	return slot.active && slot.generation == static_cast<uint32_t>(id >> 32);
+}
+
+void TimerQueue::ReleaseSlotLocked(uint32_t index)
+{
+	Slot& slot = m_slots[index];
+	slot.callback = nullptr;
+	slot.active = false;
+	slot.generation = (slot.generation == UINT32_MAX) ? 1 : slot.generation + 1;
+	m_freeSlots.push_back(index);
+	m_pending--;
+}
+
+void TimerQueue::PushEntryLocked(const Entry& entry)
+{
+	m_heap.push_back(entry);
+	std::push_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+}
+
+void TimerQueue::PopEntryLocked()
+{
+	std::pop_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+	m_heap.pop_back();
+}
+
+void TimerQueue::DiscardCancelledLocked()
+{
+	// 丢弃堆顶已取消的条目，避免为其空转唤醒
+	while (!m_heap.empty() && !IsActiveLocked(m_heap.front().id))
+	{
+		PopEntryLocked();
+	}
+}
+
+void TimerQueue::CompactLocked()
+{
+	// 原地移除失效条目后重建堆，O(n)且不分配内存；均摊到触发压缩前的各次取消上
+	m_heap.erase(std::remove_if(m_heap.begin(), m_heap.end(),
+		[this](const Entry& entry) { return !IsActiveLocked(entry.id); }), m_heap.end());
+	std::make_heap(m_heap.begin(), m_heap.end(), std::greater<Entry>());
+}
+
+void TimerQueue::CollectExpiredLocked(Clock::time_point now, std::vector<Callback>& expired)
+{
+	while (!m_heap.empty() && m_heap.front().deadline <= now)
+	{
+		TimerId id = m_heap.front().id;
+		PopEntryLocked();
+
+		if (IsActiveLocked(id))
+		{
+			uint32_t index = static_cast<uint32_t>(id & 0xFFFFFFFFu) - 1;
+			expired.push_back(std::move(m_slots[index].callback));
+			ReleaseSlotLocked(index);
+		}
+	}
+}
@@ -0,0 +1,98 @@
+﻿#pragma once
+#pragma execution_character_set("utf-8")
+
+#include <cstdint>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <atomic>
+
+// 定时器队列（最小堆，按截止时间排序）
+// 用法：
+//   TimerQueue timers;
+//   TimerQueue::TimerId id = timers.ScheduleAfter(500, [] { ... });
+//   timers.Cancel(id);             // 取消后回调不再执行
+//   timers.Run();                  // 在专用线程中阻塞运行，直到Stop()
+// 也可由外部事件循环驱动：GetNextDeadline() 决定等待时长，RunExpired() 执行到期回调。
+// 回调在锁外执行，回调内可以再次调度或取消定时器。
+// 回调保存在可复用的槽位中，稳态下调度与取消不分配内存。
+// 取消的条目留在堆中延迟清理，失效条目多于有效定时器时整体压缩，堆大小不随取消次数增长。
+class TimerQueue
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	using TimerId = uint64_t;
+	using Callback = std::function<void()>;
+
+	static const TimerId INVALID_TIMER = 0;
+	static const size_t COMPACT_MIN_STALE = 64;   // 失效条目达到该数量且多于有效定时器时压缩堆
+
+public:
+	TimerQueue();
+	~TimerQueue();
+
+	TimerQueue(const TimerQueue&) = delete;
+	TimerQueue& operator=(const TimerQueue&) = delete;
+
+	// 调度与取消
+	TimerId Schedule(Clock::time_point deadline, Callback callback);
+	TimerId ScheduleAfter(uint32_t delayMs, Callback callback);
+	bool Cancel(TimerId id);
+	void Clear();
+
+	// 阻塞运行到期回调，直到Stop()；Reset()后可再次运行
+	void Run();
+	void Stop();
+	void Reset();
+
+	// 外部驱动接口：执行截止时间不晚于now的回调，返回执行个数
+	size_t RunExpired(Clock::time_point now);
+	bool GetNextDeadline(Clock::time_point& deadline);
+
+	size_t GetPendingCount() const;
+	uint64_t GetWakeupCount() const { return m_wakeups.load(); }
+
+private:
+	struct Entry
+	{
+		Clock::time_point deadline;
+		uint64_t order;
+		TimerId id;
+
+		// 用于最小堆：截止时间早者优先，相同时按调度顺序
+		bool operator>(const Entry& other) const
+		{
+			return deadline > other.deadline || (deadline == other.deadline && order > other.order);
+		}
+	};
+
+	// 回调槽位：TimerId高32位为槽位代数，低32位为槽位序号+1，槽位释放时代数递增使旧ID失效
+	struct Slot
+	{
+		Callback callback;
+		uint32_t generation = 1;
+		bool active = false;
+	};
+
+	bool IsActiveLocked(TimerId id) const;
+	void ReleaseSlotLocked(uint32_t index);
+	void PushEntryLocked(const Entry& entry);
+	void PopEntryLocked();
+	void DiscardCancelledLocked();
+	void CompactLocked();
+	void CollectExpiredLocked(Clock::time_point now, std::vector<Callback>& expired);
+
+private:
+	std::vector<Entry> m_heap;          // 最小堆（std::push_heap/pop_heap，std::greater），含已取消的失效条目
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_freeSlots;
+	size_t m_pending;                  // 仍有效的定时器数
+	uint64_t m_nextOrder;
+	std::vector<Callback> m_expired;   // RunExpired()复用的到期回调缓冲
+	bool m_stopped;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::atomic<uint64_t> m_wakeups; // Run()的唤醒次数
+};
@@ -83,6 +83,16 @@ using StateChangedCallback = std::function<void(TransportState)>;
 // 错误发生回调
 using ErrorOccurredCallback = std::function<void(TransportError, const std::string&)>;
 
+// 写队列回落到低水位、恢复可写时的回调
+using WritableCallback = std::function<void()>;
+
+// 分散写入的数据段（对应iovec/WSABUF）
+struct WriteSegment
+{
+	const void* data;
+	size_t size;
+};
+
 // 传输层接口
 class ITransport
 {
@@ -140,6 +150,58 @@ public:
 	// 获取可用字节数
 	virtual size_t GetAvailableBytes() const = 0;
 
+	// 写入背压（可选）：带写队列的传输统计已提交未写出的字节数，
+	// 达到高水位后不可写（WriteAsync返回Busy，Write等待），回落到低水位后恢复可写并触发回调。
+	// 默认实现表示不支持：始终可写，待写字节数为0
+
+	// 已提交但尚未写出的字节数
+	virtual size_t GetPendingWriteBytes() const { return 0; }
+
+	// 设置高/低水位（字节）
+	virtual void SetWriteWatermarks(size_t highWatermark, size_t lowWatermark) {}
+
+	// 当前是否可写
+	virtual bool IsWritable() const { return true; }
+
+	// 等待恢复可写，超时返回false
+	virtual bool WaitWritable(DWORD timeoutMs) { return true; }
+
+	// 设置恢复可写回调（在写出数据的线程中调用）
+	virtual void SetWritableCallback(WritableCallback callback) {}
+
+	// 分散写入：按顺序写出多个数据段，效果等同于写入它们的拼接。
+	// 默认实现拼接到临时缓冲区后调用Write；套接字等传输可重写为一次系统调用直接发送各段
+	virtual TransportError WriteV(const WriteSegment* segments, size_t count, size_t* written = nullptr)
+	{
+		if (written)
+		{
+			*written = 0;
+		}
+		if (!segments && count > 0)
+		{
+			return TransportError::InvalidParameter;
+		}
+		if (count == 1)
+		{
+			return Write(segments[0].data, segments[0].size, written);
+		}
+
+		size_t totalSize = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			totalSize += segments[i].size;
+		}
+
+		std::vector<uint8_t> buffer;
+		buffer.reserve(totalSize);
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(segments[i].data);
+			buffer.insert(buffer.end(), bytes, bytes + segments[i].size);
+		}
+		return Write(buffer.data(), buffer.size(), written);
+	}
+
 	// 获取错误描述
 	static std::string GetErrorString(TransportError error);
 };
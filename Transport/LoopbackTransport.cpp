@@ -3,11 +3,22 @@
 #include "pch.h"
 #include "LoopbackTransport.h"
 #include "../Common/CommonTypes.h"
+#include "../Common/Logger.h"
 #include <random>
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
 
+// 逐包日志：enableLogging开启时按值捕获参数入队（TRACE级别，默认不输出），不在收发路径上拼接字符串
+#define LOOPBACK_TRACE(...) \
+	do \
+	{ \
+		if (m_config.enableLogging) \
+		{ \
+			PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_TRACE, __VA_ARGS__); \
+		} \
+	} while (0)
+
 // 构造函数
 LoopbackTransport::LoopbackTransport()
 	: m_state(TransportState::Closed), m_stopLoopback(false), m_loopbackTestRunning(false), m_sequenceCounter(0), m_packetsProcessed(0), m_randomGenerator(m_randomDevice()), m_percentDistribution(0, 99)
@@ -70,6 +81,7 @@ TransportError LoopbackTransport::Open(const TransportConfig& config)
 
 	// 重置统计信息
 	ResetStats();
+	m_writeBackpressure.Reset();
 
 	// 【P1优化】重置握手保护计数器
 	m_packetsProcessed = 0;
@@ -142,6 +154,9 @@ TransportError LoopbackTransport::Close()
 		m_receiveQueue.swap(empty);
 	}
 
+	// 丢弃的待写数据不再计入背压，同时唤醒等待可写的写入方
+	m_writeBackpressure.Reset();
+
 	m_state = TransportState::Closed;
 	NotifyStateChanged(m_state);
 
@@ -149,10 +164,42 @@ TransportError LoopbackTransport::Close()
 	return TransportError::Success;
 }
 
-// 同步写入数据
+// 同步写入数据：写队列达到高水位时等待回落（最长writeTimeout），超时返回Timeout
 TransportError LoopbackTransport::Write(const void* data, size_t size, size_t* written)
 {
-	if (!data || size == 0)
+	WriteSegment segment = { data, size };
+	return EnqueuePacket(&segment, 1, written, m_config.writeTimeout);
+}
+
+// 分散写入：各段直接拷入同一个数据包，不经中间拼接缓冲区
+TransportError LoopbackTransport::WriteV(const WriteSegment* segments, size_t count, size_t* written)
+{
+	return EnqueuePacket(segments, count, written, m_config.writeTimeout);
+}
+
+// 数据包入发送队列；waitMs为0时不可写立即返回Busy
+TransportError LoopbackTransport::EnqueuePacket(const WriteSegment* segments, size_t count, size_t* written, DWORD waitMs)
+{
+	if (written)
+	{
+		*written = 0;
+	}
+
+	if (!segments)
+	{
+		return TransportError::InvalidParameter;
+	}
+
+	size_t size = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!segments[i].data && segments[i].size > 0)
+		{
+			return TransportError::InvalidParameter;
+		}
+		size += segments[i].size;
+	}
+	if (size == 0)
 	{
 		return TransportError::InvalidParameter;
 	}
@@ -162,16 +209,47 @@ TransportError LoopbackTransport::Write(const void* data, size_t size, size_t* w
 		return TransportError::NotOpen;
 	}
 
-	// 创建数据包
-	std::vector<uint8_t> dataVec(static_cast<const uint8_t*>(data),
-		static_cast<const uint8_t*>(data) + size);
+	// 写入背压：发送队列中未回路的字节达到高水位后，等待回路线程消化到低水位
+	if (!m_writeBackpressure.TryAcquire(size))
+	{
+		if (waitMs == 0)
+		{
+			return TransportError::Busy;
+		}
 
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(waitMs);
+		do
+		{
+			auto now = std::chrono::steady_clock::now();
+			if (now >= deadline)
+			{
+				return TransportError::Timeout;
+			}
+			m_writeBackpressure.WaitWritable(static_cast<DWORD>(
+				std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1));
+			if (m_state != TransportState::Open)
+			{
+				return TransportError::NotOpen;
+			}
+		} while (!m_writeBackpressure.TryAcquire(size));
+	}
+
+	// 创建数据包：各段依次拷入packet.data，这是数据唯一的一次拷贝
 	uint32_t sequenceId = m_sequenceCounter.fetch_add(1);
-	LoopbackPacket packet(dataVec, sequenceId);
+	LoopbackPacket packet;
+	packet.sequenceId = sequenceId;
+	packet.data.reserve(size);
+	for (size_t i = 0; i < count; i++)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(segments[i].data);
+		packet.data.insert(packet.data.end(), bytes, bytes + segments[i].size);
+	}
 
 	// 模拟错误和丢包
 	packet.shouldError = ShouldSimulateError();
 	packet.shouldLoss = ShouldSimulatePacketLoss();
+	bool shouldError = packet.shouldError;
+	bool shouldLoss = packet.shouldLoss;
 
 	{
 		std::lock_guard<std::mutex> lock(m_sendQueueMutex);
@@ -179,11 +257,12 @@ TransportError LoopbackTransport::Write(const void* data, size_t size, size_t* w
 		// 检查队列大小
 		if (m_sendQueue.size() >= m_config.maxQueueSize)
 		{
-			LogOperation("写入数据", "发送队列已满，丢弃数据包 #" + std::to_string(sequenceId));
+			LOOPBACK_TRACE("LoopbackTransport::写入数据 - 发送队列已满，丢弃数据包 #{}", sequenceId);
+			m_writeBackpressure.Release(size);
 			return TransportError::Busy;
 		}
 
-		m_sendQueue.push(packet);
+		m_sendQueue.push(std::move(packet));
 	}
 
 	// 更新统计
@@ -192,13 +271,13 @@ TransportError LoopbackTransport::Write(const void* data, size_t size, size_t* w
 		m_stats.bytesSent += size;
 		m_stats.packetsTotal++;
 
-		if (packet.shouldError)
+		if (shouldError)
 		{
 			m_stats.simulatedErrors++;
 			m_stats.packetsError++;
 		}
 
-		if (packet.shouldLoss)
+		if (shouldLoss)
 		{
 			m_stats.simulatedLosses++;
 			m_stats.packetsError++;
@@ -210,10 +289,8 @@ TransportError LoopbackTransport::Write(const void* data, size_t size, size_t* w
 		*written = size;
 	}
 
-	LogOperation("写入数据", "数据包 #" + std::to_string(sequenceId) +
-		" 大小:" + std::to_string(size) + "字节" +
-		(packet.shouldError ? " [模拟错误]" : "") +
-		(packet.shouldLoss ? " [模拟丢包]" : ""));
+	LOOPBACK_TRACE("LoopbackTransport::写入数据 - 数据包 #{} 大小:{}字节{}{}",
+		sequenceId, size, shouldError ? " [模拟错误]" : "", shouldLoss ? " [模拟丢包]" : "");
 
 	return TransportError::Success;
 }
@@ -289,9 +366,8 @@ TransportError LoopbackTransport::Read(void* buffer, size_t size, size_t* read,
 		*read = copySize;
 	}
 
-	LogOperation("读取数据", "数据包 #" + std::to_string(packet.sequenceId) +
-		" 大小:" + std::to_string(copySize) + "字节" +
-		" 延迟:" + std::to_string(latency) + "ms");
+	LOOPBACK_TRACE("LoopbackTransport::读取数据 - 数据包 #{} 大小:{}字节 延迟:{}ms",
+		packet.sequenceId, copySize, latency);
 
 	return TransportError::Success;
 }
@@ -299,8 +375,9 @@ TransportError LoopbackTransport::Read(void* buffer, size_t size, size_t* read,
 // 异步写入数据
 TransportError LoopbackTransport::WriteAsync(const void* data, size_t size)
 {
-	// 异步写入与同步写入使用相同的逻辑，因为回路传输本身就是异步的
-	return Write(data, size, nullptr);
+	// 回路传输本身就是异步的，与同步写入的区别只在于不可写时立即返回Busy
+	WriteSegment segment = { data, size };
+	return EnqueuePacket(&segment, 1, nullptr, 0);
 }
 
 // 启动异步读取
@@ -411,6 +488,8 @@ TransportError LoopbackTransport::FlushBuffers()
 		std::lock_guard<std::mutex> sendLock(m_sendQueueMutex);
 		std::queue<LoopbackPacket> empty;
 		m_sendQueue.swap(empty);
+		// 丢弃的包不会再经ProcessSendQueue释放，待写字节随队列一并清零，否则计数泄漏后一直不可写
+		m_writeBackpressure.Reset();
 	}
 
 	{
@@ -440,6 +519,32 @@ size_t LoopbackTransport::GetAvailableBytes() const
 	return totalBytes;
 }
 
+// 写入背压：由WriteBackpressure统计发送队列中尚未回路的字节
+size_t LoopbackTransport::GetPendingWriteBytes() const
+{
+	return m_writeBackpressure.GetPendingBytes();
+}
+
+void LoopbackTransport::SetWriteWatermarks(size_t highWatermark, size_t lowWatermark)
+{
+	m_writeBackpressure.SetWatermarks(highWatermark, lowWatermark);
+}
+
+bool LoopbackTransport::IsWritable() const
+{
+	return m_writeBackpressure.IsWritable();
+}
+
+bool LoopbackTransport::WaitWritable(DWORD timeoutMs)
+{
+	return m_writeBackpressure.WaitWritable(timeoutMs);
+}
+
+void LoopbackTransport::SetWritableCallback(WritableCallback callback)
+{
+	m_writeBackpressure.SetWritableCallback(callback);
+}
+
 // 设置回路配置
 void LoopbackTransport::SetLoopbackConfig(const LoopbackConfig& config)
 {
@@ -573,7 +678,7 @@ void LoopbackTransport::ProcessSendQueue()
 		return;
 	}
 
-	LoopbackPacket packet = m_sendQueue.front();
+	LoopbackPacket packet = std::move(m_sendQueue.front());
 	m_sendQueue.pop();
 	sendLock.unlock();
 
@@ -584,6 +689,9 @@ void LoopbackTransport::ProcessSendQueue()
 		SimulateDelay(delay);
 	}
 
+	// 数据包已离开发送队列（含模拟丢包），释放写入背压
+	m_writeBackpressure.Release(packet.data.size());
+
 	// 【P1优化】握手保护 - 前N个包不丢包，确保握手成功
 	uint32_t currentPacketIndex = m_packetsProcessed.fetch_add(1);
 	bool inHandshakeProtection = (currentPacketIndex < m_config.handshakeProtectionCount);
@@ -591,12 +699,12 @@ void LoopbackTransport::ProcessSendQueue()
 	// 检查是否模拟丢包（握手保护期内不丢包）
 	if (!inHandshakeProtection && packet.shouldLoss)
 	{
-		LogOperation("处理数据包", "数据包 #" + std::to_string(packet.sequenceId) + " 被丢弃（模拟丢包）");
+		LOOPBACK_TRACE("LoopbackTransport::处理数据包 - 数据包 #{} 被丢弃（模拟丢包）", packet.sequenceId);
 		return;
 	}
 	else if (inHandshakeProtection && packet.shouldLoss)
 	{
-		LogOperation("处理数据包", "数据包 #" + std::to_string(packet.sequenceId) + " 在握手保护期内，跳过丢包");
+		LOOPBACK_TRACE("LoopbackTransport::处理数据包 - 数据包 #{} 在握手保护期内，跳过丢包", packet.sequenceId);
 	}
 
 	// 检查是否模拟错误
@@ -611,7 +719,7 @@ void LoopbackTransport::ProcessSendQueue()
 				packet.data[0] ^= 0x55; // 翻转部分位
 			}
 		}
-		LogOperation("处理数据包", "数据包 #" + std::to_string(packet.sequenceId) + " 已损坏（模拟错误）");
+		LOOPBACK_TRACE("LoopbackTransport::处理数据包 - 数据包 #{} 已损坏（模拟错误）", packet.sequenceId);
 	}
 
 	// 将数据包移到接收队列
@@ -2,6 +2,7 @@
 #pragma execution_character_set("utf-8")
 
 #include "ITransport.h"
+#include "WriteBackpressure.h"
 #include <queue>
 #include <thread>
 #include <chrono>
@@ -97,6 +98,16 @@ public:
 	virtual TransportError FlushBuffers() override;
 	virtual size_t GetAvailableBytes() const override;
 
+	// 写入背压：待写字节为发送队列中尚未回路的数据
+	virtual size_t GetPendingWriteBytes() const override;
+	virtual void SetWriteWatermarks(size_t highWatermark, size_t lowWatermark) override;
+	virtual bool IsWritable() const override;
+	virtual bool WaitWritable(DWORD timeoutMs) override;
+	virtual void SetWritableCallback(WritableCallback callback) override;
+
+	// 分散写入：各段组成一个数据包
+	virtual TransportError WriteV(const WriteSegment* segments, size_t count, size_t* written = nullptr) override;
+
 	// 回路测试特有功能
 	LoopbackStats GetLoopbackStats() const;
 	void SetLoopbackConfig(const LoopbackConfig& config);
@@ -127,6 +138,7 @@ private:
 	mutable std::mutex m_sendQueueMutex;
 	mutable std::mutex m_receiveQueueMutex;
 	std::condition_variable m_receiveCondition;
+	WriteBackpressure m_writeBackpressure;
 
 	// 工作线程
 	std::thread m_loopbackThread;
@@ -147,6 +159,7 @@ private:
 	std::chrono::steady_clock::time_point m_lastStatsUpdate;
 
 	// 内部方法
+	TransportError EnqueuePacket(const WriteSegment* segments, size_t count, size_t* written, DWORD waitMs);
 	void LoopbackWorkerThread();
 	void ProcessSendQueue();
 	void ProcessReceiveQueue();
@@ -191,12 +191,21 @@ TransportError NetworkPrintTransport::Close()
 	if (m_asyncWriteRunning)
 	{
 		m_asyncWriteRunning = false;
+		m_writeQueueCondition.notify_all();
 		if (m_asyncWriteThread.joinable())
 		{
 			m_asyncWriteThread.join();
 		}
 	}
 
+	// 丢弃未发送的异步写入，同时唤醒等待可写的写入方
+	{
+		std::lock_guard<std::mutex> queueLock(m_writeQueueMutex);
+		std::queue<std::vector<uint8_t>> empty;
+		m_writeQueue.swap(empty);
+	}
+	m_writeBackpressure.Reset();
+
 	// 关闭套接字
 	CloseSocket();
 
@@ -251,6 +260,44 @@ TransportError NetworkPrintTransport::Write(const void* data, size_t size, size_
 	return result;
 }
 
+// 分散写入数据
+TransportError NetworkPrintTransport::WriteV(const WriteSegment* segments, size_t count, size_t* written)
+{
+	// LPR/IPP需要在作业头中声明数据长度且每次写入是一个作业，沿用拼接后Write
+	if (m_config.protocol != NetworkPrintProtocol::RAW)
+	{
+		return ITransport::WriteV(segments, count, written);
+	}
+
+	if (written)
+	{
+		*written = 0;
+	}
+
+	if (!IsOpen())
+	{
+		return TransportError::NotOpen;
+	}
+
+	if (!segments || count == 0)
+	{
+		return TransportError::InvalidParameter;
+	}
+
+	SetConnectionState(NetworkConnectionState::Sending);
+
+	size_t sent = 0;
+	TransportError result = SendDataV(segments, count, &sent);
+
+	if (written)
+	{
+		*written = (result == TransportError::Success) ? sent : 0;
+	}
+
+	SetConnectionState(NetworkConnectionState::Connected);
+	return result;
+}
+
 // 同步读取数据
 TransportError NetworkPrintTransport::Read(void* buffer, size_t size, size_t* read, DWORD timeout)
 {
@@ -284,6 +331,12 @@ TransportError NetworkPrintTransport::WriteAsync(const void* data, size_t size)
 		return TransportError::InvalidParameter;
 	}
 
+	// 写队列达到高水位后拒绝入队，调用方可WaitWritable()后重试，避免队列无限增长
+	if (!m_writeBackpressure.TryAcquire(size))
+	{
+		return TransportError::Busy;
+	}
+
 	// 将数据加入写入队列
 	std::vector<uint8_t> buffer(static_cast<const uint8_t*>(data),
 		static_cast<const uint8_t*>(data) + size);
@@ -292,6 +345,7 @@ TransportError NetworkPrintTransport::WriteAsync(const void* data, size_t size)
 		std::lock_guard<std::mutex> lock(m_writeQueueMutex);
 		m_writeQueue.push(std::move(buffer));
 	}
+	m_writeQueueCondition.notify_one();
 
 	// 启动异步写入线程
 	if (!m_asyncWriteRunning)
@@ -429,6 +483,32 @@ size_t NetworkPrintTransport::GetAvailableBytes() const
 	return static_cast<size_t>(available);
 }
 
+// 写入背压：由WriteBackpressure统计异步写队列中尚未发送的字节
+size_t NetworkPrintTransport::GetPendingWriteBytes() const
+{
+	return m_writeBackpressure.GetPendingBytes();
+}
+
+void NetworkPrintTransport::SetWriteWatermarks(size_t highWatermark, size_t lowWatermark)
+{
+	m_writeBackpressure.SetWatermarks(highWatermark, lowWatermark);
+}
+
+bool NetworkPrintTransport::IsWritable() const
+{
+	return m_writeBackpressure.IsWritable();
+}
+
+bool NetworkPrintTransport::WaitWritable(DWORD timeoutMs)
+{
+	return m_writeBackpressure.WaitWritable(timeoutMs);
+}
+
+void NetworkPrintTransport::SetWritableCallback(WritableCallback callback)
+{
+	m_writeBackpressure.SetWritableCallback(callback);
+}
+
 // 获取连接状态
 NetworkConnectionState NetworkPrintTransport::GetConnectionState() const
 {
@@ -810,6 +890,81 @@ TransportError NetworkPrintTransport::SendData(const void* data, size_t size, si
 	return TransportError::Success;
 }
 
+// 分散发送数据：各段组成WSABUF数组由WSASend一次提交，部分发送时从断点继续
+TransportError NetworkPrintTransport::SendDataV(const WriteSegment* segments, size_t count, size_t* sent)
+{
+	std::vector<WSABUF> buffers;
+	buffers.reserve(count);
+	size_t totalSize = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (segments[i].size == 0)
+		{
+			continue;
+		}
+		WSABUF buffer;
+		buffer.buf = static_cast<char*>(const_cast<void*>(segments[i].data));
+		buffer.len = static_cast<ULONG>(segments[i].size);
+		buffers.push_back(buffer);
+		totalSize += segments[i].size;
+	}
+
+	size_t first = 0;
+	size_t totalSent = 0;
+
+	while (first < buffers.size())
+	{
+		DWORD bytesSent = 0;
+		int result = WSASend(m_socket, &buffers[first], static_cast<DWORD>(buffers.size() - first),
+			&bytesSent, 0, nullptr, nullptr);
+
+		if (result == SOCKET_ERROR)
+		{
+			int errorCode = WSAGetLastError();
+			if (errorCode == WSAEWOULDBLOCK)
+			{
+				// 非阻塞模式下暂时无法发送，短暂等待后重试
+				Sleep(1);
+				continue;
+			}
+
+			if (sent) *sent = totalSent;
+			return GetSocketError();
+		}
+
+		if (bytesSent == 0)
+		{
+			// 连接已关闭
+			break;
+		}
+
+		totalSent += bytesSent;
+		UpdateStats(bytesSent, 0);
+
+		// 跳过已发完的段，调整部分发送的段
+		size_t consumed = bytesSent;
+		while (first < buffers.size() && consumed >= buffers[first].len)
+		{
+			consumed -= buffers[first].len;
+			first++;
+		}
+		if (consumed > 0)
+		{
+			buffers[first].buf += consumed;
+			buffers[first].len -= static_cast<ULONG>(consumed);
+		}
+	}
+
+	if (sent) *sent = totalSent;
+
+	if (totalSent < totalSize)
+	{
+		return TransportError::WriteFailed;
+	}
+
+	return TransportError::Success;
+}
+
 // 接收数据
 TransportError NetworkPrintTransport::ReceiveData(void* buffer, size_t size, size_t* received, DWORD timeout)
 {
@@ -911,10 +1066,9 @@ TransportError NetworkPrintTransport::SendLPRJob(const void* data, size_t size,
 	result = ReceiveLPRResponse(response);
 	if (result != TransportError::Success || response[0] != '\0') return TransportError::WriteFailed;
 
-	result = SendData(data, size, &sent);
-	if (result != TransportError::Success) return result;
-
-	result = SendData(&ack, 1, &sent);
+	// 数据文件与结束确认字节一次发送
+	WriteSegment dataSegments[] = { { data, size }, { &ack, 1 } };
+	result = SendDataV(dataSegments, 2, &sent);
 	if (result != TransportError::Success) return result;
 
 	result = ReceiveLPRResponse(response);
@@ -926,13 +1080,12 @@ TransportError NetworkPrintTransport::SendLPRJob(const void* data, size_t size,
 // 发送IPP作业
 TransportError NetworkPrintTransport::SendIPPJob(const void* data, size_t size, const std::string& jobName)
 {
-	// 构建IPP请求
-	std::vector<uint8_t> jobData(static_cast<const uint8_t*>(data),
-		static_cast<const uint8_t*>(data) + size);
-	std::vector<uint8_t> ippRequest = BuildIPPRequest(jobData, jobName);
+	// IPP请求体 = 属性 + 文档数据；文档数据直接作为发送段，不拷入请求缓冲区
+	std::vector<uint8_t> attributes = BuildIPPAttributes(jobName);
+	WriteSegment body[] = { { attributes.data(), attributes.size() }, { data, size } };
 
 	// 发送HTTP请求
-	return SendHTTPRequest("POST", m_config.httpPath, ippRequest, m_config.contentType);
+	return SendHTTPRequest("POST", m_config.httpPath, body, 2, m_config.contentType);
 }
 
 // 发送LPR命令
@@ -985,29 +1138,24 @@ std::string NetworkPrintTransport::FormatLPRControlFile(const std::string& jobNa
 
 // 发送HTTP请求
 TransportError NetworkPrintTransport::SendHTTPRequest(const std::string& method, const std::string& path,
-	const std::vector<uint8_t>& data, const std::string& contentType)
+	const WriteSegment* body, size_t bodyCount, const std::string& contentType)
 {
-	std::string headers = BuildHTTPHeaders(method, path, data.size(), contentType);
-
-	// 发送HTTP头
-	size_t sent = 0;
-	TransportError result = SendData(headers.c_str(), headers.length(), &sent);
-	if (result != TransportError::Success)
+	size_t contentLength = 0;
+	for (size_t i = 0; i < bodyCount; i++)
 	{
-		return result;
+		contentLength += body[i].size;
 	}
 
-	// 发送数据
-	if (!data.empty())
-	{
-		result = SendData(data.data(), data.size(), &sent);
-		if (result != TransportError::Success)
-		{
-			return result;
-		}
-	}
+	std::string headers = BuildHTTPHeaders(method, path, contentLength, contentType);
 
-	return TransportError::Success;
+	// HTTP头与请求体各段一次发送
+	std::vector<WriteSegment> segments;
+	segments.reserve(bodyCount + 1);
+	segments.push_back({ headers.c_str(), headers.length() });
+	segments.insert(segments.end(), body, body + bodyCount);
+
+	size_t sent = 0;
+	return SendDataV(segments.data(), segments.size(), &sent);
 }
 
 // 接收HTTP响应
@@ -1075,8 +1223,8 @@ std::string NetworkPrintTransport::BuildHTTPHeaders(const std::string& method, c
 	return oss.str();
 }
 
-// 构建IPP请求
-std::vector<uint8_t> NetworkPrintTransport::BuildIPPRequest(const std::vector<uint8_t>& data, const std::string& jobName) const
+// 构建IPP请求的属性部分（文档数据由调用方作为单独的发送段跟在其后）
+std::vector<uint8_t> NetworkPrintTransport::BuildIPPAttributes(const std::string& jobName) const
 {
 	std::vector<uint8_t> request;
 
@@ -1175,10 +1323,6 @@ std::vector<uint8_t> NetworkPrintTransport::BuildIPPRequest(const std::vector<ui
 	// === 数据结束标记 ===
 	request.push_back(0x03);  // end-of-attributes-tag
 
-	// === 文档数据 ===
-	// 将实际的打印数据附加到IPP请求末尾
-	request.insert(request.end(), data.begin(), data.end());
-
 	return request;
 }
 
@@ -1322,12 +1466,13 @@ void NetworkPrintTransport::AsyncWriteThread()
 	{
 		std::vector<uint8_t> data;
 
-		// 从队列中获取数据
+		// 从队列中获取数据（队列为空时等待入队通知，不持锁休眠）
 		{
-			std::lock_guard<std::mutex> lock(m_writeQueueMutex);
+			std::unique_lock<std::mutex> lock(m_writeQueueMutex);
+			m_writeQueueCondition.wait_for(lock, std::chrono::milliseconds(100),
+				[this]() { return !m_writeQueue.empty() || !m_asyncWriteRunning; });
 			if (m_writeQueue.empty())
 			{
-				Sleep(10);
 				continue;
 			}
 
@@ -1343,6 +1488,9 @@ void NetworkPrintTransport::AsyncWriteThread()
 		{
 			NotifyError(result, "异步写入失败");
 		}
+
+		// 无论成功与否数据都已离开写队列
+		m_writeBackpressure.Release(data.size());
 	}
 }
 
@@ -2,12 +2,14 @@
 #pragma execution_character_set("utf-8")
 
 #include "ITransport.h"
+#include "WriteBackpressure.h"
 #include <Windows.h>
 #include <WinSock2.h>
 #include <WS2tcpip.h>
 #include <memory>
 #include <string>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
 #include <thread>
 #include <queue>
@@ -128,6 +130,16 @@ public:
 	virtual TransportError FlushBuffers() override;
 	virtual size_t GetAvailableBytes() const override;
 
+	// 写入背压：待写字节为异步写队列中尚未发送的数据
+	virtual size_t GetPendingWriteBytes() const override;
+	virtual void SetWriteWatermarks(size_t highWatermark, size_t lowWatermark) override;
+	virtual bool IsWritable() const override;
+	virtual bool WaitWritable(DWORD timeoutMs) override;
+	virtual void SetWritableCallback(WritableCallback callback) override;
+
+	// 分散写入：RAW协议用WSASend一次发送各段；LPR/IPP沿用拼接后Write
+	virtual TransportError WriteV(const WriteSegment* segments, size_t count, size_t* written = nullptr) override;
+
 	// 网络打印专用方法
 	NetworkConnectionState GetConnectionState() const;
 	std::string GetRemoteAddress() const;
@@ -170,6 +182,8 @@ private:
 	std::thread m_asyncReadThread;
 	std::queue<std::vector<uint8_t>> m_writeQueue;
 	std::mutex m_writeQueueMutex;
+	std::condition_variable m_writeQueueCondition;
+	WriteBackpressure m_writeBackpressure;
 	std::thread m_asyncWriteThread;
 	std::atomic<bool> m_asyncWriteRunning;
 
@@ -195,6 +209,7 @@ private:
 	void CloseSocket();
 	TransportError ConnectToHost();
 	TransportError SendData(const void* data, size_t size, size_t* sent);
+	TransportError SendDataV(const WriteSegment* segments, size_t count, size_t* sent);
 	TransportError ReceiveData(void* buffer, size_t size, size_t* received, DWORD timeout);
 
 	// 协议实现
@@ -210,11 +225,11 @@ private:
 
 	// IPP协议辅助
 	TransportError SendHTTPRequest(const std::string& method, const std::string& path,
-		const std::vector<uint8_t>& data, const std::string& contentType);
+		const WriteSegment* body, size_t bodyCount, const std::string& contentType);
 	TransportError ReceiveHTTPResponse(std::vector<uint8_t>& response);
 	std::string BuildHTTPHeaders(const std::string& method, const std::string& path,
 		size_t contentLength, const std::string& contentType) const;
-	std::vector<uint8_t> BuildIPPRequest(const std::vector<uint8_t>& data, const std::string& jobName) const;
+	std::vector<uint8_t> BuildIPPAttributes(const std::string& jobName) const;
 
 	// 认证处理
 	TransportError Authenticate();
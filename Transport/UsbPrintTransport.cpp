@@ -641,19 +641,19 @@ TransportError UsbPrintTransport::WriteToDevice(const void* data, size_t size, s
 	// 【修复】增强参数验证和状态检查
 	if (m_hDevice == INVALID_HANDLE_VALUE || m_hDevice == nullptr)
 	{
-		Logger::LogDebug("WriteToDevice错误: 设备句柄无效\n");
+		PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_DEBUG, "WriteToDevice错误: 设备句柄无效");
 		return TransportError::NotOpen;
 	}
 
 	if (!data)
 	{
-		Logger::LogDebug("WriteToDevice错误: 数据指针为空\n");
+		PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_DEBUG, "WriteToDevice错误: 数据指针为空");
 		return TransportError::InvalidParameter;
 	}
 
 	if (size == 0)
 	{
-		Logger::LogDebug("WriteToDevice警告: 数据大小为0\n");
+		PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_DEBUG, "WriteToDevice警告: 数据大小为0");
 		if (written) *written = 0;
 		return TransportError::Success;
 	}
@@ -661,23 +661,20 @@ TransportError UsbPrintTransport::WriteToDevice(const void* data, size_t size, s
 	// 【第九轮修复】二次检查设备句柄有效性（防止多线程环境下句柄被释放）
 	if (m_hDevice == INVALID_HANDLE_VALUE || m_hDevice == nullptr)
 	{
-		Logger::LogDebug("WriteToDevice: 设备句柄在写入前变为无效\n");
+		PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_DEBUG, "WriteToDevice: 设备句柄在写入前变为无效");
 		return TransportError::NotOpen;
 	}
 
-	// 【修复】添加详细的调试日志
-	Logger::LogDebug("WriteToDevice: 准备写入数据，大小=" + std::to_string(size) +
-		"字节，设备句柄=0x" + std::to_string(reinterpret_cast<uintptr_t>(m_hDevice)) + "\n");
+	// 【修复】添加详细的调试日志（逐次写入的细节为TRACE级别，默认不求值、不入队）
+	PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_TRACE, "WriteToDevice: 准备写入数据，大小={}字节，设备句柄={}",
+		size, reinterpret_cast<uintptr_t>(m_hDevice));
 
 	// 【修复】检查数据内容的前几个字节用于调试
 	if (size >= 4)
 	{
 		const uint8_t* byteData = static_cast<const uint8_t*>(data);
-		Logger::LogDebug("WriteToDevice: 数据前4字节=[" +
-			std::to_string(byteData[0]) + ", " +
-			std::to_string(byteData[1]) + ", " +
-			std::to_string(byteData[2]) + ", " +
-			std::to_string(byteData[3]) + "]\n");
+		PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_TRACE, "WriteToDevice: 数据前4字节=[{}, {}, {}, {}]",
+			byteData[0], byteData[1], byteData[2], byteData[3]);
 	}
 
 	// 【第九轮修复】调用受SEH保护的WriteFile包装函数
@@ -686,14 +683,14 @@ TransportError UsbPrintTransport::WriteToDevice(const void* data, size_t size, s
 	BOOL success = WriteFileProtected(m_hDevice, data, static_cast<DWORD>(size), &bytesWritten, &lastError);
 
 	// 【修复】记录WriteFile调用结果
-	Logger::LogDebug("WriteToDevice: WriteFileProtected返回=" + std::string(success ? "成功" : "失败") +
-		"，实际写入=" + std::to_string(bytesWritten) + "字节\n");
+	PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_TRACE, "WriteToDevice: WriteFileProtected返回={}，实际写入={}字节",
+		success ? "成功" : "失败", bytesWritten);
 
 	if (written) *written = bytesWritten;
 
 	if (!success)
 	{
-		Logger::LogDebug("WriteToDevice: WriteFile失败，Windows错误码=" + std::to_string(lastError) + "\n");
+		PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_WARNING, "WriteToDevice: WriteFile失败，Windows错误码={}", lastError);
 
 		// 【第九轮修复】处理设备断开连接的特殊错误码
 		if (lastError == ERROR_DEVICE_NOT_CONNECTED ||
@@ -701,14 +698,14 @@ TransportError UsbPrintTransport::WriteToDevice(const void* data, size_t size, s
 			lastError == ERROR_GEN_FAILURE ||
 			lastError == ERROR_NOT_READY)
 		{
-			Logger::LogDebug("WriteToDevice: 检测到设备已断开或不可用\n");
+			PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_WARNING, "WriteToDevice: 检测到设备已断开或不可用");
 			return TransportError::ConnectionClosed;
 		}
 
 		// 【第九轮修复】处理SEH异常（lastError == 0xFFFFFFFF表示发生了SEH异常）
 		if (lastError == 0xFFFFFFFF)
 		{
-			Logger::LogDebug("WriteToDevice: 捕获到SEH异常，可能是设备句柄无效或驱动程序错误\n");
+			PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_WARNING, "WriteToDevice: 捕获到SEH异常，可能是设备句柄无效或驱动程序错误");
 			return TransportError::WriteFailed;
 		}
 
@@ -719,12 +716,11 @@ TransportError UsbPrintTransport::WriteToDevice(const void* data, size_t size, s
 	// 验证写入的字节数是否匹配
 	if (bytesWritten != static_cast<DWORD>(size))
 	{
-		Logger::LogDebug("WriteToDevice警告: 请求写入" + std::to_string(size) +
-			"字节，实际写入" + std::to_string(bytesWritten) + "字节\n");
+		PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_DEBUG, "WriteToDevice警告: 请求写入{}字节，实际写入{}字节", size, bytesWritten);
 	}
 
 	UpdateStats(bytesWritten, 0);
-	Logger::LogDebug("WriteToDevice: 数据写入成功完成\n");
+	PM_LOG(LogModule::Transport, LogLevel::LOG_LEVEL_TRACE, "WriteToDevice: 数据写入成功完成");
 	return TransportError::Success;
 }
 
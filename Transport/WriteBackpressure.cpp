@@ -0,0 +1,130 @@
+﻿#pragma execution_character_set("utf-8")
+
+#include "pch.h"
+#include "WriteBackpressure.h"
+#include <chrono>
+
+WriteBackpressure::WriteBackpressure()
+	: m_pendingBytes(0)
+	, m_highWatermark(DEFAULT_HIGH_WATERMARK)
+	, m_lowWatermark(DEFAULT_LOW_WATERMARK)
+	, m_blocked(false)
+{
+}
+
+void WriteBackpressure::SetWatermarks(size_t highWatermark, size_t lowWatermark)
+{
+	if (highWatermark == 0)
+	{
+		return;
+	}
+
+	bool becameWritable = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_highWatermark = highWatermark;
+		m_lowWatermark = (lowWatermark < highWatermark) ? lowWatermark : highWatermark / 2;
+
+		// 按新水位重新判定当前状态
+		if (m_blocked && m_pendingBytes <= m_lowWatermark)
+		{
+			m_blocked = false;
+			becameWritable = true;
+		}
+		else if (!m_blocked && m_pendingBytes >= m_highWatermark)
+		{
+			m_blocked = true;
+		}
+	}
+
+	if (becameWritable)
+	{
+		NotifyWritable();
+	}
+}
+
+void WriteBackpressure::SetWritableCallback(WritableCallback callback)
+{
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	m_writableCallback = callback;
+}
+
+bool WriteBackpressure::TryAcquire(size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_blocked)
+	{
+		return false;
+	}
+
+	// 未达高水位时总是接受，本次写入可以越过高水位，之后的写入被拒绝
+	m_pendingBytes += bytes;
+	if (m_pendingBytes >= m_highWatermark)
+	{
+		m_blocked = true;
+	}
+	return true;
+}
+
+void WriteBackpressure::Release(size_t bytes)
+{
+	bool becameWritable = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pendingBytes -= (std::min)(bytes, m_pendingBytes);
+		if (m_blocked && m_pendingBytes <= m_lowWatermark)
+		{
+			m_blocked = false;
+			becameWritable = true;
+		}
+	}
+
+	if (becameWritable)
+	{
+		NotifyWritable();
+	}
+}
+
+void WriteBackpressure::Reset()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_pendingBytes = 0;
+		m_blocked = false;
+	}
+	m_condition.notify_all();
+}
+
+size_t WriteBackpressure::GetPendingBytes() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_pendingBytes;
+}
+
+bool WriteBackpressure::IsWritable() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return !m_blocked;
+}
+
+bool WriteBackpressure::WaitWritable(DWORD timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (timeoutMs == INFINITE)
+	{
+		m_condition.wait(lock, [this]() { return !m_blocked; });
+		return true;
+	}
+	return m_condition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]() { return !m_blocked; });
+}
+
+void WriteBackpressure::NotifyWritable()
+{
+	m_condition.notify_all();
+
+	std::lock_guard<std::mutex> lock(m_callbackMutex);
+	if (m_writableCallback)
+	{
+		m_writableCallback();
+	}
+}
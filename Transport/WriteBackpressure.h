@@ -0,0 +1,52 @@
+﻿#pragma once
+#pragma execution_character_set("utf-8")
+
+#include "ITransport.h"
+#include <mutex>
+#include <condition_variable>
+
+// 写入背压：统计已提交但尚未写出的字节数，按高/低水位切换可写状态
+// 用法（带写队列的传输实现）：
+//   入队前 TryAcquire(size)，返回false时不入队（WriteAsync返回Busy，或WaitWritable后重试）；
+//   数据写出或丢弃后 Release(size)；关闭时 Reset()。
+// 达到高水位后不可写，回落到低水位才恢复可写（滞回，避免在阈值附近反复切换），
+// 恢复时唤醒WaitWritable()的等待者并在Release()的线程中触发回调（不持有状态锁）。
+class WriteBackpressure
+{
+public:
+	static const size_t DEFAULT_HIGH_WATERMARK = 1024 * 1024;
+	static const size_t DEFAULT_LOW_WATERMARK = 256 * 1024;
+
+public:
+	WriteBackpressure();
+
+	WriteBackpressure(const WriteBackpressure&) = delete;
+	WriteBackpressure& operator=(const WriteBackpressure&) = delete;
+
+	// 低水位不小于高水位时取高水位的一半
+	void SetWatermarks(size_t highWatermark, size_t lowWatermark);
+	// 设置后返回时，之前的回调不会再被调用
+	void SetWritableCallback(WritableCallback callback);
+
+	bool TryAcquire(size_t bytes);
+	void Release(size_t bytes);
+	void Reset();
+
+	size_t GetPendingBytes() const;
+	bool IsWritable() const;
+	bool WaitWritable(DWORD timeoutMs);
+
+private:
+	void NotifyWritable();
+
+private:
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	size_t m_pendingBytes;
+	size_t m_highWatermark;
+	size_t m_lowWatermark;
+	bool m_blocked;
+
+	std::mutex m_callbackMutex;   // 串行化回调的调用与替换
+	WritableCallback m_writableCallback;
+};
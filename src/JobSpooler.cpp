@@ -0,0 +1,1014 @@
+﻿#pragma execution_character_set("utf-8")
+
+#include "pch.h"
+#include "JobSpooler.h"
+#include "TransmissionTask.h"
+#include "../Protocol/Crc32.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+	const uint32_t RECORD_MAGIC = 0x4A534D50; // "PMSJ"
+	const uint8_t RECORD_VERSION = 1;
+	const char* const PAYLOAD_EXTENSION = ".dat";
+	const char* const RECORD_EXTENSION = ".job";
+	const char* const TEMP_EXTENSION = ".tmp";
+
+	const int RAW_BUSY_RETRY_LIMIT = 100;     // 直接模式下单个分块遇到传输忙的最大重试次数
+	const DWORD RAW_BUSY_RETRY_DELAY_MS = 10;
+	const DWORD RAW_ABORT_POLL_MS = 50;       // 直接模式等待任务结束期间检查取消/停止的间隔
+
+	void PutLittleEndian(std::vector<uint8_t>& data, uint64_t value, int bytes)
+	{
+		for (int i = 0; i < bytes; i++)
+		{
+			data.push_back(static_cast<uint8_t>((value >> (i * 8)) & 0xFF));
+		}
+	}
+
+	uint64_t GetLittleEndian(const uint8_t* data, int bytes)
+	{
+		uint64_t value = 0;
+		for (int i = 0; i < bytes; i++)
+		{
+			value |= static_cast<uint64_t>(data[i]) << (i * 8);
+		}
+		return value;
+	}
+
+	void PutString(std::vector<uint8_t>& data, const std::string& value)
+	{
+		size_t length = (std::min)(value.size(), static_cast<size_t>(0xFFFF));
+		PutLittleEndian(data, length, 2);
+		data.insert(data.end(), value.begin(), value.begin() + length);
+	}
+
+	bool GetString(const uint8_t*& p, const uint8_t* end, std::string& value)
+	{
+		if (end - p < 2)
+		{
+			return false;
+		}
+		size_t length = static_cast<size_t>(GetLittleEndian(p, 2));
+		p += 2;
+		if (static_cast<size_t>(end - p) < length)
+		{
+			return false;
+		}
+		value.assign(reinterpret_cast<const char*>(p), length);
+		p += length;
+		return true;
+	}
+
+	bool EndsWith(const std::string& value, const char* suffix)
+	{
+		size_t length = strlen(suffix);
+		return value.size() >= length && value.compare(value.size() - length, length, suffix) == 0;
+	}
+
+	bool QueryFileSize(const std::string& filePath, uint64_t& size)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA data = {};
+		if (!GetFileAttributesExA(filePath.c_str(), GetFileExInfoStandard, &data))
+		{
+			return false;
+		}
+		size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+		return true;
+	}
+
+	// 写入整个文件，flush时等待数据落盘；失败时删除不完整的文件
+	bool WriteWholeFile(const std::string& filePath, const uint8_t* data, size_t size, bool flush)
+	{
+		HANDLE file = CreateFileA(filePath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		bool ok = true;
+		while (ok && size > 0)
+		{
+			DWORD chunk = static_cast<DWORD>((std::min)(size, static_cast<size_t>(64 * 1024 * 1024)));
+			DWORD written = 0;
+			ok = WriteFile(file, data, chunk, &written, nullptr) && written == chunk;
+			data += chunk;
+			size -= chunk;
+		}
+		if (ok && flush)
+		{
+			ok = FlushFileBuffers(file) != FALSE;
+		}
+		CloseHandle(file);
+
+		if (!ok)
+		{
+			DeleteFileA(filePath.c_str());
+		}
+		return ok;
+	}
+
+	bool FlushExistingFile(const std::string& filePath)
+	{
+		HANDLE file = CreateFileA(filePath.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		bool ok = FlushFileBuffers(file) != FALSE;
+		CloseHandle(file);
+		return ok;
+	}
+}
+
+// ==================== 构造与析构 ====================
+
+JobSpooler::JobSpooler()
+	: m_open(false)
+	, m_activeJobs(0)
+	, m_nextJobId(1)
+{
+}
+
+JobSpooler::~JobSpooler()
+{
+	Close();
+}
+
+// ==================== 生命周期 ====================
+
+bool JobSpooler::Open(const JobSpoolerConfig& config)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_open)
+	{
+		WriteLog("JobSpooler::Open - 假脱机已打开");
+		return false;
+	}
+
+	if (config.spoolDirectory.empty())
+	{
+		WriteLog("JobSpooler::Open - 未指定假脱机目录");
+		return false;
+	}
+
+	if (!CreateDirectoryA(config.spoolDirectory.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		WriteLog("JobSpooler::Open - 无法创建假脱机目录: " + config.spoolDirectory);
+		return false;
+	}
+
+	m_config = config;
+	m_config.maxConcurrentJobs = (std::max)(m_config.maxConcurrentJobs, static_cast<size_t>(1));
+	m_config.rawChunkSize = (std::max)((std::min)(m_config.rawChunkSize, static_cast<size_t>(64 * 1024)), static_cast<size_t>(1));
+	m_stats = JobSpoolerStats();
+	m_activeJobs = 0;
+
+	RecoverJobs();
+	m_open = true;
+
+	WriteLog("JobSpooler::Open - 假脱机目录: " + m_config.spoolDirectory + "，恢复作业: " + std::to_string(m_stats.jobsRecovered));
+	return true;
+}
+
+void JobSpooler::Close()
+{
+	std::map<std::string, std::unique_ptr<PortWorker>> workers;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_open)
+		{
+			return;
+		}
+		m_open = false;
+		for (auto& entry : m_workers)
+		{
+			entry.second->stopRequested = true;
+		}
+		workers.swap(m_workers);
+	}
+	m_condition.notify_all();
+
+	// 中止的作业在FinishJob中回到排队状态并写回记录
+	for (auto& entry : workers)
+	{
+		if (entry.second->thread.joinable())
+		{
+			entry.second->thread.join();
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_jobs.clear();
+	m_queues.clear();
+	m_activeJobs = 0;
+	WriteLog("JobSpooler::Close - 假脱机已关闭");
+}
+
+bool JobSpooler::IsOpen() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_open;
+}
+
+// ==================== 端口管理 ====================
+
+bool JobSpooler::AttachPort(const std::string& portName, std::shared_ptr<ITransport> transport, std::shared_ptr<ReliableChannel> reliableChannel)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!m_open || portName.empty() || (!transport && !reliableChannel))
+	{
+		return false;
+	}
+
+	if (m_workers.find(portName) != m_workers.end())
+	{
+		WriteLog("JobSpooler::AttachPort - 端口已附加: " + portName);
+		return false;
+	}
+
+	std::unique_ptr<PortWorker> worker(new PortWorker());
+	worker->portName = portName;
+	worker->transport = transport;
+	worker->reliableChannel = reliableChannel;
+	worker->thread = std::thread(&JobSpooler::WorkerThread, this, worker.get());
+	m_workers[portName] = std::move(worker);
+
+	WriteLog("JobSpooler::AttachPort - 端口: " + portName + "，模式: " + (reliableChannel ? "可靠" : "直接"));
+	return true;
+}
+
+void JobSpooler::DetachPort(const std::string& portName)
+{
+	std::unique_ptr<PortWorker> worker;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_workers.find(portName);
+		if (it == m_workers.end())
+		{
+			return;
+		}
+		it->second->stopRequested = true;
+		worker = std::move(it->second);
+		m_workers.erase(it);
+	}
+	m_condition.notify_all();
+
+	if (worker->thread.joinable())
+	{
+		worker->thread.join();
+	}
+	WriteLog("JobSpooler::DetachPort - 端口: " + portName);
+}
+
+// ==================== 入队与取消 ====================
+
+uint64_t JobSpooler::Enqueue(const std::string& portName, const std::vector<uint8_t>& data, const SpoolJobOptions& options)
+{
+	if (!IsOpen() || portName.empty() || data.empty())
+	{
+		return 0;
+	}
+
+	// 负载先落盘，记录写入后作业才算入队；中途崩溃只留下无记录的负载，恢复时删除
+	uint64_t jobId = m_nextJobId++;
+	if (!WriteWholeFile(GetPayloadPath(jobId), data.data(), data.size(), m_config.flushToDisk))
+	{
+		WriteLog("JobSpooler::Enqueue - 写入负载失败: " + GetPayloadPath(jobId));
+		return 0;
+	}
+
+	return CommitJob(portName, data.size(), options, jobId);
+}
+
+uint64_t JobSpooler::EnqueueFile(const std::string& portName, const std::string& filePath, const SpoolJobOptions& options)
+{
+	if (!IsOpen() || portName.empty())
+	{
+		return 0;
+	}
+
+	uint64_t size = 0;
+	if (!QueryFileSize(filePath, size) || size == 0)
+	{
+		WriteLog("JobSpooler::EnqueueFile - 文件不存在或为空: " + filePath);
+		return 0;
+	}
+
+	uint64_t jobId = m_nextJobId++;
+	std::string payloadPath = GetPayloadPath(jobId);
+	if (!CopyFileA(filePath.c_str(), payloadPath.c_str(), FALSE) ||
+		(m_config.flushToDisk && !FlushExistingFile(payloadPath)) ||
+		!QueryFileSize(payloadPath, size))
+	{
+		DeleteFileA(payloadPath.c_str());
+		WriteLog("JobSpooler::EnqueueFile - 复制文件失败: " + filePath);
+		return 0;
+	}
+
+	SpoolJobOptions jobOptions = options;
+	if (jobOptions.displayName.empty())
+	{
+		jobOptions.displayName = filePath;
+	}
+	return CommitJob(portName, size, jobOptions, jobId);
+}
+
+uint64_t JobSpooler::CommitJob(const std::string& portName, uint64_t size, const SpoolJobOptions& options, uint64_t jobId)
+{
+	SpoolJob job;
+	job.info.id = jobId;
+	job.info.portName = portName;
+	job.info.displayName = options.displayName;
+	job.info.priority = options.priority;
+	job.info.state = SpoolJobState::Queued;
+	job.info.maxAttempts = (std::max)(options.maxAttempts, 1);
+	job.info.size = size;
+	job.info.createdTime = static_cast<uint64_t>(std::time(nullptr));
+
+	if (!SaveRecord(job.info))
+	{
+		DeleteJobFiles(jobId);
+		WriteLog("JobSpooler::Enqueue - 写入作业记录失败: " + GetRecordPath(jobId));
+		return 0;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_open)
+		{
+			// Close()期间入队：记录已落盘，下次Open()时恢复
+			return jobId;
+		}
+		m_jobs[jobId] = job;
+		QueueJobLocked(job);
+		m_stats.jobsEnqueued++;
+	}
+	m_condition.notify_all();
+
+	NotifyJobState(job.info);
+	return jobId;
+}
+
+bool JobSpooler::Cancel(uint64_t jobId)
+{
+	SpoolJobInfo snapshot;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_jobs.find(jobId);
+		if (it == m_jobs.end())
+		{
+			return false;
+		}
+
+		SpoolJob& job = it->second;
+		if (job.info.state == SpoolJobState::Running)
+		{
+			// 由工作线程在发送返回后删除
+			job.cancelRequested = true;
+			return true;
+		}
+
+		UnqueueJobLocked(job);
+		job.info.state = SpoolJobState::Cancelled;
+		snapshot = job.info;
+		m_jobs.erase(it);
+	}
+	m_condition.notify_all();
+
+	DeleteJobFiles(jobId);
+	NotifyJobState(snapshot);
+	WriteLog("JobSpooler::Cancel - 作业已取消: " + std::to_string(jobId));
+	return true;
+}
+
+// ==================== 状态查询 ====================
+
+bool JobSpooler::GetJob(uint64_t jobId, SpoolJobInfo& info) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_jobs.find(jobId);
+	if (it == m_jobs.end())
+	{
+		return false;
+	}
+	info = it->second.info;
+	return true;
+}
+
+std::vector<SpoolJobInfo> JobSpooler::GetJobs() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<SpoolJobInfo> jobs;
+	jobs.reserve(m_jobs.size());
+	for (const auto& entry : m_jobs)
+	{
+		jobs.push_back(entry.second.info);
+	}
+	return jobs;
+}
+
+size_t JobSpooler::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	size_t pending = m_activeJobs;
+	for (const auto& entry : m_queues)
+	{
+		pending += entry.second.size();
+	}
+	return pending;
+}
+
+JobSpoolerStats JobSpooler::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+bool JobSpooler::WaitForIdle(DWORD timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_condition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] {
+		if (m_activeJobs > 0)
+		{
+			return false;
+		}
+		for (const auto& entry : m_queues)
+		{
+			if (!entry.second.empty())
+			{
+				return false;
+			}
+		}
+		return true;
+	});
+}
+
+void JobSpooler::SetJobStateCallback(JobStateCallback callback)
+{
+	m_jobStateCallback = callback;
+}
+
+void JobSpooler::SetLogCallback(LogCallback callback)
+{
+	m_logCallback = callback;
+}
+
+// ==================== 工作线程 ====================
+
+void JobSpooler::WorkerThread(PortWorker* worker)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (!worker->stopRequested)
+	{
+		// 端口未就绪时按重试基准间隔轮询，其余情况由入队、作业完成或退避到期唤醒
+		auto nextWake = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_config.retryBaseDelayMs);
+		uint64_t jobId = 0;
+		if (m_activeJobs >= m_config.maxConcurrentJobs || !IsPortReady(worker) ||
+			!PickJobLocked(worker->portName, jobId, nextWake))
+		{
+			m_condition.wait_until(lock, nextWake);
+			continue;
+		}
+
+		SpoolJob& job = m_jobs[jobId];
+		job.info.state = SpoolJobState::Running;
+		job.info.attempts++;
+		job.info.bytesSent = 0;
+		SpoolJobInfo snapshot = job.info;
+		m_activeJobs++;
+		lock.unlock();
+
+		// 记录发送次数，崩溃后恢复的作业不会无限重试
+		SaveRecord(snapshot);
+		NotifyJobState(snapshot);
+		WriteLog("JobSpooler::WorkerThread - 端口 " + worker->portName + " 开始作业 " + std::to_string(jobId) +
+			"（第" + std::to_string(snapshot.attempts) + "次，" + std::to_string(snapshot.size) + " 字节）");
+
+		std::string error;
+		SendOutcome outcome = SendJob(worker, jobId, GetPayloadPath(jobId), error);
+		FinishJob(jobId, outcome, error);
+
+		lock.lock();
+	}
+}
+
+JobSpooler::SendOutcome JobSpooler::SendJob(PortWorker* worker, uint64_t jobId, const std::string& payloadPath, std::string& error)
+{
+	if (!worker->reliableChannel)
+	{
+		return SendRaw(worker, jobId, payloadPath, error);
+	}
+
+	// 对端看到的文件名取作业显示名称，而不是假脱机目录中的负载路径
+	std::string remoteName;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		remoteName = m_jobs[jobId].info.displayName;
+	}
+	if (remoteName.empty())
+	{
+		remoteName = payloadPath.substr(payloadPath.find_last_of("\\/") + 1);
+	}
+
+	// 可靠模式：SendFile由FileSource从磁盘流式读取并等待对端确认
+	bool ok = worker->reliableChannel->SendFile(payloadPath, [this, jobId](int64_t sent, int64_t) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_jobs.find(jobId);
+		if (it != m_jobs.end())
+		{
+			it->second.info.bytesSent = static_cast<uint64_t>(sent);
+		}
+	}, remoteName);
+
+	if (!ok)
+	{
+		error = "可靠通道发送失败";
+		return SendOutcome::Failed;
+	}
+	return SendOutcome::Success;
+}
+
+JobSpooler::SendOutcome JobSpooler::SendRaw(PortWorker* worker, uint64_t jobId, const std::string& payloadPath, std::string& error)
+{
+	// 直接模式：由RawTransmissionTask从负载文件按块读取并写入传输层（忙时等待可写或退避重试）。
+	// 分块大小固定为rawChunkSize，使用流水线读取但不做自适应分块，块间不加额外间隔
+	RawTransmissionTask task(worker->transport);
+	task.SetChunkSize(m_config.rawChunkSize);
+	task.SetRetrySettings(RAW_BUSY_RETRY_LIMIT, static_cast<int>(RAW_BUSY_RETRY_DELAY_MS));
+	task.SetPipelineDepth(2);
+
+	std::mutex resultMutex;
+	std::condition_variable resultCondition;
+	bool finished = false;
+	TransmissionResult result;
+
+	task.SetProgressCallback([this, jobId](const TransmissionProgress& progress) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_jobs.find(jobId);
+		if (it != m_jobs.end())
+		{
+			it->second.info.bytesSent = progress.bytesTransmitted;
+		}
+	});
+	task.SetCompletionCallback([&](const TransmissionResult& taskResult) {
+		std::lock_guard<std::mutex> lock(resultMutex);
+		result = taskResult;
+		finished = true;
+		resultCondition.notify_all();
+	});
+
+	if (!task.Start(std::unique_ptr<ITransmissionSource>(new FileTransmissionSource(payloadPath))))
+	{
+		error = (worker->transport && worker->transport->IsOpen()) ? "无法打开负载文件: " + payloadPath : "传输通道未打开";
+		return SendOutcome::Failed;
+	}
+
+	// 等待任务结束，期间定期检查取消与端口停止；任务在下一分块前响应取消
+	bool aborted = false;
+	{
+		std::unique_lock<std::mutex> lock(resultMutex);
+		while (!finished)
+		{
+			if (resultCondition.wait_for(lock, std::chrono::milliseconds(RAW_ABORT_POLL_MS), [&] { return finished; }))
+			{
+				break;
+			}
+
+			lock.unlock();
+			{
+				std::lock_guard<std::mutex> jobLock(m_mutex);
+				aborted = aborted || IsAbortRequestedLocked(worker, jobId);
+			}
+			if (aborted)
+			{
+				task.Cancel();
+			}
+			lock.lock();
+		}
+	}
+	task.Join();
+
+	if (result.finalState == TransmissionTaskState::Completed)
+	{
+		return SendOutcome::Success;
+	}
+	if (aborted || result.finalState == TransmissionTaskState::Cancelled)
+	{
+		return SendOutcome::Aborted;
+	}
+
+	error = result.errorMessage + "，错误码: " + std::to_string(static_cast<int>(result.errorCode));
+	return SendOutcome::Failed;
+}
+
+bool JobSpooler::IsPortReady(const PortWorker* worker) const
+{
+	if (worker->reliableChannel)
+	{
+		return worker->reliableChannel->IsConnected();
+	}
+	return worker->transport && worker->transport->IsOpen();
+}
+
+void JobSpooler::FinishJob(uint64_t jobId, SendOutcome outcome, const std::string& error)
+{
+	// 先按发送结果写回磁盘，再更新内存状态；期间作业仍为Running，Cancel()只做标记，不会与这里的写盘交错
+	SpoolJobInfo next;
+	bool cancelled = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		const SpoolJob& job = m_jobs[jobId];
+		next = job.info;
+		cancelled = job.cancelRequested;
+	}
+
+	bool remove = false;
+	if (outcome == SendOutcome::Success)
+	{
+		next.state = SpoolJobState::Completed;
+		next.bytesSent = next.size;
+		remove = true;
+	}
+	else if (cancelled)
+	{
+		next.state = SpoolJobState::Cancelled;
+		remove = true;
+	}
+	else if (outcome == SendOutcome::Aborted)
+	{
+		// 端口停止导致的中止不计入发送次数
+		next.state = SpoolJobState::Queued;
+		next.attempts = (std::max)(next.attempts - 1, 0);
+		next.bytesSent = 0;
+	}
+	else
+	{
+		next.state = (next.attempts < next.maxAttempts) ? SpoolJobState::Queued : SpoolJobState::Failed;
+		next.bytesSent = 0;
+		next.lastError = error;
+	}
+
+	if (remove)
+	{
+		DeleteJobFiles(jobId);
+	}
+	else
+	{
+		SaveRecord(next);
+	}
+
+	bool lateCancel = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_activeJobs--;
+		SpoolJob& job = m_jobs[jobId];
+
+		// 写盘期间收到的取消在这里处理
+		lateCancel = !remove && job.cancelRequested;
+		if (lateCancel)
+		{
+			next.state = SpoolJobState::Cancelled;
+			remove = true;
+		}
+
+		job.info = next;
+		job.cancelRequested = false;
+
+		switch (next.state)
+		{
+		case SpoolJobState::Completed:
+			m_stats.jobsCompleted++;
+			m_stats.bytesSent += next.size;
+			break;
+		case SpoolJobState::Queued:
+			if (outcome == SendOutcome::Failed)
+			{
+				// 指数退避：base * 2^(attempts-1)，不超过上限
+				uint64_t delay = static_cast<uint64_t>(m_config.retryBaseDelayMs) << (std::min)((std::max)(next.attempts - 1, 0), 16);
+				delay = (std::min)(delay, static_cast<uint64_t>(m_config.retryMaxDelayMs));
+				job.notBefore = std::chrono::steady_clock::now() + std::chrono::milliseconds(delay);
+				m_stats.jobsRetried++;
+			}
+			QueueJobLocked(job);
+			break;
+		case SpoolJobState::Failed:
+			m_stats.jobsFailed++;
+			break;
+		default:
+			break;
+		}
+
+		if (remove)
+		{
+			m_jobs.erase(jobId);
+		}
+	}
+	m_condition.notify_all();
+
+	if (lateCancel)
+	{
+		DeleteJobFiles(jobId);
+	}
+
+	NotifyJobState(next);
+	if (next.state == SpoolJobState::Queued || next.state == SpoolJobState::Failed)
+	{
+		WriteLog("JobSpooler::FinishJob - 作业 " + std::to_string(jobId) + " 未完成（" +
+			(next.state == SpoolJobState::Failed ? "重试耗尽" : "重新排队") + "）: " + next.lastError);
+	}
+}
+
+// ==================== 调度 ====================
+
+bool JobSpooler::PickJobLocked(const std::string& portName, uint64_t& jobId, std::chrono::steady_clock::time_point& nextWake)
+{
+	auto queue = m_queues.find(portName);
+	if (queue == m_queues.end())
+	{
+		return false;
+	}
+
+	// 按优先级顺序取第一个不在退避期的作业；退避中的作业只影响下次唤醒时间
+	auto now = std::chrono::steady_clock::now();
+	for (auto it = queue->second.begin(); it != queue->second.end(); ++it)
+	{
+		const SpoolJob& job = m_jobs[it->second];
+		if (job.notBefore <= now)
+		{
+			jobId = it->second;
+			queue->second.erase(it);
+			return true;
+		}
+		nextWake = (std::min)(nextWake, job.notBefore);
+	}
+	return false;
+}
+
+void JobSpooler::QueueJobLocked(const SpoolJob& job)
+{
+	m_queues[job.info.portName].insert(QueueKey(job.info.priority, job.info.id));
+}
+
+void JobSpooler::UnqueueJobLocked(const SpoolJob& job)
+{
+	auto queue = m_queues.find(job.info.portName);
+	if (queue != m_queues.end())
+	{
+		queue->second.erase(QueueKey(job.info.priority, job.info.id));
+	}
+}
+
+bool JobSpooler::IsAbortRequestedLocked(const PortWorker* worker, uint64_t jobId) const
+{
+	if (worker->stopRequested)
+	{
+		return true;
+	}
+	auto it = m_jobs.find(jobId);
+	return it == m_jobs.end() || it->second.cancelRequested;
+}
+
+// ==================== 持久化 ====================
+
+std::string JobSpooler::GetPayloadPath(uint64_t jobId) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(jobId));
+	return m_config.spoolDirectory + "\\" + name + PAYLOAD_EXTENSION;
+}
+
+std::string JobSpooler::GetRecordPath(uint64_t jobId) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(jobId));
+	return m_config.spoolDirectory + "\\" + name + RECORD_EXTENSION;
+}
+
+bool JobSpooler::SaveRecord(const SpoolJobInfo& info) const
+{
+	std::vector<uint8_t> data;
+	data.reserve(64 + info.portName.size() + info.displayName.size() + info.lastError.size());
+	PutLittleEndian(data, RECORD_MAGIC, 4);
+	data.push_back(RECORD_VERSION);
+	PutLittleEndian(data, info.id, 8);
+	PutLittleEndian(data, static_cast<uint32_t>(info.priority), 4);
+	data.push_back(static_cast<uint8_t>(info.state));
+	PutLittleEndian(data, static_cast<uint16_t>((std::min)(info.attempts, 0xFFFF)), 2);
+	PutLittleEndian(data, static_cast<uint16_t>((std::min)(info.maxAttempts, 0xFFFF)), 2);
+	PutLittleEndian(data, info.size, 8);
+	PutLittleEndian(data, info.createdTime, 8);
+	PutString(data, info.portName);
+	PutString(data, info.displayName);
+	PutString(data, info.lastError);
+	PutLittleEndian(data, Crc32::Calculate(data.data(), data.size()), 4);
+
+	// 临时文件写完后整体替换，任一时刻磁盘上的记录要么是旧版本要么是新版本
+	std::string recordPath = GetRecordPath(info.id);
+	std::string tempPath = recordPath + TEMP_EXTENSION;
+	if (!WriteWholeFile(tempPath, data.data(), data.size(), m_config.flushToDisk))
+	{
+		return false;
+	}
+
+	DWORD flags = MOVEFILE_REPLACE_EXISTING | (m_config.flushToDisk ? MOVEFILE_WRITE_THROUGH : 0);
+	if (!MoveFileExA(tempPath.c_str(), recordPath.c_str(), flags))
+	{
+		DeleteFileA(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool JobSpooler::LoadRecord(const std::string& recordPath, SpoolJobInfo& info) const
+{
+	std::ifstream file(recordPath, std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	file.close();
+
+	// 固定字段38字节 + 三个字符串（各2字节长度） + CRC32
+	const size_t fixedSize = 38;
+	if (data.size() < fixedSize + 6 + 4)
+	{
+		return false;
+	}
+
+	size_t bodySize = data.size() - 4;
+	if (Crc32::Calculate(data.data(), bodySize) != static_cast<uint32_t>(GetLittleEndian(data.data() + bodySize, 4)))
+	{
+		return false;
+	}
+
+	const uint8_t* p = data.data();
+	const uint8_t* end = p + bodySize;
+	if (GetLittleEndian(p, 4) != RECORD_MAGIC || p[4] != RECORD_VERSION)
+	{
+		return false;
+	}
+
+	info.id = GetLittleEndian(p + 5, 8);
+	info.priority = static_cast<int>(static_cast<int32_t>(GetLittleEndian(p + 13, 4)));
+	if (p[17] > static_cast<uint8_t>(SpoolJobState::Cancelled))
+	{
+		return false;
+	}
+	info.state = static_cast<SpoolJobState>(p[17]);
+	info.attempts = static_cast<int>(GetLittleEndian(p + 18, 2));
+	info.maxAttempts = static_cast<int>(GetLittleEndian(p + 20, 2));
+	info.size = GetLittleEndian(p + 22, 8);
+	info.createdTime = GetLittleEndian(p + 30, 8);
+	info.bytesSent = 0;
+
+	p += fixedSize;
+	return GetString(p, end, info.portName) && GetString(p, end, info.displayName) &&
+		GetString(p, end, info.lastError) && p == end;
+}
+
+void JobSpooler::DeleteJobFiles(uint64_t jobId) const
+{
+	// 记录先删：崩溃后最多留下无记录的负载，恢复时清理
+	DeleteFileA(GetRecordPath(jobId).c_str());
+	DeleteFileA(GetPayloadPath(jobId).c_str());
+}
+
+void JobSpooler::RecoverJobs()
+{
+	m_jobs.clear();
+	m_queues.clear();
+
+	std::vector<std::string> names;
+	WIN32_FIND_DATAA findData = {};
+	HANDLE find = FindFirstFileA((m_config.spoolDirectory + "\\*").c_str(), &findData);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+			{
+				names.push_back(findData.cFileName);
+			}
+		} while (FindNextFileA(find, &findData));
+		FindClose(find);
+	}
+
+	uint64_t maxId = 0;
+	std::set<uint64_t> payloads;
+	std::set<uint64_t> records;
+	for (const std::string& name : names)
+	{
+		std::string path = m_config.spoolDirectory + "\\" + name;
+		char* parseEnd = nullptr;
+		uint64_t jobId = strtoull(name.c_str(), &parseEnd, 16);
+		std::string extension = parseEnd ? std::string(parseEnd) : std::string();
+
+		// 未完成替换的临时文件与无法识别的文件名不属于任何已提交的作业
+		if (EndsWith(name, TEMP_EXTENSION) || jobId == 0)
+		{
+			if (EndsWith(name, TEMP_EXTENSION))
+			{
+				DeleteFileA(path.c_str());
+			}
+			continue;
+		}
+
+		maxId = (std::max)(maxId, jobId);
+		if (extension == PAYLOAD_EXTENSION)
+		{
+			payloads.insert(jobId);
+		}
+		else if (extension == RECORD_EXTENSION)
+		{
+			records.insert(jobId);
+		}
+	}
+
+	for (uint64_t jobId : records)
+	{
+		SpoolJob job;
+		uint64_t payloadSize = 0;
+		if (!LoadRecord(GetRecordPath(jobId), job.info) || job.info.id != jobId ||
+			payloads.find(jobId) == payloads.end() || !QueryFileSize(GetPayloadPath(jobId), payloadSize) || payloadSize != job.info.size)
+		{
+			WriteLog("JobSpooler::RecoverJobs - 丢弃损坏的作业: " + std::to_string(jobId));
+			DeleteJobFiles(jobId);
+			continue;
+		}
+
+		// 崩溃时正在发送的作业重新排队，已计入的发送次数保留
+		if (job.info.state == SpoolJobState::Running)
+		{
+			job.info.state = (job.info.attempts < job.info.maxAttempts) ? SpoolJobState::Queued : SpoolJobState::Failed;
+			if (job.info.state == SpoolJobState::Failed)
+			{
+				job.info.lastError = "发送过程中程序退出";
+				SaveRecord(job.info);
+			}
+		}
+
+		if (job.info.state == SpoolJobState::Queued)
+		{
+			QueueJobLocked(job);
+		}
+		else if (job.info.state != SpoolJobState::Failed)
+		{
+			// 已完成或已取消但未来得及删除
+			DeleteJobFiles(jobId);
+			continue;
+		}
+
+		m_jobs[jobId] = job;
+		m_stats.jobsRecovered++;
+	}
+
+	// 没有记录的负载来自入队中途崩溃
+	for (uint64_t jobId : payloads)
+	{
+		if (m_jobs.find(jobId) == m_jobs.end() && records.find(jobId) == records.end())
+		{
+			DeleteFileA(GetPayloadPath(jobId).c_str());
+		}
+	}
+
+	m_nextJobId = maxId + 1;
+}
+
+// ==================== 通知 ====================
+
+void JobSpooler::NotifyJobState(const SpoolJobInfo& info)
+{
+	try {
+		if (m_jobStateCallback)
+		{
+			m_jobStateCallback(info);
+		}
+	}
+	catch (...) {
+		// 忽略回调中的异常，避免工作线程退出
+	}
+}
+
+void JobSpooler::WriteLog(const std::string& message)
+{
+	try {
+		if (m_logCallback)
+		{
+			m_logCallback(message);
+		}
+	}
+	catch (...) {
+		// 忽略日志回调过程中的异常
+	}
+}
@@ -0,0 +1,215 @@
+﻿#pragma once
+#pragma execution_character_set("utf-8")
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+#include "../Protocol/ReliableChannel.h"
+#include "../Transport/ITransport.h"
+
+// 作业状态
+enum class SpoolJobState
+{
+	Queued,     // 排队中（含等待重试）
+	Running,    // 正在发送
+	Completed,  // 已完成
+	Failed,     // 重试耗尽后失败（保留在假脱机目录，可Cancel删除）
+	Cancelled   // 已取消
+};
+
+// 入队选项
+struct SpoolJobOptions
+{
+	int priority = 0;            // 优先级，数值越大越先发送；同优先级按入队顺序
+	int maxAttempts = 3;         // 最大发送次数（含首次）
+	std::string displayName;     // 显示名称（日志与界面用）
+};
+
+// 作业信息快照
+struct SpoolJobInfo
+{
+	uint64_t id = 0;
+	std::string portName;
+	std::string displayName;
+	int priority = 0;
+	SpoolJobState state = SpoolJobState::Queued;
+	int attempts = 0;            // 已开始发送的次数
+	int maxAttempts = 0;
+	uint64_t size = 0;           // 负载字节数
+	uint64_t bytesSent = 0;      // 当前一次发送的进度
+	uint64_t createdTime = 0;    // 入队时间（Unix秒）
+	std::string lastError;
+};
+
+// 假脱机配置
+struct JobSpoolerConfig
+{
+	std::string spoolDirectory;      // 假脱机目录（不存在时创建）
+	size_t maxConcurrentJobs = 4;    // 所有端口同时发送的作业数上限（每个端口同一时刻只发送一个作业）
+	DWORD retryBaseDelayMs = 1000;   // 失败后首次重试延迟，之后每次翻倍
+	DWORD retryMaxDelayMs = 30000;   // 重试延迟上限
+	bool flushToDisk = true;         // 入队与状态更新时FlushFileBuffers，关闭后吞吐更高但掉电可能丢失最近的更新
+	size_t rawChunkSize = 4096;      // 直接模式每次写入的字节数
+};
+
+// 假脱机统计
+struct JobSpoolerStats
+{
+	uint64_t jobsEnqueued = 0;
+	uint64_t jobsCompleted = 0;
+	uint64_t jobsFailed = 0;
+	uint64_t jobsRetried = 0;        // 失败后重新排队的次数
+	uint64_t jobsRecovered = 0;      // Open()时从假脱机目录恢复的作业数
+	uint64_t bytesSent = 0;          // 已完成作业的字节数
+};
+
+/**
+ * @brief 作业假脱机：持久化作业队列 + 每端口工作线程
+ *
+ * 职责：把待打印数据先落到假脱机目录，再由端口工作线程按优先级逐个从磁盘流式发送
+ * 位置：src/ 目录（传输服务，位于TransmissionTask/ReliableChannel之前）
+ *
+ * 持久化：
+ * - 每个作业对应两个文件：<id>.dat（负载）与 <id>.job（作业记录，含CRC）
+ * - 入队时先写负载再写记录，记录通过临时文件+重命名原子替换；记录存在即作业存在
+ * - Open()扫描目录恢复作业：崩溃时处于Running的作业回到排队状态，
+ *   没有记录的负载与残留的临时文件被删除，校验失败的记录连同负载一起丢弃
+ * - 作业完成或取消时先删记录再删负载，Failed的作业保留记录供查看
+ *
+ * 发送：
+ * - 端口已附加可靠通道且已连接时调用ReliableChannel::SendFile（由FileSource从磁盘流式读取），对端文件名取displayName
+ * - 否则由RawTransmissionTask以rawChunkSize为单位从磁盘读取后写入ITransport，传输忙时退避重试
+ * - 端口未就绪时作业保持排队，不消耗重试次数；发送失败按指数退避重新排队，次数耗尽后标记Failed
+ * - 内存中只保存作业记录，负载始终留在磁盘
+ *
+ * 线程安全性：所有公开接口可在任意线程调用；状态回调在工作线程中执行，不要在回调内调用Close()/DetachPort()
+ */
+class JobSpooler
+{
+public:
+	using JobStateCallback = std::function<void(const SpoolJobInfo&)>;
+	using LogCallback = std::function<void(const std::string&)>;
+
+public:
+	JobSpooler();
+	~JobSpooler();
+
+	JobSpooler(const JobSpooler&) = delete;
+	JobSpooler& operator=(const JobSpooler&) = delete;
+
+	// 打开假脱机目录并恢复未完成的作业
+	bool Open(const JobSpoolerConfig& config);
+	// 停止全部工作线程；直接模式的作业在分块间中止并回到排队状态，可靠通道的SendFile需等待其返回
+	void Close();
+	bool IsOpen() const;
+
+	// 为端口启动工作线程；reliableChannel为空时使用直接模式
+	bool AttachPort(const std::string& portName, std::shared_ptr<ITransport> transport, std::shared_ptr<ReliableChannel> reliableChannel = nullptr);
+	void DetachPort(const std::string& portName);
+
+	// 入队，返回作业ID；失败返回0
+	uint64_t Enqueue(const std::string& portName, const std::vector<uint8_t>& data, const SpoolJobOptions& options = SpoolJobOptions());
+	// 复制文件到假脱机目录后入队，源文件之后可被删除或修改
+	uint64_t EnqueueFile(const std::string& portName, const std::string& filePath, const SpoolJobOptions& options = SpoolJobOptions());
+
+	// 取消排队或失败的作业；正在发送的作业在直接模式下于下一分块前中止
+	bool Cancel(uint64_t jobId);
+
+	// 状态查询
+	bool GetJob(uint64_t jobId, SpoolJobInfo& info) const;
+	std::vector<SpoolJobInfo> GetJobs() const;
+	size_t GetPendingCount() const;   // 排队中与发送中的作业数
+	JobSpoolerStats GetStats() const;
+
+	// 等待所有排队作业处理完毕（测试与退出前排空用），超时返回false
+	bool WaitForIdle(DWORD timeoutMs);
+
+	void SetJobStateCallback(JobStateCallback callback);
+	void SetLogCallback(LogCallback callback);
+
+private:
+	struct SpoolJob
+	{
+		SpoolJobInfo info;
+		std::chrono::steady_clock::time_point notBefore; // 重试退避期间不被调度
+		bool cancelRequested = false;
+	};
+
+	// 同一端口的排队作业按（优先级降序，ID升序）排列
+	using QueueKey = std::pair<int, uint64_t>;
+	struct QueueKeyOrder
+	{
+		bool operator()(const QueueKey& a, const QueueKey& b) const
+		{
+			return (a.first != b.first) ? (a.first > b.first) : (a.second < b.second);
+		}
+	};
+
+	struct PortWorker
+	{
+		std::string portName;
+		std::shared_ptr<ITransport> transport;
+		std::shared_ptr<ReliableChannel> reliableChannel;
+		std::thread thread;
+		bool stopRequested = false;
+	};
+
+	enum class SendOutcome
+	{
+		Success,
+		Failed,
+		Aborted     // 取消或停止，不计入重试
+	};
+
+private:
+	void WorkerThread(PortWorker* worker);
+	SendOutcome SendJob(PortWorker* worker, uint64_t jobId, const std::string& payloadPath, std::string& error);
+	SendOutcome SendRaw(PortWorker* worker, uint64_t jobId, const std::string& payloadPath, std::string& error);
+	bool IsPortReady(const PortWorker* worker) const;
+	void FinishJob(uint64_t jobId, SendOutcome outcome, const std::string& error);
+
+	// 调度（调用方持有m_mutex）
+	bool PickJobLocked(const std::string& portName, uint64_t& jobId, std::chrono::steady_clock::time_point& nextWake);
+	void QueueJobLocked(const SpoolJob& job);
+	void UnqueueJobLocked(const SpoolJob& job);
+	bool IsAbortRequestedLocked(const PortWorker* worker, uint64_t jobId) const;
+
+	// 持久化
+	uint64_t CommitJob(const std::string& portName, uint64_t size, const SpoolJobOptions& options, uint64_t jobId);
+	bool SaveRecord(const SpoolJobInfo& info) const;
+	bool LoadRecord(const std::string& recordPath, SpoolJobInfo& info) const;
+	void DeleteJobFiles(uint64_t jobId) const;
+	void RecoverJobs();
+	std::string GetPayloadPath(uint64_t jobId) const;
+	std::string GetRecordPath(uint64_t jobId) const;
+
+	void NotifyJobState(const SpoolJobInfo& info);
+	void WriteLog(const std::string& message);
+
+private:
+	JobSpoolerConfig m_config;
+	bool m_open;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::map<uint64_t, SpoolJob> m_jobs;
+	std::map<std::string, std::set<QueueKey, QueueKeyOrder>> m_queues; // 端口名 -> 排队作业
+	std::map<std::string, std::unique_ptr<PortWorker>> m_workers;
+	size_t m_activeJobs;                                 // 正在发送的作业数（受maxConcurrentJobs限制）
+	JobSpoolerStats m_stats;
+
+	std::atomic<uint64_t> m_nextJobId;
+
+	// 回调在工作线程中执行，设置后不应再修改
+	JobStateCallback m_jobStateCallback;
+	LogCallback m_logCallback;
+};
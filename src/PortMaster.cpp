@@ -6,6 +6,7 @@
 #include "framework.h"
 #include "PortMaster.h"
 #include "PortMasterDlg.h"
+#include "../Common/Logger.h"
 
 #ifdef _DEBUG
 #define new DEBUG_NEW
@@ -102,6 +103,7 @@ BOOL CPortMasterApp::InitInstance()
 
 int CPortMasterApp::ExitInstance()
 {
-	// TODO: 在此处添加退出清理代码
+	// 写出队列中的日志并停止日志写入线程
+	Logger::Shutdown();
 	return CWinApp::ExitInstance();
 }
\ No newline at end of file
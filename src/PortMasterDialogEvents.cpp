@@ -364,6 +364,8 @@ void PortMasterDialogEvents::HandleToggleHex()
 	else if (m_dialog.m_sendCacheValid)
 	{
 		m_dialog.m_sendDataCache.clear();
+		m_dialog.m_sendFilePath.clear();
+		m_dialog.m_sendFileSize = 0;
 		m_dialog.m_sendCacheValid = false;
 	}
 
@@ -618,13 +620,17 @@ void PortMasterDialogEvents::LoadDataFromSelectedFile(const CString& filePath)
 
 	bool isLargeFile = fileLength > PREVIEW_SIZE;
 
+	// 超过流式阈值的文件不整体载入内存：缓存只保存预览，发送时由FileTransmissionSource按块读取
+	const ULONGLONG STREAM_THRESHOLD = 64ULL * 1024 * 1024;  // 64MB
+	bool streamFromFile = fileLength > STREAM_THRESHOLD;
+
 	// 【第七轮修复】删除512MB人为限制，直接使用文件长度
 	// 如果文件过大导致内存分配失败，将在 try/catch 中捕获并提示用户
-	size_t readSize = static_cast<size_t>(fileLength);
+	size_t readSize = streamFromFile ? PREVIEW_SIZE : static_cast<size_t>(fileLength);
 
 	// 为了安全起见，仍添加一个合理的内存上限（2GB），超过此限制提示用户
 	const size_t ABSOLUTE_LIMIT = 2ULL * 1024 * 1024 * 1024;  // 2GB 绝对上限
-	if (fileLength > ABSOLUTE_LIMIT)
+	if (!streamFromFile && fileLength > ABSOLUTE_LIMIT)
 	{
 		m_dialog.MessageBox(
 			_T("文件过于巨大（>2GB），无法完整加载到内存。\n请选择较小的文件。"),
@@ -679,6 +685,13 @@ void PortMasterDialogEvents::LoadDataFromSelectedFile(const CString& filePath)
 	bool isBinaryFile = (nullByteCount > 0) || ((nonPrintableCount * 100 / SAMPLE_SIZE) > 20);
 
 	m_dialog.UpdateSendCacheFromBytes(reinterpret_cast<const BYTE*>(fileBuffer.get()), (size_t)bytesRead);
+	if (streamFromFile)
+	{
+		// UpdateSendCacheFromBytes会清空流式路径，需在其后设置
+		m_dialog.m_sendFilePath = std::wstring(CT2W(filePath));
+		m_dialog.m_sendFileSize = fileLength;
+		m_dialog.WriteLog("LoadDataFromSelectedFile: 大文件将从磁盘流式发送，大小: " + std::to_string(fileLength) + " 字节");
+	}
 	m_dialog.UpdateSendDisplayFromCache();
 
 	if (m_dialog.m_uiController)
@@ -12,11 +12,11 @@
 #include "../Common/CommonTypes.h"
 #include "../Common/ConfigStore.h"
 #include "../Common/StringUtils.h"
+#include "../Common/Logger.h"
 #include <chrono>
 #include <thread>
 #include <shellapi.h>
 #include <ctime>
-#include <fstream>
 #include <algorithm>
 
 // 【UI优化】定时器ID常量定义
@@ -160,26 +160,8 @@ void CPortMasterDlg::WriteLog(const std::string& message)
 			return;
 		}
 
-		// 获取当前时间
-		auto now = std::chrono::system_clock::now();
-		auto time_t = std::chrono::system_clock::to_time_t(now);
-		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
-
-		std::tm tm;
-		localtime_s(&tm, &time_t);
-
-		// 格式化时间字符串
-		char timeStr[32];
-		sprintf_s(timeStr, sizeof(timeStr), "[%02d:%02d:%02d.%03d] ",
-			tm.tm_hour, tm.tm_min, tm.tm_sec, static_cast<int>(ms.count()));
-
-		// 打开日志文件（追加模式）
-		std::ofstream logFile("PortMaster_debug.log", std::ios::app);
-		if (logFile.is_open())
-		{
-			logFile << timeStr << message << std::endl;
-			logFile.close();
-		}
+		// 写入日志文件（异步，时间戳由Logger添加）
+		Logger::Log(message);
 
 		// 【阶段B修复】正确处理UTF-8到Unicode编码转换，解决状态栏乱码问题
 		dispatchStatusMessage(displayMessageW);
@@ -220,6 +202,7 @@ CPortMasterDlg::CPortMasterDlg(CWnd* pParent /*=nullptr*/)
 	m_totalSentBytes(0),
 	m_sendCacheValid(false),
 	m_receiveCacheValid(false),
+	m_sendFileSize(0),
 	m_useTempCacheFile(false),
 	m_totalReceivedBytes(0),
 	// 【线程安全修复】初始化日志缓存机制
@@ -266,6 +249,9 @@ CPortMasterDlg::CPortMasterDlg(CWnd* pParent /*=nullptr*/)
 		// 设置详细日志（开发阶段开启）
 		m_receiveCacheService->SetVerboseLogging(true);
 
+		// 写后模式：接收线程只拷入暂存环，由刷新线程批量落盘，避免每次读取一次写盘加一组日志
+		m_receiveCacheService->SetWriteBehind(true);
+
 		// 初始化临时缓存文件
 		if (!m_receiveCacheService->Initialize())
 		{
@@ -414,16 +400,8 @@ BOOL CPortMasterDlg::OnInitDialog()
 {
 	CDialogEx::OnInitDialog();
 
-	// 【程序启动时清空日志文件】避免反复测试导致日志文件过长
-	try {
-		std::ofstream logFile("PortMaster_debug.log", std::ios::out | std::ios::trunc);
-		if (logFile.is_open()) {
-			logFile.close();
-		}
-	}
-	catch (...) {
-		// 忽略清空日志文件的错误，不影响程序启动
-	}
+	// 【程序启动时清空日志文件】避免反复测试导致日志文件过长（Logger初始化时清空并启动写入线程）
+	Logger::Initialize("PortMaster_debug.log");
 
 	// 将"关于..."菜单项添加到系统菜单中。
 
@@ -839,7 +817,7 @@ void CPortMasterDlg::StartTransmission()
 	m_sendComplete = false;
 	if (m_isLoopbackTest)
 	{
-		m_expectedReceiveBytes = m_sendDataCache.size();
+		m_expectedReceiveBytes = m_sendFilePath.empty() ? static_cast<uint64_t>(m_sendDataCache.size()) : m_sendFileSize;
 	}
 	else
 	{
@@ -948,7 +926,10 @@ void CPortMasterDlg::PerformDataTransmission()
 			return;
 		}
 
-		this->WriteLog("PerformDataTransmission: 开始协调传输任务，数据大小: " + std::to_string(data.size()) + " 字节");
+		const bool streamFromFile = !m_sendFilePath.empty();
+		this->WriteLog("PerformDataTransmission: 开始协调传输任务，数据大小: " +
+			std::to_string(streamFromFile ? m_sendFileSize : static_cast<uint64_t>(data.size())) + " 字节" +
+			(streamFromFile ? "（从文件流式读取）" : ""));
 
 		// 使用TransmissionCoordinator自动选择传输通道并启动传输
 		if (m_transmissionCoordinator)
@@ -1056,13 +1037,23 @@ void CPortMasterDlg::PerformDataTransmission()
 						  ", 端口名称=" + (portName.empty() ? "未指定" : portName) +
 						  ", 可靠模式=" + std::string(isReliableMode ? "是" : "否"));
 
-			bool started = m_transmissionCoordinator->Start(
-				data,
-				reliableChannel,
-				transport,
-				portType,
-				portName
-			);
+			m_transmissionCoordinator->SetWriteTimeout(m_transportConfig.writeTimeout);
+
+			// 大文件不整体载入内存，传输中从文件按块读取
+			bool started = streamFromFile ?
+				m_transmissionCoordinator->Start(
+					std::unique_ptr<ITransmissionSource>(new FileTransmissionSource(m_sendFilePath)),
+					reliableChannel,
+					transport,
+					portType,
+					portName) :
+				m_transmissionCoordinator->Start(
+					data,
+					reliableChannel,
+					transport,
+					portType,
+					portName
+				);
 
 			if (!started)
 			{
@@ -1528,6 +1519,8 @@ void CPortMasterDlg::UpdateSendCache(const CString& data)
 {
 	// 将CString转换为字节序列并缓存
 	m_sendDataCache.clear();
+	m_sendFilePath.clear();
+	m_sendFileSize = 0;
 
 	// 获取字符串长度（字符数）
 	int len = data.GetLength();
@@ -1566,6 +1559,8 @@ void CPortMasterDlg::UpdateSendCacheFromBytes(const BYTE* data, size_t length)
 {
 	// 直接从字节数据更新缓存，避免任何编码转换
 	m_sendDataCache.clear();
+	m_sendFilePath.clear();
+	m_sendFileSize = 0;
 	m_sendDataCache.reserve(length);
 
 	// 直接复制字节数据，保持原始值不变
@@ -1582,6 +1577,8 @@ void CPortMasterDlg::UpdateSendCacheFromHex(const CString& hexData)
 {
 	// 在十六进制模式下，将十六进制字符串解析为字节数据并缓存
 	m_sendDataCache.clear();
+	m_sendFilePath.clear();
+	m_sendFileSize = 0;
 
 	// 提取有效的十六进制字符
 	CString cleanHex;
@@ -1720,6 +1717,8 @@ void CPortMasterDlg::OnEnChangeEditSendData()
 	{
 		// 如果编辑框为空，清空缓存
 		m_sendDataCache.clear();
+		m_sendFilePath.clear();
+		m_sendFileSize = 0;
 		m_sendCacheValid = false;
 	}
 }
@@ -2153,6 +2152,11 @@ void CPortMasterDlg::BuildTransportConfigFromUI()
 	m_reliableConfig.maxPayloadSize = 1024;
 	m_reliableConfig.windowSize = 32;
 	m_reliableConfig.heartbeatInterval = 1000;
+	m_reliableConfig.enableCompression = m_configStore.GetProtocolConfig().enableCompression;
+	m_reliableConfig.enableStreamCompression = m_configStore.GetProtocolConfig().enableStreamCompression;
+	m_reliableConfig.enableFec = m_configStore.GetProtocolConfig().enableFec;
+	m_reliableConfig.fecGroupSize = m_configStore.GetProtocolConfig().fecGroupSize;
+	m_reliableConfig.enableMultiplexing = m_configStore.GetProtocolConfig().enableMultiplexing;
 
 	WriteLog("BuildTransportConfigFromUI: 配置构建完成 - portType=" + std::to_string(static_cast<int>(m_transportConfig.portType)) +
 		", portName=" + m_transportConfig.portName);
@@ -2796,8 +2800,8 @@ LRESULT CPortMasterDlg::OnTransmissionComplete(WPARAM wParam, LPARAM lParam)
 		UpdateSaveButtonStatus();
 
 		// 更新发送统计
-		const std::vector<uint8_t>& data = m_sendDataCache;
-		m_bytesSent += data.size();
+		const uint64_t sentSize = m_sendFilePath.empty() ? m_sendDataCache.size() : m_sendFileSize;
+		m_bytesSent += sentSize;
 		CString sentText;
 		sentText.Format(_T("%llu"), static_cast<unsigned long long>(m_bytesSent));
 		if (m_uiController)
@@ -2807,7 +2811,7 @@ LRESULT CPortMasterDlg::OnTransmissionComplete(WPARAM wParam, LPARAM lParam)
 
 		// 显示传输完成状态并设置进度条为100%
 		CString completeStatus;
-		completeStatus.Format(_T("传输完成: %u 字节"), data.size());
+		completeStatus.Format(_T("传输完成: %llu 字节"), static_cast<unsigned long long>(sentSize));
 		if (m_uiController)
 		{
 			m_uiController->SetStatusText(completeStatus);
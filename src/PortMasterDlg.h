@@ -123,7 +123,7 @@ private:
 	// 【兼容性保留】回路测试进度同步标志（已弃用，保留以防兼容性问题）
 	bool m_isLoopbackTest;      // 当前是否为回路测试模式（已弃用，使用m_smartProgressManager代替）
 	bool m_sendComplete;        // 发送方是否已完成发送（已弃用）
-	size_t m_expectedReceiveBytes; // 回路测试时期望接收的总字节数（已弃用）
+	uint64_t m_expectedReceiveBytes; // 回路测试时期望接收的总字节数（已弃用）
 
 	DECLARE_MESSAGE_MAP()
 
@@ -226,6 +226,8 @@ private:
 	std::vector<uint8_t> m_receiveDataCache; // 接收数据的原始字节缓存
 	bool m_sendCacheValid;					 // 发送缓存是否有效
 	bool m_receiveCacheValid;				 // 接收缓存是否有效
+	std::wstring m_sendFilePath;			 // 大文件流式发送：非空时发送数据从该文件按块读取，m_sendDataCache只保存预览
+	uint64_t m_sendFileSize;				 // 流式发送文件的大小
 
 	// 临时缓存文件管理
 	CString m_tempCacheFilePath;			 // 临时缓存文件路径
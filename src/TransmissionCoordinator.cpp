@@ -11,6 +11,7 @@ TransmissionCoordinator::TransmissionCoordinator()
 	, m_maxRetries(3)
 	, m_retryDelayMs(100)
 	, m_progressUpdateIntervalMs(100)
+	, m_writeTimeoutMs(2000)
 {
 }
 
@@ -28,6 +29,23 @@ bool TransmissionCoordinator::Start(
 	std::shared_ptr<ITransport> transport,
 	PortType portType,
 	const std::string& portName)
+{
+	// 检查数据有效性
+	if (data.empty())
+	{
+		return false;
+	}
+
+	return Start(std::unique_ptr<ITransmissionSource>(new MemoryTransmissionSource(data)),
+		reliableChannel, transport, portType, portName);
+}
+
+bool TransmissionCoordinator::Start(
+	std::unique_ptr<ITransmissionSource> source,
+	std::shared_ptr<ReliableChannel> reliableChannel,
+	std::shared_ptr<ITransport> transport,
+	PortType portType,
+	const std::string& portName)
 {
 	// 检查是否已有任务在运行
 	if (m_currentTask && !m_currentTask->IsCompleted())
@@ -35,8 +53,8 @@ bool TransmissionCoordinator::Start(
 		return false;
 	}
 
-	// 检查数据有效性
-	if (data.empty())
+	// 检查数据源有效性
+	if (!source)
 	{
 		return false;
 	}
@@ -96,6 +114,15 @@ bool TransmissionCoordinator::Start(
 	m_currentTask->SetChunkSize(m_chunkSize);
 	m_currentTask->SetRetrySettings(m_maxRetries, m_retryDelayMs);
 	m_currentTask->SetProgressUpdateInterval(m_progressUpdateIntervalMs);
+	m_currentTask->SetWriteTimeout(m_writeTimeoutMs);
+
+	// 回路与网络传输没有逐块节奏要求，启用流水线与自适应分块；
+	// 串口/并口/USB保持逐块发送及10ms间隔，避免大分块触发写超时
+	if (portType == PortType::PORT_TYPE_LOOPBACK || portType == PortType::PORT_TYPE_NETWORK_PRINT)
+	{
+		m_currentTask->SetPipelineDepth(4);
+		m_currentTask->SetAdaptiveChunkSize(true);
+	}
 
 	// 设置任务回调（集成智能进度管理）
 	m_currentTask->SetProgressCallback([this](const TransmissionProgress& progress) {
@@ -125,7 +152,7 @@ bool TransmissionCoordinator::Start(
 		});
 
 	// 启动任务
-	return m_currentTask->Start(data);
+	return m_currentTask->Start(std::move(source));
 }
 
 void TransmissionCoordinator::Pause()
@@ -257,6 +284,11 @@ void TransmissionCoordinator::SetProgressUpdateInterval(int intervalMs)
 	m_progressUpdateIntervalMs = intervalMs;
 }
 
+void TransmissionCoordinator::SetWriteTimeout(DWORD writeTimeoutMs)
+{
+	m_writeTimeoutMs = writeTimeoutMs;
+}
+
 // ==================== 智能进度报告接口 ====================
 
 SmartProgressManager& TransmissionCoordinator::GetProgressManager()
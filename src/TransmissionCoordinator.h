@@ -87,6 +87,20 @@ public:
 		PortType portType = PortType::PORT_TYPE_SERIAL,
 		const std::string& portName = "");
 
+	/**
+	 * @brief 从数据源启动传输任务
+	 * @param source 数据源（文件、生成器、管道等），传输中按块读取
+	 *
+	 * 说明：
+	 * - 其余参数与行为同Start(data, ...)
+	 * - 数据不整体载入内存，适合超过可用内存的大文件
+	 */
+	bool Start(std::unique_ptr<ITransmissionSource> source,
+		std::shared_ptr<ReliableChannel> reliableChannel,
+		std::shared_ptr<ITransport> transport,
+		PortType portType = PortType::PORT_TYPE_SERIAL,
+		const std::string& portName = "");
+
 	/**
 	 * @brief 暂停当前传输任务
 	 *
@@ -218,6 +232,12 @@ public:
 	 */
 	void SetProgressUpdateInterval(int intervalMs);
 
+	/**
+	 * @brief 设置传输层写超时（用于限制自适应分块的增长）
+	 * @param writeTimeoutMs 写超时（毫秒）
+	 */
+	void SetWriteTimeout(DWORD writeTimeoutMs);
+
 	// ========== 智能进度报告接口 ==========
 
 	/**
@@ -277,4 +297,5 @@ private:
 	int m_maxRetries;
 	int m_retryDelayMs;
 	int m_progressUpdateIntervalMs;
+	DWORD m_writeTimeoutMs;
 };
@@ -1,6 +1,9 @@
 ﻿#include "pch.h"
 #include "TransmissionTask.h"
 #include <algorithm>
+#include <cstring>
+#include <deque>
+#include <condition_variable>
 
 // 【P1修复】传输任务基类实现
 
@@ -12,6 +15,9 @@ TransmissionTask::TransmissionTask()
 	, m_maxRetries(3)              // 默认最大重试3次
 	, m_retryDelayMs(50)           // 默认重试延迟50ms
 	, m_progressUpdateIntervalMs(100) // 默认进度更新间隔100ms
+	, m_pipelineDepth(1)           // 默认逐块发送，由调用方按端口类型启用流水线
+	, m_adaptiveChunkSize(false)
+	, m_writeTimeoutMs(2000)       // 与TransportConfig默认写超时一致
 {
 }
 
@@ -43,6 +49,17 @@ TransmissionTask::~TransmissionTask()
 }
 
 bool TransmissionTask::Start(const std::vector<uint8_t>& data)
+{
+	if (data.empty())
+	{
+		WriteLog("TransmissionTask::Start - 数据为空，无法开始传输");
+		return false;
+	}
+
+	return Start(std::unique_ptr<ITransmissionSource>(new MemoryTransmissionSource(data)));
+}
+
+bool TransmissionTask::Start(std::unique_ptr<ITransmissionSource> source)
 {
 	std::lock_guard<std::mutex> lock(m_stateMutex);
 
@@ -52,9 +69,9 @@ bool TransmissionTask::Start(const std::vector<uint8_t>& data)
 		return false;
 	}
 
-	if (data.empty())
+	if (!source)
 	{
-		WriteLog("TransmissionTask::Start - 数据为空，无法开始传输");
+		WriteLog("TransmissionTask::Start - 数据源为空，无法开始传输");
 		return false;
 	}
 
@@ -64,16 +81,23 @@ bool TransmissionTask::Start(const std::vector<uint8_t>& data)
 		return false;
 	}
 
-	// 保存数据和初始化状态
-	m_data = data;
-	m_totalBytes = data.size();
+	if (!source->Open())
+	{
+		WriteLog("TransmissionTask::Start - 无法打开数据源: " + source->GetDescription());
+		return false;
+	}
+
+	// 保存数据源和初始化状态，数据在工作线程中按块读取
+	m_source = std::move(source);
+	m_totalBytes = m_source->GetTotalSize();
 	m_bytesTransmitted = 0;
 	m_state = TransmissionTaskState::Running;
 	m_startTime = std::chrono::steady_clock::now();
 	m_lastProgressUpdate = m_startTime;
 
-	WriteLog("TransmissionTask::Start - 开始传输任务，数据大小: " + std::to_string(m_totalBytes) +
-		" 字节，传输通道: " + GetTransportDescription());
+	WriteLog("TransmissionTask::Start - 开始传输任务，数据源: " + m_source->GetDescription() +
+		"，数据大小: " + (m_totalBytes > 0 ? std::to_string(m_totalBytes) + " 字节" : std::string("未知")) +
+		"，传输通道: " + GetTransportDescription());
 
 	// 启动后台工作线程
 	m_workerThread = std::make_unique<std::thread>(&TransmissionTask::ExecuteTransmission, this);
@@ -146,6 +170,14 @@ void TransmissionTask::Stop()
 	// 检查Cancelled状态并自行结束，然后调用ReportCompletion通知UI
 }
 
+void TransmissionTask::Join()
+{
+	if (m_workerThread && m_workerThread->joinable() && m_workerThread->get_id() != std::this_thread::get_id())
+	{
+		m_workerThread->join();
+	}
+}
+
 TransmissionTaskState TransmissionTask::GetState() const
 {
 	return m_state.load();
@@ -153,7 +185,7 @@ TransmissionTaskState TransmissionTask::GetState() const
 
 TransmissionProgress TransmissionTask::GetProgress() const
 {
-	size_t transmitted = m_bytesTransmitted.load();
+	uint64_t transmitted = m_bytesTransmitted.load();
 	TransmissionTaskState currentState = m_state.load();
 
 	std::string status;
@@ -211,12 +243,33 @@ void TransmissionTask::SetLogCallback(LogCallback callback)
 
 void TransmissionTask::SetChunkSize(size_t chunkSize)
 {
-	if (chunkSize > 0 && chunkSize <= 64 * 1024) // 限制在64KB以内
+	if (chunkSize > 0 && chunkSize <= MAX_CHUNK_SIZE) // 限制在64KB以内
 	{
 		m_chunkSize = chunkSize;
 	}
 }
 
+void TransmissionTask::SetPipelineDepth(size_t depth)
+{
+	if (depth > 0 && depth <= MAX_PIPELINE_DEPTH)
+	{
+		m_pipelineDepth = depth;
+	}
+}
+
+void TransmissionTask::SetAdaptiveChunkSize(bool enable)
+{
+	m_adaptiveChunkSize = enable;
+}
+
+void TransmissionTask::SetWriteTimeout(DWORD writeTimeoutMs)
+{
+	if (writeTimeoutMs > 0)
+	{
+		m_writeTimeoutMs = writeTimeoutMs;
+	}
+}
+
 void TransmissionTask::SetRetrySettings(int maxRetries, int retryDelayMs)
 {
 	m_maxRetries = (maxRetries > 0) ? maxRetries : 0;
@@ -232,12 +285,32 @@ void TransmissionTask::ExecuteTransmission()
 {
 	WriteLog("TransmissionTask::ExecuteTransmission - 后台传输线程开始");
 
+	if (m_pipelineDepth > 1)
+	{
+		ExecutePipelinedTransmission();
+	}
+	else
+	{
+		ExecuteSequentialTransmission();
+	}
+
+	WriteLog("TransmissionTask::ExecuteTransmission - 后台传输线程结束");
+}
+
+void TransmissionTask::ExecuteSequentialTransmission()
+{
 	try
 	{
-		size_t totalSent = 0;
-		const size_t dataSize = m_data.size();
+		uint64_t totalSent = 0;
+		const uint64_t totalBytes = m_totalBytes;
+		const uint64_t totalChunks = (totalBytes + m_chunkSize - 1) / m_chunkSize;
+		uint64_t chunkIndex = 0;
+		bool sourceFinished = false;
+
+		// 只保留一个分块的缓冲，内存占用与数据大小无关
+		m_chunkBuffer.resize(m_chunkSize);
 
-		while (totalSent < dataSize)
+		while (true)
 		{
 			// 检查暂停和取消状态
 			if (!CheckPauseAndCancel())
@@ -246,12 +319,24 @@ void TransmissionTask::ExecuteTransmission()
 				break;
 			}
 
-			// 计算当前块大小
-			size_t currentChunkSize = (m_chunkSize < (dataSize - totalSent)) ? m_chunkSize : (dataSize - totalSent);
+			// 从数据源读取下一块
+			size_t currentChunkSize = m_source->Read(m_chunkBuffer.data(), m_chunkBuffer.size());
+			if (currentChunkSize == 0)
+			{
+				if (m_source->HasFailed())
+				{
+					WriteLog("TransmissionTask::ExecuteTransmission - 读取数据源失败，停止传输");
+					ReportCompletion(TransmissionTaskState::Failed, TransportError::ReadFailed,
+						"读取数据源失败，位置: " + std::to_string(totalSent));
+					return;
+				}
+				sourceFinished = true;
+				break;
+			}
+			chunkIndex++;
 
-			WriteLog("TransmissionTask::ExecuteTransmission - 发送块 " +
-				std::to_string(totalSent / m_chunkSize + 1) +
-				"/" + std::to_string((dataSize + m_chunkSize - 1) / m_chunkSize) +
+			WriteLog("TransmissionTask::ExecuteTransmission - 发送块 " + std::to_string(chunkIndex) +
+				(totalChunks > 0 ? "/" + std::to_string(totalChunks) : std::string()) +
 				"，大小: " + std::to_string(currentChunkSize));
 
 			// 重试发送当前块
@@ -260,7 +345,7 @@ void TransmissionTask::ExecuteTransmission()
 
 			do
 			{
-				chunkError = DoSendChunk(m_data.data() + totalSent, currentChunkSize);
+				chunkError = DoSendChunk(m_chunkBuffer.data(), currentChunkSize);
 
 				if (chunkError == TransportError::Success)
 				{
@@ -297,51 +382,290 @@ void TransmissionTask::ExecuteTransmission()
 			m_bytesTransmitted = totalSent;
 
 			// 定期更新进度（避免过于频繁的UI更新）
-			auto now = std::chrono::steady_clock::now();
-			auto timeSinceLastUpdate = std::chrono::duration_cast<std::chrono::milliseconds>(
-				now - m_lastProgressUpdate).count();
+			ReportProgressThrottled(totalSent, false);
+
+			// 添加小延迟，避免过快发送
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
 
-			if (timeSinceLastUpdate >= m_progressUpdateIntervalMs || totalSent == dataSize)
+		FinishTransmission(sourceFinished, totalSent);
+	}
+	catch (const std::exception& e)
+	{
+		WriteLog("TransmissionTask::ExecuteTransmission - 传输过程中发生异常: " + std::string(e.what()));
+		ReportCompletion(TransmissionTaskState::Failed, TransportError::WriteFailed,
+			"传输异常: " + std::string(e.what()));
+	}
+}
+
+void TransmissionTask::ExecutePipelinedTransmission()
+{
+	// 流水线模式：读取线程把数据源的分块填入空闲缓冲，本线程按顺序连续提交已就绪的缓冲。
+	// 最多m_pipelineDepth个分块提前就绪，读取与写入重叠，块间不再固定休眠，
+	// 写入速度由传输层的阻塞写入与Busy退避决定
+	struct PipelineSlot
+	{
+		std::vector<uint8_t> data;
+		size_t size = 0;
+	};
+
+	const size_t depth = m_pipelineDepth;
+	std::vector<PipelineSlot> slots(depth);
+	std::deque<size_t> freeSlots;
+	std::deque<size_t> readySlots;
+	std::mutex pipelineMutex;
+	std::condition_variable pipelineCondition;
+	bool readerDone = false;      // 数据源已读完或读取失败
+	bool readFailed = false;
+	bool stopReader = false;
+	std::atomic<size_t> targetChunkSize(m_chunkSize);
+
+	const size_t slotCapacity = m_adaptiveChunkSize ? static_cast<size_t>(MAX_CHUNK_SIZE) : m_chunkSize;
+	for (size_t i = 0; i < depth; ++i)
+	{
+		slots[i].data.resize(slotCapacity);
+		freeSlots.push_back(i);
+	}
+
+	std::thread reader([&]()
+	{
+		while (true)
+		{
+			size_t slot = 0;
 			{
-				int progress = static_cast<int>((totalSent * 100) / dataSize);
-				UpdateProgress(totalSent, dataSize,
-					"正在传输: " + std::to_string(totalSent) + "/" + std::to_string(dataSize) +
-					" 字节 (" + std::to_string(progress) + "%)");
-				m_lastProgressUpdate = now;
+				std::unique_lock<std::mutex> lock(pipelineMutex);
+				pipelineCondition.wait(lock, [&]() { return stopReader || !freeSlots.empty(); });
+				if (stopReader)
+				{
+					return;
+				}
+				slot = freeSlots.front();
+				freeSlots.pop_front();
 			}
 
-			// 添加小延迟，避免过快发送
-			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			size_t length = 0;
+			bool failed = false;
+			try
+			{
+				length = m_source->Read(slots[slot].data.data(), (std::min)(targetChunkSize.load(), slotCapacity));
+				failed = (length == 0) && m_source->HasFailed();
+			}
+			catch (...)
+			{
+				length = 0;
+				failed = true;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(pipelineMutex);
+				if (length == 0)
+				{
+					readerDone = true;
+					readFailed = failed;
+				}
+				else
+				{
+					slots[slot].size = length;
+					readySlots.push_back(slot);
+				}
+			}
+			pipelineCondition.notify_all();
+
+			if (length == 0)
+			{
+				return;
+			}
 		}
+	});
+
+	uint64_t totalSent = 0;
+	bool sourceFinished = false;
+	bool sourceFailed = false;
+	TransportError sendError = TransportError::Success;
+	std::string exceptionMessage;
+	const auto pipelineStart = std::chrono::steady_clock::now();
 
-		// 检查最终状态
-		if (m_state.load() == TransmissionTaskState::Cancelled)
+	try
+	{
+		while (CheckPauseAndCancel())
 		{
-			WriteLog("TransmissionTask::ExecuteTransmission - 传输被用户取消");
-			ReportCompletion(TransmissionTaskState::Cancelled, TransportError::WriteFailed, "用户取消传输");
+			size_t slot = 0;
+			{
+				std::unique_lock<std::mutex> lock(pipelineMutex);
+				pipelineCondition.wait(lock, [&]() { return !readySlots.empty() || readerDone; });
+				if (readySlots.empty())
+				{
+					sourceFinished = !readFailed;
+					sourceFailed = readFailed;
+					break;
+				}
+				slot = readySlots.front();
+				readySlots.pop_front();
+			}
+
+			const size_t chunkSize = slots[slot].size;
+			auto writeStart = std::chrono::steady_clock::now();
+			sendError = SendChunkWithBackoff(slots[slot].data.data(), chunkSize);
+			if (sendError != TransportError::Success)
+			{
+				break;
+			}
+			auto writeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - writeStart).count();
+
+			{
+				std::lock_guard<std::mutex> lock(pipelineMutex);
+				freeSlots.push_back(slot);
+			}
+			pipelineCondition.notify_all();
+
+			totalSent += chunkSize;
+			m_bytesTransmitted = totalSent;
+
+			// 写入很快说明每块的固定开销占主导，加大分块；写入变慢（含Busy退避）则缩小，
+			// 保证暂停、取消与进度更新的响应，但不小于SetChunkSize设定值。
+			// 加倍前按累计吞吐量估算新分块的写入耗时，超过写超时的一半则不再增长，避免慢速链路写超时
+			if (m_adaptiveChunkSize)
+			{
+				size_t target = targetChunkSize.load();
+				uint64_t elapsedMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+					std::chrono::steady_clock::now() - pipelineStart).count());
+				bool withinTimeout = static_cast<uint64_t>(target) * 2 * elapsedMs <=
+					totalSent * (m_writeTimeoutMs / 2);
+				if (writeMs < ADAPTIVE_GROW_LATENCY_MS && chunkSize >= target && target < MAX_CHUNK_SIZE && withinTimeout)
+				{
+					targetChunkSize = (std::min)(target * 2, static_cast<size_t>(MAX_CHUNK_SIZE));
+				}
+				else if (writeMs > ADAPTIVE_SHRINK_LATENCY_MS && target > m_chunkSize)
+				{
+					targetChunkSize = (std::max)(target / 2, m_chunkSize);
+				}
+			}
+
+			ReportProgressThrottled(totalSent, false);
 		}
-		else if (totalSent == dataSize)
+	}
+	catch (const std::exception& e)
+	{
+		exceptionMessage = e.what();
+	}
+
+	// 停止读取线程；阻塞在数据源读取中的线程需等待本次读取返回
+	{
+		std::lock_guard<std::mutex> lock(pipelineMutex);
+		stopReader = true;
+	}
+	pipelineCondition.notify_all();
+	reader.join();
+
+	if (!exceptionMessage.empty())
+	{
+		WriteLog("TransmissionTask::ExecutePipelinedTransmission - 传输过程中发生异常: " + exceptionMessage);
+		ReportCompletion(TransmissionTaskState::Failed, TransportError::WriteFailed, "传输异常: " + exceptionMessage);
+		return;
+	}
+
+	if (sourceFailed)
+	{
+		WriteLog("TransmissionTask::ExecutePipelinedTransmission - 读取数据源失败，停止传输");
+		ReportCompletion(TransmissionTaskState::Failed, TransportError::ReadFailed,
+			"读取数据源失败，位置: " + std::to_string(totalSent));
+		return;
+	}
+
+	if (sendError != TransportError::Success && m_state.load() != TransmissionTaskState::Cancelled)
+	{
+		WriteLog("TransmissionTask::ExecutePipelinedTransmission - 块发送失败，错误码: " +
+			std::to_string(static_cast<int>(sendError)));
+		ReportCompletion(TransmissionTaskState::Failed, sendError,
+			"数据块发送失败，位置: " + std::to_string(totalSent));
+		return;
+	}
+
+	WriteLog("TransmissionTask::ExecutePipelinedTransmission - 最终分块大小: " + std::to_string(targetChunkSize.load()));
+	FinishTransmission(sourceFinished, totalSent);
+}
+
+TransportError TransmissionTask::SendChunkWithBackoff(const uint8_t* data, size_t size)
+{
+	// 传输忙时：传输层写队列超过高水位则等待其恢复可写，否则从1ms开始指数退避（单次不超过m_retryDelayMs），
+	// 总等待与逐块模式的重试策略相同（m_maxRetries * m_retryDelayMs）
+	const int waitBudgetMs = m_maxRetries * m_retryDelayMs;
+	int waitedMs = 0;
+	int delayMs = 1;
+
+	while (true)
+	{
+		TransportError error = DoSendChunk(data, size);
+		if (error != TransportError::Busy || waitedMs >= waitBudgetMs ||
+			m_state.load() == TransmissionTaskState::Cancelled)
 		{
-			WriteLog("TransmissionTask::ExecuteTransmission - 传输成功完成");
-			ReportCompletion(TransmissionTaskState::Completed, TransportError::Success);
+			return error;
 		}
-		else
+
+		if (IsTransportBlocked())
 		{
-			WriteLog("TransmissionTask::ExecuteTransmission - 传输未完成，数据不完整");
-			ReportCompletion(TransmissionTaskState::Failed, TransportError::WriteFailed, "数据传输不完整");
+			auto waitStart = std::chrono::steady_clock::now();
+			WaitTransportWritable(static_cast<DWORD>(waitBudgetMs - waitedMs));
+			int elapsedMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - waitStart).count());
+			waitedMs += (std::max)(elapsedMs, 1);
+			continue;
 		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+		waitedMs += delayMs;
+		delayMs = (std::min)(delayMs * 2, m_retryDelayMs);
 	}
-	catch (const std::exception& e)
+}
+
+void TransmissionTask::ReportProgressThrottled(uint64_t totalSent, bool force)
+{
+	auto now = std::chrono::steady_clock::now();
+	auto timeSinceLastUpdate = std::chrono::duration_cast<std::chrono::milliseconds>(
+		now - m_lastProgressUpdate).count();
+
+	if (!force && timeSinceLastUpdate < m_progressUpdateIntervalMs && totalSent != m_totalBytes)
 	{
-		WriteLog("TransmissionTask::ExecuteTransmission - 传输过程中发生异常: " + std::string(e.what()));
-		ReportCompletion(TransmissionTaskState::Failed, TransportError::WriteFailed,
-			"传输异常: " + std::string(e.what()));
+		return;
 	}
 
-	WriteLog("TransmissionTask::ExecuteTransmission - 后台传输线程结束");
+	if (m_totalBytes > 0)
+	{
+		int progress = static_cast<int>((totalSent * 100) / m_totalBytes);
+		UpdateProgress(totalSent, m_totalBytes,
+			"正在传输: " + std::to_string(totalSent) + "/" + std::to_string(m_totalBytes) +
+			" 字节 (" + std::to_string(progress) + "%)");
+	}
+	else
+	{
+		UpdateProgress(totalSent, 0, "正在传输: " + std::to_string(totalSent) + " 字节");
+	}
+	m_lastProgressUpdate = now;
+}
+
+void TransmissionTask::FinishTransmission(bool sourceFinished, uint64_t totalSent)
+{
+	// 检查最终状态
+	if (m_state.load() == TransmissionTaskState::Cancelled)
+	{
+		WriteLog("TransmissionTask::ExecuteTransmission - 传输被用户取消");
+		ReportCompletion(TransmissionTaskState::Cancelled, TransportError::WriteFailed, "用户取消传输");
+	}
+	else if (sourceFinished && (m_totalBytes == 0 || totalSent == m_totalBytes))
+	{
+		WriteLog("TransmissionTask::ExecuteTransmission - 传输成功完成");
+		ReportCompletion(TransmissionTaskState::Completed, TransportError::Success);
+	}
+	else
+	{
+		// 数据源提前结束（如文件在传输中被截断）
+		WriteLog("TransmissionTask::ExecuteTransmission - 传输未完成，数据不完整");
+		ReportCompletion(TransmissionTaskState::Failed, TransportError::WriteFailed, "数据传输不完整");
+	}
 }
 
-void TransmissionTask::UpdateProgress(size_t transmitted, size_t total, const std::string& status)
+void TransmissionTask::UpdateProgress(uint64_t transmitted, uint64_t total, const std::string& status)
 {
 	// 【第九轮修复】添加异常保护，防止进度回调崩溃
 	try {
@@ -364,6 +688,10 @@ void TransmissionTask::ReportCompletion(TransmissionTaskState finalState, Transp
 {
 	m_state = finalState;
 
+	// 传输结束即释放数据源（关闭文件/映射）与分块缓冲
+	m_source.reset();
+	std::vector<uint8_t>().swap(m_chunkBuffer);
+
 	// 【修复】安全调用完成回调，防止在析构过程中访问无效对象
 	try {
 		if (m_completionCallback)
@@ -427,6 +755,121 @@ bool TransmissionTask::CheckPauseAndCancel()
 	}
 }
 
+// ==================== 传输数据源 ====================
+
+MemoryTransmissionSource::MemoryTransmissionSource(std::vector<uint8_t> data)
+	: m_data(std::move(data))
+	, m_position(0)
+{
+}
+
+bool MemoryTransmissionSource::Open()
+{
+	m_position = 0;
+	return !m_data.empty();
+}
+
+size_t MemoryTransmissionSource::Read(uint8_t* buffer, size_t size)
+{
+	size_t length = (std::min)(size, m_data.size() - m_position);
+	if (length > 0)
+	{
+		memcpy(buffer, m_data.data() + m_position, length);
+		m_position += length;
+	}
+	return length;
+}
+
+FileTransmissionSource::FileTransmissionSource(const std::string& filePath)
+	: m_filePath(filePath)
+{
+}
+
+FileTransmissionSource::FileTransmissionSource(const std::wstring& filePath)
+	: m_filePath(CW2A(filePath.c_str(), CP_UTF8))
+	, m_widePath(filePath)
+{
+}
+
+bool FileTransmissionSource::Open()
+{
+	return m_widePath.empty() ? m_file.Open(m_filePath) : m_file.Open(m_widePath);
+}
+
+size_t FileTransmissionSource::Read(uint8_t* buffer, size_t size)
+{
+	return m_file.Read(buffer, size);
+}
+
+uint64_t FileTransmissionSource::GetTotalSize() const
+{
+	return static_cast<uint64_t>(m_file.GetSize());
+}
+
+std::string FileTransmissionSource::GetDescription() const
+{
+	return "文件: " + m_filePath + (m_file.IsMapped() ? "（内存映射）" : "");
+}
+
+GeneratorTransmissionSource::GeneratorTransmissionSource(Generator generator, uint64_t totalSize)
+	: m_generator(std::move(generator))
+	, m_totalSize(totalSize)
+	, m_failed(false)
+{
+}
+
+size_t GeneratorTransmissionSource::Read(uint8_t* buffer, size_t size)
+{
+	if (m_failed)
+	{
+		return 0;
+	}
+
+	size_t length = m_generator(buffer, size);
+	if (length == GENERATOR_ERROR || length > size)
+	{
+		m_failed = true;
+		return 0;
+	}
+	return length;
+}
+
+PipeTransmissionSource::PipeTransmissionSource(HANDLE pipe, bool closeOnDestroy)
+	: m_pipe(pipe)
+	, m_closeOnDestroy(closeOnDestroy)
+	, m_failed(false)
+{
+}
+
+PipeTransmissionSource::~PipeTransmissionSource()
+{
+	if (m_closeOnDestroy && m_pipe != INVALID_HANDLE_VALUE && m_pipe != nullptr)
+	{
+		CloseHandle(m_pipe);
+	}
+}
+
+size_t PipeTransmissionSource::Read(uint8_t* buffer, size_t size)
+{
+	if (m_failed)
+	{
+		return 0;
+	}
+
+	DWORD bytesRead = 0;
+	DWORD request = static_cast<DWORD>((std::min)(size, static_cast<size_t>(MAXDWORD)));
+	if (!ReadFile(m_pipe, buffer, request, &bytesRead, nullptr))
+	{
+		// 写端关闭表示数据结束，其余错误视为读取失败
+		if (GetLastError() != ERROR_BROKEN_PIPE)
+		{
+			m_failed = true;
+		}
+		return 0;
+	}
+	return bytesRead;
+}
+
 // 【P1修复】可靠传输任务实现类
 
 ReliableTransmissionTask::ReliableTransmissionTask(std::shared_ptr<ReliableChannel> reliableChannel)
@@ -488,4 +931,17 @@ bool RawTransmissionTask::IsTransportReady() const
 std::string RawTransmissionTask::GetTransportDescription() const
 {
 	return "原始传输通道";
+}
+
+bool RawTransmissionTask::IsTransportBlocked() const
+{
+	return m_transport && !m_transport->IsWritable();
+}
+
+void RawTransmissionTask::WaitTransportWritable(DWORD timeoutMs)
+{
+	if (m_transport)
+	{
+		m_transport->WaitWritable(timeoutMs);
+	}
 }
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include <functional>
 #include <chrono>
 #include "../Protocol/ReliableChannel.h"
+#include "../Protocol/FileSource.h"
 #include "../Transport/ITransport.h"
 
 // 传输任务状态枚举
@@ -25,8 +26,8 @@ enum class TransmissionTaskState
 // 传输进度信息
 struct TransmissionProgress
 {
-	size_t bytesTransmitted; // 已传输字节数
-	size_t totalBytes;       // 总字节数
+	uint64_t bytesTransmitted; // 已传输字节数
+	uint64_t totalBytes;       // 总字节数（0表示数据源长度未知）
 	int progressPercent;     // 进度百分比
 	std::string statusText;  // 状态文本
 	std::chrono::steady_clock::time_point timestamp; // 时间戳
@@ -36,7 +37,7 @@ struct TransmissionProgress
 		, timestamp(std::chrono::steady_clock::now()) {
 	}
 
-	TransmissionProgress(size_t transmitted, size_t total, const std::string& status)
+	TransmissionProgress(uint64_t transmitted, uint64_t total, const std::string& status)
 		: bytesTransmitted(transmitted), totalBytes(total), statusText(status)
 		, timestamp(std::chrono::steady_clock::now())
 	{
@@ -49,7 +50,7 @@ struct TransmissionResult
 {
 	TransmissionTaskState finalState;
 	TransportError errorCode;
-	size_t bytesTransmitted;
+	uint64_t bytesTransmitted;
 	std::string errorMessage;
 	std::chrono::milliseconds duration;
 
@@ -61,6 +62,106 @@ struct TransmissionResult
 	}
 };
 
+// 传输数据源：任务按需拉取分块，只持有一个分块大小的缓冲区，数据不必整体载入内存
+// Read()在任务的工作线程中调用；阻塞的Read()（如等待管道写端）期间暂停与取消要等其返回后生效。
+class ITransmissionSource
+{
+public:
+	virtual ~ITransmissionSource() = default;
+
+	// 准备读取，在Start()中调用；返回false时任务不启动
+	virtual bool Open() = 0;
+	// 读取最多size字节，返回0表示数据已结束；出错时返回0且HasFailed()为true
+	virtual size_t Read(uint8_t* buffer, size_t size) = 0;
+	// 总字节数，未知时（生成器、管道）返回0
+	virtual uint64_t GetTotalSize() const = 0;
+	virtual bool HasFailed() const = 0;
+	virtual std::string GetDescription() const = 0;
+};
+
+// 内存数据源（兼容Start(const std::vector<uint8_t>&)）
+class MemoryTransmissionSource : public ITransmissionSource
+{
+public:
+	explicit MemoryTransmissionSource(std::vector<uint8_t> data);
+
+	bool Open() override;
+	size_t Read(uint8_t* buffer, size_t size) override;
+	uint64_t GetTotalSize() const override { return m_data.size(); }
+	bool HasFailed() const override { return false; }
+	std::string GetDescription() const override { return "内存数据"; }
+
+private:
+	std::vector<uint8_t> m_data;
+	size_t m_position;
+};
+
+// 文件数据源：由FileSource读取，优先内存映射（视图按64MB滑动），映射失败时退化为流式ReadFile
+// 内存占用与文件大小无关，32位进程也可发送超过地址空间的文件。
+class FileTransmissionSource : public ITransmissionSource
+{
+public:
+	explicit FileTransmissionSource(const std::string& filePath);
+	explicit FileTransmissionSource(const std::wstring& filePath); // 宽字符路径（界面选择的文件）
+
+	bool Open() override;
+	size_t Read(uint8_t* buffer, size_t size) override;
+	uint64_t GetTotalSize() const override;
+	bool HasFailed() const override { return m_file.HasFailed(); }
+	std::string GetDescription() const override;
+
+private:
+	std::string m_filePath;   // 描述用（宽字符路径转为UTF-8）
+	std::wstring m_widePath;  // 非空时按宽字符路径打开
+	FileSource m_file;
+};
+
+// 生成器数据源：回调向buffer写入最多size字节并返回写入数，返回0表示结束，返回GENERATOR_ERROR表示出错
+class GeneratorTransmissionSource : public ITransmissionSource
+{
+public:
+	static const size_t GENERATOR_ERROR = static_cast<size_t>(-1);
+	using Generator = std::function<size_t(uint8_t* buffer, size_t size)>;
+
+public:
+	// totalSize仅用于进度显示，0表示未知
+	explicit GeneratorTransmissionSource(Generator generator, uint64_t totalSize = 0);
+
+	bool Open() override { return static_cast<bool>(m_generator); }
+	size_t Read(uint8_t* buffer, size_t size) override;
+	uint64_t GetTotalSize() const override { return m_totalSize; }
+	bool HasFailed() const override { return m_failed; }
+	std::string GetDescription() const override { return "生成器数据"; }
+
+private:
+	Generator m_generator;
+	uint64_t m_totalSize;
+	bool m_failed;
+};
+
+// 管道数据源：从管道（或任意可ReadFile的句柄）读取，写端关闭即数据结束
+class PipeTransmissionSource : public ITransmissionSource
+{
+public:
+	// closeOnDestroy为true时析构时关闭句柄
+	PipeTransmissionSource(HANDLE pipe, bool closeOnDestroy);
+	~PipeTransmissionSource() override;
+
+	PipeTransmissionSource(const PipeTransmissionSource&) = delete;
+	PipeTransmissionSource& operator=(const PipeTransmissionSource&) = delete;
+
+	bool Open() override { return m_pipe != INVALID_HANDLE_VALUE && m_pipe != nullptr; }
+	size_t Read(uint8_t* buffer, size_t size) override;
+	uint64_t GetTotalSize() const override { return 0; }
+	bool HasFailed() const override { return m_failed; }
+	std::string GetDescription() const override { return "管道数据"; }
+
+private:
+	HANDLE m_pipe;
+	bool m_closeOnDestroy;
+	bool m_failed;
+};
+
 // 【P1修复】传输任务抽象类 - 实现UI与传输任务解耦
 class TransmissionTask
 {
@@ -80,10 +181,13 @@ public:
 
 	// 核心控制接口
 	bool Start(const std::vector<uint8_t>& data);
+	bool Start(std::unique_ptr<ITransmissionSource> source); // 从数据源按需读取，不整体载入内存
 	void Pause();
 	void Resume();
 	void Cancel();
 	void Stop();
+	// 等待工作线程退出（任务结束后由非UI线程回收线程用，不得在回调中调用）
+	void Join();
 
 	// 状态查询接口
 	TransmissionTaskState GetState() const;
@@ -102,6 +206,15 @@ public:
 	void SetChunkSize(size_t chunkSize);
 	void SetRetrySettings(int maxRetries, int retryDelayMs);
 	void SetProgressUpdateInterval(int intervalMs);
+	// 流水线深度：读取线程最多提前准备的分块数；默认1为逐块读取-发送（保留原有10ms发送间隔）
+	void SetPipelineDepth(size_t depth);
+	// 自适应分块：按写入耗时在SetChunkSize设定值与MAX_CHUNK_SIZE之间调整（仅流水线模式，默认关闭）
+	void SetAdaptiveChunkSize(bool enable);
+	// 传输层写超时：自适应分块按实测吞吐量限制单块写入耗时不超过其一半
+	void SetWriteTimeout(DWORD writeTimeoutMs);
+
+	static const size_t MAX_CHUNK_SIZE = 64 * 1024;
+	static const size_t MAX_PIPELINE_DEPTH = 16;
 
 protected:
 	// 抽象方法 - 由具体实现类重写
@@ -109,12 +222,21 @@ protected:
 	virtual bool IsTransportReady() const = 0;
 	virtual std::string GetTransportDescription() const = 0;
 
+	// 传输层写入背压：返回Busy且不可写时等待恢复可写，而不是退避休眠（默认不支持）
+	virtual bool IsTransportBlocked() const { return false; }
+	virtual void WaitTransportWritable(DWORD timeoutMs) {}
+
 private:
 	// 后台线程主函数
 	void ExecuteTransmission();
+	void ExecuteSequentialTransmission();
+	void ExecutePipelinedTransmission();
 
 	// 内部辅助方法
-	void UpdateProgress(size_t transmitted, size_t total, const std::string& status);
+	TransportError SendChunkWithBackoff(const uint8_t* data, size_t size);
+	void ReportProgressThrottled(uint64_t totalSent, bool force);
+	void FinishTransmission(bool sourceFinished, uint64_t totalSent);
+	void UpdateProgress(uint64_t transmitted, uint64_t total, const std::string& status);
 	void ReportCompletion(TransmissionTaskState finalState, TransportError errorCode, const std::string& errorMsg = "");
 	void WriteLog(const std::string& message);
 	bool CheckPauseAndCancel();
@@ -125,9 +247,10 @@ private:
 	mutable std::mutex m_stateMutex;
 
 	// 数据管理
-	std::vector<uint8_t> m_data;
-	size_t m_totalBytes;
-	std::atomic<size_t> m_bytesTransmitted;
+	std::unique_ptr<ITransmissionSource> m_source;
+	std::vector<uint8_t> m_chunkBuffer;    // 当前分块（逐块模式下工作线程独占）
+	uint64_t m_totalBytes;                 // 0表示数据源长度未知
+	std::atomic<uint64_t> m_bytesTransmitted;
 
 	// 线程管理
 	std::unique_ptr<std::thread> m_workerThread;
@@ -137,6 +260,13 @@ private:
 	int m_maxRetries;
 	int m_retryDelayMs;
 	int m_progressUpdateIntervalMs;
+	size_t m_pipelineDepth;
+	bool m_adaptiveChunkSize;
+	DWORD m_writeTimeoutMs;
+
+	// 自适应分块阈值：单块写入快于GROW则加倍，慢于SHRINK则减半
+	static const int ADAPTIVE_GROW_LATENCY_MS = 5;
+	static const int ADAPTIVE_SHRINK_LATENCY_MS = 50;
 
 	// 回调函数
 	ProgressCallback m_progressCallback;
@@ -175,6 +305,8 @@ protected:
 	TransportError DoSendChunk(const uint8_t* data, size_t size) override;
 	bool IsTransportReady() const override;
 	std::string GetTransportDescription() const override;
+	bool IsTransportBlocked() const override;
+	void WaitTransportWritable(DWORD timeoutMs) override;
 
 private:
 	std::shared_ptr<ITransport> m_transport;